@@ -5,6 +5,7 @@
 #include "common/timer.h"
 #include "navigation/image_database.h"
 #include "navigation/infomax.h"
+#include "navigation/infomax_quantised.h"
 
 // Third-party includes
 #include "third_party/matplotlibcpp.h"
@@ -36,7 +37,8 @@ using namespace units::math;
 using FloatType = float;
 using InfoMaxType = InfoMaxRotater<InSilicoRotater, FloatType>;
 
-void doTesting(const InfoMaxType &infomax, const std::vector<double> &allx,
+template<class InfoMaxT>
+void doTesting(const InfoMaxT &infomax, const std::vector<double> &allx,
                  const std::vector<double> &ally, const std::vector<cv::Mat> &images)
 {
     std::vector<double> x, y, u, v;
@@ -117,6 +119,9 @@ main(int argc, char **argv)
 
         InfoMaxType infomax(imSize, weights);
         doTesting(infomax, x, y, images);
+
+        // Compare with int8 weights, which use a quarter of the memory
+        doTesting(InfoMaxQuantised<>(infomax), x, y, images);
     } else {
         // ...otherwise do the training now
         InfoMaxType infomax(imSize);
@@ -143,6 +148,7 @@ main(int argc, char **argv)
         }
 
         doTesting(infomax, x, y, images);
+        doTesting(InfoMaxQuantised<>(infomax), x, y, images);
     }
 
     return 0;
@@ -1,7 +1,11 @@
 // BoB robotics includes
 #include "common/logging.h"
+#include "common/thread_pool.h"
 #include "common/timer.h"
+#include "navigation/insilico_view_rotater.h"
 #include "navigation/perfect_memory.h"
+#include "navigation/perfect_memory_hierarchical.h"
+#include "navigation/perfect_memory_store_compact.h"
 #include "navigation/perfect_memory_store_raw.h"
 #include "navigation/perfect_memory_store_hog.h"
 
@@ -47,6 +51,45 @@ main()
         LOGI << "Difference score: " << difference;
     }
 
+    {
+        LOGI << "Testing with best-matching snapshot method on multiple threads...";
+
+        PerfectMemoryRotater<> pm(imSize);
+        pm.setNumThreads(ThreadPool::getDefaultNumThreads());
+        trainRoute(pm);
+
+        // Time testing phase
+        Timer<> t{ "Time taken for testing: " };
+
+        // Treat snapshot #10 as test data
+        const auto snap = pm.getSnapshot(10);
+        size_t snapshot;
+        float difference;
+        std::tie(heading, snapshot, difference, allDifferences) = pm.getHeading(snap);
+        LOGI << "Heading: " << heading;
+        LOGI << "Best-matching snapshot: #" << snapshot;
+        LOGI << "Difference score: " << difference;
+    }
+
+    {
+        LOGI << "Testing with best-matching snapshot method without copying rotated images...";
+
+        PerfectMemoryRotater<PerfectMemoryStore::RawImage<>, BestMatchingSnapshot, InSilicoViewRotater> pm(imSize);
+        trainRoute(pm);
+
+        // Time testing phase
+        Timer<> t{ "Time taken for testing: " };
+
+        // Treat snapshot #10 as test data
+        const auto snap = pm.getSnapshot(10);
+        size_t snapshot;
+        float difference;
+        std::tie(heading, snapshot, difference, allDifferences) = pm.getHeading(snap);
+        LOGI << "Heading: " << heading;
+        LOGI << "Best-matching snapshot: #" << snapshot;
+        LOGI << "Difference score: " << difference;
+    }
+
     {
         LOGI << "Testing with best-matching snapshot method with partial rotation...";
 
@@ -88,6 +131,24 @@ main()
         LOGI << "Difference score: " << difference;
     }
 
+    {
+        LOGI << "Testing with snapshots stored contiguously at 4 bits per pixel...";
+        PerfectMemoryRotater<PerfectMemoryStore::CompactImage<>> pm(imSize, true);
+        trainRoute(pm);
+
+        // Time testing phase
+        Timer<> t{ "Time taken for testing: " };
+
+        // Treat snapshot #10 as test data
+        const cv::Mat snap = pm.getSnapshot(10).clone();
+        size_t snapshot;
+        float difference;
+        std::tie(heading, snapshot, difference, allDifferences) = pm.getHeading(snap);
+        LOGI << "Heading: " << heading;
+        LOGI << "Best-matching snapshot: #" << snapshot;
+        LOGI << "Difference score: " << difference;
+    }
+
     {
         constexpr size_t numComp = 3;
         LOGI <<  "Testing with " << numComp << " weighted snapshots...";
@@ -108,6 +169,24 @@ main()
         }
     }
 
+    {
+        LOGI << "Testing with coarse-to-fine search...";
+        PerfectMemoryHierarchical<> pm(imSize, 3);
+        trainRoute(pm);
+
+        // Time testing phase
+        Timer<> t{ "Time taken for testing: " };
+
+        // Treat snapshot #10 as test data
+        const auto snap = pm.getSnapshot(10);
+        size_t snapshot;
+        float difference;
+        std::tie(heading, snapshot, difference) = pm.getHeading(snap);
+        LOGI << "Heading: " << heading;
+        LOGI << "Best-matching snapshot: #" << snapshot;
+        LOGI << "Difference score: " << difference;
+    }
+
     {
         LOGI << "Testing with HOG...";
 
@@ -38,8 +38,10 @@ main(int, char **)
 
     auto window = AntWorld::AntAgent::initialiseWindow(RenderSize);
 
-    // Create renderer
-    AntWorld::Renderer renderer(256, 0.001, 1000.0, 360_deg);
+    // Create renderer, rendering greyscale cubemaps in a single pass if possible, as we only use greyscale views
+    const auto cubemapMode = GLEW_VERSION_3_3 ? AntWorld::Renderer::CubemapMode::LayeredGreyscale
+                                              : AntWorld::Renderer::CubemapMode::Colour;
+    AntWorld::Renderer renderer(256, 0.001, 1000.0, 360_deg, 75_deg, cubemapMode);
     renderer.getWorld().load(Path::getResourcesPath() / "antworld" / "world5000_gray.bin",
                              {0.0f, 1.0f, 0.0f}, {0.898f, 0.718f, 0.353f});
 
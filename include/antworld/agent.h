@@ -1,6 +1,7 @@
 #pragma once
 
 // BoB robotics includes
+#include "batch_renderer.h"
 #include "camera.h"
 #include "common/pose.h"
 #include "hid/joystick.h"
@@ -8,6 +9,7 @@
 #include "robots/robot.h"
 
 // Standard C++ includes
+#include <memory>
 #include <mutex>
 
 namespace BoBRobotics {
@@ -66,10 +68,14 @@ public:
 
     void updatePose(const units::time::second_t elapsedTime);
 
+    //! Get a renderer for rendering many of this agent's views at once (created the first time it's needed)
+    BatchRenderer &getBatchRenderer();
+
 private:
     meters_per_second_t m_Velocity;
     radians_per_second_t m_TurnSpeed;
     std::mutex m_PoseMutex;
+    std::unique_ptr<BatchRenderer> m_BatchRenderer;
     float m_JoystickX = 0.f, m_JoystickY = 0.f;
 
     enum class MoveMode
@@ -0,0 +1,104 @@
+#pragma once
+
+// BoB robotics includes
+#include "common/pose.h"
+
+// Antworld includes
+#include "render_target.h"
+#include "renderer.h"
+
+// OpenCV includes
+#include <opencv2/opencv.hpp>
+
+// OpenGL includes
+#include <GL/glew.h>
+
+// Standard C++ includes
+#include <array>
+#include <functional>
+#include <vector>
+
+namespace BoBRobotics
+{
+namespace AntWorld
+{
+//----------------------------------------------------------------------------
+// BoBRobotics::AntWorld::BatchRenderer
+//----------------------------------------------------------------------------
+/*!
+ * \brief Renders panoramic views from many poses at once, e.g. for building
+ *        image databases or rotating an agent on the spot
+ *
+ * Rendering one view at a time with Camera means waiting for each frame to be
+ * displayed and read back before the next can be rendered. Instead, this
+ * renders a batch of views into tiles of an offscreen RenderTarget and reads
+ * the whole batch back asynchronously into a pixel buffer object, so the GPU
+ * can render the next batch while the previous one is copied out.
+ */
+class BatchRenderer
+{
+    using degree_t = units::angle::degree_t;
+    using meter_t = units::length::meter_t;
+
+public:
+    using Pose = Pose3<meter_t, degree_t>;
+
+    //! Called with the index of each pose and its view, in order
+    using FrameHandler = std::function<void(size_t, const cv::Mat &)>;
+
+    /*!
+     * \brief Create a batch renderer which renders views of size frameSize
+     *
+     * At most framesPerBatch views are rendered (and read back) together,
+     * fewer if the tiles wouldn't fit in one texture.
+     */
+    BatchRenderer(Renderer &renderer, const cv::Size &frameSize, size_t framesPerBatch = 16);
+    BatchRenderer(const BatchRenderer &) = delete;
+    void operator=(const BatchRenderer &) = delete;
+    ~BatchRenderer();
+
+    //------------------------------------------------------------------------
+    // Public API
+    //------------------------------------------------------------------------
+    /*!
+     * \brief Render the view from each pose, passing them to handler as they
+     *        are read back
+     *
+     * type can be CV_8UC3, giving BGR frames (as Camera does), or CV_8UC1 for
+     * greyscale. If the renderer renders greyscale cubemaps, greyscale frames
+     * are read back directly, rather than converted from BGR. The frame passed
+     * to handler is reused, so must be copied if it is needed afterwards.
+     */
+    void renderPanoramicViews(const std::vector<Pose> &poses, const FrameHandler &handler, int type = CV_8UC3);
+
+    //! Render the view from each pose, returning all of them
+    std::vector<cv::Mat> renderPanoramicViews(const std::vector<Pose> &poses, int type = CV_8UC3);
+
+    const cv::Size &getFrameSize() const{ return m_FrameSize; }
+    size_t getFramesPerBatch() const{ return m_FramesPerBatch; }
+
+private:
+    //------------------------------------------------------------------------
+    // Private methods
+    //------------------------------------------------------------------------
+    void renderBatch(const std::vector<Pose> &poses, size_t first, size_t count, unsigned int buffer, int readType);
+    void readBatch(size_t first, size_t count, unsigned int buffer, const FrameHandler &handler, int type, int readType);
+
+    //------------------------------------------------------------------------
+    // Members
+    //------------------------------------------------------------------------
+    Renderer &m_Renderer;
+    const cv::Size m_FrameSize;
+    const size_t m_FramesPerBatch;
+
+    //! Target with one frame-sized tile per view, stacked vertically
+    RenderTarget m_RenderTarget;
+
+    //! Two pixel buffers so one batch can be read back while the next is rendered
+    std::array<GLuint, 2> m_PixelBuffers;
+    std::array<GLsync, 2> m_Fences;
+
+    cv::Mat m_Frame, m_GreyscaleFrame;
+};
+}   // namespace AntWorld
+}   // namespace BoBRobotics
@@ -27,6 +27,7 @@ public:
 
     Pose3<meter_t, degree_t> getPose() const;
     sf::Window &getWindow() const;
+    Renderer &getRenderer() const;
     bool isOpen() const;
     void setPose(const Pose3<meter_t, degree_t> &pose);
     void setPosition(meter_t x, meter_t y, meter_t z);
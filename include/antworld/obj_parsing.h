@@ -0,0 +1,77 @@
+#pragma once
+
+// Standard C includes
+#include <cstddef>
+
+// Standard C++ includes
+#include <utility>
+#include <vector>
+
+//----------------------------------------------------------------------------
+// BoBRobotics::AntWorld::ObjParsing
+//----------------------------------------------------------------------------
+/*!
+ * \brief Helpers for parsing obj files directly from memory
+ *
+ * Parsing with std::istringstream (and converting numbers with std::stof etc.)
+ * is slow for files of hundreds of megabytes, so these functions work on
+ * pointers into the text instead. Each takes a pointer to the start of the
+ * text to parse and one to the end of the line, and returns a pointer to the
+ * first character they didn't consume (or nullptr if the text was invalid).
+ * This also allows a file to be split into chunks of lines which are parsed
+ * in parallel.
+ */
+namespace BoBRobotics
+{
+namespace AntWorld
+{
+namespace ObjParsing
+{
+//! A range of text
+using TextRange = std::pair<const char*, const char*>;
+
+//! Skip any spaces or tabs
+const char *skipWhitespace(const char *text, const char *end);
+
+//! Get the first whitespace-delimited token, returning a pointer past it
+const char *readToken(const char *text, const char *end, TextRange &token);
+
+//! Check whether token matches the null-terminated string
+bool tokenEquals(const TextRange &token, const char *string);
+
+//! Parse a decimal number (optionally with an exponent)
+const char *parseFloat(const char *text, const char *end, float &value);
+
+//! Parse a decimal integer, which may be negative
+const char *parseInt(const char *text, const char *end, long &value);
+
+/*!
+ * \brief Split text into at most numChunks chunks of roughly equal size,
+ *        which all end at the end of a line
+ */
+std::vector<TextRange> splitLines(const char *text, const char *end, size_t numChunks);
+
+//! Call func with each line in text, excluding line endings
+template<typename Func>
+void forEachLine(const char *text, const char *end, Func func)
+{
+    while(text < end) {
+        // Find end of line
+        const char *lineEnd = text;
+        while(lineEnd < end && *lineEnd != '\n') {
+            lineEnd++;
+        }
+
+        // Strip windows line endings
+        const char *contentEnd = lineEnd;
+        if(contentEnd > text && contentEnd[-1] == '\r') {
+            contentEnd--;
+        }
+
+        func(text, contentEnd);
+        text = lineEnd + 1;
+    }
+}
+}   // namespace ObjParsing
+}   // namespace AntWorld
+}   // namespace BoBRobotics
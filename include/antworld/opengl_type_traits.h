@@ -34,5 +34,11 @@ struct OpenGLTypeTraits<GLbyte>
     static constexpr GLenum type = GL_UNSIGNED_BYTE;
 };
 
+template<>
+struct OpenGLTypeTraits<GLubyte>
+{
+    static constexpr GLenum type = GL_UNSIGNED_BYTE;
+};
+
 }   // namespace AntWorld
 }   // namespace BoBRobotics
@@ -1,5 +1,8 @@
 #pragma once
 
+// Standard C++ includes
+#include <bitset>
+
 // OpenGL includes
 #include <GL/glew.h>
 #include <GL/glu.h>
@@ -31,18 +34,25 @@ public:
     //------------------------------------------------------------------------
     void render() const;
 
+    //! Get which cubemap faces (in GL_TEXTURE_CUBE_MAP_POSITIVE_X + f order) are sampled by mesh
+    const std::bitset<6> &getCubeFaces() const{ return m_CubeFaces; }
+
 protected:
     RenderMesh()
     {
+        m_CubeFaces.set();
     }
 
     Surface &getSurface(){ return m_Surface; }
 
+    void setCubeFaces(const std::bitset<6> &cubeFaces){ m_CubeFaces = cubeFaces; }
+
 private:
     //-----------------------------------------------------------------------
     // Members
     //------------------------------------------------------------------------
     Surface m_Surface;
+    std::bitset<6> m_CubeFaces;
 };
 
 //----------------------------------------------------------------------------
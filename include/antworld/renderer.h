@@ -32,8 +32,25 @@ class Renderer
     using meter_t = units::length::meter_t;
 
 public:
+    //! How the cubemap which panoramic views are sampled from is rendered
+    enum class CubemapMode
+    {
+        //! Render each cubemap face in a separate pass, in colour
+        Colour,
+
+        /*!
+         * \brief Render all cubemap faces in a single pass, using a geometry shader
+         *        to send each triangle to the faces it covers, into a greyscale cubemap
+         *
+         * Requires OpenGL 3.3 and that renderPanoramicGeometry() only draws triangles.
+         * Only the World's textured surfaces are textured.
+         */
+        LayeredGreyscale,
+    };
+
     Renderer(GLsizei cubemapSize = 256, double nearClip = 0.001, double farClip = 1000.0,
-             degree_t horizontalFOV = 296_deg, degree_t verticalFOV = 75_deg);
+             degree_t horizontalFOV = 296_deg, degree_t verticalFOV = 75_deg,
+             CubemapMode cubemapMode = CubemapMode::Colour);
     virtual ~Renderer();
 
 
@@ -59,6 +76,8 @@ public:
     World &getWorld(){ return m_World; }
     const World &getWorld() const{ return m_World; }
 
+    CubemapMode getCubemapMode() const{ return m_CubemapMode; }
+
 protected:
     //------------------------------------------------------------------------
     // Declared virtuals
@@ -70,7 +89,12 @@ private:
     //------------------------------------------------------------------------
     // Private methods
     //------------------------------------------------------------------------
+    void createObjects();
+    void deleteObjects();
     void generateCubeFaceLookAtMatrices();
+    void createLayeredProgram();
+    void renderCubemapFaces(const float (&antMatrix)[16]);
+    void renderCubemapLayers(const float (&antMatrix)[16]);
     void applyFrame(meter_t x, meter_t y, meter_t z,
                     degree_t yaw, degree_t pitch, degree_t roll);
 
@@ -85,9 +109,17 @@ private:
     GLuint m_DepthBuffer;
     GLfloat m_CubeFaceLookAtMatrices[6][16];
 
+    // Shader program used to render all cubemap faces in one pass
+    GLuint m_LayeredProgram;
+
+    // Location of layered program's textured uniform and whether it's in use
+    GLint m_TexturedUniform;
+    bool m_RenderingLayers;
+
     const GLsizei m_CubemapSize;
     const double m_NearClip;
     const double m_FarClip;
+    const CubemapMode m_CubemapMode;
 };
 }   // namespace AntWorld
 }   // namespace BoBRobotics
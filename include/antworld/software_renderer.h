@@ -0,0 +1,152 @@
+#pragma once
+
+// BoB robotics includes
+#include "common/thread_pool.h"
+
+// Libantworld includes
+#include "world_data.h"
+
+// Third-party includes
+#include "third_party/units.h"
+
+// OpenCV includes
+#include <opencv2/opencv.hpp>
+
+// Standard C includes
+#include <cstdint>
+
+// Standard C++ includes
+#include <array>
+#include <memory>
+#include <vector>
+
+namespace BoBRobotics
+{
+namespace AntWorld
+{
+using namespace units::literals;
+
+//----------------------------------------------------------------------------
+// BoBRobotics::AntWorld::SoftwareRenderer
+//----------------------------------------------------------------------------
+/*!
+ * \brief Renders panoramic views of a world on the CPU, without OpenGL
+ *
+ * Renderer needs an OpenGL context (and so, in practice, a display), whereas
+ * this casts a ray for each pixel of the panorama through a bounding volume
+ * hierarchy built over the world's triangles, so it can be used on headless
+ * machines. Only the pixels we need are rendered, rather than six cube faces.
+ *
+ * Views match those of Renderer::renderPanoramicView() with the same fields of
+ * view, except that each pixel's direction is calculated exactly rather than
+ * being interpolated across RenderMeshSpherical's mesh. As with Renderer (set
+ * up by Camera::initialiseWindow()), back faces are culled and textures are
+ * sampled bilinearly, though without mipmapping.
+ */
+class SoftwareRenderer
+{
+    using degree_t = units::angle::degree_t;
+    using meter_t = units::length::meter_t;
+
+public:
+    SoftwareRenderer(double nearClip = 0.001, double farClip = 1000.0,
+                     degree_t horizontalFOV = 296_deg, degree_t verticalFOV = 75_deg);
+
+    //------------------------------------------------------------------------
+    // Public API
+    //------------------------------------------------------------------------
+    //! Render the given world, building the bounding volume hierarchy needed to do so
+    void setWorld(WorldData world);
+
+    const WorldData &getWorld() const{ return m_World; }
+
+    /*!
+     * \brief Render a panoramic view from the given pose
+     *
+     * type can be CV_8UC3, giving a BGR image (like those read back from
+     * Renderer) or CV_8UC1 for greyscale.
+     */
+    void renderPanoramicView(meter_t x, meter_t y, meter_t z,
+                             degree_t yaw, degree_t pitch, degree_t roll,
+                             cv::Mat &image, const cv::Size &size, int type = CV_8UC3);
+
+    //! Set the BGR colour of pixels where no geometry is hit (defaults to cyan, like Camera::initialiseWindow())
+    void setSkyColour(uint8_t blue, uint8_t green, uint8_t red);
+
+    /*!
+     * \brief Split rendering between numThreads threads
+     *
+     * By default, one thread per core is used.
+     */
+    void setNumThreads(size_t numThreads);
+
+private:
+    //------------------------------------------------------------------------
+    // Typedefines
+    //------------------------------------------------------------------------
+    using Vector = std::array<float, 3>;
+
+    //! A triangle, with edges precomputed for intersection tests
+    struct Triangle
+    {
+        Vector vertex, edge1, edge2;
+
+        //! Index of surface in world
+        uint32_t surface;
+
+        //! Indices of vertices within surface
+        std::array<uint32_t, 3> vertices;
+    };
+
+    //! A node of the bounding volume hierarchy
+    struct Node
+    {
+        Vector min, max;
+
+        //! Index of first triangle if this is a leaf, otherwise index of left child (right child follows it)
+        uint32_t first;
+
+        //! Number of triangles or zero if this isn't a leaf
+        uint32_t count;
+    };
+
+    //! The closest intersection found along a ray
+    struct Hit
+    {
+        float distance;
+        float u, v;
+        const Triangle *triangle = nullptr;
+    };
+
+    //------------------------------------------------------------------------
+    // Private methods
+    //------------------------------------------------------------------------
+    void buildHierarchy();
+    void buildNode(size_t nodeIndex, size_t first, size_t count, unsigned int depth,
+                   std::vector<uint32_t> &indices, const std::vector<Vector> &centroids);
+    void updateDirections(const cv::Size &size);
+    void renderRow(int row, const float (&rotation)[3][3], const Vector &origin, cv::Mat &image) const;
+    bool intersect(const Vector &origin, const Vector &direction, Hit &hit) const;
+    Vector shade(const Hit &hit) const;
+
+    //------------------------------------------------------------------------
+    // Members
+    //------------------------------------------------------------------------
+    WorldData m_World;
+    std::vector<Triangle> m_Triangles;
+    std::vector<Node> m_Nodes;
+
+    // Direction of each pixel's ray in the agent's frame of reference
+    cv::Size m_DirectionsSize;
+    std::vector<Vector> m_Directions;
+
+    Vector m_SkyColour;
+    std::unique_ptr<ThreadPool> m_ThreadPool;
+
+    const float m_NearClip;
+    const float m_FarClip;
+    const degree_t m_HorizontalFOV;
+    const degree_t m_VerticalFOV;
+};
+}   // namespace AntWorld
+}   // namespace BoBRobotics
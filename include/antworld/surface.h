@@ -47,16 +47,23 @@ public:
 
     template<typename T>
     void uploadPositions(const std::vector<T> &positions, GLint size = 3)
+    {
+        uploadPositions(positions.data(), positions.size(), size);
+    }
+
+    // **NOTE** the raw array overloads allow data to be uploaded directly from e.g. a memory-mapped file
+    template<typename T>
+    void uploadPositions(const T *positions, size_t count, GLint size = 3)
     {
         // Upload positions to buffer
-        uploadBuffer(positions, m_PositionVBO, GL_ARRAY_BUFFER, GL_STATIC_DRAW);
+        uploadBuffer(positions, count, m_PositionVBO, GL_ARRAY_BUFFER, GL_STATIC_DRAW);
 
         // Set vertex pointer and enable client state in VAO
         glVertexPointer(size, OpenGLTypeTraits<T>::type, 0, BUFFER_OFFSET(0));
         glEnableClientState(GL_VERTEX_ARRAY);
 
         // Calculate number of vertices from positions
-        m_NumVertices = positions.size() / size;
+        m_NumVertices = count / size;
 
         // Unbind buffer
         glBindBuffer(GL_ARRAY_BUFFER, 0);
@@ -64,9 +71,15 @@ public:
 
     template<typename T>
     void uploadColours(const std::vector<T> &colours, GLint size = 3)
+    {
+        uploadColours(colours.data(), colours.size(), size);
+    }
+
+    template<typename T>
+    void uploadColours(const T *colours, size_t count, GLint size = 3)
     {
         // Upload colours to buffer
-        uploadBuffer(colours, m_ColourVBO, GL_ARRAY_BUFFER, GL_STATIC_DRAW);
+        uploadBuffer(colours, count, m_ColourVBO, GL_ARRAY_BUFFER, GL_STATIC_DRAW);
 
         // Set colour pointer and enable client state in VAO
         glColorPointer(size, OpenGLTypeTraits<T>::type, 0, BUFFER_OFFSET(0));
@@ -78,9 +91,15 @@ public:
 
     template<typename T>
     void uploadTexCoords(const std::vector<T> &texCoords, GLint size = 2)
+    {
+        uploadTexCoords(texCoords.data(), texCoords.size(), size);
+    }
+
+    template<typename T>
+    void uploadTexCoords(const T *texCoords, size_t count, GLint size = 2)
     {
         // Upload texture coordinates to buffer
-        uploadBuffer(texCoords, m_TexCoordVBO, GL_ARRAY_BUFFER, GL_STATIC_DRAW);
+        uploadBuffer(texCoords, count, m_TexCoordVBO, GL_ARRAY_BUFFER, GL_STATIC_DRAW);
 
         // Set colour pointer and enable client state in VAO
         glTexCoordPointer(size, OpenGLTypeTraits<T>::type, 0, BUFFER_OFFSET(0));
@@ -92,12 +111,18 @@ public:
 
     template<typename T>
     void uploadIndices(const std::vector<T> &indices)
+    {
+        uploadIndices(indices.data(), indices.size());
+    }
+
+    template<typename T>
+    void uploadIndices(const T *indices, size_t count)
     {
         // Upload indices
-        uploadBuffer(indices, m_IBO, GL_ELEMENT_ARRAY_BUFFER, GL_STATIC_DRAW);
+        uploadBuffer(indices, count, m_IBO, GL_ELEMENT_ARRAY_BUFFER, GL_STATIC_DRAW);
 
         // Cache number of indices
-        m_NumIndices = indices.size();
+        m_NumIndices = count;
 
         // **NOTE** GL_ELEMENT_ARRAY_BUFFER works subtly different from GL_ARRAY_BUFFER
         // as it has no client state/pointer tying it to the VAO. Therefore we need to
@@ -105,13 +130,14 @@ public:
     }
     
     void setTexture(const Texture *texture){ m_Texture = texture; }
+    bool isTextured() const{ return (m_Texture != nullptr); }
 
 private:
     //------------------------------------------------------------------------
     // Private methods
     //------------------------------------------------------------------------
     template<typename T>
-    void uploadBuffer(const std::vector<T> &data, GLuint &bufferObject,
+    void uploadBuffer(const T *data, size_t count, GLuint &bufferObject,
                       GLenum target, GLenum usage)
     {
         // Generate buffer if required
@@ -123,7 +149,7 @@ private:
         glBindBuffer(target, bufferObject);
 
         // Upload data
-        glBufferData(target, data.size() * sizeof(T), data.data(), usage);
+        glBufferData(target, count * sizeof(T), data, usage);
     }
 
     //------------------------------------------------------------------------
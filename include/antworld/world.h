@@ -1,7 +1,6 @@
 #pragma once
 
 // Standard C++ includes
-#include <map>
 #include <memory>
 #include <string>
 #include <vector>
@@ -16,13 +15,10 @@
 // Libantworld include
 #include "surface.h"
 #include "texture.h"
+#include "world_cache.h"
+#include "world_data.h"
 
 // Forward declarations
-namespace cv
-{
-    class Mat;
-}
-
 namespace filesystem
 {
     class path;
@@ -49,10 +45,29 @@ public:
     //------------------------------------------------------------------------
     // Public API
     //------------------------------------------------------------------------
-    void render() const;
+    /*!
+     * \brief Render each surface
+     *
+     * Shaders can't tell whether GL_TEXTURE_2D is enabled so, if one is in
+     * use, pass the location of a bool uniform to set to whether each
+     * surface is textured.
+     */
+    void render(GLint texturedUniform = -1) const;
     void load(const filesystem::path &filename, const GLfloat (&worldColour)[3], const GLfloat (&groundColour)[3]);
+    /*!
+     * \brief Load a world from an obj file
+     *
+     * The first time a file is loaded, a WorldCache is written alongside it,
+     * which subsequent loads use (unless the file has changed).
+     */
     void loadObj(const filesystem::path &objFilename, float scale = 1.0f, int maxTextureSize = -1, GLint textureFormat = GL_RGB);
 
+    //! Upload world data which has already been loaded (e.g. so it can also be used with SoftwareRenderer)
+    void upload(const WorldData &worldData, GLint textureFormat = GL_RGB);
+
+    //! Upload a world directly from a cache
+    void upload(const WorldCache &worldCache, GLint textureFormat = GL_RGB);
+
     const Vector3<meter_t> &getMinBound()
     {
         return m_MinBound;
@@ -64,13 +79,6 @@ public:
     }
 
 private:
-    //------------------------------------------------------------------------
-    // Private methods
-    //------------------------------------------------------------------------
-    void loadMaterials(const filesystem::path &basePath, const std::string &filename,
-                       GLint textureFormat, int maxTextureSize,
-                       std::map<std::string, Texture*> &textureNames);
-
     //------------------------------------------------------------------------
     // Members
     //------------------------------------------------------------------------
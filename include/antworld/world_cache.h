@@ -0,0 +1,116 @@
+#pragma once
+
+// BoB robotics includes
+#include "common/memory_mapped_file.h"
+#include "common/pose.h"
+
+// Libantworld includes
+#include "world_data.h"
+
+// OpenCV includes
+#include <opencv2/opencv.hpp>
+
+// Standard C includes
+#include <cstdint>
+
+// Standard C++ includes
+#include <string>
+#include <vector>
+
+// Forward declarations
+namespace filesystem
+{
+    class path;
+}
+
+namespace BoBRobotics
+{
+namespace AntWorld
+{
+//----------------------------------------------------------------------------
+// BoBRobotics::AntWorld::WorldCache
+//----------------------------------------------------------------------------
+/*!
+ * \brief A world stored in a binary file, which can be memory-mapped and
+ *        uploaded without any parsing
+ *
+ * Parsing an obj file and loading its textures can take tens of seconds for
+ * large worlds. A cache holds the result: indexed vertex data for each
+ * surface and the pixels of each texture, all laid out as OpenGL expects them. World::loadObj() creates a cache alongside the obj
+ * file the first time it is loaded (as does tools/obj_process) and uses it
+ * until the obj file changes.
+ */
+class WorldCache
+{
+    using meter_t = units::length::meter_t;
+
+public:
+    //! A surface's vertex data, pointing into the memory-mapped file
+    struct Surface
+    {
+        std::string name;
+        size_t numVertices;
+        size_t numIndices;
+
+        //! XYZ position of each vertex
+        const float *positions;
+
+        //! RGB colour of each vertex or nullptr if surface has no vertex colours
+        const uint8_t *colours;
+
+        //! UV texture coordinate of each vertex or nullptr if surface has none
+        const float *texCoords;
+
+        //! Indices of each triangle's vertices or nullptr if surface isn't indexed
+        const uint32_t *indices;
+
+        //! Index into textures or -1 if surface isn't textured
+        int texture;
+    };
+
+    explicit WorldCache(const filesystem::path &filename);
+
+    //------------------------------------------------------------------------
+    // Public API
+    //------------------------------------------------------------------------
+    const std::vector<Surface> &getSurfaces() const{ return m_Surfaces; }
+
+    //! Get the textures (these share read-only memory with the file)
+    const std::vector<cv::Mat> &getTextures() const{ return m_Textures; }
+
+    const Vector3<meter_t> &getMinBound() const{ return m_MinBound; }
+    const Vector3<meter_t> &getMaxBound() const{ return m_MaxBound; }
+
+    //! Copy the world out of the cache, e.g. to render it with SoftwareRenderer
+    WorldData getWorldData() const;
+
+    //! Get the path of the cache for an obj file
+    static filesystem::path getPath(const filesystem::path &objFilename);
+
+    //! Check that a cache exists and was written from the current obj file with the same parameters
+    static bool isUpToDate(const filesystem::path &filename, const filesystem::path &objFilename,
+                           float scale, int maxTextureSize);
+
+    /*!
+     * \brief Write world, loaded from objFilename with the given parameters,
+     *        into a cache
+     *
+     * Surfaces are stored as they are, so world should usually be indexed
+     * (as WorldData::loadObj() does) first.
+     */
+    static void write(const filesystem::path &filename, const WorldData &world,
+                      const filesystem::path &objFilename, float scale, int maxTextureSize);
+
+private:
+    //------------------------------------------------------------------------
+    // Members
+    //------------------------------------------------------------------------
+    MemoryMappedFile m_File;
+    std::vector<Surface> m_Surfaces;
+    std::vector<cv::Mat> m_Textures;
+
+    Vector3<meter_t> m_MinBound;
+    Vector3<meter_t> m_MaxBound;
+};
+}   // namespace AntWorld
+}   // namespace BoBRobotics
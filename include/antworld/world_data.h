@@ -0,0 +1,100 @@
+#pragma once
+
+// BoB robotics includes
+#include "common/pose.h"
+
+// OpenCV includes
+#include <opencv2/opencv.hpp>
+
+// Standard C includes
+#include <cstdint>
+
+// Standard C++ includes
+#include <string>
+#include <vector>
+
+// Forward declarations
+namespace filesystem
+{
+    class path;
+}
+
+namespace BoBRobotics
+{
+using namespace units::literals;
+
+namespace AntWorld
+{
+//----------------------------------------------------------------------------
+// BoBRobotics::AntWorld::WorldData
+//----------------------------------------------------------------------------
+/*!
+ * \brief The geometry and textures of a world, read from disk
+ *
+ * This doesn't depend on OpenGL, so it can be rendered with either World
+ * (once uploaded) or SoftwareRenderer.
+ */
+struct WorldData
+{
+    using meter_t = units::length::meter_t;
+
+    //! Triangles which are rendered with one material
+    struct SurfaceData
+    {
+        std::string name;
+
+        //! XYZ position of each vertex, with three vertices per triangle
+        std::vector<float> positions;
+
+        //! RGB colour of each vertex (may be empty)
+        std::vector<uint8_t> colours;
+
+        //! UV texture coordinate of each vertex (may be empty)
+        std::vector<float> texCoords;
+
+        //! Indices of each triangle's vertices (if empty, every three vertices make a triangle)
+        std::vector<uint32_t> indices;
+
+        //! Index into textures or -1 if surface isn't textured
+        int texture = -1;
+
+        //! Get the number of distinct vertices
+        size_t getNumVertices() const{ return positions.size() / 3; }
+    };
+
+    std::vector<SurfaceData> surfaces;
+
+    //! BGR textures, flipped vertically so that their first row is at texture coordinate V=0
+    std::vector<cv::Mat> textures;
+
+    Vector3<meter_t> minBound{ 0_m, 0_m, 0_m };
+    Vector3<meter_t> maxBound{ 0_m, 0_m, 0_m };
+
+    //! Load a world stored in the binary format used by the original Matlab simulation
+    static WorldData load(const filesystem::path &filename, const float (&worldColour)[3], const float (&groundColour)[3]);
+
+    /*!
+     * \brief Merge identical vertices within each unindexed surface, adding
+     *        indices so the same triangles are drawn
+     *
+     * Most vertices are shared between several triangles, so indexing
+     * reduces the memory (and vertex processing) needed to render the world.
+     * loadObj() already produces indexed surfaces, so this is only needed for
+     * worlds built in other ways.
+     */
+    void index();
+
+    //! Load a world from an obj file, resizing textures to be no larger than maxTextureSize (if specified)
+    static WorldData loadObj(const filesystem::path &objFilename, float scale = 1.0f, int maxTextureSize = -1);
+
+    /*!
+     * \brief Load a world from the text of an obj file, with materials relative to basePath
+     *
+     * The text is split into numChunks chunks of lines which are parsed in
+     * parallel (by default, one per thread).
+     */
+    static WorldData loadObj(const char *objText, size_t objSize, const filesystem::path &basePath,
+                             float scale = 1.0f, int maxTextureSize = -1, size_t numChunks = 0);
+};
+}   // namespace AntWorld
+}   // namespace BoBRobotics
@@ -1,47 +1,95 @@
-// Standard includes
-#include <stdexcept>
+#pragma once
+
 // BoB includes
+#include "background_exception_catcher.h"
 #include "nmea_parser.h"
-#include "serial_reader.h"
+#include "serial_interface.h"
 #include "../third_party/units.h"
 #include "map_coordinate.h"
 
+// Standard C++ includes
+#include <atomic>
+#include <stdexcept>
+#include <thread>
 
-namespace BoBRobotics 
+namespace BoBRobotics
 {
-namespace GPS 
+namespace GPS
 {
 
+/*!
+ * \brief Reads data from a GPS receiver over a serial port
+ *
+ * A background thread feeds bytes from the serial port into an NMEAParser as
+ * they arrive, so getGPSData() just returns the latest fix.
+ */
 class Gps {
 
-    private:
-    
-    SerialReader sreader;
-    const char *m_device_path;
-    bool isConnected;
-    
     public:
 
     Gps() {}
 
-    Gps(const char *device_path) : m_device_path(device_path), isConnected(false) {
+    Gps(const char *device_path) {
         connect(device_path);
     }
 
-    void connect(const char *device_path) {     
-        sreader.connect(device_path);
-        if (!sreader.isConnected()) throw GPSError("device not found");
-        m_device_path = device_path;
-        isConnected = true;
-       
+    ~Gps() {
+        m_DoRun = false;
+        if (m_ReadThread.joinable()) {
+            m_ReadThread.join();
+        }
+    }
+
+    void connect(const char *device_path) {
+        if (m_ReadThread.joinable()) throw GPSError("Already connected to a device");
+
+        try {
+            m_Serial.setup(device_path);
+
+            // Time out reads, so the thread can be stopped even if no data arrives
+            m_Serial.setBlocking(false);
+        } catch (std::runtime_error &e) {
+            throw GPSError(e.what());
+        }
+
+        m_DoRun = true;
+        m_ReadThread = std::thread(&Gps::readSerial, this);
     }
 
-    GPSData getGPSData() {
+    //! Get the latest data, throwing GPSError if there's none yet
+    GPSData getGPSData() const {
+        if (!m_ReadThread.joinable()) throw GPSError("Not connected to the device");
+
         GPSData data;
-        if (!isConnected) throw GPSError("Not connected to the device");
-        data = NMEAParser::parseNMEA(sreader.readData()); 
+        if (!m_Parser.getLatestData(data)) throw GPSError("No data received yet");
         return data;
     }
+
+    //! Get the latest data without blocking or allocating, returning false if there's none yet
+    bool tryGetGPSData(GPSData &data) const {
+        return m_Parser.getLatestData(data);
+    }
+
+    Gps(const Gps &) = delete;
+    void operator=(const Gps &) = delete;
+
+    private:
+
+    SerialInterface m_Serial;
+    NMEAParser m_Parser;
+    std::thread m_ReadThread;
+    std::atomic<bool> m_DoRun{ false };
+
+    void readSerial() {
+        try {
+            char buffer[256];
+            while (m_DoRun) {
+                m_Parser.feed(buffer, m_Serial.readSome(buffer, sizeof(buffer)));
+            }
+        } catch (...) {
+            BackgroundExceptionCatcher::set(std::current_exception());
+        }
+    }
 };
 } // GPS
-} // BoBRobotics
\ No newline at end of file
+} // BoBRobotics
@@ -0,0 +1,45 @@
+#pragma once
+
+// Standard C includes
+#include <cstddef>
+#include <cstdint>
+
+// Standard C++ includes
+#include <string>
+
+namespace BoBRobotics {
+//----------------------------------------------------------------------------
+// BoBRobotics::MemoryMappedFile
+//----------------------------------------------------------------------------
+/*!
+ * \brief Maps the whole of a file into memory, read-only
+ *
+ * Writing to the mapped data will crash, so anything which hands out views
+ * of it must make clear that they cannot be modified.
+ */
+class MemoryMappedFile
+{
+public:
+    MemoryMappedFile(const std::string &path);
+    ~MemoryMappedFile();
+
+    MemoryMappedFile(const MemoryMappedFile &) = delete;
+    void operator=(const MemoryMappedFile &) = delete;
+
+    //! Get a pointer to the start of the file's data
+    const uint8_t *data() const;
+
+    //! Get the size of the file in bytes
+    size_t size() const;
+
+private:
+    uint8_t *m_Data = nullptr;
+    size_t m_Size = 0;
+
+#ifdef _WIN32
+    // These are HANDLEs, but we don't want to pull in windows.h here
+    void *m_File = nullptr;
+    void *m_Mapping = nullptr;
+#endif
+}; // MemoryMappedFile
+} // BoBRobotics
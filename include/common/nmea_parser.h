@@ -11,7 +11,8 @@ $--GGA,hhmmss.ss,llll.ll,a,yyyyy.yy,a,x,xx,x.x,x.x,M,x.x,M,x.x,xxxx*hh
 4) Longitude
 5) E or W (East or West)
 6) GPS Quality Indicator,
-0 = Invalid, 1 = Valid SPS, 2 = Valid DGPS, 3 = Valid PPS
+0 = Invalid, 1 = Valid SPS, 2 = Valid DGPS, 3 = Valid PPS, 4 = RTK fixed,
+5 = RTK float, 6 = Estimated (dead reckoning), 7 = Manual input, 8 = Simulation
 7) Number of satellites in view, 00 - 12
 8) Horizontal Dilution of precision, lower is better
 9) Antenna Altitude above/below mean-sea-level (geoid)
@@ -30,11 +31,18 @@ type 1 or 9 update, null field when DGPS is not used
 #include "third_party/units.h"
 #include "map_coordinate.h"
 
+// Standard C includes
+#include <cstdint>
+#include <cstring>
+
 // Standard C++ includes
+#include <algorithm>
+#include <atomic>
 #include <iomanip>
 #include <sstream>
 #include <string>
-#include <vector>
+#include <thread>
+#include <type_traits>
 
 namespace BoBRobotics
 {
@@ -50,14 +58,138 @@ public:
 
 enum class GPSQuality
 {
-    INVALID = 0,
-    GPSFIX  = 1,
-    DGPSFIX = 2,
-    PPSFIX  = 3,
-    RTK     = 4,
-    FRTK    = 5
+    INVALID    = 0,
+    GPSFIX     = 1,
+    DGPSFIX    = 2,
+    PPSFIX     = 3,
+    RTK        = 4,
+    FRTK       = 5,
+    ESTIMATED  = 6,
+    MANUAL     = 7,
+    SIMULATION = 8
+};
+
+namespace Internal {
+//! A field of an NMEA sentence, pointing into the buffer it was read into
+struct NMEAField
+{
+    const char *begin, *end;
+
+    bool empty() const { return begin == end; }
+
+    size_t size() const { return static_cast<size_t>(end - begin); }
+
+    bool operator==(const char *str) const
+    {
+        return std::strlen(str) == size() && std::memcmp(begin, str, size()) == 0;
+    }
+};
+
+inline bool
+isDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+//! A decimal number, with its integer and fractional parts kept separate so no precision is lost
+struct NMEADecimal
+{
+    uint64_t integer = 0, fraction = 0;
+    int fractionDigits = 0;
+    bool negative = false;
+
+    double fractionValue() const
+    {
+        double scale = 1.0;
+        for (int i = 0; i < fractionDigits; i++) {
+            scale *= 10.0;
+        }
+        return static_cast<double>(fraction) / scale;
+    }
+
+    double value() const
+    {
+        const double magnitude = static_cast<double>(integer) + fractionValue();
+        return negative ? -magnitude : magnitude;
+    }
 };
 
+/*!
+ * \brief Parse a number like "-123.456" in the manner of std::from_chars,
+ *        without copying or allocating
+ *
+ * Fails unless the whole field is a number.
+ */
+inline bool
+parseDecimal(const NMEAField &field, NMEADecimal &number)
+{
+    number = NMEADecimal{};
+    const char *c = field.begin;
+    if (c != field.end && (*c == '-' || *c == '+')) {
+        number.negative = (*c == '-');
+        ++c;
+    }
+
+    int integerDigits = 0;
+    for (; c != field.end && isDigit(*c); ++c) {
+        // Don't overflow
+        if (++integerDigits > 18) {
+            return false;
+        }
+        number.integer = number.integer * 10 + static_cast<uint64_t>(*c - '0');
+    }
+    if (c != field.end && *c == '.') {
+        for (++c; c != field.end && isDigit(*c); ++c) {
+            // Further digits are beyond the precision of a double anyway
+            if (number.fractionDigits < 18) {
+                number.fraction = number.fraction * 10 + static_cast<uint64_t>(*c - '0');
+                number.fractionDigits++;
+            }
+        }
+    }
+
+    return c == field.end && (integerDigits > 0 || number.fractionDigits > 0);
+}
+
+inline bool
+parseDouble(const NMEAField &field, double &value)
+{
+    NMEADecimal number;
+    if (!parseDecimal(field, number)) {
+        return false;
+    }
+    value = number.value();
+    return true;
+}
+
+inline bool
+parseInt(const NMEAField &field, int &value)
+{
+    NMEADecimal number;
+    if (!parseDecimal(field, number) || number.fractionDigits > 0 || number.integer > 1000000000) {
+        return false;
+    }
+    value = number.negative ? -static_cast<int>(number.integer) : static_cast<int>(number.integer);
+    return true;
+}
+
+//! Value of a hexadecimal digit or -1 if it isn't one
+inline int
+hexValue(char c)
+{
+    if (isDigit(c)) {
+        return c - '0';
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    return -1;
+}
+} // Internal
+
 struct TimeStamp
 {
     int hour{}, minute{}, second{}, millisecond{};
@@ -68,12 +200,8 @@ struct TimeStamp
     {
         if (timeString.empty())
             throw GPSError("Empty string when reading time");
-        if (timeString.length() < 9)
+        if (!parse({ timeString.data(), timeString.data() + timeString.size() }, *this))
             throw GPSError("Time information parse error");
-        hour = stoi(timeString.substr(0, 2));
-        minute = stoi(timeString.substr(2, 2));
-        second = stoi(timeString.substr(4, 2));
-        millisecond = stoi(timeString.substr(7, 2));
     }
 
     std::string str() const
@@ -87,11 +215,51 @@ struct TimeStamp
         ss << static_cast<float>(second) + static_cast<float>(millisecond) / 1000.f;
         return ss.str();
     }
+
+    //! Parse a time in the form hhmmss or hhmmss.sss (with any number of decimal places)
+    static bool parse(const Internal::NMEAField &field, TimeStamp &time)
+    {
+        using Internal::isDigit;
+
+        const char *c = field.begin;
+        if (field.size() < 6 || !std::all_of(c, c + 6, isDigit)) {
+            return false;
+        }
+        const auto twoDigits = [](const char *digits) {
+            return 10 * (digits[0] - '0') + (digits[1] - '0');
+        };
+
+        TimeStamp parsed;
+        parsed.hour = twoDigits(c);
+        parsed.minute = twoDigits(c + 2);
+        parsed.second = twoDigits(c + 4); // NB: Can be 60 for a leap second
+        if (parsed.hour > 23 || parsed.minute > 59 || parsed.second > 60) {
+            return false;
+        }
+
+        c += 6;
+        if (c != field.end) {
+            if (*c != '.') {
+                return false;
+            }
+            int scale = 100;
+            for (++c; c != field.end; ++c) {
+                if (!isDigit(*c)) {
+                    return false;
+                }
+                parsed.millisecond += scale * (*c - '0');
+                scale /= 10;
+            }
+        }
+
+        time = parsed;
+        return true;
+    }
 };
 
 struct GPSData {
     BoBRobotics::MapCoordinate::GPSCoordinate coordinate;  // Latitude and longitude coordinate
-    units::length::meter_t altitude;                       // Altitude above ellipsoid
+    units::length::meter_t altitude;                       // Altitude above mean sea level
     units::velocity::meters_per_second_t velocity;         // velocity
     int numberOfSatellites;                                 // Currently observed number of satelites
     double horizontalDilution;                             // horizontal dilution - lower value is better
@@ -99,109 +267,330 @@ struct GPSData {
     TimeStamp time;                                        // time of measurement
 };
 
+//----------------------------------------------------------------------------
+// BoBRobotics::GPS::NMEAParser
+//----------------------------------------------------------------------------
+/*!
+ * \brief An incremental parser for the GGA, RMC and VTG sentences sent by GPS
+ *        receivers
+ *
+ * Bytes are fed in as they are read from the serial port, in chunks of any
+ * size. Each sentence is collected in a fixed-size buffer, its checksum is
+ * verified and its fields are converted in place, so parsing never allocates
+ * memory. Sentences from any talker (GP, GN, GL etc.) are accepted and other
+ * sentence types are ignored.
+ *
+ * Position, altitude and fix quality come from GGA sentences and velocity
+ * from RMC or VTG sentences. Once a GGA sentence has been received, the
+ * combined data is published after each sentence through a slot protected by
+ * a sequence lock. This means another thread can read the latest fix with
+ * getLatestData() without blocking the thread calling feed().
+ */
 class NMEAParser {
 
-    using second_t = units::time::second_t;
-    using minute_t = units::time::minute_t;
-    using hour_t = units::time::hour_t;
-    using millisecond_t = units::time::millisecond_t;
-    using meter_t = units::length::meter_t;
     using degree_t = units::angle::degree_t;
     using arcminute_t = units::angle::arcminute_t;
-    using meters_per_second_t = units::velocity::meters_per_second_t;
+    using meter_t = units::length::meter_t;
+    using Field = Internal::NMEAField;
+
+    static_assert(std::is_trivially_copyable<GPSData>::value,
+                  "GPSData must be trivially copyable to be read without locking");
+
+    public:
+
+    //! Longest sentence accepted, excluding the '$' and line ending (the standard allows 80 characters)
+    static constexpr size_t MaxSentenceLength = 128;
+
+    //! Fields after this number are ignored
+    static constexpr size_t MaxFields = 24;
+
+    NMEAParser() = default;
+
+    /*!
+     * \brief Process a single character
+     *
+     * \return true if it completed a sentence which updated the published data
+     */
+    bool consume(char c)
+    {
+        if (c == '$') {
+            // Any unfinished sentence has been cut short
+            if (m_InSentence) {
+                m_NumBadSentences++;
+            }
+            m_InSentence = true;
+            m_Length = 0;
+            return false;
+        }
+        if (!m_InSentence) {
+            return false;
+        }
+        if (c == '\r' || c == '\n') {
+            m_InSentence = false;
+            return processSentence();
+        }
+        if (m_Length == MaxSentenceLength) {
+            m_InSentence = false;
+            m_NumBadSentences++;
+            return false;
+        }
+
+        m_Buffer[m_Length++] = c;
+        return false;
+    }
+
+    //! Process a chunk of characters, returning the number of times the published data was updated
+    size_t feed(const char *data, size_t length)
+    {
+        size_t numUpdates = 0;
+        for (size_t i = 0; i < length; i++) {
+            numUpdates += consume(data[i]);
+        }
+        return numUpdates;
+    }
+
+    /*!
+     * \brief Get the most recently published data (can be called from any thread)
+     *
+     * \return false if no GGA sentence has been received yet
+     */
+    bool getLatestData(GPSData &data) const
+    {
+        while (true) {
+            // An odd sequence number means the data is being updated
+            const uint32_t sequence = m_Sequence.load(std::memory_order_acquire);
+            if (sequence == 0) {
+                return false;
+            }
+            if (sequence & 1) {
+                std::this_thread::yield();
+                continue;
+            }
+
+            // Copy data and check it wasn't updated in the meantime
+            data = m_Published;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (m_Sequence.load(std::memory_order_relaxed) == sequence) {
+                return true;
+            }
+        }
+    }
+
+    //! Number of sentences dropped because they were cut short, too long, had a bad checksum or couldn't be parsed
+    size_t getNumBadSentences() const
+    {
+        return m_NumBadSentences;
+    }
+
+    /*!
+     * \brief Parse a block of text containing one or more NMEA sentences
+     *
+     * Returns the data from the last GGA sentence (and any RMC or VTG
+     * sentences before it) or throws GPSError if there was none.
+     */
+    static GPSData parseNMEA(const std::string &toParse) {
+        if (toParse.empty()) throw GPSError("Empty serial output");
+
+        NMEAParser parser;
+        parser.feed(toParse.data(), toParse.size());
+        parser.consume('\n'); // In case the last sentence wasn't terminated
+
+        GPSData data;
+        if (!parser.getLatestData(data)) {
+            throw GPSError("cannot find valid GGA sentence");
+        }
+        return data;
+    }
+
+    NMEAParser(const NMEAParser &) = delete;
+    void operator=(const NMEAParser &) = delete;
 
     private:
 
-    static std::vector<std::string> parseNMEAstring(const std::string &textToParse,
-                                                    const std::string &NMEA_sentence_id) {
+    // Sentence being collected, excluding the '$'
+    char m_Buffer[MaxSentenceLength];
+    size_t m_Length = 0;
+    bool m_InSentence = false;
+
+    // Data accumulated from sentences so far
+    GPSData m_Data{};
+    bool m_HaveGGA = false;
 
-        if (textToParse.empty()) throw GPSError("Empty string to parse");
+    // Slot which the latest data is published in
+    std::atomic<uint32_t> m_Sequence{ 0 };
+    GPSData m_Published{};
 
-        using namespace std;
-        const char delimiter = '$';      // sentences separated by [$]
-        const char w_delimiter = ',';    // elements separated by  [,]
+    std::atomic<size_t> m_NumBadSentences{ 0 };
+
+    bool processSentence()
+    {
+        // The sentence should end with '*' and a checksum of two hex digits
+        if (m_Length < 3 || m_Buffer[m_Length - 3] != '*') {
+            return badSentence();
+        }
+        uint8_t checksum = 0;
+        const char *const end = &m_Buffer[m_Length - 3];
+        for (const char *c = m_Buffer; c != end; ++c) {
+            checksum ^= static_cast<uint8_t>(*c);
+        }
+        const int high = Internal::hexValue(end[1]), low = Internal::hexValue(end[2]);
+        if (high < 0 || low < 0 || checksum != ((high << 4) | low)) {
+            return badSentence();
+        }
 
-        bool found = false;
-        string sentence;
-        istringstream split(textToParse);
-        while (getline(split, sentence, delimiter)) {
-            if (sentence.find(NMEA_sentence_id) != string::npos) {
-                found = true;
+        // Split into fields, pointing into the buffer
+        Field fields[MaxFields];
+        size_t numFields = 0;
+        for (const char *begin = m_Buffer; numFields < MaxFields;) {
+            const char *comma = std::find(begin, end, ',');
+            fields[numFields++] = { begin, comma };
+            if (comma == end) {
                 break;
             }
+            begin = comma + 1;
+        }
+
+        // The address is a two-letter talker ID followed by the sentence type
+        const Field &address = fields[0];
+        if (address.size() != 5) {
+            return false;
         }
-        if (!found) {
-            throw GPSError("cannot find NMEA id");
+        const Field type{ address.begin + 2, address.end };
+        bool parsed;
+        if (type == "GGA") {
+            parsed = parseGGA(fields, numFields);
+        } else if (type == "RMC") {
+            parsed = parseRMC(fields, numFields);
+        } else if (type == "VTG") {
+            parsed = parseVTG(fields, numFields);
+        } else {
+            return false;
+        }
+        if (!parsed) {
+            return badSentence();
         }
 
-        // separating the sentence to words
-        istringstream splitWord{ sentence };
-        vector<string> words;
-        for (string word; getline(splitWord, word, w_delimiter); words.push_back(word));
+        if (!m_HaveGGA) {
+            return false;
+        }
+        publish();
+        return true;
+    }
 
-        return words;
+    bool badSentence()
+    {
+        m_NumBadSentences++;
+        return false;
     }
 
-    public:
+    /*
+     * Empty fields (e.g. the position before the receiver has a fix) leave
+     * the previous values unchanged. Fields are parsed into a copy, so that
+     * if parsing fails nothing is changed.
+     */
+    bool parseGGA(const Field *fields, size_t numFields)
+    {
+        if (numFields < 10) {
+            return false;
+        }
 
-    static GPSData parseNMEA(const std::string  &toParse) {
-        using namespace std;
-
-        degree_t            latitude, longitude;
-        arcminute_t         latitudeMinutes, longitudeMinutes;
-        char                latDirection, longDirection;
-        meter_t             altitude;
-        meters_per_second_t velocity;
-        double              horizontalDilution;
-        int                 numberOfSatellites;
-        int                 gpsQualityIndicator;
-        GPSQuality          qualityOfGps;
-        GPSData             data;
-
-        try {
-            if (toParse.empty()) throw GPSError("Emtpy serial output");
-            vector<string> elements= parseNMEAstring(toParse, "GNGGA"); // parse string
-            if (elements.size() < 10) throw GPSError("Wrong number of elements when parsing the string");
-            string timeString = elements[1];
-            TimeStamp time{ timeString };
-            latitude = degree_t(stod(elements[2].substr(0, 2)));
-            latitudeMinutes = arcminute_t(stod(elements[2].substr(2,8)));
-            latDirection = elements[3][0];
-            longitude = degree_t(stod(elements[4].substr(0,3)));
-            longitudeMinutes = arcminute_t(stod(elements[4].substr(3,9)));
-            longDirection = elements[5][0];
-            gpsQualityIndicator = stoi(elements[6]);
-            numberOfSatellites = stoi(elements[7]);
-            horizontalDilution = stod(elements[8]);
-            altitude = meter_t(stod(elements[9]));
-            vector<string> elementsRMC= parseNMEAstring(toParse, "GNRMC"); // parse GNRMC for velocity
-            velocity = units::velocity::knot_t(stod(elementsRMC[7])); // we change unit from knot to meters_per_second
-            qualityOfGps = static_cast<GPSQuality>(gpsQualityIndicator);
-
-            // adding up the latitude and longitude parts
-            latitude += latitudeMinutes;
-            longitude += longitudeMinutes;
-
-            // West and South has negative angles
-            if (longDirection == 'W') longitude = - longitude;
-            if (latDirection == 'S')  latitude  = - latitude;
-
-            BoBRobotics::MapCoordinate::GPSCoordinate coordinate;
-            coordinate.lat = latitude;
-            coordinate.lon = longitude;
-            data.coordinate = coordinate;
-            data.numberOfSatellites = numberOfSatellites;
-            data.altitude = altitude;
-            data.velocity = velocity;
-            data.horizontalDilution = horizontalDilution;
-            data.gpsQuality = qualityOfGps;
-            data.time = time; // UTC time
-        } catch(std::invalid_argument &e) {
-            throw GPSError(e.what());
-        } catch(std::out_of_range &e) {
-            throw GPSError(e.what());
+        GPSData data = m_Data;
+        int quality;
+        if (!Internal::parseInt(fields[6], quality) || quality < 0 || quality > 8) {
+            return false;
         }
-        return data;
+        data.gpsQuality = static_cast<GPSQuality>(quality);
+
+        double altitude;
+        if ((!fields[1].empty() && !TimeStamp::parse(fields[1], data.time)) ||
+                !parseCoordinate(fields[2], fields[3], 'N', 'S', data.coordinate.lat) ||
+                !parseCoordinate(fields[4], fields[5], 'E', 'W', data.coordinate.lon) ||
+                (!fields[7].empty() && !Internal::parseInt(fields[7], data.numberOfSatellites)) ||
+                (!fields[8].empty() && !Internal::parseDouble(fields[8], data.horizontalDilution))) {
+            return false;
+        }
+        if (!fields[9].empty()) {
+            if (!Internal::parseDouble(fields[9], altitude)) {
+                return false;
+            }
+            data.altitude = meter_t(altitude);
+        }
+
+        m_Data = data;
+        m_HaveGGA = true;
+        return true;
+    }
+
+    // Speed over ground is field 7, in knots
+    bool parseRMC(const Field *fields, size_t numFields)
+    {
+        if (numFields < 8) {
+            return false;
+        }
+        return parseSpeed<units::velocity::knot_t>(fields[7]);
+    }
+
+    // Speed over ground is field 7 in km/h, or field 5 in knots
+    bool parseVTG(const Field *fields, size_t numFields)
+    {
+        if (numFields >= 9 && fields[8] == "K") {
+            return parseSpeed<units::velocity::kilometers_per_hour_t>(fields[7]);
+        }
+        if (numFields >= 7 && fields[6] == "N") {
+            return parseSpeed<units::velocity::knot_t>(fields[5]);
+        }
+        return false;
+    }
+
+    template<typename SpeedUnit>
+    bool parseSpeed(const Field &field)
+    {
+        if (field.empty()) {
+            return true;
+        }
+
+        double speed;
+        if (!Internal::parseDouble(field, speed)) {
+            return false;
+        }
+        m_Data.velocity = SpeedUnit(speed);
+        return true;
+    }
+
+    //! Convert e.g. "4807.038","N" (ddmm.mmm and hemisphere) to degrees
+    static bool parseCoordinate(const Field &value, const Field &hemisphere,
+                                char positive, char negative, degree_t &angle)
+    {
+        if (value.empty()) {
+            return true;
+        }
+
+        Internal::NMEADecimal number;
+        if (!Internal::parseDecimal(value, number) || number.negative || hemisphere.size() != 1 ||
+                (hemisphere.begin[0] != positive && hemisphere.begin[0] != negative)) {
+            return false;
+        }
+
+        // West and South have negative angles
+        const arcminute_t minutes{ static_cast<double>(number.integer % 100) + number.fractionValue() };
+        angle = degree_t(static_cast<double>(number.integer / 100)) + minutes;
+        if (hemisphere.begin[0] == negative) {
+            angle = -angle;
+        }
+        return true;
+    }
+
+    void publish()
+    {
+        // Mark data as being updated (there's only one writer)
+        const uint32_t sequence = m_Sequence.load(std::memory_order_relaxed);
+        m_Sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        m_Published = m_Data;
+
+        // Skip zero if sequence number wraps around
+        m_Sequence.store((sequence + 2 == 0) ? 2 : (sequence + 2), std::memory_order_release);
     }
 };
 } // GPS
@@ -29,6 +29,14 @@ public:
     void setBlocking(bool should_block);
     bool readByte(uint8_t &byte);
 
+    /*!
+     * \brief Read whatever data is available, up to maxLength bytes
+     *
+     * Returns the number of bytes read, which is zero if the read timed out
+     * (see setBlocking()).
+     */
+    size_t readSome(char *data, size_t maxLength);
+
     template<typename T, size_t N>
     bool read(T (&data)[N])
     {
@@ -61,6 +69,6 @@ private:
     //---------------------------------------------------------------------
     // Members
     //---------------------------------------------------------------------
-    int m_Serial_fd;
+    int m_Serial_fd = -1;
 };
 } // BoBRobotics
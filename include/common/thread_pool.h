@@ -0,0 +1,71 @@
+#pragma once
+
+// Standard C++ includes
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace BoBRobotics {
+//----------------------------------------------------------------------------
+// BoBRobotics::ThreadPool
+//----------------------------------------------------------------------------
+/*!
+ * \brief A fixed-size pool of worker threads
+ *
+ * Tasks are run in the order in which they were submitted. Exceptions thrown
+ * by tasks are passed back to the caller through the returned std::future.
+ */
+class ThreadPool
+{
+public:
+    //! Create a pool with the given number of threads (defaults to one per core)
+    ThreadPool(size_t numThreads = getDefaultNumThreads());
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    void operator=(const ThreadPool &) = delete;
+
+    //! Get the number of worker threads
+    size_t getNumThreads() const;
+
+    //! Run func on a worker thread, returning a future for its result
+    template<class Func>
+    auto enqueue(Func &&func)
+    {
+        using ResultType = std::result_of_t<std::decay_t<Func>()>;
+        auto task = std::make_shared<std::packaged_task<ResultType()>>(std::forward<Func>(func));
+        auto future = task->get_future();
+        push([task]() { (*task)(); });
+        return future;
+    }
+
+    /*!
+     * \brief Split the range [0, size) into one contiguous chunk per thread
+     *        and call func(chunkIndex, begin, end) for each, blocking until
+     *        all have finished
+     *
+     * As each chunk index is only used by one call at a time, it can be used
+     * to index per-thread scratch memory.
+     */
+    void parallelFor(size_t size, const std::function<void(size_t, size_t, size_t)> &func);
+
+    //! One thread per core, or one if this can't be determined
+    static size_t getDefaultNumThreads();
+
+private:
+    std::vector<std::thread> m_Threads;
+    std::queue<std::function<void()>> m_Tasks;
+    std::mutex m_TasksMutex;
+    std::condition_variable m_TasksCondition;
+    bool m_Stopping = false;
+
+    void push(std::function<void()> task);
+    void runWorker();
+}; // ThreadPool
+} // BoBRobotics
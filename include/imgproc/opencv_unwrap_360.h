@@ -1,7 +1,11 @@
 #pragma once
 
+// Standard C includes
+#include <cstdint>
+
 // Standard C++ includes
 #include <string>
+#include <vector>
 
 // OpenCV includes
 #include <opencv2/core.hpp>
@@ -52,6 +56,27 @@ public:
 
     void unwrap(const cv::Mat &input, cv::Mat &output);
 
+    /*!
+     * \brief Unwrap the image, convert it to greyscale and (optionally)
+     *        downsample it in a single pass
+     *
+     * Rather than remapping the whole colour image and then converting and
+     * resizing it, only the source pixels which are needed are read, via a
+     * precomputed table of offsets into the input image, and each is
+     * converted to greyscale as it is read.
+     *
+     * The input can be greyscale (CV_8UC1), BGR (CV_8UC3), BGRA (CV_8UC4) or
+     * YUYV (CV_8UC2, as given by many cameras), so a camera's raw buffer can
+     * be wrapped in a cv::Mat header and passed here without being copied or
+     * converted first.
+     *
+     * \param input      Image from the camera, at the camera resolution
+     * \param output     Greyscale, unwrapped image
+     * \param downsample Factor to shrink the unwrapped image by; each output
+     *                   pixel is the mean of a downsample x downsample block
+     */
+    void unwrapGreyscale(const cv::Mat &input, cv::Mat &output, int downsample = 1);
+
     //! Serialise this object.
     void write(cv::FileStorage &fs) const;
 
@@ -77,7 +102,15 @@ private:
     cv::Mat m_UnwrapMapX;
     cv::Mat m_UnwrapMapY;
 
+    // Fixed-point versions of the maps, which cv::remap handles faster
+    cv::Mat m_FixedMap1, m_FixedMap2;
+
+    //! Byte offset into the input image for each unwrapped pixel (-1 if outside the input)
+    std::vector<int32_t> m_SourceOffsets;
+    size_t m_SourceStep = 0, m_SourceElemSize = 0;
+
     void createMaps();
+    void updateSourceOffsets(size_t step, size_t elemSize);
 }; // OpenCVUnwrap360
 
 void
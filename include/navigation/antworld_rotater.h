@@ -2,10 +2,16 @@
 
 // BoB robotics includes
 #include "antworld/agent.h"
+#include "antworld/batch_renderer.h"
+#include "common/thread_pool.h"
 
 // Third-party includes
 #include "third_party/units.h"
 
+// Standard C++ includes
+#include <algorithm>
+#include <vector>
+
 namespace BoBRobotics {
 namespace Navigation {
 using namespace units::literals;
@@ -29,16 +35,46 @@ public:
                     const degree_t pitch = 0_deg,
                     const degree_t roll = 0_deg);
 
+    //! Render the view at each rotation in batches, then call func for each of them
     template<class Func>
     void rotate(Func func)
     {
-        cv::Mat fr, mask;
-        size_t i = 0;
-        for (degree_t yaw = 0_deg; yaw < 360_deg; yaw += m_YawStep, i++) {
-            m_Agent.setAttitude(yaw, m_Pitch, m_Roll);
-            m_Agent.readGreyscaleFrame(fr);
-            func(fr, mask, i);
-        }
+        const cv::Mat mask;
+        m_BatchRenderer.renderPanoramicViews(getPoses(),
+                                             [&mask, &func](size_t i, const cv::Mat &fr) {
+                                                 func(fr, mask, i);
+                                             },
+                                             CV_8UC1);
+    }
+
+    /*!
+     * \brief Render all the rotations on this thread (as OpenGL requires),
+     *        then call func for each of them across the threads in pool
+     */
+    template<class Func>
+    void rotateInParallel(ThreadPool &pool, Func func)
+    {
+        rotateInParallel(pool, 1,
+                         [&func](const cv::Mat &image, const cv::Mat &maskImage, size_t rotation, size_t, size_t) {
+                             func(image, maskImage, rotation);
+                         });
+    }
+
+    //! Split each rotation into numParts parts and spread the grid across threads, as InSilicoRotater does
+    template<class Func>
+    void rotateInParallel(ThreadPool &pool, size_t numParts, Func func)
+    {
+        const auto frames = m_BatchRenderer.renderPanoramicViews(getPoses(), CV_8UC1);
+
+        const cv::Mat mask;
+        pool.parallelFor(frames.size() * numParts,
+                         [&frames, &mask, numParts, &func](size_t, size_t begin, size_t end) {
+                             for (size_t i = begin / numParts; i * numParts < end; i++) {
+                                 const size_t first = i * numParts;
+                                 func(frames[i], mask, i,
+                                      std::max(begin, first) - first, std::min(end, first + numParts) - first);
+                             }
+                         });
     }
 
     size_t numRotations() const;
@@ -54,8 +90,12 @@ public:
 
 private:
     AntWorld::AntAgent &m_Agent;
+    AntWorld::BatchRenderer &m_BatchRenderer;
     const degree_t m_YawStep, m_Pitch, m_Roll;
     const cv::Size m_UnwrapRes;
+
+    //! The agent's pose at each rotation
+    std::vector<AntWorld::BatchRenderer::Pose> getPoses() const;
 }; // AntWorldRotater
 } // Navigation
 } // BoBRobotics
@@ -7,6 +7,7 @@
 
 // Standard C includes
 #include <cmath>
+#include <cstdint>
 #include <cstdlib>
 
 // Standard C++ includes
@@ -41,6 +42,23 @@ namespace Internal {
     {
         return std::end(input);
     }
+
+    /*
+     * Fused difference-and-reduce kernels for 8-bit images. These are defined in
+     * differencers.cc, which contains AVX2, SSE2, NEON and scalar versions; the
+     * fastest one supported by the current CPU is chosen at runtime.
+     *
+     * The masked versions only include pixels which are non-zero in both masks
+     * and return the number of such pixels via numUnmasked.
+     */
+    uint64_t sumAbsDiff(const uint8_t *src1, const uint8_t *src2, size_t n);
+    uint64_t sumAbsDiffMasked(const uint8_t *src1, const uint8_t *src2,
+                              const uint8_t *mask1, const uint8_t *mask2,
+                              size_t n, size_t &numUnmasked);
+    uint64_t sumSquaredDiff(const uint8_t *src1, const uint8_t *src2, size_t n);
+    uint64_t sumSquaredDiffMasked(const uint8_t *src1, const uint8_t *src2,
+                                  const uint8_t *mask1, const uint8_t *mask2,
+                                  size_t n, size_t &numUnmasked);
 }
 
 //------------------------------------------------------------------------
@@ -67,6 +85,20 @@ public:
         return Internal::begin(dst);
     }
 
+    //! Sum of absolute differences between two 8-bit images, in a single pass
+    static inline uint64_t sum(const uint8_t *src1, const uint8_t *src2, size_t n)
+    {
+        return Internal::sumAbsDiff(src1, src2, n);
+    }
+
+    //! Sum of absolute differences over pixels unmasked in both masks
+    static inline uint64_t sumMasked(const uint8_t *src1, const uint8_t *src2,
+                                     const uint8_t *mask1, const uint8_t *mask2,
+                                     size_t n, size_t &numUnmasked)
+    {
+        return Internal::sumAbsDiffMasked(src1, src2, mask1, mask2, n, numUnmasked);
+    }
+
     static inline float mean(const float sum, const float n)
     {
         return sum / n;
@@ -102,6 +134,20 @@ class RMSDiff
         return m_Differences.begin();
     }
 
+    //! Sum of squared differences between two 8-bit images, in a single pass
+    static inline uint64_t sum(const uint8_t *src1, const uint8_t *src2, size_t n)
+    {
+        return Internal::sumSquaredDiff(src1, src2, n);
+    }
+
+    //! Sum of squared differences over pixels unmasked in both masks
+    static inline uint64_t sumMasked(const uint8_t *src1, const uint8_t *src2,
+                                     const uint8_t *mask1, const uint8_t *mask2,
+                                     size_t n, size_t &numUnmasked)
+    {
+        return Internal::sumSquaredDiffMasked(src1, src2, mask1, mask2, n, numUnmasked);
+    }
+
     static inline float mean(const float sum, const float n)
     {
         return sqrt(sum / n);
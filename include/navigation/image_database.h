@@ -2,6 +2,7 @@
 
 // BoB robotics includes
 #include "common/macros.h"
+#include "common/memory_mapped_file.h"
 #include "common/pose.h"
 
 // Third-party includes
@@ -14,6 +15,7 @@
 // Standard C++ includes
 #include <array>
 #include <fstream>
+#include <functional>
 #include <memory>
 #include <string>
 #include <utility>
@@ -71,7 +73,23 @@ public:
         filesystem::path path;
         std::array<size_t, 3> gridPosition; //! For grid-type databases, indicates the x,y,z grid position
 
+        /*!
+         * For packed databases, the entry's image data inside the mapped
+         * file: either raw greyscale pixels or, if packedEncoded is set, an
+         * encoded (e.g. PNG) image. Only valid while the ImageDatabase exists.
+         */
+        cv::Mat packedData;
+        bool packedEncoded = false;
+
         cv::Mat load() const;
+
+        /*!
+         * \brief Load the image as greyscale
+         *
+         * For packed, uncompressed databases, this is a view into the
+         * read-only mapped file rather than a copy: writing to it will crash,
+         * so clone() it first if it needs modifying.
+         */
         cv::Mat loadGreyscale() const;
     };
 
@@ -184,12 +202,38 @@ public:
     //! Check if the database is non-empty and a grid-type database
     bool isGrid() const;
 
+    //! Check if this database is stored in a single packed file (see pack())
+    bool isPacked() const;
+
     //! Load all of the images in this database into memory and return
     std::vector<cv::Mat> getImages() const;
 
     //! Load all of the images in this database into the specified std::vector<>
     void getImages(std::vector<cv::Mat> &images) const;
 
+    //! Called with the index of an entry and its image by forEachImage()
+    using ImageCallback = std::function<void(size_t, const cv::Mat &)>;
+
+    /*!
+     * \brief Load every image in this database on a pool of worker threads,
+     *        passing them, in order, to func on the calling thread
+     *
+     * At most readAhead images are loaded ahead of the one being processed by
+     * func, so decoding overlaps with processing without the whole database
+     * needing to fit in memory.
+     *
+     * \param func       Called with each entry's index and image
+     * \param greyscale  Whether to load images as greyscale rather than colour
+     * \param resolution If non-empty, images are resized to this on the worker threads
+     * \param numThreads Number of threads to decode with (defaults to one per core)
+     * \param readAhead  Maximum number of images in flight (defaults to twice numThreads)
+     */
+    void forEachImage(const ImageCallback &func,
+                      bool greyscale = true,
+                      const cv::Size &resolution = {},
+                      size_t numThreads = 0,
+                      size_t readAhead = 0) const;
+
     //! Access the metadata for this database via OpenCV's persistence API
     cv::FileNode getMetadata() const;
 
@@ -216,6 +260,17 @@ public:
      */
     void unwrap(const filesystem::path &destination, const cv::Size &unwrapRes);
 
+    /**!
+     *  \brief Write all the images in this database, as greyscale, into a
+     *         single packed file, along with the entries and metadata.
+     *
+     * The file can be opened by passing its path to ImageDatabase's
+     * constructor. Images are stored either as raw pixels, which are used
+     * directly from the memory-mapped file without being copied or decoded,
+     * or, if compress is set, as PNGs.
+     */
+    void pack(const filesystem::path &destination, bool compress = false) const;
+
     //! Get a filename for a route-type database
     static std::string getFilename(const size_t routeIndex,
                                    const std::string &imageFormat = "png");
@@ -228,12 +283,16 @@ private:
     const filesystem::path m_Path;
     std::vector<Entry> m_Entries;
     std::unique_ptr<cv::FileStorage> m_MetadataYAML;
+    std::unique_ptr<MemoryMappedFile> m_PackedFile;
     cv::Size m_Resolution;
     bool m_IsRoute;
     static constexpr const char *MetadataFilename = "database_metadata.yaml";
     static constexpr const char *EntriesFilename = "database_entries.csv";
 
     void loadMetadata();
+    void parseMetadata(const std::string &metadataText);
+    std::string getMetadataText() const;
+    void loadPacked();
     void writeImage(const std::string &filename, const cv::Mat &image) const;
     void addNewEntries(std::vector<Entry> &newEntries);
     void writeEntry(std::ofstream &os, const Entry &e);
@@ -81,28 +81,98 @@ public:
         return m_Weights;
     }
 
+    //! Copy an image into a column vector of floats (e.g. of the input matrix for testBatch())
+    template<class Derived>
+    static void copyToColumn(const cv::Mat &image, Eigen::MatrixBase<Derived> const &column)
+    {
+        BOB_ASSERT(column.size() == image.rows * image.cols);
+
+        // The image may not be continuous (e.g. a view), so copy row by row
+        auto &out = const_cast<Eigen::MatrixBase<Derived> &>(column);
+        for (int y = 0; y < image.rows; y++) {
+            Eigen::Map<const Eigen::Matrix<uint8_t, Eigen::Dynamic, 1>> row(image.ptr(y), image.cols);
+            out.segment(y * image.cols, image.cols) = row.template cast<FloatType>() / (FloatType) 255;
+        }
+    }
+
+    /*!
+     * \brief Train the network on a minibatch of images at once
+     *
+     * Rather than updating the weights after each image, the updates for all
+     * the images in the batch are calculated with the same weights and their
+     * mean is applied, so that the whole batch is handled with matrix-matrix
+     * products.
+     */
+    void trainBatch(const std::vector<cv::Mat> &images)
+    {
+        BOB_ASSERT(!images.empty());
+
+        // Gather images into columns of a matrix
+        m_BatchInputs.resize(m_Weights.cols(), images.size());
+        for (size_t i = 0; i < images.size(); i++) {
+            checkImage(images[i]);
+            copyToColumn(images[i], m_BatchInputs.col(i));
+        }
+
+        // U = W * X, Y = tanh(U)
+        m_BatchU.noalias() = m_Weights * m_BatchInputs;
+        m_BatchY = m_BatchU.array().tanh();
+
+        /*
+         * weights = weights + lrate/N * (eye(H) - (Y+U)*U'/B) * weights
+         *
+         * Calculated as (U' * weights) first so that the H x H matrices are
+         * never created.
+         */
+        const FloatType learnRate = m_LearningRate / (FloatType) m_BatchU.rows();
+        m_BatchUW.noalias() = m_BatchU.transpose() * m_Weights;
+        m_BatchY += m_BatchU;
+        m_Weights *= (FloatType) 1 + learnRate;
+        m_Weights.noalias() -= (learnRate / (FloatType) images.size()) * m_BatchY * m_BatchUW;
+    }
+
+    /*!
+     * \brief Test many images, stored as the columns of inputs, at once
+     *
+     * Images can be copied into inputs with copyToColumn(). The differences are
+     * calculated with a single matrix-matrix product, rather than one
+     * matrix-vector product per image.
+     */
+    template<class Derived>
+    void testBatch(const Eigen::MatrixBase<Derived> &inputs, std::vector<FloatType> &differences) const
+    {
+        BOB_ASSERT(inputs.rows() == m_Weights.cols());
+
+        m_BatchOutputs.noalias() = m_Weights * inputs;
+        differences.resize(inputs.cols());
+        Eigen::Map<VectorType>(differences.data(), differences.size()) = m_BatchOutputs.array().abs().colwise().sum().transpose();
+    }
+
 #ifndef EXPOSE_INFOMAX_INTERNALS
     private:
 #endif
     void trainUY()
     {
-        // weights = weights + lrate/N * (eye(H)-(y+u)*u') * weights;
-        const auto id = MatrixType::Identity(m_Weights.rows(), m_Weights.rows());
-        const auto sumYU = (m_Y.array() + m_U.array()).matrix();
+        /*
+         * weights = weights + lrate/N * (eye(H)-(y+u)*u') * weights;
+         *
+         * This is applied in place as a rank-1 update, i.e.:
+         * weights = (1 + lrate/N) * weights - lrate/N * (y+u) * (u' * weights)
+         * so the H x H matrices are never created.
+         */
         const FloatType learnRate = m_LearningRate / (FloatType) m_U.rows();
-        m_Weights.array() += (learnRate * (id - sumYU * m_U.transpose()) * m_Weights).array();
+        m_SumYU = m_Y + m_U;
+        m_UW.noalias() = m_U.transpose() * m_Weights;
+        m_Weights *= (FloatType) 1 + learnRate;
+        m_Weights.noalias() -= learnRate * m_SumYU * m_UW;
     }
 
     void calculateUY(const cv::Mat &image)
     {
-        BOB_ASSERT(image.type() == CV_8UC1);
-
-        const cv::Size &unwrapRes = getUnwrapResolution();
-        BOB_ASSERT(image.cols == unwrapRes.width);
-        BOB_ASSERT(image.rows == unwrapRes.height);
+        checkImage(image);
 
         // Convert image to vector of floats
-        m_U = m_Weights * getFloatVector(image);
+        m_U.noalias() = m_Weights * getFloatVector(image);
         m_Y = tanh(m_U.array());
     }
 
@@ -150,16 +220,30 @@ public:
         return weights.transpose();
     }
 
+protected:
+    static auto getFloatVector(const cv::Mat &image)
+    {
+        BOB_ASSERT(image.isContinuous());
+        Eigen::Map<Eigen::Matrix<uint8_t, Eigen::Dynamic, 1>> map(image.data, image.cols * image.rows);
+        return map.cast<FloatType>() / (FloatType) 255;
+    }
+
 private:
     size_t m_SnapshotCount = 0;
     FloatType m_LearningRate;
     MatrixType m_Weights;
-    VectorType m_U, m_Y;
+    VectorType m_U, m_Y, m_SumYU;
+    Eigen::Matrix<FloatType, 1, Eigen::Dynamic> m_UW;
+    MatrixType m_BatchInputs, m_BatchU, m_BatchY, m_BatchUW;
+    mutable MatrixType m_BatchOutputs;
 
-    static auto getFloatVector(const cv::Mat &image)
+    void checkImage(const cv::Mat &image) const
     {
-        Eigen::Map<Eigen::Matrix<uint8_t, Eigen::Dynamic, 1>> map(image.data, image.cols * image.rows);
-        return map.cast<FloatType>() / 255.0;
+        BOB_ASSERT(image.type() == CV_8UC1);
+
+        const cv::Size &unwrapRes = getUnwrapResolution();
+        BOB_ASSERT(image.cols == unwrapRes.width);
+        BOB_ASSERT(image.rows == unwrapRes.height);
     }
 
     template<class T>
@@ -231,20 +315,23 @@ private:
     template<typename R>
     void calcImageDifferences(R &rotater) const
     {
-        // Ensure there's enough space in rotated differe
-        m_RotatedDifferences.reserve(rotater.numRotations());
-        m_RotatedDifferences.clear();
-
-        // Populate rotated differences with results
-        rotater.rotate([this] (const cv::Mat &image, auto, auto) {
-            m_RotatedDifferences.push_back(this->test(image));
+        // Gather all rotations into the columns of one matrix...
+        const cv::Size unwrapRes = this->getUnwrapResolution();
+        m_RotatedInputs.resize(unwrapRes.width * unwrapRes.height, rotater.numRotations());
+        rotater.rotate([this] (const cv::Mat &image, auto, size_t i) {
+            BOB_ASSERT(i < (size_t) m_RotatedInputs.cols());
+            this->copyToColumn(image, m_RotatedInputs.col(i));
         });
+
+        // ...so they can be tested with a single matrix-matrix product
+        this->testBatch(m_RotatedInputs, m_RotatedDifferences);
     }
 
     //------------------------------------------------------------------------
     // Members
     //------------------------------------------------------------------------
     mutable std::vector<FloatType> m_RotatedDifferences;
+    mutable MatrixType m_RotatedInputs;
 };
 } // Navigation
 } // BoBRobotics
@@ -0,0 +1,261 @@
+#pragma once
+
+// BoB robotics includes
+#include "common/macros.h"
+#include "common/thread_pool.h"
+#include "infomax.h"
+#include "insilico_rotater.h"
+#include "visual_navigation_base.h"
+
+// Third-party includes
+#include "third_party/units.h"
+
+// Eigen
+#include <Eigen/Core>
+
+// OpenCV
+#include <opencv2/opencv.hpp>
+
+// Standard C includes
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+// Standard C++ includes
+#include <algorithm>
+#include <memory>
+#include <tuple>
+#include <vector>
+
+namespace BoBRobotics {
+namespace Navigation {
+namespace Internal {
+//! Dot product of int8 weights with uint8 inputs, using SIMD where available
+int64_t
+dotProductS8U8(const int8_t *weights, const uint8_t *inputs, size_t n);
+} // Internal
+
+//------------------------------------------------------------------------
+// BoBRobotics::Navigation::InfoMaxQuantised
+//------------------------------------------------------------------------
+/*!
+ * \brief An inference-only version of InfoMaxRotater with weights quantised
+ *        to 8-bit integers
+ *
+ * Each row of the weight matrix is stored as int8s along with a single float
+ * scale factor (the row's largest absolute weight / 127), using a quarter of
+ * the memory of float weights. Images are never converted to floats: the
+ * uint8 pixels are multiplied with the int8 weights with an integer SIMD
+ * kernel and the scale factor (with the division by 255 folded in) is applied
+ * once per hidden unit.
+ *
+ * Networks must be trained with InfoMax and then converted, either by passing
+ * the InfoMax object or its weights to the constructor.
+ */
+template<typename Rotater = InSilicoRotater>
+class InfoMaxQuantised : public VisualNavigationBase
+{
+public:
+    template<typename FloatType>
+    InfoMaxQuantised(const InfoMax<FloatType> &infomax)
+      : InfoMaxQuantised(infomax.getUnwrapResolution(), infomax.getWeights())
+    {}
+
+    template<class Derived>
+    InfoMaxQuantised(const cv::Size &unwrapRes, const Eigen::MatrixBase<Derived> &weights)
+      : VisualNavigationBase(unwrapRes)
+      , m_NumInputs(static_cast<size_t>(unwrapRes.width * unwrapRes.height))
+      , m_NumHidden(static_cast<size_t>(weights.rows()))
+      , m_Weights(m_NumInputs * m_NumHidden)
+      , m_Scales(m_NumHidden)
+    {
+        BOB_ASSERT(static_cast<size_t>(weights.cols()) == m_NumInputs);
+
+        for (size_t i = 0; i < m_NumHidden; i++) {
+            const auto row = weights.row(i).template cast<double>();
+            const double maxWeight = row.cwiseAbs().maxCoeff();
+            const double scale = (maxWeight > 0.0) ? (maxWeight / 127.0) : 1.0;
+
+            int8_t *quantised = &m_Weights[i * m_NumInputs];
+            for (size_t j = 0; j < m_NumInputs; j++) {
+                quantised[j] = static_cast<int8_t>(std::lround(row(j) / scale));
+            }
+
+            // Fold the conversion of pixels to the range 0-1 into the scale
+            m_Scales[i] = static_cast<float>(scale / 255.0);
+        }
+    }
+
+    //------------------------------------------------------------------------
+    // VisualNavigationBase virtuals
+    //------------------------------------------------------------------------
+    //! Quantised networks can't be trained: train with InfoMax and convert
+    BOB_NOT_IMPLEMENTED(virtual void train(const cv::Mat &) override)
+
+    virtual float test(const cv::Mat &image) const override
+    {
+        checkImage(image);
+
+        const uint8_t *input = getContinuousInput(image);
+        float sum = 0.f;
+        for (size_t i = 0; i < m_NumHidden; i++) {
+            sum += std::fabs(m_Scales[i] * static_cast<float>(Internal::dotProductS8U8(&m_Weights[i * m_NumInputs], input, m_NumInputs)));
+        }
+        return sum;
+    }
+
+    BOB_NOT_IMPLEMENTED(virtual void clearMemory() override)
+
+    //------------------------------------------------------------------------
+    // Public API
+    //------------------------------------------------------------------------
+    template<class... Ts>
+    const std::vector<float> &getImageDifferences(Ts &&... args) const
+    {
+        auto rotater = Rotater::create(getUnwrapResolution(), getMaskImage(), std::forward<Ts>(args)...);
+        calcImageDifferences(rotater);
+        return m_RotatedDifferences;
+    }
+
+    template<class... Ts>
+    auto getHeading(Ts &&... args) const
+    {
+        using radian_t = units::angle::radian_t;
+
+        auto rotater = Rotater::create(getUnwrapResolution(), getMaskImage(), std::forward<Ts>(args)...);
+        calcImageDifferences(rotater);
+
+        // Find index of lowest difference
+        const auto el = std::min_element(m_RotatedDifferences.cbegin(), m_RotatedDifferences.cend());
+        const size_t bestIndex = std::distance(m_RotatedDifferences.cbegin(), el);
+
+        // Convert this to an angle
+        radian_t heading = rotater.columnToHeading(bestIndex);
+        while (heading <= -180_deg) {
+            heading += 360_deg;
+        }
+        while (heading > 180_deg) {
+            heading -= 360_deg;
+        }
+
+        return std::make_tuple(heading, *el, std::cref(m_RotatedDifferences));
+    }
+
+    /*!
+     * \brief Split testing of rotations between numThreads threads
+     *
+     * By default, everything is done on the calling thread.
+     */
+    void setNumThreads(size_t numThreads)
+    {
+        if (numThreads > 1) {
+            m_ThreadPool = std::make_shared<ThreadPool>(numThreads);
+        } else {
+            m_ThreadPool.reset();
+        }
+    }
+
+    //! Get the quantised weights, stored row by row
+    const std::vector<int8_t> &getWeights() const
+    {
+        return m_Weights;
+    }
+
+    //! Get the factor by which each row of weights is multiplied (including the division of pixels by 255)
+    const std::vector<float> &getScales() const
+    {
+        return m_Scales;
+    }
+
+private:
+    //------------------------------------------------------------------------
+    // Private API
+    //------------------------------------------------------------------------
+    template<typename R>
+    void calcImageDifferences(R &rotater) const
+    {
+        // Gather all rotations into the rows of one buffer...
+        const size_t numRotations = rotater.numRotations();
+        m_RotatedInputs.resize(numRotations * m_NumInputs);
+        rotater.rotate([this, numRotations](const cv::Mat &image, auto, size_t rotation) {
+            BOB_ASSERT(rotation < numRotations);
+            copyToRow(image, &m_RotatedInputs[rotation * m_NumInputs]);
+        });
+
+        /*
+         * ...so that each row of weights is loaded once and applied to every
+         * rotation while it's in cache
+         */
+        m_RotatedDifferences.assign(numRotations, 0.f);
+        if (m_ThreadPool) {
+            // Give each chunk of hidden units its own sums, to be added up afterwards
+            const size_t numChunks = m_ThreadPool->getNumThreads();
+            m_PartialDifferences.assign(numChunks * numRotations, 0.f);
+            m_ThreadPool->parallelFor(m_NumHidden,
+                                      [this, numRotations](size_t chunk, size_t begin, size_t end) {
+                                          accumulateDifferences(begin, end, numRotations,
+                                                                &m_PartialDifferences[chunk * numRotations]);
+                                      });
+
+            for (size_t chunk = 0; chunk < numChunks; chunk++) {
+                const float *partial = &m_PartialDifferences[chunk * numRotations];
+                for (size_t rotation = 0; rotation < numRotations; rotation++) {
+                    m_RotatedDifferences[rotation] += partial[rotation];
+                }
+            }
+        } else {
+            accumulateDifferences(0, m_NumHidden, numRotations, m_RotatedDifferences.data());
+        }
+    }
+
+    void accumulateDifferences(size_t beginHidden, size_t endHidden, size_t numRotations, float *differences) const
+    {
+        for (size_t i = beginHidden; i < endHidden; i++) {
+            const int8_t *weights = &m_Weights[i * m_NumInputs];
+            for (size_t rotation = 0; rotation < numRotations; rotation++) {
+                const int64_t dot = Internal::dotProductS8U8(weights, &m_RotatedInputs[rotation * m_NumInputs], m_NumInputs);
+                differences[rotation] += std::fabs(m_Scales[i] * static_cast<float>(dot));
+            }
+        }
+    }
+
+    const uint8_t *getContinuousInput(const cv::Mat &image) const
+    {
+        if (image.isContinuous()) {
+            return image.data;
+        }
+
+        m_RotatedInputs.resize(m_NumInputs);
+        copyToRow(image, m_RotatedInputs.data());
+        return m_RotatedInputs.data();
+    }
+
+    void checkImage(const cv::Mat &image) const
+    {
+        BOB_ASSERT(image.type() == CV_8UC1);
+
+        const cv::Size &unwrapRes = getUnwrapResolution();
+        BOB_ASSERT(image.cols == unwrapRes.width);
+        BOB_ASSERT(image.rows == unwrapRes.height);
+    }
+
+    //! The image may not be continuous (e.g. a view), so copy row by row
+    static void copyToRow(const cv::Mat &image, uint8_t *out)
+    {
+        for (int y = 0; y < image.rows; y++) {
+            std::memcpy(&out[y * image.cols], image.ptr(y), image.cols);
+        }
+    }
+
+    //------------------------------------------------------------------------
+    // Members
+    //------------------------------------------------------------------------
+    const size_t m_NumInputs, m_NumHidden;
+    std::vector<int8_t> m_Weights;
+    std::vector<float> m_Scales;
+    std::shared_ptr<ThreadPool> m_ThreadPool;
+    mutable std::vector<uint8_t> m_RotatedInputs;
+    mutable std::vector<float> m_RotatedDifferences, m_PartialDifferences;
+}; // InfoMaxQuantised
+} // Navigation
+} // BoBRobotics
@@ -2,6 +2,7 @@
 
 // BoB robotics includes
 #include "common/macros.h"
+#include "common/thread_pool.h"
 
 // Third-party includes
 #include "third_party/units.h"
@@ -49,43 +50,85 @@ struct InSilicoRotater
             BOB_ASSERT(image.type() == CV_8UC1);
             BOB_ASSERT(image.isContinuous());
             BOB_ASSERT(beginRoll < endRoll);
-            BOB_ASSERT((distance(endRoll, beginRoll) % scanStep) == 0);
-
-            const auto index = toIndex(beginRoll);
-            rollImage(image, m_Image, index);
-            if (!maskImage.empty()) {
-                rollImage(maskImage, m_MaskImage, index);
-            }
+            BOB_ASSERT((distance(beginRoll, endRoll) % scanStep) == 0);
         }
 
+        //! Roll the image to each rotation in turn and call func with it; this can be called repeatedly
         template<class Func>
         void rotate(Func func)
         {
             auto i = m_BeginRoll;
+            size_t rotation = 0;
             while (true) {
-                func(m_Image, m_MaskImage, distance(m_BeginRoll, i));
-
-                i += m_ScanStep;
-                if (i >= m_EndRoll) {
-                    break;
-                }
-
                 const auto index = toIndex(i);
                 rollImage(m_ImageOriginal, m_Image, index);
                 if (!m_MaskImageOriginal.empty()) {
                     rollImage(m_MaskImageOriginal, m_MaskImage, index);
                 }
+
+                func(m_Image, m_MaskImage, rotation++);
+
+                i += m_ScanStep;
+                if (i >= m_EndRoll) {
+                    break;
+                }
             }
         }
 
+        /*!
+         * \brief Rotate the image as with rotate(), but spread the rotations
+         *        across the threads in pool
+         *
+         * Each thread rolls the image into its own scratch buffers, so func
+         * must be safe to call concurrently for different rotations.
+         */
+        template<class Func>
+        void rotateInParallel(ThreadPool &pool, Func func)
+        {
+            rotateInParallel(pool, 1,
+                             [&func](const cv::Mat &image, const cv::Mat &maskImage, size_t rotation, size_t, size_t) {
+                                 func(image, maskImage, rotation);
+                             });
+        }
+
+        /*!
+         * \brief Split the work for each rotation into numParts parts and
+         *        spread the whole grid of rotations and parts across the
+         *        threads in pool
+         *
+         * func is called with each rotated image and the range of parts
+         * [partBegin, partEnd) to process for it. This keeps all the threads
+         * busy even when there are fewer rotations than threads.
+         */
+        template<class Func>
+        void rotateInParallel(ThreadPool &pool, size_t numParts, Func func)
+        {
+            pool.parallelFor(numRotations() * numParts,
+                             [this, numParts, &func](size_t, size_t begin, size_t end) {
+                                 cv::Mat image(m_ImageOriginal.rows, m_ImageOriginal.cols, CV_8UC1);
+                                 cv::Mat maskImage(m_MaskImageOriginal.rows, m_MaskImageOriginal.cols, m_MaskImageOriginal.type());
+                                 for (size_t rotation = begin / numParts; rotation * numParts < end; rotation++) {
+                                     const auto index = toIndex(m_BeginRoll + rotation * m_ScanStep);
+                                     rollImage(m_ImageOriginal, image, index);
+                                     if (!m_MaskImageOriginal.empty()) {
+                                         rollImage(m_MaskImageOriginal, maskImage, index);
+                                     }
+
+                                     const size_t first = rotation * numParts;
+                                     func(image, maskImage, rotation,
+                                          std::max(begin, first) - first, std::min(end, first + numParts) - first);
+                                 }
+                             });
+        }
+
         units::angle::radian_t columnToHeading(size_t column) const
         {
-            return units::angle::turn_t{ (double) toIndex(m_BeginRoll + column) / (double) m_ImageOriginal.cols };
+            return units::angle::turn_t{ (double) toIndex(m_BeginRoll + column * m_ScanStep) / (double) m_ImageOriginal.cols };
         }
 
         size_t numRotations() const
         {
-            return (m_EndRoll - m_BeginRoll) / m_ScanStep;
+            return distance(m_BeginRoll, m_EndRoll) / m_ScanStep;
         }
 
     private:
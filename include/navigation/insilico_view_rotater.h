@@ -0,0 +1,185 @@
+#pragma once
+
+// BoB robotics includes
+#include "common/macros.h"
+#include "common/thread_pool.h"
+
+// Third-party includes
+#include "third_party/units.h"
+
+// OpenCV
+#include <opencv2/opencv.hpp>
+
+// Standard C++ includes
+#include <algorithm>
+#include <iterator>
+
+namespace BoBRobotics {
+namespace Navigation {
+using namespace units::literals;
+
+//------------------------------------------------------------------------
+// BoBRobotics::Navigation::InSilicoViewRotater
+//------------------------------------------------------------------------
+/*!
+ * \brief A "rotater" for PerfectMemoryBase classes which, like
+ *        InSilicoRotater, rotates a panoramic image in silico, but without
+ *        copying the image for every rotation
+ *
+ * The image (and mask) are copied once into a buffer twice as wide, with the
+ * image repeated side by side. Rotating the image left by n columns is then
+ * just a (non-continuous) view starting at column n of this buffer. Stores
+ * must therefore accept images whose rows are not contiguous;
+ * PerfectMemoryStore::RawImage difference them row by row, giving identical
+ * results to InSilicoRotater.
+ */
+struct InSilicoViewRotater
+{
+    template<typename IterType>
+    class RotaterInternal
+    {
+    public:
+        RotaterInternal(const cv::Size &unwrapRes,
+                        const cv::Mat &maskImage,
+                        const cv::Mat &image,
+                        size_t scanStep,
+                        IterType beginRoll,
+                        IterType endRoll)
+          : m_ScanStep(scanStep)
+          , m_BeginRoll(beginRoll)
+          , m_EndRoll(endRoll)
+          , m_Width(image.cols)
+        {
+            BOB_ASSERT(image.cols == unwrapRes.width);
+            BOB_ASSERT(image.rows == unwrapRes.height);
+            BOB_ASSERT(image.type() == CV_8UC1);
+            BOB_ASSERT(beginRoll < endRoll);
+
+            cv::hconcat(image, image, m_ImageDoubled);
+            if (!maskImage.empty()) {
+                cv::hconcat(maskImage, maskImage, m_MaskImageDoubled);
+            }
+        }
+
+        template<class Func>
+        void rotate(Func func)
+        {
+            const size_t count = numRotations();
+            for (size_t rotation = 0; rotation < count; rotation++) {
+                func(getView(m_ImageDoubled, rotation), getView(m_MaskImageDoubled, rotation), rotation);
+            }
+        }
+
+        //! As the views are read-only, rotations can be trivially split between threads
+        template<class Func>
+        void rotateInParallel(ThreadPool &pool, Func func)
+        {
+            rotateInParallel(pool, 1,
+                             [&func](const cv::Mat &image, const cv::Mat &maskImage, size_t rotation, size_t, size_t) {
+                                 func(image, maskImage, rotation);
+                             });
+        }
+
+        //! Split each rotation into numParts parts and spread the grid across threads, as InSilicoRotater does
+        template<class Func>
+        void rotateInParallel(ThreadPool &pool, size_t numParts, Func func)
+        {
+            pool.parallelFor(numRotations() * numParts,
+                             [this, numParts, &func](size_t, size_t begin, size_t end) {
+                                 for (size_t rotation = begin / numParts; rotation * numParts < end; rotation++) {
+                                     const size_t first = rotation * numParts;
+                                     func(getView(m_ImageDoubled, rotation), getView(m_MaskImageDoubled, rotation), rotation,
+                                          std::max(begin, first) - first, std::min(end, first + numParts) - first);
+                                 }
+                             });
+        }
+
+        units::angle::radian_t columnToHeading(size_t column) const
+        {
+            return units::angle::turn_t{ (double) getColumn(column) / (double) m_Width };
+        }
+
+        size_t numRotations() const
+        {
+            return distance(m_BeginRoll, m_EndRoll) / m_ScanStep;
+        }
+
+    private:
+        const size_t m_ScanStep;
+        const IterType m_BeginRoll, m_EndRoll;
+        const int m_Width;
+        cv::Mat m_ImageDoubled, m_MaskImageDoubled;
+
+        //! Get the column the image is rolled left by for the given rotation
+        size_t getColumn(size_t rotation) const
+        {
+            return toIndex(m_BeginRoll + rotation * m_ScanStep) % m_Width;
+        }
+
+        cv::Mat getView(const cv::Mat &doubled, size_t rotation) const
+        {
+            if (doubled.empty()) {
+                return doubled;
+            }
+
+            const int column = static_cast<int>(getColumn(rotation));
+            return doubled(cv::Rect(column, 0, m_Width, doubled.rows));
+        }
+
+        static size_t distance(size_t first, size_t last)
+        {
+            return last - first;
+        }
+
+        template<typename Iter>
+        static size_t distance(Iter first, Iter last)
+        {
+            return static_cast<size_t>(std::distance(first, last));
+        }
+
+        static size_t toIndex(size_t index)
+        {
+            return index;
+        }
+
+        template<typename Iter>
+        static size_t toIndex(Iter it)
+        {
+            return *it;
+        }
+    };
+
+    template<typename IterType>
+    static auto
+    create(const cv::Size &unwrapRes,
+           const cv::Mat &maskImage,
+           const cv::Mat &image,
+           IterType beginRoll,
+           IterType endRoll)
+    {
+        return RotaterInternal<IterType>(unwrapRes, maskImage, image, 1, beginRoll, endRoll);
+    }
+
+    static auto
+    create(const cv::Size &unwrapRes,
+           const cv::Mat &maskImage,
+           const cv::Mat &image,
+           size_t scanStep,
+           size_t beginRoll,
+           size_t endRoll)
+    {
+        return RotaterInternal<size_t>(unwrapRes, maskImage, image, scanStep, beginRoll, endRoll);
+    }
+
+    static auto
+    create(const cv::Size &unwrapRes,
+           const cv::Mat &maskImage,
+           const cv::Mat &image,
+           size_t scanStep = 1,
+           size_t beginRoll = 0)
+    {
+        return RotaterInternal<size_t>(unwrapRes, maskImage, image, scanStep, beginRoll, image.cols);
+    }
+};
+} // Navigation
+} // BoBRobotics
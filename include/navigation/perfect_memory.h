@@ -2,6 +2,7 @@
 
 // BoB robotics includes
 #include "common/macros.h"
+#include "common/thread_pool.h"
 #include "differencers.h"
 #include "insilico_rotater.h"
 #include "perfect_memory_store_raw.h"
@@ -21,6 +22,7 @@
 #include <array>
 #include <functional>
 #include <limits>
+#include <memory>
 #include <numeric>
 #include <tuple>
 #include <vector>
@@ -89,8 +91,8 @@ public:
      //! Return the number of snapshots that have been read into memory
     size_t getNumSnapshots() const{ return m_Store.getNumSnapshots(); }
 
-    //! Return a specific snapshot
-    const cv::Mat &getSnapshot(size_t index) const{ return m_Store.getSnapshot(index); }
+    //! Return a specific snapshot (by value, as some stores construct it on demand)
+    cv::Mat getSnapshot(size_t index) const{ return m_Store.getSnapshot(index); }
 
     /*!
      * \brief Get differences between current view and stored snapshots
@@ -110,6 +112,13 @@ protected:
         return m_Store.calcSnapshotDifference(image, imageMask, snapshot, getMaskImage());
     }
 
+    //! Calculate differences between image and snapshots in [begin, end), calling func(snapshot, difference) for each
+    template<class Func>
+    void calcSnapshotDifferences(const cv::Mat &image, const cv::Mat &imageMask, size_t begin, size_t end, Func func) const
+    {
+        m_Store.calcSnapshotDifferences(image, imageMask, begin, end, getMaskImage(), func);
+    }
+
 private:
     //------------------------------------------------------------------------
     // Private members
@@ -151,64 +160,255 @@ public:
      * \brief Get an estimate for heading based on comparing image with stored
      *        snapshots
      *
-     * The parameters are perfect-forwarded to the Rotater class, so e.g. for
+     * The parameters are forwarded to the Rotater class, so e.g. for
      * InSilicoRotater one passes in a cv::Mat and (optionally) an unsigned int
      * for the scan step and for the AntWorldRotater, one passes in one or more
      * angles.
+     *
+     * If a snapshot window has been set with setSnapshotWindow(), only
+     * snapshots within the window are compared; the others are given an
+     * infinite difference.
      */
     template<class... Ts>
     auto getHeading(Ts &&... args) const
     {
-        auto rotater = Rotater::create(this->getUnwrapResolution(), this->getMaskImage(), std::forward<Ts>(args)...);
-        calcImageDifferences(rotater);
         const size_t numSnapshots = this->getNumSnapshots();
+        BOB_ASSERT(numSnapshots > 0);
+
+        // Start with a window around the last best-matching snapshot, if we have one
+        size_t halfWidth = m_WindowHalfWidth;
+        const bool windowed = (halfWidth > 0) && (m_LastBestSnapshot < numSnapshots);
+        size_t begin = 0, end = numSnapshots;
+        if (windowed) {
+            getWindow(halfWidth, begin, end);
+        }
+
+        auto rotater = Rotater::create(this->getUnwrapResolution(), this->getMaskImage(), args...);
+        resizeImageDifferences(rotater.numRotations());
+        calcImageDifferences(rotater, begin, end);
 
         // Now get the minimum for each snapshot and the column this corresponds to
-        std::vector<size_t> bestColumns;
-        bestColumns.reserve(numSnapshots);
-        std::vector<float> minDifferences;
-        minDifferences.reserve(numSnapshots);
-        for (size_t i = 0; i < numSnapshots; i++) {
-            const auto elem = std::min_element(std::cbegin(m_RotatedDifferences[i]), std::cend(m_RotatedDifferences[i]));
-            bestColumns.push_back(std::distance(std::cbegin(m_RotatedDifferences[i]), elem));
-            minDifferences.push_back(*elem);
+        std::vector<size_t> bestColumns(numSnapshots, 0);
+        std::vector<float> minDifferences(numSnapshots, std::numeric_limits<float>::infinity());
+        calcMinDifferences(begin, end, bestColumns, minDifferences);
+
+        // If the best match is poor, keep widening the window until it isn't (or we run out of snapshots)
+        while (windowed && (begin > 0 || end < numSnapshots)) {
+            const auto best = std::min_element(minDifferences.cbegin() + begin, minDifferences.cbegin() + end);
+            if (*best <= m_WindowWideningThreshold) {
+                break;
+            }
+
+            halfWidth *= 2;
+            size_t newBegin, newEnd;
+            getWindow(halfWidth, newBegin, newEnd);
+
+            // Only compare the snapshots we haven't already done
+            calcImageDifferences(rotater, newBegin, newEnd, begin, end);
+            calcMinDifferences(newBegin, begin, bestColumns, minDifferences);
+            calcMinDifferences(end, newEnd, bestColumns, minDifferences);
+            begin = newBegin;
+            end = newEnd;
         }
+        invalidateImageDifferences(begin, end);
+
+        // Remember the best-matching snapshot for next time
+        const auto best = std::min_element(minDifferences.cbegin() + begin, minDifferences.cbegin() + end);
+        m_LastBestSnapshot = static_cast<size_t>(std::distance(minDifferences.cbegin(), best));
 
         // Return result
         return std::tuple_cat(RIDFProcessor()(bestColumns, minDifferences, rotater),
                               std::make_tuple(std::cref(m_RotatedDifferences)));
     }
 
+    /*!
+     * \brief Only compare images with snapshots near the last best-matching one
+     *
+     * This is useful for following long routes, where the agent will be
+     * close to the snapshot it matched last time. Only the snapshots up to
+     * halfWidth either side of the last best match are compared. If the
+     * lowest difference is above wideningThreshold, the window is doubled
+     * until it isn't or the window covers the whole route. The first call
+     * (and the first after resetSnapshotWindow()) always searches the whole
+     * route.
+     *
+     * wideningThreshold is in the same units as the differences returned by
+     * the store, e.g. a mean absolute pixel difference (0-255) for
+     * PerfectMemoryStore::RawImage<AbsDiff>, or a distance between descriptors
+     * for PerfectMemoryStore::HOG.
+     *
+     * Note that RIDF processors which combine several snapshots (e.g.
+     * WeightSnapshotsDynamic) need the window to contain at least that many.
+     */
+    void setSnapshotWindow(size_t halfWidth, float wideningThreshold)
+    {
+        BOB_ASSERT(halfWidth > 0);
+        m_WindowHalfWidth = halfWidth;
+        m_WindowWideningThreshold = wideningThreshold;
+    }
+
+    //! Compare images with all snapshots again
+    void disableSnapshotWindow()
+    {
+        m_WindowHalfWidth = 0;
+    }
+
+    //! Forget the last best-matching snapshot, so the next search covers the whole route
+    void resetSnapshotWindow()
+    {
+        m_LastBestSnapshot = std::numeric_limits<size_t>::max();
+    }
+
+    //! Get the index of the best-matching snapshot found by the last call to getHeading()
+    size_t getLastBestSnapshot() const
+    {
+        return m_LastBestSnapshot;
+    }
+
+    virtual void clearMemory() override
+    {
+        PerfectMemory<Store>::clearMemory();
+        resetSnapshotWindow();
+    }
+
+    /*!
+     * \brief Set the number of threads used to compare images with snapshots
+     *
+     * With more than one thread, the grid of rotations and snapshots is split
+     * between the threads of a pool owned by this object, so they are kept
+     * busy even with few rotations. Each element of the image differences is
+     * still only written by one thread, so the results are the same as when
+     * running serially.
+     */
+    void setNumThreads(size_t numThreads)
+    {
+        BOB_ASSERT(numThreads > 0);
+        if (numThreads == 1) {
+            m_ThreadPool.reset();
+        } else {
+            m_ThreadPool = std::make_shared<ThreadPool>(numThreads);
+        }
+    }
+
+    //! Get the number of threads used to compare images with snapshots
+    size_t getNumThreads() const
+    {
+        return m_ThreadPool ? m_ThreadPool->getNumThreads() : 1;
+    }
+
 private:
     //------------------------------------------------------------------------
     // Private API
     //------------------------------------------------------------------------
+    void resizeImageDifferences(size_t numRotations) const
+    {
+        // Preallocate snapshot difference vectors
+        m_RotatedDifferences.resize(this->getNumSnapshots());
+        for (auto &differences : m_RotatedDifferences) {
+            differences.resize(numRotations, std::numeric_limits<float>::infinity());
+        }
+    }
+
+    /*
+     * Calculate differences for snapshots in range [begin, end), skipping
+     * those in [skipBegin, skipEnd)
+     */
+    template<class RotaterType>
+    void calcImageDifferences(RotaterType &rotater, size_t begin, size_t end,
+                              size_t skipBegin = 0, size_t skipEnd = 0) const
+    {
+        // The snapshots to compare are [begin, firstEnd) followed by [secondBegin, end)
+        const bool skip = (skipBegin < skipEnd);
+        const size_t firstEnd = skip ? skipBegin : end;
+        const size_t secondBegin = skip ? skipEnd : end;
+        const size_t numFirst = firstEnd - begin;
+        const size_t numCompared = numFirst + (end - secondBegin);
+
+        // Calculate differences for the compared snapshots numbered [partBegin, partEnd)
+        const auto calcDifferences =
+                [this, begin, secondBegin, numFirst](const cv::Mat &fr, const cv::Mat &mask, size_t i,
+                                                     size_t partBegin, size_t partEnd) {
+                    const auto setDifference = [this, i](size_t s, float difference) {
+                        m_RotatedDifferences[s][i] = difference;
+                    };
+                    if (partBegin < numFirst) {
+                        this->calcSnapshotDifferences(fr, mask, begin + partBegin,
+                                                      begin + std::min(partEnd, numFirst), setDifference);
+                    }
+                    if (partEnd > numFirst) {
+                        this->calcSnapshotDifferences(fr, mask, secondBegin + std::max(partBegin, numFirst) - numFirst,
+                                                      secondBegin + partEnd - numFirst, setDifference);
+                    }
+                };
+
+        // Scan across image columns, splitting the grid of columns and snapshots between threads if requested
+        if (numCompared > 0) {
+            if (m_ThreadPool) {
+                rotater.rotateInParallel(*m_ThreadPool, numCompared, calcDifferences);
+            } else {
+                rotater.rotate([&calcDifferences, numCompared](const cv::Mat &fr, const cv::Mat &mask, size_t i) {
+                    calcDifferences(fr, mask, i, 0, numCompared);
+                });
+            }
+        }
+
+        m_ValidBegin = std::min(begin, m_ValidBegin);
+        m_ValidEnd = std::max(end, m_ValidEnd);
+    }
+
     template<class RotaterType>
     void calcImageDifferences(RotaterType &rotater) const
     {
         const size_t numSnapshots = this->getNumSnapshots();
         BOB_ASSERT(numSnapshots > 0);
 
-        // Preallocate snapshot difference vectors
-        while (m_RotatedDifferences.size() < numSnapshots) {
-            m_RotatedDifferences.emplace_back(rotater.numRotations());
+        resizeImageDifferences(rotater.numRotations());
+        calcImageDifferences(rotater, 0, numSnapshots);
+    }
+
+    //! Get the minimum difference and the column this corresponds to for snapshots in [begin, end)
+    void calcMinDifferences(size_t begin, size_t end, std::vector<size_t> &bestColumns,
+                            std::vector<float> &minDifferences) const
+    {
+        for (size_t i = begin; i < end; i++) {
+            const auto elem = std::min_element(std::cbegin(m_RotatedDifferences[i]), std::cend(m_RotatedDifferences[i]));
+            bestColumns[i] = std::distance(std::cbegin(m_RotatedDifferences[i]), elem);
+            minDifferences[i] = *elem;
         }
+    }
 
-        // Scan across image columns
-        rotater.rotate(
-                [this, numSnapshots](const cv::Mat &fr, const cv::Mat &mask, size_t i) {
-                    // Loop through snapshots
-                    for (size_t s = 0; s < numSnapshots; s++) {
-                        // Calculate difference
-                        m_RotatedDifferences[s][i] = this->calcSnapshotDifference(fr, mask, s);
-                    }
-                });
+    //! Mark differences left over from previous calls outside [begin, end) as invalid
+    void invalidateImageDifferences(size_t begin, size_t end) const
+    {
+        const size_t validEnd = std::min(m_ValidEnd, m_RotatedDifferences.size());
+        for (size_t s = m_ValidBegin; s < validEnd; s++) {
+            if (s == begin) {
+                s = end - 1;
+                continue;
+            }
+            std::fill(m_RotatedDifferences[s].begin(), m_RotatedDifferences[s].end(),
+                      std::numeric_limits<float>::infinity());
+        }
+        m_ValidBegin = begin;
+        m_ValidEnd = end;
+    }
+
+    //! Get the window of snapshots around the last best-matching one
+    void getWindow(size_t halfWidth, size_t &begin, size_t &end) const
+    {
+        begin = (m_LastBestSnapshot > halfWidth) ? (m_LastBestSnapshot - halfWidth) : 0;
+        end = std::min(this->getNumSnapshots(), m_LastBestSnapshot + halfWidth + 1);
     }
 
     //------------------------------------------------------------------------
     // Members
     //------------------------------------------------------------------------
     mutable std::vector<std::vector<float>> m_RotatedDifferences;
+    mutable size_t m_ValidBegin = 0, m_ValidEnd = 0;
+    std::shared_ptr<ThreadPool> m_ThreadPool;
+    size_t m_WindowHalfWidth = 0;
+    float m_WindowWideningThreshold = std::numeric_limits<float>::infinity();
+    mutable size_t m_LastBestSnapshot = std::numeric_limits<size_t>::max();
 }; // PerfectMemoryBase
 } // Navigation
 } // BoBRobotics
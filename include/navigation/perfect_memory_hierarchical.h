@@ -0,0 +1,285 @@
+#pragma once
+
+// BoB robotics includes
+#include "common/macros.h"
+#include "perfect_memory.h"
+#include "perfect_memory_store_raw.h"
+#include "ridf_processors.h"
+
+// Third-party includes
+#include "third_party/units.h"
+
+// OpenCV
+#include <opencv2/opencv.hpp>
+
+// Standard C++ includes
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+namespace BoBRobotics {
+namespace Navigation {
+
+//------------------------------------------------------------------------
+// BoBRobotics::Navigation::PerfectMemoryHierarchical
+//------------------------------------------------------------------------
+/*!
+ * \brief A perfect memory which estimates heading with a coarse-to-fine
+ *        search, rather than comparing every snapshot at every rotation
+ *
+ * An image pyramid is built for each snapshot as it is added, with each level
+ * having half the resolution of the one below. When testing, all snapshots
+ * are compared with the test image at every rotation at the coarsest level.
+ * Only the best-matching numCandidates snapshots then go on to the finer
+ * levels. At each finer level, a snapshot is only compared at the columns
+ * around the best column found at the level above.
+ *
+ * Snapshots which didn't make the cut are reported to RIDFProcessor as having
+ * an infinite difference, so numCandidates should be at least as big as the
+ * number of snapshots RIDFProcessor uses (e.g. numComp for
+ * WeightSnapshotsDynamic).
+ */
+template<typename RIDFProcessor = BestMatchingSnapshot, typename Store = PerfectMemoryStore::RawImage<>>
+class PerfectMemoryHierarchical : public PerfectMemory<Store>
+{
+public:
+    /*!
+     * \param unwrapRes    The resolution of the full-size images
+     * \param numLevels    The number of levels in the pyramid, including the
+     *                     full-size image
+     * \param storeArgs    Extra arguments for the Store at each level
+     */
+    template<class... Ts>
+    PerfectMemoryHierarchical(const cv::Size &unwrapRes, size_t numLevels = 3, const Ts &... storeArgs)
+      : PerfectMemory<Store>(unwrapRes, storeArgs...)
+    {
+        BOB_ASSERT(numLevels > 0);
+
+        // Create stores for the downsampled levels
+        cv::Size levelRes = unwrapRes;
+        for (size_t level = 1; level < numLevels; level++) {
+            levelRes = getDownsampledSize(levelRes);
+            m_LevelStores.emplace_back(levelRes, storeArgs...);
+        }
+    }
+
+    //------------------------------------------------------------------------
+    // VisualNavigationBase virtuals
+    //------------------------------------------------------------------------
+    virtual void train(const cv::Mat &image) override
+    {
+        PerfectMemory<Store>::train(image);
+
+        // Add downsampled copies of snapshot to the other levels
+        cv::Mat levelImage = image;
+        for (auto &store : m_LevelStores) {
+            levelImage = downsample(levelImage);
+            store.addSnapshot(levelImage);
+        }
+    }
+
+    virtual void clearMemory() override
+    {
+        PerfectMemory<Store>::clearMemory();
+        for (auto &store : m_LevelStores) {
+            store.clear();
+        }
+    }
+
+    //------------------------------------------------------------------------
+    // Public API
+    //------------------------------------------------------------------------
+    //! Set how many snapshots are refined at the finer levels of the pyramid
+    void setNumCandidates(size_t numCandidates)
+    {
+        BOB_ASSERT(numCandidates > 0);
+        m_NumCandidates = numCandidates;
+    }
+
+    //! Set how many columns either side of the previous level's best column are searched
+    void setSearchRadius(int searchRadius)
+    {
+        BOB_ASSERT(searchRadius >= 0);
+        m_SearchRadius = searchRadius;
+    }
+
+    //! Get the number of levels in the pyramid, including the full-size image
+    size_t getNumLevels() const
+    {
+        return m_LevelStores.size() + 1;
+    }
+
+    /*!
+     * \brief Get an estimate for heading based on comparing image with stored
+     *        snapshots
+     *
+     * The result is in the same format as returned by RIDFProcessor.
+     */
+    auto getHeading(const cv::Mat &image) const
+    {
+        const cv::Size &unwrapRes = this->getUnwrapResolution();
+        BOB_ASSERT(image.size() == unwrapRes);
+        BOB_ASSERT(image.type() == CV_8UC1);
+
+        const size_t numSnapshots = this->getNumSnapshots();
+        BOB_ASSERT(numSnapshots > 0);
+
+        // Build pyramids for the test image and mask
+        std::vector<cv::Mat> images{ image }, masks{ this->getMaskImage() };
+        for (size_t level = 1; level < getNumLevels(); level++) {
+            images.emplace_back(downsample(images.back()));
+            masks.emplace_back(downsampleMask(masks.back(), images.back().size()));
+        }
+
+        // At the coarsest level, find the best column for every snapshot
+        const size_t coarsest = getNumLevels() - 1;
+        m_BestColumns.assign(numSnapshots, 0);
+        m_MinDifferences.assign(numSnapshots, std::numeric_limits<float>::infinity());
+        {
+            const int width = images[coarsest].cols;
+            const auto doubledImage = doubleWidth(images[coarsest]);
+            const auto doubledMask = doubleWidth(masks[coarsest]);
+            for (int column = 0; column < width; column++) {
+                const auto view = getView(doubledImage, column, width);
+                const auto maskView = getView(doubledMask, column, width);
+                for (size_t s = 0; s < numSnapshots; s++) {
+                    const float difference = calcSnapshotDifference(coarsest, view, maskView, s, masks[coarsest]);
+                    if (difference < m_MinDifferences[s]) {
+                        m_MinDifferences[s] = difference;
+                        m_BestColumns[s] = static_cast<size_t>(column);
+                    }
+                }
+            }
+        }
+
+        // Pick the best-matching snapshots as candidates for refinement
+        const size_t numCandidates = std::min(m_NumCandidates, numSnapshots);
+        m_Candidates.resize(numSnapshots);
+        std::iota(m_Candidates.begin(), m_Candidates.end(), 0);
+        std::partial_sort(m_Candidates.begin(), m_Candidates.begin() + numCandidates, m_Candidates.end(),
+                          [this](size_t a, size_t b) {
+                              return m_MinDifferences[a] < m_MinDifferences[b];
+                          });
+        m_Candidates.resize(numCandidates);
+
+        // Other snapshots are excluded from the final result
+        std::vector<float> coarseDifferences(numCandidates);
+        for (size_t i = 0; i < numCandidates; i++) {
+            coarseDifferences[i] = m_MinDifferences[m_Candidates[i]];
+        }
+        std::fill(m_MinDifferences.begin(), m_MinDifferences.end(), std::numeric_limits<float>::infinity());
+
+        // Refine candidates' best columns at each finer level in turn
+        for (size_t level = coarsest; level-- > 0;) {
+            const int width = images[level].cols;
+            const int widthAbove = images[level + 1].cols;
+            const auto doubledImage = doubleWidth(images[level]);
+            const auto doubledMask = doubleWidth(masks[level]);
+
+            for (size_t s : m_Candidates) {
+                // Scale best column from level above and search around it
+                const int centre = static_cast<int>((m_BestColumns[s] * width + widthAbove / 2) / widthAbove);
+                float minDifference = std::numeric_limits<float>::infinity();
+                for (int offset = -m_SearchRadius; offset <= m_SearchRadius; offset++) {
+                    const int column = (centre + offset + width) % width;
+                    const float difference = calcSnapshotDifference(level,
+                                                                    getView(doubledImage, column, width),
+                                                                    getView(doubledMask, column, width),
+                                                                    s, masks[level]);
+                    if (difference < minDifference) {
+                        minDifference = difference;
+                        m_BestColumns[s] = static_cast<size_t>(column);
+                    }
+                }
+
+                if (level == 0) {
+                    m_MinDifferences[s] = minDifference;
+                }
+            }
+        }
+
+        // If there's only one level, the coarse differences are the full-size ones
+        if (coarsest == 0) {
+            for (size_t i = 0; i < numCandidates; i++) {
+                m_MinDifferences[m_Candidates[i]] = coarseDifferences[i];
+            }
+        }
+
+        // Columns are now in terms of the full-size image
+        return RIDFProcessor()(m_BestColumns, m_MinDifferences, ColumnHeadings{ unwrapRes.width });
+    }
+
+private:
+    //! Converts columns of the full-size image to headings for RIDFProcessor, in place of a rotater
+    struct ColumnHeadings
+    {
+        int width;
+
+        units::angle::radian_t columnToHeading(size_t column) const
+        {
+            return units::angle::turn_t{ (double) column / (double) width };
+        }
+    };
+
+    //------------------------------------------------------------------------
+    // Private API
+    //------------------------------------------------------------------------
+    float calcSnapshotDifference(size_t level, const cv::Mat &image, const cv::Mat &imageMask,
+                                 size_t snapshot, const cv::Mat &snapshotMask) const
+    {
+        if (level == 0) {
+            return PerfectMemory<Store>::calcSnapshotDifference(image, imageMask, snapshot);
+        } else {
+            return m_LevelStores[level - 1].calcSnapshotDifference(image, imageMask, snapshot, snapshotMask);
+        }
+    }
+
+    static cv::Size getDownsampledSize(const cv::Size &size)
+    {
+        return { (size.width + 1) / 2, (size.height + 1) / 2 };
+    }
+
+    static cv::Mat downsample(const cv::Mat &image)
+    {
+        cv::Mat out;
+        cv::resize(image, out, getDownsampledSize(image.size()), 0, 0, cv::INTER_AREA);
+        return out;
+    }
+
+    static cv::Mat downsampleMask(const cv::Mat &mask, const cv::Size &size)
+    {
+        cv::Mat out;
+        if (!mask.empty()) {
+            cv::resize(mask, out, size, 0, 0, cv::INTER_NEAREST);
+        }
+        return out;
+    }
+
+    //! Place two copies of the image side by side, so rotations are just views
+    static cv::Mat doubleWidth(const cv::Mat &image)
+    {
+        cv::Mat out;
+        if (!image.empty()) {
+            cv::hconcat(image, image, out);
+        }
+        return out;
+    }
+
+    static cv::Mat getView(const cv::Mat &doubled, int column, int width)
+    {
+        return doubled.empty() ? doubled : doubled(cv::Rect(column, 0, width, doubled.rows));
+    }
+
+    //------------------------------------------------------------------------
+    // Members
+    //------------------------------------------------------------------------
+    std::vector<Store> m_LevelStores;
+    size_t m_NumCandidates = 10;
+    int m_SearchRadius = 2;
+    mutable std::vector<size_t> m_BestColumns, m_Candidates;
+    mutable std::vector<float> m_MinDifferences;
+}; // PerfectMemoryHierarchical
+} // Navigation
+} // BoBRobotics
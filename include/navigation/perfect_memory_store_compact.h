@@ -0,0 +1,314 @@
+#pragma once
+
+// BoB robotics includes
+#include "common/macros.h"
+#include "differencers.h"
+
+// OpenCV includes
+#include <opencv2/opencv.hpp>
+
+// Standard C includes
+#include <cstdint>
+#include <cstring>
+
+// Standard C++ includes
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace BoBRobotics {
+namespace Navigation {
+namespace PerfectMemoryStore {
+
+//------------------------------------------------------------------------
+// BoBRobotics::Navigation::PerfectMemoryStore::CompactImage
+//------------------------------------------------------------------------
+/*!
+ * \brief Perfect memory store which packs all snapshots into a single,
+ *        contiguous, cache-line-aligned block of memory
+ *
+ * Unlike RawImage, there is no heap allocation or cv::Mat header per
+ * snapshot, so routes can be streamed through the difference kernels
+ * sequentially. When full, the capacity of the block is doubled.
+ *
+ * Optionally, snapshots can be quantised to 4 bits per pixel, halving memory
+ * usage. They are then compared with the (full-precision) test image after
+ * being expanded back to the range 0-255.
+ *
+ * \tparam Differencer This can be AbsDiff or RMSDiff
+ */
+template<typename Differencer = AbsDiff>
+class CompactImage
+{
+public:
+    CompactImage(const cv::Size &unwrapRes, bool quantise4Bit = false)
+      : m_UnwrapRes(unwrapRes)
+      , m_Quantise4Bit(quantise4Bit)
+      , m_SnapshotStride(roundUpToCacheLine(getSnapshotSize()))
+    {}
+
+    //! Copy other's snapshots into a new block, aligned for this object
+    CompactImage(const CompactImage &other)
+      : m_UnwrapRes(other.m_UnwrapRes)
+      , m_Quantise4Bit(other.m_Quantise4Bit)
+      , m_SnapshotStride(other.m_SnapshotStride)
+    {
+        reserve(other.m_Capacity);
+        if (other.m_NumSnapshots > 0) {
+            std::memcpy(m_Arena, other.m_Arena, other.m_NumSnapshots * m_SnapshotStride);
+        }
+        m_NumSnapshots = other.m_NumSnapshots;
+    }
+
+    //! Take ownership of other's block, which stays at the same address, leaving other empty
+    CompactImage(CompactImage &&other) noexcept
+      : m_UnwrapRes(other.m_UnwrapRes)
+      , m_Quantise4Bit(other.m_Quantise4Bit)
+      , m_SnapshotStride(other.m_SnapshotStride)
+      , m_NumSnapshots(other.m_NumSnapshots)
+      , m_Capacity(other.m_Capacity)
+      , m_Buffer(std::move(other.m_Buffer))
+      , m_Arena(other.m_Arena)
+    {
+        other.m_NumSnapshots = 0;
+        other.m_Capacity = 0;
+        other.m_Buffer.clear();
+        other.m_Arena = nullptr;
+    }
+
+    CompactImage &operator=(const CompactImage &) = delete;
+    CompactImage &operator=(CompactImage &&) = delete;
+
+    //------------------------------------------------------------------------
+    // Public API
+    //------------------------------------------------------------------------
+    size_t getNumSnapshots() const
+    {
+        return m_NumSnapshots;
+    }
+
+    /*!
+     * \brief Get a stored snapshot
+     *
+     * Unquantised snapshots are returned as a read-only view of the block,
+     * which is only valid until the store is next reallocated, cleared or
+     * destroyed; clone() it to keep it. 4-bit snapshots are expanded into a
+     * new image.
+     */
+    cv::Mat getSnapshot(size_t index) const
+    {
+        BOB_ASSERT(index < m_NumSnapshots);
+
+        const uint8_t *snapshot = getSnapshotPtr(index);
+        if (m_Quantise4Bit) {
+            cv::Mat unpacked(m_UnwrapRes, CV_8UC1);
+            unpack4Bit(snapshot, 0, m_UnwrapRes.area(), unpacked.data);
+            return unpacked;
+        } else {
+            return cv::Mat(m_UnwrapRes, CV_8UC1, const_cast<uint8_t *>(snapshot));
+        }
+    }
+
+    size_t addSnapshot(const cv::Mat &image)
+    {
+        BOB_ASSERT(image.size() == m_UnwrapRes);
+        BOB_ASSERT(image.type() == CV_8UC1);
+
+        // Double capacity if we've run out of space
+        if (m_NumSnapshots == m_Capacity) {
+            reserve(std::max<size_t>(1, 2 * m_Capacity));
+        }
+
+        uint8_t *snapshot = getSnapshotPtr(m_NumSnapshots);
+        const size_t width = static_cast<size_t>(m_UnwrapRes.width);
+        for (int y = 0; y < image.rows; y++) {
+            if (m_Quantise4Bit) {
+                pack4Bit(image.ptr(y), y * width, width, snapshot);
+            } else {
+                std::memcpy(&snapshot[y * width], image.ptr(y), width);
+            }
+        }
+
+        // Return index of new snapshot
+        return m_NumSnapshots++;
+    }
+
+    //! Allocate space for numSnapshots snapshots, so they can be added without reallocating
+    void reserve(size_t numSnapshots)
+    {
+        if (numSnapshots <= m_Capacity) {
+            return;
+        }
+
+        // Over-allocate so we can align the start of the block to a cache line
+        std::vector<uint8_t> buffer(numSnapshots * m_SnapshotStride + CacheLineSize, 0);
+        uint8_t *arena = alignToCacheLine(buffer.data());
+        if (m_NumSnapshots > 0) {
+            std::memcpy(arena, m_Arena, m_NumSnapshots * m_SnapshotStride);
+        }
+
+        m_Buffer.swap(buffer);
+        m_Arena = arena;
+        m_Capacity = numSnapshots;
+    }
+
+    void clear()
+    {
+        m_NumSnapshots = 0;
+    }
+
+    //! Get the number of bytes used to store each snapshot, including padding
+    size_t getSnapshotStride() const
+    {
+        return m_SnapshotStride;
+    }
+
+    float calcSnapshotDifference(const cv::Mat &image, const cv::Mat &imageMask, size_t snapshot, const cv::Mat &snapshotMask) const
+    {
+        const uint8_t *snapshotPtr = getSnapshotPtr(snapshot);
+
+        // If the image isn't continuous (e.g. it comes from InSilicoViewRotater), go row by row
+        const bool continuous = image.isContinuous() && (imageMask.empty() || imageMask.isContinuous());
+        const int numPasses = continuous ? 1 : image.rows;
+        const size_t passSize = continuous ? (image.rows * image.cols) : image.cols;
+
+        uint64_t sumDifference = 0;
+        size_t numUnmaskedPixels = 0;
+        for (int y = 0; y < numPasses; y++) {
+            const size_t offset = y * passSize;
+            const uint8_t *imagePtr = image.ptr(y);
+            const uint8_t *imageMaskPtr = imageMask.empty() ? nullptr : imageMask.ptr(y);
+            const uint8_t *snapshotMaskPtr = imageMask.empty() ? nullptr : snapshotMask.ptr(y);
+
+            if (m_Quantise4Bit) {
+                // Expand snapshot in small chunks which will stay in L1 cache
+                alignas(CacheLineSize) uint8_t chunk[ChunkSize];
+                for (size_t i = 0; i < passSize; i += ChunkSize) {
+                    const size_t chunkSize = std::min(ChunkSize, passSize - i);
+                    unpack4Bit(snapshotPtr, offset + i, chunkSize, chunk);
+                    sumDifference += sumPass(&imagePtr[i], chunk,
+                                             imageMaskPtr ? &imageMaskPtr[i] : nullptr,
+                                             snapshotMaskPtr ? &snapshotMaskPtr[i] : nullptr,
+                                             chunkSize, numUnmaskedPixels);
+                }
+            } else {
+                sumDifference += sumPass(imagePtr, &snapshotPtr[offset],
+                                         imageMaskPtr, snapshotMaskPtr,
+                                         passSize, numUnmaskedPixels);
+            }
+        }
+
+        // Return mean
+        if (imageMask.empty()) {
+            return Differencer::mean((float) sumDifference, (float) (image.rows * image.cols));
+        } else {
+            return Differencer::mean((float) sumDifference, (float) numUnmaskedPixels);
+        }
+    }
+
+    /*!
+     * \brief Calculate differences between image and snapshots in
+     *        [begin, end), calling func(snapshot, difference) for each
+     */
+    template<class Func>
+    void calcSnapshotDifferences(const cv::Mat &image, const cv::Mat &imageMask, size_t begin, size_t end,
+                                 const cv::Mat &snapshotMask, Func func) const
+    {
+        for (size_t s = begin; s < end; s++) {
+            func(s, calcSnapshotDifference(image, imageMask, s, snapshotMask));
+        }
+    }
+
+private:
+    //------------------------------------------------------------------------
+    // Constants
+    //------------------------------------------------------------------------
+    static constexpr size_t CacheLineSize = 64;
+    static constexpr size_t ChunkSize = 512;
+
+    //------------------------------------------------------------------------
+    // Members
+    //------------------------------------------------------------------------
+    const cv::Size m_UnwrapRes;
+    const bool m_Quantise4Bit;
+    const size_t m_SnapshotStride;
+    size_t m_NumSnapshots = 0;
+    size_t m_Capacity = 0;
+    std::vector<uint8_t> m_Buffer;
+    uint8_t *m_Arena = nullptr;
+
+    //------------------------------------------------------------------------
+    // Private methods
+    //------------------------------------------------------------------------
+    size_t getSnapshotSize() const
+    {
+        const size_t numPixels = m_UnwrapRes.area();
+        return m_Quantise4Bit ? ((numPixels + 1) / 2) : numPixels;
+    }
+
+    const uint8_t *getSnapshotPtr(size_t index) const
+    {
+        return &m_Arena[index * m_SnapshotStride];
+    }
+
+    uint8_t *getSnapshotPtr(size_t index)
+    {
+        return &m_Arena[index * m_SnapshotStride];
+    }
+
+    static uint64_t sumPass(const uint8_t *image, const uint8_t *snapshot,
+                            const uint8_t *imageMask, const uint8_t *snapshotMask,
+                            size_t n, size_t &numUnmaskedPixels)
+    {
+        if (!imageMask) {
+            return Differencer::sum(image, snapshot, n);
+        } else {
+            size_t numUnmasked;
+            const uint64_t sum = Differencer::sumMasked(image, snapshot, imageMask, snapshotMask, n, numUnmasked);
+            numUnmaskedPixels += numUnmasked;
+            return sum;
+        }
+    }
+
+    //! Pack n 8-bit pixels into nibbles, starting at pixel index start
+    static void pack4Bit(const uint8_t *in, size_t start, size_t n, uint8_t *out)
+    {
+        for (size_t i = 0; i < n; i++) {
+            const size_t pixel = start + i;
+            const uint8_t nibble = in[i] >> 4;
+            uint8_t &byte = out[pixel / 2];
+            byte = (pixel % 2) ? ((byte & 0x0F) | (nibble << 4)) : ((byte & 0xF0) | nibble);
+        }
+    }
+
+    //! Unpack n nibbles, starting at pixel index start, into the range 0-255
+    static void unpack4Bit(const uint8_t *in, size_t start, size_t n, uint8_t *out)
+    {
+        for (size_t i = 0; i < n; i++) {
+            const size_t pixel = start + i;
+            const uint8_t byte = in[pixel / 2];
+            const uint8_t nibble = (pixel % 2) ? (byte >> 4) : (byte & 0x0F);
+            out[i] = nibble * 17;
+        }
+    }
+
+    static size_t roundUpToCacheLine(size_t size)
+    {
+        return ((size + CacheLineSize - 1) / CacheLineSize) * CacheLineSize;
+    }
+
+    static uint8_t *alignToCacheLine(uint8_t *ptr)
+    {
+        const auto address = reinterpret_cast<uintptr_t>(ptr);
+        return ptr + (roundUpToCacheLine(address) - address);
+    }
+}; // CompactImage
+
+template<typename Differencer>
+constexpr size_t CompactImage<Differencer>::CacheLineSize;
+
+template<typename Differencer>
+constexpr size_t CompactImage<Differencer>::ChunkSize;
+} // PerfectMemoryStore
+} // Navigation
+} // BoBRobotics
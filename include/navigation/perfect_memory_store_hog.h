@@ -38,8 +38,7 @@ public:
     }
 
     HOG(const cv::Size &unwrapRes, const cv::Size &blockSize, const cv::Size &blockStride, int numOrientations)
-    :   m_HOGDescriptorSize(numOrientations * ((unwrapRes.width - blockSize.width)/blockStride.width + 1) * ((unwrapRes.height - blockSize.height)/blockStride.height + 1)),
-        m_Differencer(m_HOGDescriptorSize)
+    :   m_HOGDescriptorSize(numOrientations * ((unwrapRes.width - blockSize.width)/blockStride.width + 1) * ((unwrapRes.height - blockSize.height)/blockStride.height + 1))
     {
         LOG_INFO << "Creating perfect memory for " << m_HOGDescriptorSize<< " entry HOG features";
 
@@ -86,30 +85,52 @@ public:
     }
 
     // Calculate difference between memory and snapshot with index
-    float calcSnapshotDifference(const cv::Mat &image, const cv::Mat &imageMask, size_t snapshot, const cv::Mat &) const
+    float calcSnapshotDifference(const cv::Mat &image, const cv::Mat &imageMask, size_t snapshot, const cv::Mat &snapshotMask) const
+    {
+        float difference;
+        calcSnapshotDifferences(image, imageMask, snapshot, snapshot + 1, snapshotMask,
+                                [&difference](size_t, float d) { difference = d; });
+        return difference;
+    }
+
+    /*!
+     * \brief Calculate differences between image and snapshots in
+     *        [begin, end), calling func(snapshot, difference) for each
+     *
+     * The image's HOG descriptors are only calculated once for the whole
+     * range. The scratch memory is local so that this can be called from
+     * several threads at once.
+     */
+    template<class Func>
+    void calcSnapshotDifferences(const cv::Mat &image, const cv::Mat &imageMask, size_t begin, size_t end,
+                                 const cv::Mat &, Func func) const
     {
         BOB_ASSERT(imageMask.empty());
 
         // Calculate HOG descriptors of image
-        m_HOG.compute(image, m_ScratchDescriptors);
-        BOB_ASSERT(m_ScratchDescriptors.size() == m_HOGDescriptorSize);
-
-        // Calculate differences between image HOG descriptors and snapshot
-        auto diffIter = m_Differencer(m_Snapshots[snapshot], m_ScratchDescriptors, m_ScratchDescriptors);
-
-        // Calculate RMS
-        return Differencer::mean(std::accumulate(diffIter, diffIter + m_HOGDescriptorSize, 0.0f),
-                                 m_HOGDescriptorSize);
+        std::vector<float> imageDescriptors;
+        m_HOG.compute(image, imageDescriptors);
+        BOB_ASSERT(imageDescriptors.size() == m_HOGDescriptorSize);
+
+        // Loop through snapshots
+        std::vector<float> scratchDifferences(m_HOGDescriptorSize);
+        Differencer differencer(m_HOGDescriptorSize);
+        for (size_t s = begin; s < end; s++) {
+            // Calculate differences between image HOG descriptors and snapshot
+            auto diffIter = differencer(m_Snapshots[s], imageDescriptors, scratchDifferences);
+
+            // Calculate RMS
+            func(s, Differencer::mean(std::accumulate(diffIter, diffIter + m_HOGDescriptorSize, 0.0f),
+                                      m_HOGDescriptorSize));
+        }
     }
 
 private:
     //------------------------------------------------------------------------
     // Members
     //------------------------------------------------------------------------
-    mutable std::vector<float> m_ScratchDescriptors;
     std::vector<std::vector<float>> m_Snapshots;
     cv::HOGDescriptor m_HOG;
-    mutable Differencer m_Differencer;
 }; // HOG
 } // PerfectMemoryStore
 } // Navigation
@@ -1,6 +1,7 @@
 #pragma once
 
 // BoB robotics includes
+#include "common/macros.h"
 #include "differencers.h"
 #include "ridf_processors.h"
 
@@ -11,11 +12,10 @@
 #include <opencv2/opencv.hpp>
 
 // Standard C includes
-#include <cassert>
+#include <cstdint>
 #include <cstdlib>
 
 // Standard C++ includes
-#include <numeric>
 #include <vector>
 
 namespace BoBRobotics {
@@ -28,15 +28,16 @@ namespace PerfectMemoryStore {
 /*!
  * \brief The conventional perfect memory (RIDF) algorithm
  *
+ * Differences are calculated with Differencer's fused SIMD kernels, so no
+ * intermediate difference image is created.
+ *
  * \tparam Differencer This can be AbsDiff or RMSDiff
  */
 template<typename Differencer = AbsDiff>
 class RawImage
 {
 public:
-    RawImage(const cv::Size unwrapRes)
-      : m_Differencer(unwrapRes.width * unwrapRes.height)
-      , m_DiffScratchImage(unwrapRes, CV_8UC1)
+    RawImage(const cv::Size)
     {}
 
     //------------------------------------------------------------------------
@@ -69,41 +70,54 @@ public:
 
     float calcSnapshotDifference(const cv::Mat &image, const cv::Mat &imageMask, size_t snapshot, const cv::Mat &snapshotMask) const
     {
-        // Calculate difference between image and stored image
-        const int imSize = image.rows * image.cols;
-        auto diffIter = m_Differencer(image, m_Snapshots[snapshot], m_DiffScratchImage);
+        const cv::Mat &snapshotImage = m_Snapshots[snapshot];
+
+        /*
+         * If the image is continuous, we can difference it against the stored
+         * image in a single pass. Otherwise (e.g. it is a view into a larger
+         * image, as given by InSilicoViewRotater), we go row by row.
+         */
+        const bool continuous = image.isContinuous() && (imageMask.empty() || imageMask.isContinuous());
+        const int numPasses = continuous ? 1 : image.rows;
+        const size_t passSize = continuous ? (image.rows * image.cols) : image.cols;
 
         // If there's no mask
+        uint64_t sumDifference = 0;
         if (imageMask.empty()) {
-            float sumDifference = std::accumulate(diffIter, diffIter + imSize, 0.0f);
+            for (int y = 0; y < numPasses; y++) {
+                sumDifference += Differencer::sum(image.ptr(y), snapshotImage.ptr(y), passSize);
+            }
 
             // Return mean
-            return Differencer::mean(sumDifference, imSize);
+            return Differencer::mean((float) sumDifference, (float) (image.rows * image.cols));
         }
-        // Otherwise
+        // Otherwise only include pixels masked by neither the rotated mask
+        // associated with image nor the non-rotated mask associated with snapshot
         else {
-            // Get raw access to rotated mask associated with image and non-rotated mask associated with snapshot
-            uint8_t *imageMaskPtr = imageMask.data;
-            uint8_t *snapshotMaskPtr = snapshotMask.data;
-
-            // Loop through pixels
-            float sumDifference = 0.0f;
-            unsigned int numUnmaskedPixels = 0;
-            const uint8_t *end = &imageMaskPtr[imSize];
-            while (imageMaskPtr < end) {
-                // If this pixel is masked by neither of the masks
-                if (*imageMaskPtr++ != 0 && *snapshotMaskPtr++) {
-                    // Accumulate sum of differences
-                    sumDifference += (float) *diffIter;
-
-                    // Increment unmasked pixels count
-                    numUnmaskedPixels++;
-                }
-                diffIter++;
+            size_t numUnmaskedPixels = 0;
+            for (int y = 0; y < numPasses; y++) {
+                size_t numUnmaskedRow;
+                sumDifference += Differencer::sumMasked(image.ptr(y), snapshotImage.ptr(y),
+                                                        imageMask.ptr(y), snapshotMask.ptr(y),
+                                                        passSize, numUnmaskedRow);
+                numUnmaskedPixels += numUnmaskedRow;
             }
 
             // Return mean
-            return Differencer::mean(sumDifference, (float) numUnmaskedPixels);
+            return Differencer::mean((float) sumDifference, (float) numUnmaskedPixels);
+        }
+    }
+
+    /*!
+     * \brief Calculate differences between image and snapshots in
+     *        [begin, end), calling func(snapshot, difference) for each
+     */
+    template<class Func>
+    void calcSnapshotDifferences(const cv::Mat &image, const cv::Mat &imageMask, size_t begin, size_t end,
+                                 const cv::Mat &snapshotMask, Func func) const
+    {
+        for (size_t s = begin; s < end; s++) {
+            func(s, calcSnapshotDifference(image, imageMask, s, snapshotMask));
         }
     }
 
@@ -112,8 +126,6 @@ private:
     // Members
     //------------------------------------------------------------------------
     std::vector<cv::Mat> m_Snapshots;
-    mutable Differencer m_Differencer;
-    mutable cv::Mat m_DiffScratchImage;
 }; // RawImage
 } // PerfectMemoryStore
 } // Navigation
@@ -24,9 +24,17 @@ class Client
   : public Connection
 {
 public:
-    //! Create client and connect to host over TCP
+    /*!
+     * \brief Create client and connect to host over TCP
+     *
+     * If binaryProtocol is true, the binary protocol will be used if the
+     * server supports it and if datagrams is true, commands can also be sent
+     * over UDP (see Connection).
+     */
     Client(const std::string &host = getDefaultIP(),
-           uint16_t port = DefaultListenPort);
+           uint16_t port = DefaultListenPort,
+           bool binaryProtocol = false,
+           bool datagrams = false);
 
     const std::string &getIP() const;
     static std::string getDefaultIP();
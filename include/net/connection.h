@@ -2,10 +2,16 @@
 
 // BoB robotics includes
 #include "common/threadable.h"
+#include "datagram.h"
 #include "socket.h"
 
+// Standard C includes
+#include <cstdint>
+#include <cstring>
+
 // Standard C++ includes
 #include <functional>
+#include <initializer_list>
 #include <map>
 #include <memory>
 #include <mutex>
@@ -18,16 +24,80 @@ namespace Net {
 
 class Connection; // forward declaration
 
+//! Opcodes for messages sent with the binary protocol
+namespace Opcode {
+//! Plaintext commands and raw data, exactly as they would be sent without the binary protocol
+constexpr uint16_t Stream = 0;
+
+//! Tank steering command: left and right speeds as floats
+constexpr uint16_t Tank = 1;
+
+//! A video frame: a Video::NetFrameHeader followed by the encoded frame
+constexpr uint16_t Image = 2;
+} // Opcode
+
+//! A message received with the binary protocol
+struct Message
+{
+    uint16_t opcode;
+    const uint8_t *payload;
+    size_t size;
+
+    //! Read a value from offset bytes into the payload, throwing BadCommandError if the payload is too short
+    template<class T>
+    T get(size_t offset = 0) const
+    {
+        if (offset + sizeof(T) > size) {
+            throw BadCommandError();
+        }
+
+        T value;
+        std::memcpy(&value, payload + offset, sizeof(T));
+        return value;
+    }
+};
+
 //! A callback function to handle incoming commands over the network
 using CommandHandler = std::function<void(Connection &, const Command &)>;
 
+//! A callback function to handle incoming messages sent with the binary protocol
+using MessageHandler = std::function<void(Connection &, const Message &)>;
+
 //! A callback function which is notified when a connection is made
 using ConnectedHandler = std::function<void(Connection &)>;
 
 //----------------------------------------------------------------------------
 // BoBRobotics::Net::Connection
 //----------------------------------------------------------------------------
-//! An abstract class representing a network connection, inherited by Server and Client classes
+/*!
+ * \brief An abstract class representing a network connection, inherited by
+ *        Server and Client classes
+ *
+ * By default, commands are sent as lines of plaintext. Connections can also
+ * switch to a binary protocol, in which everything is sent as messages made
+ * up of an eight-byte header (a 16-bit opcode, two reserved bytes and a
+ * 32-bit payload length, in host byte order) followed by the payload.
+ * Messages are dispatched to handlers by opcode, so they don't need to be
+ * formatted or parsed as text.
+ *
+ * The binary protocol is negotiated when connecting: the server advertises
+ * it with "HEY BIN", a client which has called requestBinaryProtocol() replies
+ * with "BIN" and the server confirms with its own "BIN". Each end switches the
+ * direction it sends in straight after sending "BIN", so peers which don't
+ * know about the binary protocol carry on using plaintext. Once switched,
+ * plaintext commands and raw data are still delivered, wrapped in
+ * Opcode::Stream messages, so code which only knows about plaintext keeps
+ * working.
+ *
+ * Commands can also be sent as UDP datagrams with sendDatagram(), so that a
+ * lost packet doesn't hold up everything sent after it (see DatagramChannel).
+ * This is negotiated in the same way: the server advertises it with "UDP" in
+ * its greeting, a client which has called requestDatagrams() replies with
+ * "UDP <port>" and the server replies with its own port. Datagrams are passed
+ * to the same command handlers as commands sent over TCP, though on a
+ * different thread, so handlers for them mustn't read any extra data from
+ * the Connection.
+ */
 class Connection : public Threadable
 {
 public:
@@ -45,10 +115,27 @@ public:
         SocketWriter &operator=(SocketWriter &&) = default;
 
         //! Send data via the Socket
-        template<typename... Args>
-        void send(Args &&... args)
+        void send(const void *buffer, size_t length);
+
+        //! Send a string via the Socket
+        void send(const std::string &msg);
+
+        //! Check whether the binary protocol has been negotiated for sending
+        bool isBinary() const;
+
+        /*!
+         * \brief Send a binary message whose payload is the concatenation of
+         *        the given buffers, without copying them
+         *
+         * Only valid if isBinary() returns true.
+         */
+        void sendMessage(uint16_t opcode, std::initializer_list<ConstBuffer> payload);
+
+        //! Send a binary message whose payload is the raw bytes of the given values
+        template<typename... Ts>
+        void sendValues(uint16_t opcode, const Ts &... values)
         {
-            m_Connection.m_Socket.send(std::forward<Args>(args)...);
+            sendMessage(opcode, { ConstBuffer{ &values, sizeof(Ts) }... });
         }
 
     private:
@@ -64,6 +151,7 @@ public:
       , m_Socket(std::forward<Ts>(args)...)
       , m_SendMutex(std::make_unique<std::mutex>())
       , m_CommandHandlersMutex(std::make_unique<std::mutex>())
+      , m_MessageHandlersMutex(std::make_unique<std::mutex>())
     {}
 
     virtual ~Connection() override;
@@ -78,6 +166,40 @@ public:
      */
     void setCommandHandler(const std::string &commandName, const CommandHandler handler);
 
+    /*!
+     * \brief Add a handler for messages with the specified opcode, sent with
+     *        the binary protocol
+     *
+     * Set to nullptr to disable and ignore these messages.
+     */
+    void setMessageHandler(uint16_t opcode, const MessageHandler handler);
+
+    /*!
+     * \brief Ask to switch to the binary protocol, if the other end supports it
+     *
+     * This must be called before the server's greeting is read.
+     */
+    void requestBinaryProtocol();
+
+    /*!
+     * \brief Ask to also exchange commands as UDP datagrams, if the other end
+     *        supports it
+     *
+     * This must be called before the server's greeting is read.
+     */
+    void requestDatagrams();
+
+    //! Check whether datagrams have been negotiated
+    bool hasDatagrams() const;
+
+    /*!
+     * \brief Send a single command as a datagram
+     *
+     * If datagrams haven't been negotiated, the command is sent over TCP
+     * instead, so callers don't need to check.
+     */
+    void sendDatagram(const std::string &command, Delivery delivery = Delivery::Latest);
+
     //! Read a specified number of bytes into a buffer
     void read(void *buffer, size_t length);
 
@@ -98,13 +220,30 @@ protected:
 
 private:
     std::map<std::string, CommandHandler> m_CommandHandlers;
+    std::vector<MessageHandler> m_MessageHandlers;
     std::vector<char> m_Buffer;
     Socket m_Socket;
-    std::unique_ptr<std::mutex> m_SendMutex, m_CommandHandlersMutex;
+    std::unique_ptr<std::mutex> m_SendMutex, m_CommandHandlersMutex, m_MessageHandlersMutex;
     size_t m_BufferStart = 0, m_BufferBytes = 0;
 
+    // Binary protocol state (m_SendBinary is protected by m_SendMutex)
+    bool m_RequestBinary = false, m_SendBinary = false, m_ReceiveBinary = false;
+    size_t m_StreamBytesLeft = 0;
+
+    // Bytes which arrived before we switched to the binary protocol and the payload of the current message
+    std::vector<char> m_WireBuffer;
+    size_t m_WireBufferStart = 0;
+    std::vector<uint8_t> m_MessageBuffer;
+
+    // Datagram state (m_Datagrams is accessed atomically, as it's set by the reading thread)
+    bool m_RequestDatagrams = false;
+    std::shared_ptr<DatagramChannel> m_Datagrams;
+
     bool parseCommand(Command &command);
 
+    //! Pass a command to its handler
+    void handleCommand(const Command &command);
+
     //! Read a plaintext command, splitting it into separate words
     Command readCommand();
 
@@ -114,6 +253,20 @@ private:
     // Debit the byte store by specified amount
     void debitBytes(const size_t nbytes);
 
+    //! Read plaintext command bytes, handling any binary messages which arrive first
+    size_t readStream(void *buffer, size_t length);
+
+    //! Read bytes off the wire, starting with any left over from before the switch to the binary protocol
+    size_t readWire(void *buffer, size_t length);
+    void readWireExactly(void *buffer, size_t length);
+
+    void sendStream(const void *buffer, size_t length);
+    void sendBinaryRequest();
+    void startReceivingBinary();
+    void offerDatagrams();
+    void startDatagrams(const Command &command);
+    void handleMessage(uint16_t opcode, size_t length);
+
 }; // Connection
 } // Net
 } // BoBRobotics
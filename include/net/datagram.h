@@ -0,0 +1,152 @@
+#pragma once
+
+// BoB robotics includes
+#include "socket.h"
+
+// Standard C includes
+#include <cstdint>
+
+// Standard C++ includes
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace BoBRobotics {
+namespace Net {
+
+//! How commands sent as datagrams are delivered
+enum class Delivery
+{
+    /*!
+     * \brief For state (e.g. motor speeds): each command supersedes earlier
+     *        ones with the same name
+     *
+     * Commands which arrive after a newer one with the same name are dropped.
+     * Only the newest command with each name is retransmitted, for as long as
+     * it takes to be acknowledged, so the receiver ends up with the latest
+     * value (e.g. a final stop) without waiting for stale ones.
+     */
+    Latest,
+
+    /*!
+     * \brief For control: each command is retransmitted until acknowledged
+     *        (or the channel is closed) and delivered once, though not
+     *        necessarily in order
+     */
+    Reliable,
+};
+
+//----------------------------------------------------------------------------
+// BoBRobotics::Net::DatagramChannel
+//----------------------------------------------------------------------------
+/*!
+ * \brief Sends and receives plaintext commands as UDP datagrams
+ *
+ * Unlike with TCP, a lost packet only delays the command it carries, rather
+ * than everything sent after it. Each datagram has an eight-byte header (a
+ * 32-bit sequence number, a byte of flags and three reserved bytes, in host
+ * byte order) followed by a single command. Datagrams are acknowledged by
+ * sending back just the header with the Ack flag set. Reliable commands are
+ * retransmitted until they're acknowledged, however long the link is down,
+ * so control commands aren't lost to a burst of packet loss; Latest ones
+ * until they're acknowledged or superseded. Datagrams which don't carry a
+ * command are dropped and counted (see getNumMalformedDatagrams()).
+ *
+ * Used by Connection (see Connection::requestDatagrams()), rather than
+ * directly.
+ */
+class DatagramChannel
+{
+public:
+    //! Called on the receiving thread for each command which is delivered
+    using Handler = std::function<void(const Command &)>;
+
+    //! The largest datagram we'll send, chosen to avoid IP fragmentation
+    static constexpr size_t MaxDatagramSize = 1200;
+
+    //! Open a UDP socket on a port chosen by the OS
+    DatagramChannel();
+    ~DatagramChannel();
+
+    //! Get the port on which we're receiving datagrams
+    uint16_t getLocalPort() const;
+
+    /*!
+     * \brief Exchange datagrams with the given address only, starting a
+     *        thread to pass received commands to handler
+     */
+    void start(const sockaddr_in &peer, const Handler handler);
+
+    bool isStarted() const;
+
+    //! Get how many datagrams have been dropped because they didn't hold a valid command
+    size_t getNumMalformedDatagrams() const;
+
+    //! Send a single command (a trailing newline is optional)
+    void send(const std::string &command, Delivery delivery);
+
+    /*!
+     * \brief Wait until every datagram sent has been acknowledged, for at
+     *        most timeout
+     *
+     * Call before tearing the channel down, so e.g. a final stop command
+     * isn't lost with it.
+     *
+     * @return Whether everything was acknowledged in time
+     */
+    bool flush(std::chrono::milliseconds timeout);
+
+    // Object is non-copyable
+    DatagramChannel(const DatagramChannel &) = delete;
+    void operator=(const DatagramChannel &) = delete;
+
+private:
+    using TimePoint = std::chrono::steady_clock::time_point;
+
+    struct PendingDatagram
+    {
+        uint32_t sequence;
+        std::vector<char> data;
+        TimePoint lastSent;
+        int transmissions;
+    };
+
+    Socket m_Socket;
+    std::thread m_Thread;
+    std::atomic<bool> m_Started{ false }, m_DoRun{ true };
+    std::atomic<size_t> m_NumMalformed{ 0 };
+
+    // Sending state, protected by m_SendMutex
+    std::mutex m_SendMutex;
+    std::condition_variable m_FlushedCondition;
+    uint32_t m_NextLatestSequence = 0, m_NextReliableSequence = 0;
+    std::map<std::string, PendingDatagram> m_PendingLatest;
+    std::map<uint32_t, PendingDatagram> m_PendingReliable;
+
+    // Receiving state, only used by the receiving thread
+    std::map<std::string, uint32_t> m_LatestReceived;
+    uint32_t m_NextReliable = 0;
+    std::set<uint32_t> m_ReliableAhead;
+
+    void runReceive(const Handler handler);
+    void handleDatagram(const char *data, size_t length, const Handler &handler);
+    void handleAck(uint32_t sequence, bool reliable);
+
+    //! Check whether a reliable datagram is new, remembering that we've now seen it
+    bool isNewReliable(uint32_t sequence);
+
+    void retransmit();
+    void transmit(const void *data, size_t length);
+
+    //! Check whether there's nothing awaiting acknowledgement (with m_SendMutex held)
+    bool isFlushed() const;
+}; // DatagramChannel
+} // Net
+} // BoBRobotics
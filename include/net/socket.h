@@ -10,6 +10,7 @@
 
 // Standard C++ includes
 #include <atomic>
+#include <cstddef>
 #include <stdexcept>
 #include <string>
 #include <vector>
@@ -20,6 +21,13 @@ namespace Net {
 //! Represents a command read from the network
 using Command = std::vector<std::string>;
 
+//! A buffer to be sent as part of a larger message, without copying
+struct ConstBuffer
+{
+    const void *data;
+    size_t size;
+};
+
 //! An exception thrown if the socket is deliberately being closed
 class SocketClosedError : public std::runtime_error
 {
@@ -74,6 +82,15 @@ public:
     //! Send a string over the socket.
     void send(const std::string &msg);
 
+    /*!
+     * \brief Send several buffers with a single system call, as if they were
+     *        one contiguous buffer (at most MaxBuffers)
+     */
+    void send(const ConstBuffer *buffers, size_t numBuffers);
+
+    //! The maximum number of buffers which can be sent at once
+    static constexpr size_t MaxBuffers = 16;
+
     // Object is non-copyable
     Socket(const Socket &) = delete;
     void operator=(const Socket &) = delete;
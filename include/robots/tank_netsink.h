@@ -63,7 +63,7 @@ public:
 
     virtual void setMaximumSpeedProportion(float value) override;
 
-    //! Motor command: send TNK command over TCP
+    //! Motor command: send TNK command as a datagram if possible, otherwise over TCP (as a binary Tank message if possible)
     virtual void tank(float left, float right) override;
 
     virtual millimeter_t getRobotWidth() const override;
@@ -8,18 +8,28 @@
 #include "common/stopwatch.h"
 #include "os/net.h"
 
+// POSIX includes
+#ifdef __linux__
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <time.h>
+#endif
+
 // Standard C includes
+#include <cmath>
 #include <cstring>
 
 // Standard C++ includes
 #include <algorithm>
 #include <array>
 #include <atomic>
+#include <chrono>
 #include <mutex>
 #include <stdexcept>
 #include <string>
+#include <memory>
 #include <thread>
-#include <unordered_map>
+#include <type_traits>
 #include <vector>
 
 namespace BoBRobotics
@@ -73,6 +83,22 @@ private:
 template<typename ObjectDataType>
 class UDPClient;
 
+/*!
+ * \brief Identifies an object tracked by a UDPClient
+ *
+ * Objects are numbered in the order in which they are first seen or
+ * registered with UDPClient::getObjectHandle(), so 0 is the first object.
+ */
+using ObjectHandle = size_t;
+
+//! A pose received from the Vicon system, with the (steady clock) time it arrived
+struct PoseSample
+{
+    std::chrono::steady_clock::time_point time;
+    uint32_t frameNumber;
+    Pose3<units::length::millimeter_t, units::angle::radian_t> pose;
+};
+
 //----------------------------------------------------------------------------
 // Vicon::ObjectDataVelocity
 //----------------------------------------------------------------------------
@@ -156,7 +182,8 @@ public:
  *  \brief Holds a reference to a Vicon object
  *
  * The pose data is updated every time it is read, in contrast to ObjectData,
- * which only contains static data.
+ * which only contains static data. Reading it never blocks the thread
+ * receiving data from the Vicon system and doesn't allocate memory.
  */
 template<typename ObjectDataType = ObjectData>
 class ObjectReference
@@ -166,20 +193,41 @@ class ObjectReference
 
 public:
     ObjectReference(const UDPClient<ObjectDataType> &client,
-                    const char *objectName,
+                    ObjectHandle handle,
                     const Stopwatch::Duration timeoutDuration)
       : m_Client(client)
+      , m_Handle(handle)
       , m_TimeoutDuration(timeoutDuration)
-    {
-        std::strcpy(m_Name, objectName);
-    }
+    {}
+
+    ObjectReference(const UDPClient<ObjectDataType> &client,
+                    const char *objectName,
+                    const Stopwatch::Duration timeoutDuration)
+      : ObjectReference(client, client.getObjectHandle(objectName), timeoutDuration)
+    {}
 
     auto getPose() const
     {
         return getData().getPose();
     }
 
-    const std::string &getName() const { return m_Name; }
+    const char *getName() const { return m_Client.getObjectName(m_Handle); }
+
+    ObjectHandle getHandle() const { return m_Handle; }
+
+    //! Get the pose at the given time (see UDPClient::getPoseAt())
+    template<class... Ts>
+    bool getPoseAt(Ts &&... args) const
+    {
+        return m_Client.getPoseAt(m_Handle, std::forward<Ts>(args)...);
+    }
+
+    //! Estimate velocity from recent poses (see UDPClient::getVelocity())
+    template<class... Ts>
+    bool getVelocity(Ts &&... args) const
+    {
+        return m_Client.getVelocity(m_Handle, std::forward<Ts>(args)...);
+    }
 
     auto timeSinceReceived() const
     {
@@ -188,8 +236,9 @@ public:
 
     ObjectDataType getData() const
     {
-        const auto objectData = m_Client.getObjectData(m_Name);
-        if (objectData.timeSinceReceived() > m_TimeoutDuration) {
+        ObjectDataType objectData{ getName() };
+        if (!m_Client.tryGetObjectData(m_Handle, objectData) ||
+                objectData.timeSinceReceived() > m_TimeoutDuration) {
             throw TimedOutError();
         }
         return objectData;
@@ -197,22 +246,41 @@ public:
 
 private:
     const UDPClient<ObjectDataType> &m_Client;
-    char m_Name[24];
+    const ObjectHandle m_Handle;
     const Stopwatch::Duration m_TimeoutDuration;
 };
 
 //----------------------------------------------------------------------------
 // BoBRobotics::Vicon::UDPClient
 //----------------------------------------------------------------------------
-//! Receiver for Vicon UDP streams
+/*!
+ * \brief Receiver for Vicon UDP streams
+ *
+ * Each object's data is stored in its own slot, protected by a sequence lock:
+ * the receiving thread never waits for readers and readers only retry if
+ * they happen to overlap with an update to the object they're reading. Slots
+ * are never moved or removed, so ObjectHandles can be used to look objects
+ * up without hashing names.
+ *
+ * The last HistorySize poses of each object are also kept, stamped with the
+ * time they arrived, so poses can be looked up for other times (e.g. when a
+ * camera frame was captured) with getPoseAt() and velocities can be estimated
+ * over several samples with getVelocity(). On Linux, all queued packets are
+ * read with a single system call, so the receiving thread keeps up at high
+ * frame rates.
+ */
 template<typename ObjectDataType = ObjectData>
 class UDPClient
 {
+    static_assert(std::is_trivially_copyable<ObjectDataType>::value,
+                  "ObjectDataType must be trivially copyable, so it can be read while being updated");
+
 private:
     /*
-     * A simple wrapper around char[N]. We need this because we use a fixed-size
-     * char array as a key for m_ObjectData and using a naked char[N] won't work
-     * (because it doesn't have a constructor).
+     * A simple wrapper around char[N]. We need this because we store object
+     * names in fixed-size char arrays, to avoid heap allocations, and using a
+     * naked char[N] as a const member won't work (because it doesn't have a
+     * constructor).
      */
 #define COMMA ,
     BOB_PACKED(template<size_t N>
@@ -220,6 +288,8 @@ private:
     {
         char data[N];
 
+        CharArray() = default;
+
         CharArray(const char *str)
         {
             strcpy(data COMMA str);
@@ -255,8 +325,19 @@ private:
         double position[3];
         double attitude[3];
     });
+    static_assert(sizeof(RawObjectData) == 75, "RawObjectData must be packed");
+
+    using millimeter_t = units::length::millimeter_t;
+    using radian_t = units::angle::radian_t;
+    using meters_per_second_t = units::velocity::meters_per_second_t;
+    using radians_per_second_t = units::angular_velocity::radians_per_second_t;
 
 public:
+    using TimePoint = std::chrono::steady_clock::time_point;
+
+    //! How many recent poses are kept for each object
+    static constexpr size_t HistorySize = 64;
+
     UDPClient() = default;
     UDPClient(uint16_t port)
     {
@@ -301,6 +382,24 @@ public:
             throw OS::Net::NetworkError("Cannot set socket timeout");
         }
 
+        // Ask for a large receive buffer so bursts of packets aren't dropped (failure isn't fatal)
+        const int receiveBufferSize = 1 << 20;
+        if (setsockopt(socket, SOL_SOCKET, SO_RCVBUF,
+                       reinterpret_cast<const char *>(&receiveBufferSize), sizeof(receiveBufferSize)) != 0) {
+            LOG_WARNING << "Vicon: Could not set socket receive buffer size";
+        }
+
+#ifdef __linux__
+        /*
+         * Have the kernel timestamp each datagram as it arrives, as several
+         * are read in one go and may have been queued for a while
+         */
+        const int enableTimestamps = 1;
+        if (setsockopt(socket, SOL_SOCKET, SO_TIMESTAMPNS, &enableTimestamps, sizeof(enableTimestamps)) != 0) {
+            LOG_WARNING << "Vicon: Could not enable packet timestamps";
+        }
+#endif
+
         // Create socket address structure
         sockaddr_in localAddress;
         memset(&localAddress, 0, sizeof(sockaddr_in));
@@ -318,45 +417,225 @@ public:
         m_ReadThread = std::thread(&UDPClient::readThread, this, socket);
     }
 
+    //! Get the number of objects seen or registered so far
     size_t getNumObjects() const
     {
         waitUntilConnected();
-        std::lock_guard<std::mutex> guard(m_ObjectMutex);
-        return m_ObjectData.size();
+        return m_NumObjects;
+    }
+
+    /*!
+     * \brief Get a handle for the named object, registering it if it hasn't
+     *        been seen yet
+     *
+     * Do this once, before a control loop starts, then use the handle.
+     */
+    ObjectHandle getObjectHandle(const std::string &name) const
+    {
+        BOB_ASSERT(name.size() < 24);
+        ObjectHandle handle;
+        if (!findObject(name.c_str(), handle)) {
+            handle = addObject(name.c_str());
+        }
+        return handle;
+    }
+
+    //! Get the name of the object with the given handle
+    const char *getObjectName(ObjectHandle handle) const
+    {
+        return getSlot(handle).name;
+    }
+
+    /*!
+     * \brief Get current pose information for the object with the given handle,
+     *        without waiting
+     *
+     * Returns false if no data has been received for this object yet.
+     */
+    bool tryGetObjectData(ObjectHandle handle, ObjectDataType &objectData) const
+    {
+        const ObjectSlot &slot = getSlot(handle);
+        return readConsistent(slot, [&]() {
+            std::memcpy(static_cast<void *>(&objectData), &slot.data, sizeof(ObjectDataType));
+        });
+    }
+
+    //! Get current pose information for the object with the given handle
+    ObjectDataType getObjectData(ObjectHandle handle) const
+    {
+        waitUntilConnected();
+
+        ObjectDataType objectData{ getObjectName(handle) };
+        if (!tryGetObjectData(handle, objectData)) {
+            throw std::out_of_range("No data received for Vicon object");
+        }
+        return objectData;
     }
 
     //! Get current pose information for specified object
     ObjectDataType getObjectData(const std::string &name) const
     {
-        // Note: We return by value because m_ObjectData is protected by mutex
         waitUntilConnected();
 
-        // Convert to fixed-size char array
         BOB_ASSERT(name.size() < 24);
-        char bytes[24];
-        strcpy(bytes, name.c_str());
+        ObjectHandle handle;
+        if (!findObject(name.c_str(), handle)) {
+            throw std::out_of_range("Unknown Vicon object: " + name);
+        }
+        return getObjectData(handle);
+    }
 
-        std::lock_guard<std::mutex> guard(m_ObjectMutex);
-        return m_ObjectData.at(bytes);
-    }
-
-     //! Get current pose information for first object
-     ObjectDataType getObjectData() const
-     {
-         // Note: We return by value because m_ObjectData is protected by mutex
-         waitUntilConnected();
-         std::lock_guard<std::mutex> guard(m_ObjectMutex);
-         return m_ObjectData.begin()->second;
-     }
-
-     auto getObjectReference(Stopwatch::Duration timeoutDuration = 10s) const
-     {
-         waitUntilConnected();
-         std::lock_guard<std::mutex> guard(m_ObjectMutex);
-         return ObjectReference<ObjectDataType>(*this,
-                                                m_ObjectData.begin()->first,
-                                                timeoutDuration);
-     }
+    //! Get current pose information for first object
+    ObjectDataType getObjectData() const
+    {
+        return getObjectData(ObjectHandle{ 0 });
+    }
+
+    /*!
+     * \brief Copy the object's most recent poses into history, oldest first,
+     *        without waiting
+     *
+     * Returns the number of poses copied (at most HistorySize).
+     */
+    size_t getPoseHistory(ObjectHandle handle, std::array<PoseSample, HistorySize> &history) const
+    {
+        const ObjectSlot &slot = getSlot(handle);
+        uint32_t numSamples = 0;
+        if (!readConsistent(slot, [&]() {
+                numSamples = slot.numSamples;
+                std::memcpy(static_cast<void *>(history.data()), slot.history.data(), sizeof(history));
+            })) {
+            return 0;
+        }
+
+        // Rotate ring buffer so oldest sample comes first
+        const size_t count = std::min<size_t>(numSamples, HistorySize);
+        std::rotate(history.begin(), history.begin() + (numSamples - count) % HistorySize, history.begin() + count);
+        return count;
+    }
+
+    /*!
+     * \brief Get the object's pose at the given time, interpolating between
+     *        the poses received either side of it
+     *
+     * Times after the latest pose are extrapolated from the last two poses, by
+     * up to maxExtrapolation. Returns false if there is no pose for this time
+     * (e.g. it's older than the history kept).
+     */
+    bool getPoseAt(ObjectHandle handle, TimePoint time, Pose3<millimeter_t, radian_t> &pose,
+                   std::chrono::nanoseconds maxExtrapolation = 50ms) const
+    {
+        std::array<PoseSample, HistorySize> history;
+        const size_t count = getPoseHistory(handle, history);
+        if (count == 0 || time < history[0].time) {
+            return false;
+        }
+
+        // Find the first pose which isn't earlier than time (searching from the newest)
+        size_t after = count;
+        while (after > 0 && history[after - 1].time >= time) {
+            after--;
+        }
+        if (after < count) {
+            if (after == 0 || history[after].time == time) {
+                pose = history[after].pose;
+            } else {
+                pose = interpolate(history[after - 1], history[after], time);
+            }
+            return true;
+        }
+
+        // Time is after newest pose
+        const PoseSample &newest = history[count - 1];
+        if (time - newest.time > maxExtrapolation) {
+            return false;
+        }
+        pose = (count < 2) ? newest.pose : interpolate(history[count - 2], newest, time);
+        return true;
+    }
+
+    /*!
+     * \brief Estimate the object's velocity from the poses received in the
+     *        last window of time, by a least-squares fit
+     *
+     * Returns false if there are fewer than two poses in this window.
+     */
+    bool getVelocity(ObjectHandle handle, std::array<meters_per_second_t, 3> &velocity,
+                     std::array<radians_per_second_t, 3> &angularVelocity,
+                     std::chrono::nanoseconds window = 50ms) const
+    {
+        std::array<PoseSample, HistorySize> history;
+        const size_t count = getPoseHistory(handle, history);
+        if (count == 0) {
+            return false;
+        }
+
+        // Only use poses in window
+        size_t first = count - 1;
+        while (first > 0 && history[count - 1].time - history[first - 1].time <= window) {
+            first--;
+        }
+        const size_t n = count - first;
+        if (n < 2) {
+            return false;
+        }
+
+        // Use times and angles relative to the first sample, to avoid precision problems and wrapping
+        const PoseSample &origin = history[first];
+        std::array<double, HistorySize> times;
+        double meanTime = 0.0;
+        for (size_t i = 0; i < n; i++) {
+            times[i] = std::chrono::duration<double>(history[first + i].time - origin.time).count();
+            meanTime += times[i];
+        }
+        meanTime /= static_cast<double>(n);
+        double timeVariance = 0.0;
+        for (size_t i = 0; i < n; i++) {
+            timeVariance += (times[i] - meanTime) * (times[i] - meanTime);
+        }
+
+        // All the samples have the same timestamp, so we can't fit a slope
+        if (!(timeVariance > 0.0)) {
+            return false;
+        }
+
+        // Slope of least-squares line for a quantity, given its value (relative to origin) for each sample
+        const auto fitSlope = [&](auto getValue) {
+            double meanValue = 0.0;
+            for (size_t i = 0; i < n; i++) {
+                meanValue += getValue(history[first + i]);
+            }
+            meanValue /= static_cast<double>(n);
+            double covariance = 0.0;
+            for (size_t i = 0; i < n; i++) {
+                covariance += (times[i] - meanTime) * (getValue(history[first + i]) - meanValue);
+            }
+            return covariance / timeVariance;
+        };
+        for (size_t axis = 0; axis < 3; axis++) {
+            velocity[axis] = meters_per_second_t(fitSlope([&](const PoseSample &sample) {
+                return units::length::meter_t(sample.pose.position()[axis] - origin.pose.position()[axis]).value();
+            }));
+            angularVelocity[axis] = radians_per_second_t(fitSlope([&](const PoseSample &sample) {
+                return circularDistance(sample.pose.attitude()[axis], origin.pose.attitude()[axis]).value();
+            }));
+        }
+        return true;
+    }
+
+    auto getObjectReference(Stopwatch::Duration timeoutDuration = 10s) const
+    {
+        return getObjectReference(ObjectHandle{ 0 }, timeoutDuration);
+    }
+
+    //! Returns an object whose pose is updated by the Vicon system over time
+    auto getObjectReference(ObjectHandle handle,
+                            Stopwatch::Duration timeoutDuration = 10s) const
+    {
+        waitUntilConnected();
+        getSlot(handle);
+        return ObjectReference<ObjectDataType>(*this, handle, timeoutDuration);
+    }
 
     //! Returns an object whose pose is updated by the Vicon system over time
     auto getObjectReference(const std::string& name,
@@ -364,7 +643,7 @@ public:
     {
         waitUntilConnected();
         return ObjectReference<ObjectDataType>(*this,
-                                               name.c_str(),
+                                               getObjectHandle(name),
                                                timeoutDuration);
     }
 
@@ -385,16 +664,132 @@ private:
     //----------------------------------------------------------------------------
     // Private API
     //----------------------------------------------------------------------------
-    void updateObjectData(uint32_t frameNumber, const RawObjectData &data)
+    struct ObjectSlot
     {
-        // Check if we already have a data structure for this object...
-        auto pos = m_ObjectData.find(data.objectName);
+        ObjectSlot(const char *objectName)
+          : name(objectName)
+          , data(objectName)
+        {}
+
+        const CharArray<24> name;
+
+        //! Zero until there's data, then odd while data is being updated
+        std::atomic<uint32_t> sequence{ 0 };
+        ObjectDataType data;
 
-        // ...and, if not, create one
-        if (pos == m_ObjectData.cend()) {
+        //! Ring buffer of recent poses
+        std::array<PoseSample, HistorySize> history;
+        uint32_t numSamples = 0;
+    };
+
+    /*!
+     * Call copy (which must only copy data out of slot) until it has run
+     * without the slot being updated at the same time. Returns false without
+     * calling copy if the slot has no data yet.
+     */
+    template<class CopyFunc>
+    static bool readConsistent(const ObjectSlot &slot, CopyFunc copy)
+    {
+        while (true) {
+            // An odd sequence number means the receiving thread is updating the data
+            const uint32_t sequence = slot.sequence.load(std::memory_order_acquire);
+            if (sequence == 0) {
+                return false;
+            }
+            if (sequence & 1) {
+                std::this_thread::yield();
+                continue;
+            }
+
+            // Copy data and check it wasn't updated in the meantime
+            copy();
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.sequence.load(std::memory_order_relaxed) == sequence) {
+                return true;
+            }
+        }
+    }
+
+    static Pose3<millimeter_t, radian_t> interpolate(const PoseSample &a, const PoseSample &b, TimePoint time)
+    {
+        // If the samples have the same timestamp, there's nothing to interpolate between
+        if (b.time <= a.time) {
+            return b.pose;
+        }
+
+        // NB: Fraction is greater than one when extrapolating
+        const double fraction = std::chrono::duration<double>(time - a.time).count() /
+                                std::chrono::duration<double>(b.time - a.time).count();
+
+        Pose3<millimeter_t, radian_t> pose;
+        for (size_t i = 0; i < 3; i++) {
+            pose.position()[i] = a.pose.position()[i] + fraction * (b.pose.position()[i] - a.pose.position()[i]);
+            pose.attitude()[i] = normaliseAngle180(a.pose.attitude()[i] +
+                                                   fraction * circularDistance(b.pose.attitude()[i], a.pose.attitude()[i]));
+        }
+        return pose;
+    }
+
+    const ObjectSlot &getSlot(ObjectHandle handle) const
+    {
+        if (handle >= m_NumObjects.load(std::memory_order_acquire)) {
+            throw std::out_of_range("Invalid Vicon object handle");
+        }
+        return *m_Objects[handle];
+    }
+
+    bool findObject(const char *name, ObjectHandle &handle, ObjectHandle hint = 0) const
+    {
+        // Objects usually arrive in the same order, so try the hint first
+        const size_t numObjects = m_NumObjects.load(std::memory_order_acquire);
+        for (size_t i = 0; i < numObjects; i++) {
+            const size_t index = (hint + i) % numObjects;
+            if (strcmp(m_Objects[index]->name, name) == 0) {
+                handle = index;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    ObjectHandle addObject(const char *name) const
+    {
+        // Only adding objects takes a lock: it may have been added while we waited
+        std::lock_guard<std::mutex> guard(m_ObjectMutex);
+        ObjectHandle handle;
+        if (findObject(name, handle)) {
+            return handle;
+        }
+
+        handle = m_NumObjects.load(std::memory_order_relaxed);
+        if (handle == MaxObjects) {
+            throw std::runtime_error("Too many Vicon objects");
+        }
+        m_Objects[handle] = std::make_unique<ObjectSlot>(name);
+        m_NumObjects.store(handle + 1, std::memory_order_release);
+        return handle;
+    }
+
+    void updateObjectData(uint32_t frameNumber, const RawObjectData &data, ObjectHandle hint, TimePoint received)
+    {
+        // Check if we already have a slot for this object and, if not, create one
+        ObjectHandle handle;
+        if (!findObject(data.objectName, handle, hint)) {
+            try {
+                handle = addObject(data.objectName);
+            } catch (std::runtime_error &) {
+                LOG_WARNING_IF(!m_WarnedTooManyObjects) << "Vicon: Too many objects; ignoring " << data.objectName;
+                m_WarnedTooManyObjects = true;
+                return;
+            }
             LOGI << "Vicon: Found new object: " << data.objectName;
-            pos = m_ObjectData.emplace(data.objectName, ObjectDataType { data.objectName }).first;
         }
+        ObjectSlot &slot = *m_Objects[handle];
+
+        // Mark data as being updated (we're the only writer)
+        const uint32_t sequence = slot.sequence.load(std::memory_order_relaxed);
+        slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
 
         /*
          * Update object data with position and attitude.
@@ -403,31 +798,100 @@ private:
          * so that they are in the order of yaw, pitch and roll (which seems to
          * be standard).
          */
-        using namespace units::length;
-        using namespace units::angle;
-        pos->second.update(frameNumber,
-                           { { millimeter_t(data.position[0]),
-                               millimeter_t(data.position[1]),
-                               millimeter_t(data.position[2]) },
-                           { radian_t(data.attitude[2]),
-                               radian_t(data.attitude[0]),
-                               radian_t(data.attitude[1]) } });
+        const Pose3<millimeter_t, radian_t> pose{ { millimeter_t(data.position[0]),
+                                                    millimeter_t(data.position[1]),
+                                                    millimeter_t(data.position[2]) },
+                                                  { radian_t(data.attitude[2]),
+                                                    radian_t(data.attitude[0]),
+                                                    radian_t(data.attitude[1]) } };
+        slot.data.update(frameNumber, pose);
+        slot.history[slot.numSamples % HistorySize] = { received, frameNumber, pose };
+        slot.numSamples++;
+
+        // Publish update (skipping zero if sequence number wraps around)
+        slot.sequence.store((sequence + 2 == 0) ? 2 : (sequence + 2), std::memory_order_release);
+    }
+
+    void handlePacket(const uint8_t *packet, size_t length, TimePoint received)
+    {
+        if (length < 5) {
+            LOG_WARNING << "Vicon: Ignoring truncated packet";
+            return;
+        }
+
+        // Read frame number
+        uint32_t frameNumber;
+        memcpy(&frameNumber, &packet[0], sizeof(uint32_t));
+
+        // Read items in block, copying them out as they may not be aligned
+        const size_t itemsInBlock = (size_t) packet[4];
+        for (size_t i = 0; i < itemsInBlock; i++) {
+            const size_t offset = 5 + i * sizeof(RawObjectData);
+            if (offset + sizeof(RawObjectData) > length) {
+                LOG_WARNING << "Vicon: Ignoring truncated packet";
+                return;
+            }
+
+            RawObjectData data;
+            memcpy(&data, &packet[offset], sizeof(RawObjectData));
+            BOB_ASSERT(data.itemDataSize == 72);
+            data.objectName[23] = '\0'; // Make sure string is null-terminated
+            updateObjectData(frameNumber, data, i, received);
+        }
     }
 
     void readThread(int socket)
     {
-        // Create buffer for reading data
+        // Create buffers for reading data
         // **NOTE** this is the maximum size supported by Vicon so will support all payload sizes
-        uint8_t buffer[1024];
+        constexpr size_t MaxPacketSize = 1024;
+        std::vector<uint8_t> buffers(BatchSize * MaxPacketSize);
+        std::array<size_t, BatchSize> packetSizes;
+
+        std::array<TimePoint, BatchSize> packetTimes;
+
+#ifdef __linux__
+        // Set up headers for receiving a batch of datagrams at once, each with its timestamp
+        std::array<iovec, BatchSize> vectors;
+        std::array<mmsghdr, BatchSize> messages;
+        std::array<TimestampControl, BatchSize> controls;
+        for (size_t i = 0; i < BatchSize; i++) {
+            vectors[i].iov_base = &buffers[i * MaxPacketSize];
+            vectors[i].iov_len = MaxPacketSize;
+            messages[i] = {};
+            messages[i].msg_hdr.msg_iov = &vectors[i];
+            messages[i].msg_hdr.msg_iovlen = 1;
+            messages[i].msg_hdr.msg_control = controls[i].buffer;
+        }
+#endif
 
         // Loop until quit flag is set
         while (!m_ShouldQuit) {
+#ifdef __linux__
+            // The kernel overwrites this with the length actually used
+            for (auto &message : messages) {
+                message.msg_hdr.msg_controllen = sizeof(TimestampControl);
+            }
+
+            // Wait for one datagram, then also take any others which are queued up
+            const int numPackets = recvmmsg(socket, messages.data(), BatchSize, MSG_WAITFORONE, nullptr);
+            const auto steadyNow = std::chrono::steady_clock::now();
+            const auto systemNow = std::chrono::system_clock::now();
+            for (int i = 0; i < numPackets; i++) {
+                packetSizes[i] = messages[i].msg_len;
+                packetTimes[i] = getReceiveTime(messages[i].msg_hdr, steadyNow, systemNow);
+            }
+#else
             // Read datagram
-            const ssize_t bytesReceived = recvfrom(socket, &buffer[0], 1024,
-                                                   0, nullptr, nullptr);
+            const auto bytesReceived = recvfrom(socket, reinterpret_cast<readbuff_t>(buffers.data()),
+                                                MaxPacketSize, 0, nullptr, nullptr);
+            const int numPackets = (bytesReceived == -1) ? -1 : 1;
+            packetSizes[0] = static_cast<size_t>(bytesReceived);
+            packetTimes[0] = std::chrono::steady_clock::now();
+#endif
 
             // If there was an error
-            if (bytesReceived == -1) {
+            if (numPackets == -1) {
                 // If this was a timeout, continue
                 if(errno == EAGAIN || errno == EINTR) {
                     continue;
@@ -439,22 +903,9 @@ private:
             }
             // Otherwise, if data was received
             else {
-                // Read frame number
-                uint32_t frameNumber;
-                memcpy(&frameNumber, &buffer[0], sizeof(uint32_t));
-
-                // Read items in block
-                const size_t itemsInBlock = (size_t) buffer[4];
-
-                // Lock mutex
-                std::lock_guard<std::mutex> guard(m_ObjectMutex);
-
-                auto objectData = reinterpret_cast<RawObjectData *>(&buffer[5]);
-                objectData->objectName[23] = '\0'; // Make sure string is null-terminated
-                std::for_each(objectData, &objectData[itemsInBlock], [&frameNumber, this](auto &data) {
-                    BOB_ASSERT(data.itemDataSize == 72);
-                    this->updateObjectData(frameNumber, data);
-                });
+                for (int i = 0; i < numPackets; i++) {
+                    handlePacket(&buffers[i * MaxPacketSize], packetSizes[i], packetTimes[i]);
+                }
 
                 // If this is the first packet we've received, signal that we're connected
                 if (!m_IsConnected) {
@@ -468,88 +919,68 @@ private:
         close(socket);
     }
 
-    struct HashChar {
-        //--------------------------------------------------------------------------
-        /*! \brief This function returns the 32-bit hash of a string
-        */
-        //--------------------------------------------------------------------------
-        //! https://stackoverflow.com/questions/19411742/what-is-the-default-hash-function-used-in-c-stdunordered-map
-        //! suggests that libstdc++ uses MurmurHash2 so this seems as good a bet as any
-        //! MurmurHash2, by Austin Appleby
-        //! It has a few limitations -
-        //! 1. It will not work incrementally.
-        //! 2. It will not produce the same results on little-endian and big-endian
-        //!    machines.
-        template<size_t N>
-        uint32_t operator()(const CharArray<N> &str) const
-        {
-            // 'm' and 'r' are mixing constants generated offline.
-            // They're not really 'magic', they just happen to work well.
-            const uint32_t m = 0x5bd1e995;
-            const unsigned int r = 24;
-
-            // String length
-            size_t len = strlen(str);
-
-            // Initialize the hash to a 'random' value
-            uint32_t h = 0xc70f6907 ^ (uint32_t)len;
-
-            // Mix 4 bytes at a time into the hash
-            const char *data = str;
-            while (len >= 4) {
-                // **NOTE** one of the assumptions of the original MurmurHash2 was that
-                // "We can read a 4-byte value from any address without crashing".
-                // Bad experiance tells me this may not be the case on ARM so use memcpy
-                uint32_t k;
-                memcpy(&k, data, 4);
-
-                k *= m;
-                k ^= k >> r;
-                k *= m;
-
-                h *= m;
-                h ^= k;
-
-                data += 4;
-                len -= 4;
-            }
-
-            // Handle the last few bytes of the input array
-            switch(len)
-            {
-                case 3: h ^= data[2] << 16; // falls through
-                case 2: h ^= data[1] << 8;  // falls through
-                case 1: h ^= data[0];
-                        h *= m;             // falls through
-            };
-
-            // Do a few final mixes of the hash to ensure the last few
-            // bytes are well-incorporated.
-            h ^= h >> 13;
-            h *= m;
-            h ^= h >> 15;
+#ifdef __linux__
+    //! Space for the control message carrying a datagram's timestamp, suitably aligned
+    union TimestampControl
+    {
+        cmsghdr header;
+        char buffer[CMSG_SPACE(sizeof(timespec))];
+    };
 
-            return h;
+    /*!
+     * Get the time at which the kernel received a datagram, converted from the
+     * system clock to the steady clock. If there's no timestamp, use now.
+     */
+    static TimePoint getReceiveTime(const msghdr &header, TimePoint steadyNow,
+                                    std::chrono::system_clock::time_point systemNow)
+    {
+        for (auto *cmsg = CMSG_FIRSTHDR(&header); cmsg; cmsg = CMSG_NXTHDR(const_cast<msghdr *>(&header), cmsg)) {
+            if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+                timespec stamp;
+                std::memcpy(&stamp, CMSG_DATA(cmsg), sizeof(stamp));
+                const auto received = std::chrono::system_clock::time_point(
+                        std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                                std::chrono::seconds(stamp.tv_sec) + std::chrono::nanoseconds(stamp.tv_nsec)));
+
+                // If the system clock has been adjusted, don't put the packet in the future
+                const auto age = std::max(systemNow - received, std::chrono::system_clock::duration::zero());
+                return steadyNow - std::chrono::duration_cast<TimePoint::duration>(age);
+            }
         }
-    };
+        return steadyNow;
+    }
+#endif
 
     //----------------------------------------------------------------------------
     // Members
     //----------------------------------------------------------------------------
+    //! The most objects we can track (slots are allocated up front, so they never move)
+    static constexpr size_t MaxObjects = 64;
+
+    //! The most datagrams we read with one system call
+    static constexpr size_t BatchSize = 32;
+
+    // Protects adding objects; reading and updating them doesn't take a lock
     mutable std::mutex m_ObjectMutex;
+    mutable std::array<std::unique_ptr<ObjectSlot>, MaxObjects> m_Objects;
+    mutable std::atomic<size_t> m_NumObjects{ 0 };
+    bool m_WarnedTooManyObjects = false;
 
-    /*
-     * We use a fixed-size char array as a key, because if we used std::string
-     * then we could get a heap allocation with every data packet received for
-     * longer object names.
-     */
-    std::unordered_map<CharArray<24>, ObjectDataType, HashChar> m_ObjectData;
     std::atomic<bool> m_ShouldQuit;
     mutable std::timed_mutex m_ConnectionMutex;
-    bool m_IsConnected = false;
+    std::atomic<bool> m_IsConnected{ false };
     std::thread m_ReadThread;
 }; // UDPClient
 
+template<typename ObjectDataType>
+constexpr size_t UDPClient<ObjectDataType>::HistorySize;
+
+template<typename ObjectDataType>
+constexpr size_t UDPClient<ObjectDataType>::MaxObjects;
+
+template<typename ObjectDataType>
+constexpr size_t UDPClient<ObjectDataType>::BatchSize;
+
 /**!
  * \brief A class which both connects to the Vicon system and also has a
  * 		  getPose() method
@@ -63,14 +63,49 @@ public:
      */
     virtual bool readGreyscaleFrame(cv::Mat &outFrame);
 
-    //! Read a frame synchronously, blocking until a new frame is received
-    void readFrameSync(cv::Mat &outFrame);
+    /*!
+     * \brief Try to read a frame in colour, sharing memory with the video
+     *        source rather than copying it, where possible
+     *
+     * As cv::Mats are reference counted, the frame remains valid for as long
+     * as the caller holds on to it, but it must be treated as read-only. By
+     * default, this is the same as readFrame().
+     *
+     * @return Whether a new frame was read
+     */
+    virtual bool readFrameShared(cv::Mat &outFrame);
+
+    /*!
+     * \brief Read a frame synchronously, blocking until a new frame is received
+     *
+     * @return False if the source stopped (e.g. disconnected) before a frame arrived
+     */
+    bool readFrameSync(cv::Mat &outFrame);
+
+    /*!
+     * \brief Read a greyscale frame synchronously, blocking until a new frame is received
+     *
+     * @return False if the source stopped (e.g. disconnected) before a frame arrived
+     */
+    bool readGreyscaleFrameSync(cv::Mat &outFrame);
 
     //! Allows OpenCV to serialise info about this Input
     void write(cv::FileStorage &fs) const;
 
     static constexpr const char *DefaultCameraName = "unknown_camera";
 
+protected:
+    /*!
+     * \brief Block until a new frame may be available
+     *
+     * Used by readFrameSync(). By default, this just sleeps for a short time;
+     * sources which receive frames asynchronously should override it to wait
+     * until a frame actually arrives.
+     *
+     * @return False if no more frames will arrive
+     */
+    virtual bool waitForNewFrame();
+
 private:
     cv::Mat m_IntermediateFrame;
 }; // Input
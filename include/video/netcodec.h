@@ -0,0 +1,96 @@
+#pragma once
+
+// OpenCV includes
+#include <opencv2/opencv.hpp>
+
+// Standard C includes
+#include <cstddef>
+#include <cstdint>
+
+// Standard C++ includes
+#include <string>
+#include <vector>
+
+namespace BoBRobotics {
+namespace Video {
+
+//! Ways in which frames can be compressed for sending over the network
+enum class NetCodec : uint16_t
+{
+    //! Lossy JPEG (quality is 0-100)
+    JPEG = 0,
+
+    //! Lossless PNG (quality is the compression level, 0-9)
+    PNG = 1,
+
+    //! Uncompressed greyscale pixels
+    RawGreyscale = 2,
+
+    /*!
+     * \brief Lossless greyscale, where each frame apart from key frames is
+     *        sent as its (wrapped) difference from the previous frame
+     *
+     * The differences are PNG-compressed, so the static parts of a scene
+     * (e.g. most of an unwrapped panorama) cost almost nothing.
+     */
+    DeltaGreyscale = 3,
+};
+
+//! Header for frames sent as binary messages (Net::Opcode::Image)
+struct NetFrameHeader
+{
+    uint32_t id;
+    uint16_t codec;
+    uint16_t keyFrame;
+    uint32_t width, height;
+};
+
+//! Parse a codec from its name, e.g. "jpeg" or "delta"
+NetCodec
+parseNetCodec(const std::string &name);
+
+//----------------------------------------------------------------------------
+// BoBRobotics::Video::NetEncoder
+//----------------------------------------------------------------------------
+//! Compresses frames with a NetCodec
+class NetEncoder
+{
+public:
+    //! Use quality = -1 for the codec's default
+    NetEncoder(NetCodec codec = NetCodec::JPEG, int quality = -1);
+
+    /*!
+     * \brief Encode frame into buffer
+     *
+     * Returns true if this is a key frame, i.e. it can be decoded without the
+     * previous frame.
+     */
+    bool encode(const cv::Mat &frame, std::vector<uint8_t> &buffer);
+
+    //! Make sure the next frame is a key frame
+    void reset();
+
+    NetCodec getCodec() const;
+
+private:
+    const NetCodec m_Codec;
+    std::vector<int> m_Params;
+    cv::Mat m_Greyscale, m_Previous, m_Delta;
+}; // NetEncoder
+
+//----------------------------------------------------------------------------
+// BoBRobotics::Video::NetDecoder
+//----------------------------------------------------------------------------
+//! Decompresses frames encoded by NetEncoder
+class NetDecoder
+{
+public:
+    //! Decode a frame of the given size (needed for raw and delta-encoded frames) into frame
+    void decode(NetCodec codec, bool keyFrame, const cv::Size &size,
+                const uint8_t *data, size_t sizeBytes, cv::Mat &frame);
+
+private:
+    cv::Mat m_Previous;
+}; // NetDecoder
+} // Video
+} // BoBRobotics
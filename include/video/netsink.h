@@ -4,11 +4,21 @@
 #include "common/semaphore.h"
 #include "net/connection.h"
 #include "input.h"
+#include "netcodec.h"
+
+// Standard C includes
+#include <cstdint>
 
 // Standard C++ includes
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <thread>
+#include <utility>
 #include <vector>
 
 namespace BoBRobotics {
@@ -16,7 +26,16 @@ namespace Video {
 //----------------------------------------------------------------------------
 // BoBRobotics::Video::NetSink
 //----------------------------------------------------------------------------
-//! Object for sending video frames synchronously or asynchronously over network
+/*!
+ * \brief Object for sending video frames synchronously or asynchronously over network
+ *
+ * Frames are encoded and sent on a background thread, so this overlaps with
+ * capturing the next frame. If the NetSource asks for it, frames are
+ * streamed: up to a window of frames (chosen by the NetSource) may be in
+ * flight at once, each being acknowledged once decoded, and the codec can be
+ * chosen with setCodec(). Otherwise, frames are sent as JPEGs, as older
+ * NetSources expect.
+ */
 class NetSink
 {
 public:
@@ -44,34 +63,70 @@ public:
     //----------------------------------------------------------------------------
     // Public API
     //----------------------------------------------------------------------------
-    //! Send a frame over the network (when operating in synchronous mode)
+    /*!
+     * \brief Send a frame over the network (when operating in synchronous mode)
+     *
+     * The frame is copied and handed to the encoding thread, so this only
+     * blocks while the previous frame is still waiting to be encoded.
+     */
     void sendFrame(const cv::Mat &frame);
 
+    //! Choose how streamed frames are compressed (see NetEncoder)
+    void setCodec(NetCodec codec, int quality = -1);
+
+    /*!
+     * \brief Get the round-trip time of the most recently acknowledged frame
+     *
+     * This runs from the frame being handed to us (or captured) until the
+     * NetSource's acknowledgement of it arrives back here, so it includes
+     * encoding, both network trips and decoding. Returns zero if no frames
+     * have been acknowledged yet.
+     */
+    std::chrono::microseconds getLatency() const;
+
 private:
+    using TimePoint = std::chrono::steady_clock::time_point;
+
     //----------------------------------------------------------------------------
     // Private methods
     //----------------------------------------------------------------------------
-    void sendFrameInternal(const cv::Mat &frame);
+    void encodeAndSend(const cv::Mat &frame, uint32_t id, bool streaming);
 
     void onCommandReceived(const Net::Command &command);
 
-    void onCommandReceivedAsync(const Net::Command &command);
-
-    void onCommandReceivedSync(const Net::Command &command);
+    void onAckReceived(const Net::Command &command);
 
     void runAsync();
 
+    void runEncoder();
+
     //----------------------------------------------------------------------------
     // Members
     //----------------------------------------------------------------------------
     Net::Connection &m_Connection;
     Semaphore m_AckSemaphore;
     const std::string m_Name;
-    std::vector<uchar> m_Buffer;
-    std::thread m_Thread;
+    std::vector<uint8_t> m_Buffer;
+    std::thread m_Thread, m_EncoderThread;
     const cv::Size m_FrameSize;
     Input *m_Input;
     std::atomic<bool> m_DoRun{ true };
+    std::atomic<int64_t> m_LatencyMicroseconds{ 0 };
+
+    // Frame waiting to be encoded and streaming state, protected by m_PipelineMutex
+    std::mutex m_PipelineMutex;
+    std::condition_variable m_PipelineCondition;
+    cv::Mat m_PendingFrame;
+    TimePoint m_PendingTime;
+    bool m_HasPendingFrame = false;
+    bool m_Streaming = false;
+    size_t m_Window = 1;
+    uint32_t m_NextFrameID = 0;
+    std::deque<std::pair<uint32_t, TimePoint>> m_FramesInFlight;
+    std::unique_ptr<NetEncoder> m_NextEncoder;
+
+    // Only used by the encoder thread
+    std::unique_ptr<NetEncoder> m_Encoder;
 };
 } // Video
 } // BoBRobotics
@@ -4,9 +4,12 @@
 #include "common/semaphore.h"
 #include "net/connection.h"
 #include "input.h"
+#include "netcodec.h"
 
 // Standard C++ includes
 #include <atomic>
+#include <condition_variable>
+#include <cstdint>
 #include <mutex>
 #include <string>
 #include <vector>
@@ -16,16 +19,24 @@ namespace Video {
 //----------------------------------------------------------------------------
 // BoBRobotics::Video::NetSource
 //----------------------------------------------------------------------------
-//! Object for receiving video transmitted over the network by a NetSink
+/*!
+ * \brief Object for receiving video transmitted over the network by a NetSink
+ *
+ * With newer NetSinks, frames are streamed: the sink keeps sending frames
+ * without waiting for each to be read, as long as no more than
+ * maxFramesInFlight are unacknowledged. Older NetSinks just send JPEGs.
+ */
 class NetSource : public Input
 {
 public:
     /*!
      * \brief Create an object to read video transmitted over the network
      *
-     * @param node The network connection from which to read images
+     * @param connection The network connection from which to read images
+     * @param maxFramesInFlight How many frames the sink may send before they
+     *                          are acknowledged
      */
-    NetSource(Net::Connection &connection);
+    NetSource(Net::Connection &connection, unsigned int maxFramesInFlight = 2);
 
     virtual ~NetSource() override;
 
@@ -36,19 +47,30 @@ public:
     virtual bool needsUnwrapping() const override;
 
     virtual bool readFrame(cv::Mat &frame) override;
+    virtual bool readFrameShared(cv::Mat &frame) override;
+
+protected:
+    virtual bool waitForNewFrame() override;
 
 private:
     cv::Mat m_Frame;
     mutable Semaphore m_ParamsSemaphore;
-    std::vector<uchar> m_Buffer;
+    cv::Mat m_Decoded;
+    std::vector<uint8_t> m_Buffer;
+    NetDecoder m_Decoder;
     std::string m_CameraName = DefaultCameraName;
     Net::Connection &m_Connection;
     cv::Size m_CameraResolution;
     std::mutex m_FrameMutex;
+    std::condition_variable m_NewFrameCondition;
     std::atomic<bool> m_NewFrame{ false };
+    bool m_SinkStreams = false;
 
     void onCommandReceived(Net::Connection &connection,
                            const Net::Command &command);
+    void onMessageReceived(const Net::Message &message);
+    void onFrameReceived(uint32_t id, NetCodec codec, bool keyFrame,
+                         const cv::Size &size, const uint8_t *data, size_t sizeBytes);
 }; // NetSource
 } // Video
 } // BoBRobotics
@@ -2,6 +2,7 @@
 
 // BoB robotics includes
 #include "common/macros.h"
+#include "common/thread_pool.h"
 #include "input.h"
 #include "v4l_camera.h"
 
@@ -12,6 +13,8 @@
 #include <cstdint>
 
 // Standard C++ includes
+#include <functional>
+#include <memory>
 #include <string>
 
 namespace BoBRobotics {
@@ -22,7 +25,18 @@ constexpr const char *See3CamDeviceName = "See3CAM_CU40";
 //------------------------------------------------------------------------
 // BoBRobotics::Video::See3CAM_CU40
 //------------------------------------------------------------------------
-//! Read video from a See3CAM_CU40
+/*!
+ * \brief Read video from a See3CAM_CU40
+ *
+ * The camera's 10-bit Bayer data is converted to "super-pixels" (one output
+ * pixel per 2x2 block of Bayer pixels) a whole row at a time with SIMD
+ * (SSE2 or NEON) where available. For high resolutions, each frame can also be
+ * split into bands of rows which are converted on multiple threads (see
+ * setNumThreads()).
+ *
+ * If Video4LinuxCamera::startCaptureThread() has been called, the capture
+ * methods return false straight away if there isn't a new frame yet.
+ */
 class See3CAM_CU40
   : public Video4LinuxCamera
   , public Input
@@ -55,11 +69,22 @@ public:
     void open(const std::string &device,
               Resolution res,
               bool resetToDefaults = true);
-    void captureSuperPixel(cv::Mat &output);
-    void captureSuperPixelClamp(cv::Mat &output);
-    void captureSuperPixelWBCoolWhite(cv::Mat &output);
-    void captureSuperPixelWBU30(cv::Mat &output);
-    void captureSuperPixelGreyscale(cv::Mat &output);
+    bool captureSuperPixel(cv::Mat &output);
+    bool captureSuperPixelClamp(cv::Mat &output);
+    bool captureSuperPixelWBCoolWhite(cv::Mat &output);
+    bool captureSuperPixelWBU30(cv::Mat &output);
+
+    /*!
+     * \brief Capture a greyscale image, optionally downsampled
+     *
+     * Each output pixel is the mean of a downsample x downsample block of
+     * super-pixels, so that frames can be shrunk to the size needed for
+     * unwrapping without ever building the full-size image.
+     */
+    bool captureSuperPixelGreyscale(cv::Mat &output, unsigned int downsample = 1);
+
+    //! Split conversion of each frame between numThreads threads (by default, the calling thread does everything)
+    void setNumThreads(size_t numThreads);
 
     // Calculates entropy, either from whole frame or within subset specified by
     // mask
@@ -91,104 +116,22 @@ public:
 
 private:
     //------------------------------------------------------------------------
-    // PixelScale
-    //------------------------------------------------------------------------
-    // Converts 10-bit intensity values to 8-bit by dividing by 4
-    class PixelScale
-    {
-    public:
-        static uint8_t getR(uint16_t r, uint16_t, uint16_t);
-        static uint8_t getG(uint16_t, uint16_t g, uint16_t);
-        static uint8_t getB(uint16_t, uint16_t, uint16_t b);
-
-    private:
-        static uint8_t getScaled(uint16_t v);
-    };
-
-    //------------------------------------------------------------------------
-    // PixelClamp
+    // Private API
     //------------------------------------------------------------------------
-    // Converts 10-bit intensity values to 8-bit by clamping at 255
-    // **NOTE** this is dubious but a)Is what the qtcam example does and b)Can
-    // LOOK nicer than PixelScale
-    class PixelClamp
-    {
-    public:
-        static uint8_t getR(uint16_t r, uint16_t, uint16_t);
-        static uint8_t getG(uint16_t, uint16_t g, uint16_t);
-        static uint8_t getB(uint16_t, uint16_t, uint16_t b);
+    /*
+     * Convert to BGR super-pixels. Each 10-bit channel is shifted left by
+     * shift and then multiplied by its gain / 65536, saturating at 255.
+     */
+    bool captureSuperPixel(cv::Mat &output, int shift, uint16_t gainB, uint16_t gainG, uint16_t gainR);
 
-    private:
-        static uint8_t getClamped(uint16_t v);
-    };
-
-    //------------------------------------------------------------------------
-    // WhiteBalanceCoolWhite
-    //------------------------------------------------------------------------
-    class WhiteBalanceCoolWhite
-    {
-    public:
-        static uint8_t getR(uint16_t r, uint16_t, uint16_t);
-        static uint8_t getG(uint16_t, uint16_t g, uint16_t);
-        static uint8_t getB(uint16_t, uint16_t, uint16_t b);
-    };
+    // Returns nullptr if the capture thread is running and there's no new frame
+    const uint16_t *captureBayer();
 
-    //------------------------------------------------------------------------
-    // WhiteBalanceU30
-    //------------------------------------------------------------------------
-    class WhiteBalanceU30
-    {
-    public:
-        static uint8_t getR(uint16_t r, uint16_t, uint16_t);
-        static uint8_t getG(uint16_t, uint16_t g, uint16_t);
-        static uint8_t getB(uint16_t, uint16_t, uint16_t b);
-    };
+    // Like captureBayer(), but waits for the capture thread's next frame
+    const uint16_t *captureBayerSync();
 
-    //------------------------------------------------------------------------
-    // Private API
-    //------------------------------------------------------------------------
-    template<typename T>
-    void captureSuperPixel(cv::Mat &output)
-    {
-        // Check that output size is suitable for super-pixel output i.e. a
-        // quarter input size
-        const unsigned int inputWidth = getWidth();
-        const unsigned int inputHeight = getHeight();
-        BOB_ASSERT(output.cols == (int) inputWidth / 2);
-        BOB_ASSERT(output.rows == (int) inputHeight / 2);
-        BOB_ASSERT(output.type() == CV_8UC3);
-
-        // Read data and size (in bytes) from camera
-        // **NOTE** these pointers are only valid within one frame
-        void *data = nullptr;
-        uint32_t sizeBytes = Video4LinuxCamera::capture(data);
-
-        // Check frame size is correct
-        BOB_ASSERT(sizeBytes == (inputWidth * inputHeight * sizeof(uint16_t)));
-        const uint16_t *bayerData = reinterpret_cast<uint16_t *>(data);
-
-        // Loop through bayer pixels
-        for (unsigned int y = 0; y < inputHeight; y += 2) {
-            // Get pointers to start of both rows of Bayer data and output
-            // RGB data
-            const uint16_t *inBG16Start = &bayerData[y * inputWidth];
-            const uint16_t *inR16Start =
-                    &bayerData[((y + 1) * inputWidth) + 1];
-            uint8_t *outRGBStart = output.ptr(y / 2);
-            for (unsigned int x = 0; x < inputWidth; x += 2) {
-                // Read Bayer pixels
-                const uint16_t b = *(inBG16Start++);
-                const uint16_t g = *(inBG16Start++);
-                const uint16_t r = *inR16Start;
-                inR16Start += 2;
-
-                // Write back to BGR
-                *(outRGBStart++) = T::getB(r, g, b);
-                *(outRGBStart++) = T::getG(r, g, b);
-                *(outRGBStart++) = T::getR(r, g, b);
-            }
-        }
-    }
+    // Call func(begin, end) for bands of rows in [0, numRows), using thread pool if there is one
+    void forEachRowBand(size_t numRows, const std::function<void(size_t, size_t)> &func);
 
     //------------------------------------------------------------------------
     // Members
@@ -196,6 +139,7 @@ private:
     Resolution m_Resolution;
     v4l2_queryctrl m_BrightnessControl;
     v4l2_queryctrl m_ExposureControl;
+    std::shared_ptr<ThreadPool> m_ThreadPool;
 }; // See3Cam_CU40
 } // Video
 } // BoBRobotics
@@ -1,9 +1,15 @@
 #pragma once
 
 // Standard C++ includes
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <functional>
+#include <mutex>
 #include <stdexcept>
 #include <string>
+#include <thread>
+#include <vector>
 
 // Standard C includes
 #include <cstdint>
@@ -16,7 +22,13 @@ namespace Video {
 //------------------------------------------------------------------------
 // BoBRobotics::Video::Video4LinuxCamera
 //------------------------------------------------------------------------
-//! An interface for the low-level Video4Linux API
+/*!
+ * \brief An interface for the low-level Video4Linux API
+ *
+ * Frames can either be captured synchronously with capture() or, after
+ * calling startCaptureThread(), by a background thread which hands frames
+ * over with tryGetFrame() without the caller ever blocking on the driver.
+ */
 class Video4LinuxCamera
 {
 public:
@@ -27,11 +39,38 @@ public:
         Error(const std::string &msg);
     };
 
+    //! What the capture thread does with frames the caller hasn't collected yet
+    enum class CapturePolicy
+    {
+        //! Only keep the newest frame, giving stale ones straight back to the driver
+        LatestOnly,
+
+        //! Keep every frame, until the driver runs out of buffers
+        Queue,
+    };
+
+    //! A frame captured by the driver
+    struct Frame
+    {
+        //! The frame data, valid until the next call to tryGetFrame() or stopCaptureThread()
+        const void *data = nullptr;
+
+        //! The number of bytes of data
+        uint32_t sizeBytes = 0;
+
+        //! The driver's frame counter, which can be used to detect dropped frames
+        uint32_t sequence = 0;
+
+        //! When the driver captured the frame (on the same clock as std::chrono::steady_clock)
+        std::chrono::steady_clock::time_point timestamp;
+    };
+
     Video4LinuxCamera();
     Video4LinuxCamera(const std::string &device,
                       unsigned int width,
                       unsigned int height,
-                      uint32_t pixelFormat);
+                      uint32_t pixelFormat,
+                      unsigned int numBuffers = 2);
     ~Video4LinuxCamera();
 
     //------------------------------------------------------------------------
@@ -40,14 +79,61 @@ public:
     void open(const std::string &device,
               unsigned int width,
               unsigned int height,
-              uint32_t pixelFormat);
+              uint32_t pixelFormat,
+              unsigned int numBuffers = 2);
     void enumerateControls(std::function<void(const v4l2_queryctrl &)> processControl);
     void queryControl(uint32_t id, v4l2_queryctrl &queryControl);
     uint32_t capture(void *&buffer);
     int32_t getControlValue(uint32_t id) const;
     void setControlValue(uint32_t id, int32_t value);
 
+    //! Get the number of buffers the driver actually allocated
+    size_t getNumBuffers() const;
+
+    /*!
+     * \brief Start capturing frames on a background thread
+     *
+     * While the thread is running, frames must be read with tryGetFrame()
+     * rather than capture(). LatestOnly needs at least three buffers: one
+     * held by the caller, one waiting to be collected and one being filled.
+     */
+    void startCaptureThread(CapturePolicy policy = CapturePolicy::LatestOnly);
+
+    //! Stop the capture thread, returning to synchronous capture
+    void stopCaptureThread();
+
+    bool isCaptureThreadRunning() const;
+
+    /*!
+     * \brief Get the next frame from the capture thread, without blocking
+     *
+     * The previous frame's buffer is given back to the driver, so its data
+     * must no longer be used. Returns false if there is no new frame yet.
+     */
+    bool tryGetFrame(Frame &frame);
+
+    /*!
+     * \brief Block until tryGetFrame() has a frame to return, for at most
+     *        timeout
+     *
+     * @return Whether there is a new frame
+     */
+    bool waitForFrame(std::chrono::milliseconds timeout);
+
 private:
+    //------------------------------------------------------------------------
+    // Private methods
+    //------------------------------------------------------------------------
+    void queueBuffer(unsigned int index);
+    bool dequeueBuffer(v4l2_buffer &bufferInfo);
+    void startStreaming();
+    void stopStreaming();
+    void runCaptureThread();
+    void fillFrame(unsigned int index, Frame &frame) const;
+
+    //! Check whether there's a frame waiting to be collected
+    bool hasNewFrame() const;
+
     //------------------------------------------------------------------------
     // Members
     //------------------------------------------------------------------------
@@ -57,9 +143,35 @@ private:
     // Index of current frame - used to select correct buffer
     unsigned int m_Frame;
 
-    // Two buffers and their corresponding information structures
-    void *m_Buffer[2];
-    v4l2_buffer m_BufferInfo[2];
+    // Buffers and their corresponding information structures
+    std::vector<void *> m_Buffer;
+    std::vector<v4l2_buffer> m_BufferInfo;
+
+    // Background capture thread and what it does with frames
+    std::thread m_CaptureThread;
+    std::atomic<bool> m_CaptureThreadRunning;
+    CapturePolicy m_CapturePolicy;
+
+    /*
+     * Index of the newest buffer waiting to be collected (LatestOnly) or -1.
+     * The capture thread swaps new buffers in and requeues any it swaps out.
+     */
+    std::atomic<int> m_LatestBuffer;
+
+    /*
+     * Single-producer, single-consumer ring of buffer indices (Queue). As
+     * each buffer can only be in the ring once, it never overflows.
+     */
+    std::vector<unsigned int> m_Ring;
+    size_t m_RingHead;
+    std::atomic<size_t> m_RingTail;
+
+    // Buffer currently held by the caller of tryGetFrame() or -1
+    int m_HeldBuffer;
+
+    // Signalled by the capture thread whenever it publishes a frame
+    std::mutex m_NewFrameMutex;
+    std::condition_variable m_NewFrameCondition;
 }; // Video4LinuxCamera
 } // Video
 } // BoBRobotics
@@ -0,0 +1,59 @@
+#pragma once
+
+// BoB robotics includes
+#include "input.h"
+#include "v4l_camera.h"
+
+// OpenCV includes
+#include <opencv2/opencv.hpp>
+
+// Standard C++ includes
+#include <string>
+
+namespace BoBRobotics {
+namespace Video {
+//------------------------------------------------------------------------
+// BoBRobotics::Video::Video4LinuxInput
+//------------------------------------------------------------------------
+/*!
+ * \brief Read video from any Video4Linux camera which supports the YUYV
+ *        pixel format
+ *
+ * Unlike reading such a camera via OpenCVInput, greyscale frames are read by
+ * taking just the luma channel of the camera's buffer, rather than
+ * converting to BGR and back again.
+ *
+ * If startCaptureThread() has been called, frames are captured in the
+ * background and readFrame() only ever returns the newest one, returning
+ * false straight away if there isn't a new frame yet; readFrameSync() waits
+ * for the capture thread to signal the next one.
+ */
+class Video4LinuxInput
+  : public Video4LinuxCamera
+  , public Input
+{
+public:
+    Video4LinuxInput(const std::string &device,
+                     const cv::Size &resolution,
+                     const std::string &cameraName = DefaultCameraName);
+
+    //------------------------------------------------------------------------
+    // Video::Input virtuals
+    //------------------------------------------------------------------------
+    virtual std::string getCameraName() const override;
+    virtual cv::Size getOutputSize() const override;
+    virtual bool readFrame(cv::Mat &outFrame) override;
+    virtual bool readGreyscaleFrame(cv::Mat &outFrame) override;
+
+protected:
+    virtual bool waitForNewFrame() override;
+
+private:
+    const cv::Size m_Resolution;
+    const std::string m_CameraName;
+
+    //! Get a header for the camera's current (YUYV) buffer; only valid until the next capture
+    bool captureYUYV(cv::Mat &yuyv);
+}; // Video4LinuxInput
+} // Video
+} // BoBRobotics
@@ -98,10 +98,9 @@ void opticalFlowThreadFunc(int cameraDevice, std::atomic<bool> &shouldQuit, std:
 
        // Create images
 #ifdef USE_SEE3CAM
-    cv::Mat greyscaleInput(camRes, CV_8UC1);
+    cv::Mat cameraInput(camRes, CV_8UC1);
 #else
-    cv::Mat rgbInput(camRes, CV_8UC3);
-    cv::Mat greyscaleInput(camRes, CV_8UC1);
+    cv::Mat cameraInput(camRes, CV_8UC3);
 #endif
     cv::Mat outputImage(unwrapRes, CV_8UC1);
 
@@ -120,19 +119,18 @@ void opticalFlowThreadFunc(int cameraDevice, std::atomic<bool> &shouldQuit, std:
     for(numFrames = 0; !shouldQuit; numFrames++) {
 #ifdef USE_SEE3CAM
         // Read directly into greyscale
-        if(!cam.captureSuperPixelGreyscale(greyscaleInput)) {
+        if(!cam.captureSuperPixelGreyscale(cameraInput)) {
             return;
         }
 #else
-        // Read from camera and convert to greyscale
-        if(!capture.read(rgbInput)) {
+        // Read from camera
+        if(!capture.read(cameraInput)) {
             return;
         }
-        cv::cvtColor(rgbInput, greyscaleInput, cv::COLOR_BGR2GRAY);
 #endif
 
-        // Unwrap
-        unwrapper.unwrap(greyscaleInput, outputImage);
+        // Unwrap, converting to greyscale in the same pass
+        unwrapper.unwrapGreyscale(cameraInput, outputImage);
 
         // Calculate optical flow
         if(opticalFlow.calculate(outputImage)) {
@@ -150,5 +150,16 @@ AntAgent::updatePose(const units::time::second_t elapsedTime)
     }
 }
 
+BatchRenderer &
+AntAgent::getBatchRenderer()
+{
+    // Recreate it if our output size has changed
+    const cv::Size size = getOutputSize();
+    if (!m_BatchRenderer || m_BatchRenderer->getFrameSize() != size) {
+        m_BatchRenderer = std::make_unique<BatchRenderer>(getRenderer(), size);
+    }
+    return *m_BatchRenderer;
+}
+
 } // AntWorld
 } // BoBRobotics
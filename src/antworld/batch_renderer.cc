@@ -0,0 +1,190 @@
+// BoB robotics includes
+#include "antworld/batch_renderer.h"
+#include "common/macros.h"
+
+// Standard C++ includes
+#include <algorithm>
+#include <stdexcept>
+
+//----------------------------------------------------------------------------
+// Anonymous namespace
+//----------------------------------------------------------------------------
+namespace
+{
+size_t calculateFramesPerBatch(const cv::Size &frameSize, size_t framesPerBatch)
+{
+    BOB_ASSERT(frameSize.width > 0 && frameSize.height > 0);
+    BOB_ASSERT(framesPerBatch > 0);
+
+    // Tiles are stacked vertically so batch can't be taller than the largest texture or renderbuffer
+    GLint maxTextureSize = 0;
+    GLint maxRenderbufferSize = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+    glGetIntegerv(GL_MAX_RENDERBUFFER_SIZE, &maxRenderbufferSize);
+    const GLint maxHeight = std::min(maxTextureSize, maxRenderbufferSize);
+    BOB_ASSERT(frameSize.width <= maxHeight && frameSize.height <= maxHeight);
+
+    return std::min(framesPerBatch, (size_t)(maxHeight / frameSize.height));
+}
+}   // Anonymous namespace
+
+//----------------------------------------------------------------------------
+// BoBRobotics::AntWorld::BatchRenderer
+//----------------------------------------------------------------------------
+namespace BoBRobotics
+{
+namespace AntWorld
+{
+BatchRenderer::BatchRenderer(Renderer &renderer, const cv::Size &frameSize, size_t framesPerBatch)
+:   m_Renderer(renderer), m_FrameSize(frameSize), m_FramesPerBatch(calculateFramesPerBatch(frameSize, framesPerBatch)),
+    m_RenderTarget(frameSize.width, frameSize.height * (GLsizei)m_FramesPerBatch), m_Fences{ { nullptr, nullptr } }
+{
+    // Create pixel buffers large enough for a whole batch of BGR frames
+    const GLsizeiptr bufferSize = (GLsizeiptr)m_FrameSize.area() * 3 * (GLsizeiptr)m_FramesPerBatch;
+    glGenBuffers((GLsizei)m_PixelBuffers.size(), m_PixelBuffers.data());
+    for(GLuint buffer : m_PixelBuffers) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+        glBufferData(GL_PIXEL_PACK_BUFFER, bufferSize, nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+//----------------------------------------------------------------------------
+BatchRenderer::~BatchRenderer()
+{
+    for(GLsync fence : m_Fences) {
+        if(fence) {
+            glDeleteSync(fence);
+        }
+    }
+    glDeleteBuffers((GLsizei)m_PixelBuffers.size(), m_PixelBuffers.data());
+}
+//----------------------------------------------------------------------------
+void BatchRenderer::renderPanoramicViews(const std::vector<Pose> &poses, const FrameHandler &handler, int type)
+{
+    BOB_ASSERT(type == CV_8UC3 || type == CV_8UC1);
+
+    // If the cubemap is greyscale, every channel is the same so, if we want greyscale, just read one
+    const bool greyscaleCubemap = (m_Renderer.getCubemapMode() == Renderer::CubemapMode::LayeredGreyscale);
+    const int readType = (greyscaleCubemap && type == CV_8UC1) ? CV_8UC1 : CV_8UC3;
+
+    // Render first batch
+    size_t previousFirst = 0;
+    size_t previousCount = std::min(m_FramesPerBatch, poses.size());
+    unsigned int buffer = 0;
+    if(previousCount > 0) {
+        renderBatch(poses, previousFirst, previousCount, buffer, readType);
+    }
+
+    // Loop through remaining batches, rendering each one before reading back the previous one
+    for(size_t first = previousCount; first < poses.size(); first += m_FramesPerBatch) {
+        const size_t count = std::min(m_FramesPerBatch, poses.size() - first);
+        renderBatch(poses, first, count, 1 - buffer, readType);
+        readBatch(previousFirst, previousCount, buffer, handler, type, readType);
+
+        previousFirst = first;
+        previousCount = count;
+        buffer = 1 - buffer;
+    }
+
+    // Read back final batch
+    if(previousCount > 0) {
+        readBatch(previousFirst, previousCount, buffer, handler, type, readType);
+    }
+}
+//----------------------------------------------------------------------------
+std::vector<cv::Mat> BatchRenderer::renderPanoramicViews(const std::vector<Pose> &poses, int type)
+{
+    std::vector<cv::Mat> frames(poses.size());
+    renderPanoramicViews(poses,
+                         [&frames](size_t i, const cv::Mat &frame)
+                         {
+                             frame.copyTo(frames[i]);
+                         },
+                         type);
+    return frames;
+}
+//----------------------------------------------------------------------------
+void BatchRenderer::renderBatch(const std::vector<Pose> &poses, size_t first, size_t count, unsigned int buffer, int readType)
+{
+    // Clear whole render target
+    m_RenderTarget.bind();
+    m_RenderTarget.clear();
+
+    // Render each view into its own tile
+    for(size_t i = 0; i < count; i++) {
+        const auto &pose = poses[first + i];
+        m_Renderer.renderPanoramicView(pose.x(), pose.y(), pose.z(), pose.yaw(), pose.pitch(), pose.roll(),
+                                       0, (GLint)i * m_FrameSize.height, m_FrameSize.width, m_FrameSize.height,
+                                       m_RenderTarget.getFBO());
+    }
+
+    // Start asynchronous read of the tiles into pixel buffer, tightly packed
+    // **NOTE** with a buffer bound, glReadPixels returns without waiting for rendering to complete
+    GLint packAlignment;
+    glGetIntegerv(GL_PACK_ALIGNMENT, &packAlignment);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, m_PixelBuffers[buffer]);
+    glReadPixels(0, 0, m_FrameSize.width, m_FrameSize.height * (GLsizei)count,
+                 (readType == CV_8UC1) ? GL_RED : GL_BGR, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glPixelStorei(GL_PACK_ALIGNMENT, packAlignment);
+
+    // Add fence so we know when read has completed
+    m_Fences[buffer] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    m_RenderTarget.unbind();
+}
+//----------------------------------------------------------------------------
+void BatchRenderer::readBatch(size_t first, size_t count, unsigned int buffer, const FrameHandler &handler, int type, int readType)
+{
+    // Wait for read to complete, flushing the commands the first time around so it can
+    GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+    while(true) {
+        const GLenum result = glClientWaitSync(m_Fences[buffer], flags, 1000000);
+        if(result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED) {
+            break;
+        }
+        else if(result == GL_WAIT_FAILED) {
+            throw std::runtime_error("Failed to wait for pixel buffer read");
+        }
+        flags = 0;
+    }
+    glDeleteSync(m_Fences[buffer]);
+    m_Fences[buffer] = nullptr;
+
+    // Map pixel buffer
+    const size_t frameBytes = (size_t)m_FrameSize.area() * ((readType == CV_8UC1) ? 1 : 3);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, m_PixelBuffers[buffer]);
+    const auto *pixels = static_cast<const uint8_t*>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, frameBytes * count,
+                                                                     GL_MAP_READ_BIT));
+    if(!pixels) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        throw std::runtime_error("Failed to map pixel buffer");
+    }
+
+    // Loop through tiles
+    for(size_t i = 0; i < count; i++) {
+        // OpenGL's origin is at the bottom left, so flip tile as we copy it out
+        const cv::Mat tile(m_FrameSize, readType, const_cast<uint8_t*>(pixels + (frameBytes * i)));
+        if(readType == CV_8UC1) {
+            cv::flip(tile, m_GreyscaleFrame, 0);
+            handler(first + i, m_GreyscaleFrame);
+        }
+        else if(type == CV_8UC1) {
+            cv::flip(tile, m_Frame, 0);
+            cv::cvtColor(m_Frame, m_GreyscaleFrame, cv::COLOR_BGR2GRAY);
+            handler(first + i, m_GreyscaleFrame);
+        }
+        else {
+            cv::flip(tile, m_Frame, 0);
+            handler(first + i, m_Frame);
+        }
+    }
+
+    // Unmap and unbind pixel buffer
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+}
+}   // namespace AntWorld
+}   // namespace BoBRobotics
@@ -28,6 +28,12 @@ Camera::getWindow() const
     return m_Window;
 }
 
+Renderer &
+Camera::getRenderer() const
+{
+    return m_Renderer;
+}
+
 void
 Camera::setPose(const Pose3<meter_t, degree_t> &pose)
 {
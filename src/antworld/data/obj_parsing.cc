@@ -0,0 +1,190 @@
+// BoB robotics includes
+#include "antworld/obj_parsing.h"
+
+// Standard C includes
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+// Standard C++ includes
+#include <algorithm>
+#include <string>
+
+//----------------------------------------------------------------------------
+// Anonymous namespace
+//----------------------------------------------------------------------------
+namespace
+{
+// Powers of ten which can be represented exactly as doubles
+constexpr double ExactPowersOfTen[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+constexpr int MaxExactPowerOfTen = 22;
+
+// Largest integer which can be represented exactly as a double
+constexpr uint64_t MaxExactMantissa = 1ull << 53;
+
+bool isDigit(char c)
+{
+    return (c >= '0' && c <= '9');
+}
+//----------------------------------------------------------------------------
+bool isWhitespace(char c)
+{
+    return (c == ' ' || c == '\t');
+}
+}   // Anonymous namespace
+
+//----------------------------------------------------------------------------
+// BoBRobotics::AntWorld::ObjParsing
+//----------------------------------------------------------------------------
+namespace BoBRobotics
+{
+namespace AntWorld
+{
+namespace ObjParsing
+{
+const char *skipWhitespace(const char *text, const char *end)
+{
+    while(text < end && isWhitespace(*text)) {
+        text++;
+    }
+    return text;
+}
+//----------------------------------------------------------------------------
+const char *readToken(const char *text, const char *end, TextRange &token)
+{
+    token.first = skipWhitespace(text, end);
+    token.second = token.first;
+    while(token.second < end && !isWhitespace(*token.second)) {
+        token.second++;
+    }
+    return token.second;
+}
+//----------------------------------------------------------------------------
+bool tokenEquals(const TextRange &token, const char *string)
+{
+    const size_t length = std::strlen(string);
+    return ((size_t)(token.second - token.first) == length && std::memcmp(token.first, string, length) == 0);
+}
+//----------------------------------------------------------------------------
+const char *parseFloat(const char *text, const char *end, float &value)
+{
+    const char *start = skipWhitespace(text, end);
+    const char *p = start;
+
+    // Read sign
+    bool negative = false;
+    if(p < end && (*p == '-' || *p == '+')) {
+        negative = (*p == '-');
+        p++;
+    }
+
+    // Accumulate up to 19 significant digits into mantissa, adjusting exponent for the rest
+    uint64_t mantissa = 0;
+    int exponent = 0;
+    int numSignificant = 0;
+    bool anyDigits = false;
+    for(; p < end && isDigit(*p); p++) {
+        if(numSignificant < 19) {
+            mantissa = (mantissa * 10) + (*p - '0');
+            if(mantissa != 0) {
+                numSignificant++;
+            }
+        }
+        else {
+            exponent++;
+        }
+        anyDigits = true;
+    }
+    if(p < end && *p == '.') {
+        for(p++; p < end && isDigit(*p); p++) {
+            if(numSignificant < 19) {
+                mantissa = (mantissa * 10) + (*p - '0');
+                if(mantissa != 0) {
+                    numSignificant++;
+                }
+                exponent--;
+            }
+            anyDigits = true;
+        }
+    }
+    if(!anyDigits) {
+        return nullptr;
+    }
+
+    // Read exponent, if there is one
+    if(p < end && (*p == 'e' || *p == 'E')) {
+        const char *e = p + 1;
+        bool negativeExponent = false;
+        if(e < end && (*e == '-' || *e == '+')) {
+            negativeExponent = (*e == '-');
+            e++;
+        }
+        if(e < end && isDigit(*e)) {
+            int explicitExponent = 0;
+            for(; e < end && isDigit(*e); e++) {
+                explicitExponent = std::min(10000, (explicitExponent * 10) + (*e - '0'));
+            }
+            exponent += negativeExponent ? -explicitExponent : explicitExponent;
+            p = e;
+        }
+    }
+
+    // If mantissa and power of ten are both exact, a single multiplication or division is correctly rounded
+    // **NOTE** rounding this to a float can, very rarely, differ from strtof by one ULP
+    if(mantissa <= MaxExactMantissa && exponent >= -MaxExactPowerOfTen && exponent <= MaxExactPowerOfTen) {
+        const double result = (exponent < 0) ? ((double)mantissa / ExactPowersOfTen[-exponent])
+                                             : ((double)mantissa * ExactPowersOfTen[exponent]);
+        value = (float)(negative ? -result : result);
+    }
+    // Otherwise, fall back to the standard library
+    else {
+        value = std::strtof(std::string(start, p).c_str(), nullptr);
+    }
+    return p;
+}
+//----------------------------------------------------------------------------
+const char *parseInt(const char *text, const char *end, long &value)
+{
+    const char *p = skipWhitespace(text, end);
+
+    // Read sign
+    bool negative = false;
+    if(p < end && (*p == '-' || *p == '+')) {
+        negative = (*p == '-');
+        p++;
+    }
+
+    // Read digits
+    if(p == end || !isDigit(*p)) {
+        return nullptr;
+    }
+    long result = 0;
+    for(; p < end && isDigit(*p); p++) {
+        result = (result * 10) + (*p - '0');
+    }
+
+    value = negative ? -result : result;
+    return p;
+}
+//----------------------------------------------------------------------------
+std::vector<TextRange> splitLines(const char *text, const char *end, size_t numChunks)
+{
+    std::vector<TextRange> chunks;
+    const size_t chunkSize = ((size_t)(end - text) + numChunks - 1) / std::max<size_t>(1, numChunks);
+    while(text < end) {
+        // Advance to end of line after chunk's nominal end
+        const char *chunkEnd = text + std::min(chunkSize, (size_t)(end - text));
+        while(chunkEnd < end && chunkEnd[-1] != '\n') {
+            chunkEnd++;
+        }
+
+        chunks.emplace_back(text, chunkEnd);
+        text = chunkEnd;
+    }
+    return chunks;
+}
+}   // namespace ObjParsing
+}   // namespace AntWorld
+}   // namespace BoBRobotics
@@ -0,0 +1,520 @@
+// BoB robotics includes
+#include "antworld/software_renderer.h"
+#include "common/logging.h"
+#include "common/macros.h"
+
+// Standard C includes
+#include <cmath>
+
+// Standard C++ includes
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+//----------------------------------------------------------------------------
+// Anonymous namespace
+//----------------------------------------------------------------------------
+namespace
+{
+using Vector = std::array<float, 3>;
+
+// Rendering starts this far below the horizon (matches Renderer's RenderMeshSpherical)
+constexpr double StartLongitudeDegrees = 15.0;
+
+// Leaves with this many triangles or fewer aren't split further
+constexpr size_t MaxLeafSize = 4;
+
+// Bounding volume hierarchy is no deeper than this, so traversal stack can be fixed-size
+constexpr unsigned int MaxDepth = 64;
+
+// Number of bins used to evaluate the surface area heuristic when splitting nodes
+constexpr size_t NumBins = 16;
+
+inline Vector operator+(const Vector &a, const Vector &b)
+{
+    return { a[0] + b[0], a[1] + b[1], a[2] + b[2] };
+}
+
+inline Vector operator-(const Vector &a, const Vector &b)
+{
+    return { a[0] - b[0], a[1] - b[1], a[2] - b[2] };
+}
+
+inline Vector operator*(const Vector &a, float s)
+{
+    return { a[0] * s, a[1] * s, a[2] * s };
+}
+
+inline float dot(const Vector &a, const Vector &b)
+{
+    return (a[0] * b[0]) + (a[1] * b[1]) + (a[2] * b[2]);
+}
+
+inline Vector cross(const Vector &a, const Vector &b)
+{
+    return { (a[1] * b[2]) - (a[2] * b[1]),
+             (a[2] * b[0]) - (a[0] * b[2]),
+             (a[0] * b[1]) - (a[1] * b[0]) };
+}
+
+//! Axis-aligned bounding box
+struct Bounds
+{
+    Vector min{ { std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max() } };
+    Vector max{ { std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest() } };
+
+    void extend(const Vector &point)
+    {
+        for(size_t c = 0; c < 3; c++) {
+            min[c] = std::min(min[c], point[c]);
+            max[c] = std::max(max[c], point[c]);
+        }
+    }
+
+    void extend(const Bounds &bounds)
+    {
+        extend(bounds.min);
+        extend(bounds.max);
+    }
+
+    float surfaceArea() const
+    {
+        const Vector size = max - min;
+        if(size[0] < 0.0f) {
+            return 0.0f;
+        }
+        return 2.0f * ((size[0] * size[1]) + (size[1] * size[2]) + (size[2] * size[0]));
+    }
+};
+
+//! Slab test, giving the distance at which the ray enters the box (if it does so before maxDistance)
+inline bool intersectBox(const Vector &min, const Vector &max, const Vector &origin,
+                         const Vector &inverseDirection, float maxDistance, float &entryDistance)
+{
+    float entry = 0.0f;
+    float exit = maxDistance;
+    for(size_t c = 0; c < 3; c++) {
+        float t0 = (min[c] - origin[c]) * inverseDirection[c];
+        float t1 = (max[c] - origin[c]) * inverseDirection[c];
+        if(t0 > t1) {
+            std::swap(t0, t1);
+        }
+        entry = std::max(entry, t0);
+        exit = std::min(exit, t1);
+    }
+
+    entryDistance = entry;
+    return entry <= exit;
+}
+
+//! Sample texture bilinearly with its edges clamped, like OpenGL's GL_LINEAR and GL_CLAMP_TO_EDGE
+Vector sampleTexture(const cv::Mat &texture, float u, float v)
+{
+    const float x = std::min(std::max(u * texture.cols - 0.5f, 0.0f), (float)(texture.cols - 1));
+    const float y = std::min(std::max(v * texture.rows - 0.5f, 0.0f), (float)(texture.rows - 1));
+    const int x0 = (int)x;
+    const int y0 = (int)y;
+    const int x1 = std::min(x0 + 1, texture.cols - 1);
+    const int y1 = std::min(y0 + 1, texture.rows - 1);
+    const float fx = x - (float)x0;
+    const float fy = y - (float)y0;
+
+    const uint8_t *row0 = texture.ptr(y0);
+    const uint8_t *row1 = texture.ptr(y1);
+    Vector colour;
+    for(size_t c = 0; c < 3; c++) {
+        const float top = row0[(x0 * 3) + c] + (fx * (row0[(x1 * 3) + c] - row0[(x0 * 3) + c]));
+        const float bottom = row1[(x0 * 3) + c] + (fx * (row1[(x1 * 3) + c] - row1[(x0 * 3) + c]));
+        colour[c] = top + (fy * (bottom - top));
+    }
+    return colour;
+}
+}
+
+//----------------------------------------------------------------------------
+// BoBRobotics::AntWorld::SoftwareRenderer
+//----------------------------------------------------------------------------
+namespace BoBRobotics
+{
+namespace AntWorld
+{
+SoftwareRenderer::SoftwareRenderer(double nearClip, double farClip,
+                                   degree_t horizontalFOV, degree_t verticalFOV)
+:   m_SkyColour{ { 255.0f, 255.0f, 0.0f } },
+    m_ThreadPool(std::make_unique<ThreadPool>()),
+    m_NearClip((float)nearClip), m_FarClip((float)farClip),
+    m_HorizontalFOV(horizontalFOV), m_VerticalFOV(verticalFOV)
+{
+}
+//----------------------------------------------------------------------------
+void SoftwareRenderer::setWorld(WorldData world)
+{
+    m_World = std::move(world);
+    buildHierarchy();
+}
+//----------------------------------------------------------------------------
+void SoftwareRenderer::renderPanoramicView(meter_t x, meter_t y, meter_t z,
+                                           degree_t yaw, degree_t pitch, degree_t roll,
+                                           cv::Mat &image, const cv::Size &size, int type)
+{
+    BOB_ASSERT(type == CV_8UC3 || type == CV_8UC1);
+    image.create(size, type);
+    updateDirections(size);
+
+    // Build matrix which rotates from the world to the agent's frame, in the same way as Renderer::applyFrame()
+    const float cosYaw = (float)units::math::cos(yaw), sinYaw = (float)units::math::sin(yaw);
+    const float cosPitch = (float)units::math::cos(pitch), sinPitch = (float)units::math::sin(pitch);
+    const float cosRoll = (float)units::math::cos(roll), sinRoll = (float)units::math::sin(roll);
+    const float rollPitch[3][3]{ { cosRoll, sinRoll * sinPitch, sinRoll * cosPitch },
+                                 { 0.0f, cosPitch, -sinPitch },
+                                 { -sinRoll, cosRoll * sinPitch, cosRoll * cosPitch } };
+    const float yawMatrix[3][3]{ { cosYaw, -sinYaw, 0.0f },
+                                 { sinYaw, cosYaw, 0.0f },
+                                 { 0.0f, 0.0f, 1.0f } };
+    float rotation[3][3];
+    for(size_t i = 0; i < 3; i++) {
+        for(size_t j = 0; j < 3; j++) {
+            rotation[i][j] = 0.0f;
+            for(size_t k = 0; k < 3; k++) {
+                rotation[i][j] += rollPitch[i][k] * yawMatrix[k][j];
+            }
+        }
+    }
+
+    // Interleave rows between threads, as rows of sky are much cheaper than rows of ground
+    const Vector origin{ { (float)x.value(), (float)y.value(), (float)z.value() } };
+    const size_t numThreads = m_ThreadPool ? m_ThreadPool->getNumThreads() : 1;
+    const auto renderRows = [&](size_t chunk, size_t, size_t) {
+        for(int row = (int)chunk; row < size.height; row += (int)numThreads) {
+            renderRow(row, rotation, origin, image);
+        }
+    };
+    if(m_ThreadPool) {
+        m_ThreadPool->parallelFor(numThreads, renderRows);
+    }
+    else {
+        renderRows(0, 0, 1);
+    }
+}
+//----------------------------------------------------------------------------
+void SoftwareRenderer::setSkyColour(uint8_t blue, uint8_t green, uint8_t red)
+{
+    m_SkyColour = { { (float)blue, (float)green, (float)red } };
+}
+//----------------------------------------------------------------------------
+void SoftwareRenderer::setNumThreads(size_t numThreads)
+{
+    if(numThreads > 1) {
+        m_ThreadPool = std::make_unique<ThreadPool>(numThreads);
+    }
+    else {
+        m_ThreadPool.reset();
+    }
+}
+//----------------------------------------------------------------------------
+void SoftwareRenderer::buildHierarchy()
+{
+    // Gather triangles from all surfaces
+    m_Triangles.clear();
+    std::vector<Vector> centroids;
+    for(size_t s = 0; s < m_World.surfaces.size(); s++) {
+        const auto &surface = m_World.surfaces[s];
+        const auto &positions = surface.positions;
+        const bool indexed = !surface.indices.empty();
+        const size_t numVertices = indexed ? surface.indices.size() : (positions.size() / 3);
+        for(size_t v = 0; (v + 3) <= numVertices; v += 3) {
+            const std::array<uint32_t, 3> vertices{ { indexed ? surface.indices[v] : (uint32_t)v,
+                                                      indexed ? surface.indices[v + 1] : (uint32_t)(v + 1),
+                                                      indexed ? surface.indices[v + 2] : (uint32_t)(v + 2) } };
+            const Vector v0{ { positions[(vertices[0] * 3)], positions[(vertices[0] * 3) + 1], positions[(vertices[0] * 3) + 2] } };
+            const Vector v1{ { positions[(vertices[1] * 3)], positions[(vertices[1] * 3) + 1], positions[(vertices[1] * 3) + 2] } };
+            const Vector v2{ { positions[(vertices[2] * 3)], positions[(vertices[2] * 3) + 1], positions[(vertices[2] * 3) + 2] } };
+            m_Triangles.push_back({ v0, v1 - v0, v2 - v0, (uint32_t)s, vertices });
+            centroids.push_back((v0 + v1 + v2) * (1.0f / 3.0f));
+        }
+    }
+
+    // Recursively split triangles into nodes, sorting an array of indices
+    std::vector<uint32_t> indices(m_Triangles.size());
+    std::iota(indices.begin(), indices.end(), 0);
+    m_Nodes.clear();
+    m_Nodes.reserve(2 * (m_Triangles.size() / MaxLeafSize) + 1);
+    m_Nodes.emplace_back();
+    buildNode(0, 0, m_Triangles.size(), 0, indices, centroids);
+
+    // Reorder triangles so each leaf's are contiguous
+    std::vector<Triangle> sortedTriangles;
+    sortedTriangles.reserve(m_Triangles.size());
+    for(uint32_t i : indices) {
+        sortedTriangles.push_back(m_Triangles[i]);
+    }
+    m_Triangles.swap(sortedTriangles);
+
+    LOG_INFO << "Built bounding volume hierarchy with " << m_Nodes.size() << " nodes over " << m_Triangles.size() << " triangles";
+}
+//----------------------------------------------------------------------------
+void SoftwareRenderer::buildNode(size_t nodeIndex, size_t first, size_t count, unsigned int depth,
+                                 std::vector<uint32_t> &indices, const std::vector<Vector> &centroids)
+{
+    // Calculate bounds of triangles and of their centroids
+    Bounds bounds, centroidBounds;
+    for(size_t i = first; i < (first + count); i++) {
+        const Triangle &triangle = m_Triangles[indices[i]];
+        bounds.extend(triangle.vertex);
+        bounds.extend(triangle.vertex + triangle.edge1);
+        bounds.extend(triangle.vertex + triangle.edge2);
+        centroidBounds.extend(centroids[indices[i]]);
+    }
+
+    m_Nodes[nodeIndex].min = bounds.min;
+    m_Nodes[nodeIndex].max = bounds.max;
+    m_Nodes[nodeIndex].first = (uint32_t)first;
+    m_Nodes[nodeIndex].count = (uint32_t)count;
+
+    // Split along the axis in which centroids are most spread out
+    const Vector extent = centroidBounds.max - centroidBounds.min;
+    const size_t axis = std::distance(extent.cbegin(), std::max_element(extent.cbegin(), extent.cend()));
+    if(count <= MaxLeafSize || depth == (MaxDepth - 1) || !(extent[axis] > 0.0f)) {
+        return;
+    }
+
+    // Sort centroids into bins
+    Bounds binBounds[NumBins];
+    size_t binCounts[NumBins]{};
+    const float binScale = NumBins / extent[axis];
+    const auto getBin = [&](uint32_t index) {
+        return std::min(NumBins - 1, (size_t)((centroids[index][axis] - centroidBounds.min[axis]) * binScale));
+    };
+    for(size_t i = first; i < (first + count); i++) {
+        const Triangle &triangle = m_Triangles[indices[i]];
+        const size_t bin = getBin(indices[i]);
+        binCounts[bin]++;
+        binBounds[bin].extend(triangle.vertex);
+        binBounds[bin].extend(triangle.vertex + triangle.edge1);
+        binBounds[bin].extend(triangle.vertex + triangle.edge2);
+    }
+
+    // Sweep from the right, then the left, to find split with lowest surface area heuristic cost
+    float rightCosts[NumBins];
+    Bounds rightBounds;
+    size_t rightCount = 0;
+    for(size_t b = NumBins - 1; b > 0; b--) {
+        rightBounds.extend(binBounds[b]);
+        rightCount += binCounts[b];
+        rightCosts[b] = rightBounds.surfaceArea() * rightCount;
+    }
+    Bounds leftBounds;
+    size_t leftCount = 0;
+    size_t bestSplit = 0;
+    float bestCost = std::numeric_limits<float>::max();
+    for(size_t b = 1; b < NumBins; b++) {
+        leftBounds.extend(binBounds[b - 1]);
+        leftCount += binCounts[b - 1];
+        const float cost = (leftBounds.surfaceArea() * leftCount) + rightCosts[b];
+        if(cost < bestCost) {
+            bestCost = cost;
+            bestSplit = b;
+        }
+    }
+
+    // Splitting isn't worth it if it's no cheaper than testing every triangle (within reason)
+    if(count <= (4 * MaxLeafSize) && bestCost >= (bounds.surfaceArea() * count)) {
+        return;
+    }
+
+    // Partition triangles, falling back to a median split if they all ended up on one side
+    const auto begin = indices.begin() + first;
+    const auto end = begin + count;
+    auto middle = std::partition(begin, end, [&](uint32_t index) { return getBin(index) < bestSplit; });
+    if(middle == begin || middle == end) {
+        middle = begin + (count / 2);
+        std::nth_element(begin, middle, end,
+                         [&](uint32_t a, uint32_t b) { return centroids[a][axis] < centroids[b][axis]; });
+    }
+
+    // Add children and build them
+    const size_t leftIndex = m_Nodes.size();
+    m_Nodes.emplace_back();
+    m_Nodes.emplace_back();
+    m_Nodes[nodeIndex].first = (uint32_t)leftIndex;
+    m_Nodes[nodeIndex].count = 0;
+
+    const size_t leftSize = std::distance(begin, middle);
+    buildNode(leftIndex, first, leftSize, depth + 1, indices, centroids);
+    buildNode(leftIndex + 1, first + leftSize, count - leftSize, depth + 1, indices, centroids);
+}
+//----------------------------------------------------------------------------
+void SoftwareRenderer::updateDirections(const cv::Size &size)
+{
+    if(size == m_DirectionsSize) {
+        return;
+    }
+
+    // **NOTE** this reproduces the cubemap lookup of RenderMeshSpherical, transformed by
+    // Renderer's cube face matrices back into the agent's frame (x right, y forward, z up)
+    m_Directions.resize(size.width * size.height);
+    const double horizontalFOV = units::angle::radian_t(m_HorizontalFOV).value();
+    const double verticalFOV = units::angle::radian_t(m_VerticalFOV).value();
+    const double startLongitude = units::angle::radian_t(units::angle::degree_t(StartLongitudeDegrees)).value();
+    for(int row = 0; row < size.height; row++) {
+        // Images are read back from OpenGL upside down, so first row is at the top of the mesh
+        const double y = 1.0 - ((row + 0.5) / size.height);
+        const double longitude = startLongitude - (y * verticalFOV);
+        for(int col = 0; col < size.width; col++) {
+            const double x = (col + 0.5) / size.width;
+            const double latitude = (-horizontalFOV / 2.0) + (x * horizontalFOV);
+            m_Directions[(row * size.width) + col] = { { (float)(std::sin(latitude) * std::cos(longitude)),
+                                                        (float)(std::cos(latitude) * std::cos(longitude)),
+                                                        (float)-std::sin(longitude) } };
+        }
+    }
+    m_DirectionsSize = size;
+}
+//----------------------------------------------------------------------------
+void SoftwareRenderer::renderRow(int row, const float (&rotation)[3][3], const Vector &origin, cv::Mat &image) const
+{
+    const Vector *directions = &m_Directions[row * image.cols];
+    uint8_t *pixel = image.ptr(row);
+    const bool greyscale = (image.type() == CV_8UC1);
+    for(int col = 0; col < image.cols; col++) {
+        // Rotate direction from agent's frame into world's (i.e. multiply by transpose)
+        const Vector &agentDirection = directions[col];
+        Vector direction;
+        for(size_t c = 0; c < 3; c++) {
+            direction[c] = (rotation[0][c] * agentDirection[0]) + (rotation[1][c] * agentDirection[1]) + (rotation[2][c] * agentDirection[2]);
+        }
+
+        Hit hit;
+        const Vector colour = intersect(origin, direction, hit) ? shade(hit) : m_SkyColour;
+        if(greyscale) {
+            // Use same weights as cv::cvtColor
+            *pixel++ = (uint8_t)std::lround((0.114f * colour[0]) + (0.587f * colour[1]) + (0.299f * colour[2]));
+        }
+        else {
+            for(size_t c = 0; c < 3; c++) {
+                *pixel++ = (uint8_t)std::lround(colour[c]);
+            }
+        }
+    }
+}
+//----------------------------------------------------------------------------
+bool SoftwareRenderer::intersect(const Vector &origin, const Vector &direction, Hit &hit) const
+{
+    if(m_Nodes.empty()) {
+        return false;
+    }
+
+    // **NOTE** division by zero gives infinity, which the slab test handles correctly
+    const Vector inverseDirection{ { 1.0f / direction[0], 1.0f / direction[1], 1.0f / direction[2] } };
+    hit.distance = m_FarClip;
+    hit.triangle = nullptr;
+
+    uint32_t stack[MaxDepth + 1];
+    size_t stackSize = 0;
+    stack[stackSize++] = 0;
+    while(stackSize > 0) {
+        const Node &node = m_Nodes[stack[--stackSize]];
+
+        float entryDistance;
+        if(!intersectBox(node.min, node.max, origin, inverseDirection, hit.distance, entryDistance)) {
+            continue;
+        }
+
+        if(node.count > 0) {
+            // Moller-Trumbore intersection test with each triangle
+            for(uint32_t t = node.first; t < (node.first + node.count); t++) {
+                const Triangle &triangle = m_Triangles[t];
+                const Vector p = cross(direction, triangle.edge2);
+                const float determinant = dot(triangle.edge1, p);
+
+                // Cull back faces (OpenGL's default front faces are anticlockwise) and parallel rays
+                if(determinant <= std::numeric_limits<float>::epsilon()) {
+                    continue;
+                }
+
+                const float inverseDeterminant = 1.0f / determinant;
+                const Vector s = origin - triangle.vertex;
+                const float u = dot(s, p) * inverseDeterminant;
+                if(u < 0.0f || u > 1.0f) {
+                    continue;
+                }
+
+                const Vector q = cross(s, triangle.edge1);
+                const float v = dot(direction, q) * inverseDeterminant;
+                if(v < 0.0f || (u + v) > 1.0f) {
+                    continue;
+                }
+
+                const float distance = dot(triangle.edge2, q) * inverseDeterminant;
+                if(distance > m_NearClip && distance < hit.distance) {
+                    hit.distance = distance;
+                    hit.u = u;
+                    hit.v = v;
+                    hit.triangle = &triangle;
+                }
+            }
+        }
+        else {
+            // Visit nearer child first, so that more of the further one can be skipped
+            const Node &left = m_Nodes[node.first];
+            const Node &right = m_Nodes[node.first + 1];
+            float leftDistance, rightDistance;
+            const bool hitLeft = intersectBox(left.min, left.max, origin, inverseDirection, hit.distance, leftDistance);
+            const bool hitRight = intersectBox(right.min, right.max, origin, inverseDirection, hit.distance, rightDistance);
+            if(hitLeft && hitRight) {
+                if(leftDistance < rightDistance) {
+                    stack[stackSize++] = node.first + 1;
+                    stack[stackSize++] = node.first;
+                }
+                else {
+                    stack[stackSize++] = node.first;
+                    stack[stackSize++] = node.first + 1;
+                }
+            }
+            else if(hitLeft) {
+                stack[stackSize++] = node.first;
+            }
+            else if(hitRight) {
+                stack[stackSize++] = node.first + 1;
+            }
+        }
+    }
+
+    return hit.triangle != nullptr;
+}
+//----------------------------------------------------------------------------
+SoftwareRenderer::Vector SoftwareRenderer::shade(const Hit &hit) const
+{
+    const Triangle &triangle = *hit.triangle;
+    const auto &surface = m_World.surfaces[triangle.surface];
+    const float w = 1.0f - hit.u - hit.v;
+
+    // Like OpenGL, start with white and modulate by vertex colour and texture
+    Vector colour{ { 255.0f, 255.0f, 255.0f } };
+    if(!surface.colours.empty()) {
+        const uint8_t *c0 = &surface.colours[triangle.vertices[0] * 3];
+        const uint8_t *c1 = &surface.colours[triangle.vertices[1] * 3];
+        const uint8_t *c2 = &surface.colours[triangle.vertices[2] * 3];
+
+        // **NOTE** vertex colours are RGB
+        for(size_t i = 0; i < 3; i++) {
+            colour[2 - i] = (w * c0[i]) + (hit.u * c1[i]) + (hit.v * c2[i]);
+        }
+    }
+
+    if(surface.texture != -1 && !surface.texCoords.empty()) {
+        const float *t0 = &surface.texCoords[triangle.vertices[0] * 2];
+        const float *t1 = &surface.texCoords[triangle.vertices[1] * 2];
+        const float *t2 = &surface.texCoords[triangle.vertices[2] * 2];
+        const float u = (w * t0[0]) + (hit.u * t1[0]) + (hit.v * t2[0]);
+        const float v = (w * t0[1]) + (hit.u * t1[1]) + (hit.v * t2[1]);
+        const Vector texel = sampleTexture(m_World.textures[surface.texture], u, v);
+        for(size_t c = 0; c < 3; c++) {
+            colour[c] *= texel[c] / 255.0f;
+        }
+    }
+
+    return colour;
+}
+}   // namespace AntWorld
+}   // namespace BoBRobotics
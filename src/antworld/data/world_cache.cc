@@ -0,0 +1,333 @@
+// BoB robotics includes
+#include "antworld/world_cache.h"
+#include "common/logging.h"
+#include "common/macros.h"
+
+// Third-party includes
+#include "third_party/path.h"
+
+// Standard C includes
+#include <cstdio>
+#include <cstring>
+
+// Standard C++ includes
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+// POSIX includes
+#include <sys/stat.h>
+
+//----------------------------------------------------------------------------
+// Anonymous namespace
+//----------------------------------------------------------------------------
+namespace
+{
+/*
+ * Layout of world cache files (see WorldCache::write()). Values are stored in
+ * the native byte order of the machine which wrote the cache, so a cache
+ * written on a machine of the other endianness fails the version check (and
+ * is rebuilt from the model). The file consists of:
+ *  - a CacheHeader
+ *  - one CacheSurface per surface
+ *  - one CacheTexture per texture
+ *  - surface names, vertex data and texture data, each starting on a 64-byte
+ *    boundary
+ *
+ * Only the full-size level of each texture is stored as, with GL_LINEAR
+ * minification, no others would ever be sampled.
+ */
+constexpr char CacheMagic[8] = { 'B', 'o', 'B', 'W', 'o', 'r', 'l', 'd' };
+constexpr uint32_t CacheVersion = 2;
+constexpr size_t CacheAlignment = 64;
+
+struct CacheHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t numSurfaces;
+    uint32_t numTextures;
+    int32_t maxTextureSize;
+    float scale;
+    uint32_t reserved;
+    uint64_t objSize;
+    int64_t objModified;
+    float minBound[3];
+    float maxBound[3];
+    uint64_t surfacesOffset;
+    uint64_t texturesOffset;
+};
+static_assert(sizeof(CacheHeader) == 88, "CacheHeader must be 88 bytes");
+
+// **NOTE** offsets of missing vertex data are zero
+struct CacheSurface
+{
+    uint64_t nameOffset, nameSize;
+    uint64_t numVertices, numIndices;
+    uint64_t positionsOffset, coloursOffset, texCoordsOffset, indicesOffset;
+    int32_t texture;
+    uint32_t reserved;
+};
+static_assert(sizeof(CacheSurface) == 72, "CacheSurface must be 72 bytes");
+
+struct CacheTexture
+{
+    uint32_t width, height;
+    uint64_t offset;
+};
+static_assert(sizeof(CacheTexture) == 16, "CacheTexture must be 16 bytes");
+
+size_t alignCache(size_t offset)
+{
+    return ((offset + CacheAlignment - 1) / CacheAlignment) * CacheAlignment;
+}
+//----------------------------------------------------------------------------
+void getFileStatus(const filesystem::path &path, uint64_t &size, int64_t &modified)
+{
+#ifdef _WIN32
+    struct _stati64 status;
+    if(_stati64(path.str().c_str(), &status) != 0) {
+#else
+    struct stat status;
+    if(stat(path.str().c_str(), &status) != 0) {
+#endif
+        throw std::runtime_error("Cannot stat file: " + path.str());
+    }
+
+    size = static_cast<uint64_t>(status.st_size);
+    modified = static_cast<int64_t>(status.st_mtime);
+}
+//----------------------------------------------------------------------------
+bool readHeader(const filesystem::path &filename, CacheHeader &header)
+{
+    std::ifstream input(filename.str(), std::ios::binary);
+    if(!input.good()) {
+        return false;
+    }
+
+    input.read(reinterpret_cast<char*>(&header), sizeof(CacheHeader));
+    return (input.good() && std::memcmp(header.magic, CacheMagic, sizeof(CacheMagic)) == 0
+            && header.version == CacheVersion);
+}
+}   // Anonymous namespace
+
+//----------------------------------------------------------------------------
+// BoBRobotics::AntWorld::WorldCache
+//----------------------------------------------------------------------------
+namespace BoBRobotics
+{
+namespace AntWorld
+{
+WorldCache::WorldCache(const filesystem::path &filename)
+:   m_File(filename.str())
+{
+    const size_t fileSize = m_File.size();
+    const uint8_t *data = m_File.data();
+    BOB_ASSERT(fileSize >= sizeof(CacheHeader));
+
+    CacheHeader header;
+    std::memcpy(&header, data, sizeof(CacheHeader));
+    if(std::memcmp(header.magic, CacheMagic, sizeof(CacheMagic)) != 0) {
+        throw std::runtime_error(filename.str() + " is not a world cache");
+    }
+    if(header.version != CacheVersion) {
+        throw std::runtime_error("Unsupported world cache version " + std::to_string(header.version));
+    }
+    BOB_ASSERT(header.surfacesOffset + (header.numSurfaces * sizeof(CacheSurface)) <= fileSize);
+    BOB_ASSERT(header.texturesOffset + (header.numTextures * sizeof(CacheTexture)) <= fileSize);
+
+    for(unsigned int c = 0; c < 3; c++) {
+        m_MinBound[c] = meter_t(header.minBound[c]);
+        m_MaxBound[c] = meter_t(header.maxBound[c]);
+    }
+
+    // Get pointer to array within file, checking it's in bounds
+    const auto getArray = [data, fileSize](uint64_t offset, uint64_t size)
+    {
+        BOB_ASSERT(offset + size <= fileSize);
+        return (offset == 0) ? nullptr : (data + offset);
+    };
+
+    // Read surfaces
+    const auto *surfaces = reinterpret_cast<const CacheSurface*>(data + header.surfacesOffset);
+    m_Surfaces.reserve(header.numSurfaces);
+    for(unsigned int s = 0; s < header.numSurfaces; s++) {
+        const auto &surface = surfaces[s];
+        BOB_ASSERT(surface.positionsOffset != 0);
+        BOB_ASSERT(surface.texture < (int32_t)header.numTextures);
+
+        const auto *name = getArray(surface.nameOffset, surface.nameSize);
+        m_Surfaces.push_back({
+            (name == nullptr) ? std::string() : std::string(reinterpret_cast<const char*>(name), surface.nameSize),
+            surface.numVertices,
+            surface.numIndices,
+            reinterpret_cast<const float*>(getArray(surface.positionsOffset, surface.numVertices * 3 * sizeof(float))),
+            getArray(surface.coloursOffset, surface.numVertices * 3),
+            reinterpret_cast<const float*>(getArray(surface.texCoordsOffset, surface.numVertices * 2 * sizeof(float))),
+            reinterpret_cast<const uint32_t*>(getArray(surface.indicesOffset, surface.numIndices * sizeof(uint32_t))),
+            surface.texture });
+    }
+
+    // Wrap each texture in a cv::Mat
+    const auto *textures = reinterpret_cast<const CacheTexture*>(data + header.texturesOffset);
+    m_Textures.reserve(header.numTextures);
+    for(unsigned int t = 0; t < header.numTextures; t++) {
+        const auto &texture = textures[t];
+        const cv::Size size((int)texture.width, (int)texture.height);
+        m_Textures.emplace_back(size, CV_8UC3, const_cast<uint8_t*>(getArray(texture.offset, size.area() * 3)));
+    }
+
+    LOG_INFO << "Loaded world cache with " << m_Surfaces.size() << " surfaces and " << m_Textures.size() << " textures";
+}
+//----------------------------------------------------------------------------
+WorldData WorldCache::getWorldData() const
+{
+    WorldData world;
+    world.minBound = m_MinBound;
+    world.maxBound = m_MaxBound;
+
+    for(const auto &surface : m_Surfaces) {
+        world.surfaces.emplace_back();
+        auto &surfaceData = world.surfaces.back();
+        surfaceData.name = surface.name;
+        surfaceData.texture = surface.texture;
+        surfaceData.positions.assign(surface.positions, surface.positions + (surface.numVertices * 3));
+        if(surface.colours) {
+            surfaceData.colours.assign(surface.colours, surface.colours + (surface.numVertices * 3));
+        }
+        if(surface.texCoords) {
+            surfaceData.texCoords.assign(surface.texCoords, surface.texCoords + (surface.numVertices * 2));
+        }
+        if(surface.indices) {
+            surfaceData.indices.assign(surface.indices, surface.indices + surface.numIndices);
+        }
+    }
+
+    // Copy textures
+    for(const auto &texture : m_Textures) {
+        world.textures.emplace_back(texture.clone());
+    }
+    return world;
+}
+//----------------------------------------------------------------------------
+filesystem::path WorldCache::getPath(const filesystem::path &objFilename)
+{
+    return filesystem::path(objFilename.str() + ".cache");
+}
+//----------------------------------------------------------------------------
+bool WorldCache::isUpToDate(const filesystem::path &filename, const filesystem::path &objFilename,
+                            float scale, int maxTextureSize)
+{
+    // If cache can't be read, it needs writing
+    CacheHeader header;
+    if(!readHeader(filename, header)) {
+        return false;
+    }
+
+    // Cache is only valid if it was made from the same obj file, with the same parameters
+    uint64_t objSize;
+    int64_t objModified;
+    getFileStatus(objFilename, objSize, objModified);
+    return (header.objSize == objSize && header.objModified == objModified
+            && header.scale == scale && header.maxTextureSize == maxTextureSize);
+}
+//----------------------------------------------------------------------------
+void WorldCache::write(const filesystem::path &filename, const WorldData &world,
+                       const filesystem::path &objFilename, float scale, int maxTextureSize)
+{
+    CacheHeader header{};
+    std::memcpy(header.magic, CacheMagic, sizeof(CacheMagic));
+    header.version = CacheVersion;
+    header.numSurfaces = (uint32_t)world.surfaces.size();
+    header.numTextures = (uint32_t)world.textures.size();
+    header.maxTextureSize = maxTextureSize;
+    header.scale = scale;
+    getFileStatus(objFilename, header.objSize, header.objModified);
+    for(unsigned int c = 0; c < 3; c++) {
+        header.minBound[c] = (float)world.minBound[c].value();
+        header.maxBound[c] = (float)world.maxBound[c].value();
+    }
+    header.surfacesOffset = alignCache(sizeof(CacheHeader));
+    header.texturesOffset = alignCache(header.surfacesOffset + (header.numSurfaces * sizeof(CacheSurface)));
+
+    // Write to temporary file so other processes never see a partially-written cache
+    const std::string temporaryFilename = filename.str() + ".tmp";
+    std::ofstream output(temporaryFilename, std::ios::binary);
+    if(!output.good()) {
+        throw std::runtime_error("Cannot open world cache for writing: " + temporaryFilename);
+    }
+
+    // Leave space for header and tables, which are written once data offsets are known
+    size_t offset = alignCache(header.texturesOffset + (header.numTextures * sizeof(CacheTexture)));
+    const std::vector<char> padding(std::max(offset, CacheAlignment), 0);
+    output.write(padding.data(), offset);
+
+    // Write data at offset, returning the offset it was written at, or zero if there's no data
+    const auto writeData = [&output, &offset, &padding](const void *data, size_t size)
+    {
+        if(size == 0) {
+            return (uint64_t)0;
+        }
+
+        const uint64_t dataOffset = offset;
+        output.write(reinterpret_cast<const char*>(data), size);
+        offset = alignCache(offset + size);
+        output.write(padding.data(), offset - dataOffset - size);
+        return dataOffset;
+    };
+
+    // Write surfaces
+    std::vector<CacheSurface> surfaces(world.surfaces.size());
+    for(size_t s = 0; s < world.surfaces.size(); s++) {
+        const auto &surfaceData = world.surfaces[s];
+        BOB_ASSERT(!surfaceData.positions.empty());
+
+        auto &surface = surfaces[s];
+        surface.nameSize = surfaceData.name.size();
+        surface.nameOffset = writeData(surfaceData.name.data(), surfaceData.name.size());
+        surface.numVertices = surfaceData.getNumVertices();
+        surface.numIndices = surfaceData.indices.size();
+        surface.positionsOffset = writeData(surfaceData.positions.data(), surfaceData.positions.size() * sizeof(float));
+        surface.coloursOffset = writeData(surfaceData.colours.data(), surfaceData.colours.size());
+        surface.texCoordsOffset = writeData(surfaceData.texCoords.data(), surfaceData.texCoords.size() * sizeof(float));
+        surface.indicesOffset = writeData(surfaceData.indices.data(), surfaceData.indices.size() * sizeof(uint32_t));
+        surface.texture = surfaceData.texture;
+    }
+
+    // Write textures
+    std::vector<CacheTexture> textures(world.textures.size());
+    for(size_t t = 0; t < world.textures.size(); t++) {
+        BOB_ASSERT(world.textures[t].type() == CV_8UC3);
+
+        auto &texture = textures[t];
+        texture.width = (uint32_t)world.textures[t].cols;
+        texture.height = (uint32_t)world.textures[t].rows;
+
+        const cv::Mat data = world.textures[t].isContinuous() ? world.textures[t] : world.textures[t].clone();
+        texture.offset = writeData(data.data, data.total() * 3);
+    }
+
+    // Write header and tables
+    output.seekp(0);
+    output.write(reinterpret_cast<const char*>(&header), sizeof(CacheHeader));
+    output.seekp((std::streamoff)header.surfacesOffset);
+    output.write(reinterpret_cast<const char*>(surfaces.data()), surfaces.size() * sizeof(CacheSurface));
+    output.seekp((std::streamoff)header.texturesOffset);
+    output.write(reinterpret_cast<const char*>(textures.data()), textures.size() * sizeof(CacheTexture));
+    output.close();
+    if(output.fail()) {
+        std::remove(temporaryFilename.c_str());
+        throw std::runtime_error("Cannot write world cache: " + temporaryFilename);
+    }
+
+    // Replace any existing cache
+    std::remove(filename.str().c_str());
+    if(std::rename(temporaryFilename.c_str(), filename.str().c_str()) != 0) {
+        std::remove(temporaryFilename.c_str());
+        throw std::runtime_error("Cannot rename world cache to " + filename.str());
+    }
+
+    LOG_INFO << "Wrote world cache " << filename;
+}
+}   // namespace AntWorld
+}   // namespace BoBRobotics
@@ -0,0 +1,727 @@
+// BoB robotics includes
+#include "antworld/world_data.h"
+#include "antworld/obj_parsing.h"
+#include "common/macros.h"
+#include "common/logging.h"
+#include "common/memory_mapped_file.h"
+#include "common/thread_pool.h"
+
+// Third-party includes
+#include "third_party/path.h"
+
+// Standard C++ includes
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+
+//----------------------------------------------------------------------------
+// Anonymous namespace
+//----------------------------------------------------------------------------
+namespace
+{
+using namespace BoBRobotics;
+using SurfaceData = AntWorld::WorldData::SurfaceData;
+
+//! All of a vertex's attributes, packed so they can be hashed and compared bytewise
+struct VertexKey
+{
+    float position[3];
+    float texCoord[2];
+    uint8_t colour[4];
+
+    bool operator==(const VertexKey &other) const
+    {
+        return (std::memcmp(this, &other, sizeof(VertexKey)) == 0);
+    }
+};
+
+struct VertexKeyHash
+{
+    size_t operator()(const VertexKey &key) const
+    {
+        // FNV-1a over the key's 32-bit words
+        uint32_t words[sizeof(VertexKey) / sizeof(uint32_t)];
+        std::memcpy(words, &key, sizeof(VertexKey));
+        uint64_t hash = 14695981039346656037ull;
+        for(uint32_t w : words) {
+            hash = (hash ^ w) * 1099511628211ull;
+        }
+        return static_cast<size_t>(hash ^ (hash >> 32));
+    }
+};
+
+// **NOTE** face indices in obj files are either positive, referring to all the
+// vertices in the file, or negative, referring to those read most recently. As
+// chunks are parsed before we know how many vertices precede them, the latter
+// are stored relative to the start of the chunk and resolved when merging
+constexpr int32_t NoIndex = std::numeric_limits<int32_t>::min();
+
+//! A triangle read from an obj file
+struct ObjTriangle
+{
+    int32_t positions[3];
+
+    //! Texture coordinate indices (NoIndex if vertex has none)
+    int32_t texCoords[3];
+
+    //! Bit v is set if positions[v] is relative to the start of the chunk and bit v + 3 if texCoords[v] is
+    uint8_t relative;
+};
+
+//! Triangles read following a usemtl command or, if a chunk starts part way through a surface, the start of the chunk
+struct ObjFaceGroup
+{
+    bool newSurface;
+    std::string name;
+    std::vector<ObjTriangle> triangles;
+};
+
+//! Everything read from one chunk of an obj file
+struct ObjChunk
+{
+    std::vector<float> positions;
+    std::vector<uint8_t> colours;
+    std::vector<float> texCoords;
+    std::vector<std::string> materialLibraries;
+    std::vector<ObjFaceGroup> groups;
+};
+
+//! A texture named in an mtl file
+struct MaterialTexture
+{
+    std::string materialName;
+    std::string path;
+};
+
+const char *checkParsed(const char *text)
+{
+    if(text == nullptr) {
+        throw std::runtime_error("Cannot parse obj file");
+    }
+    return text;
+}
+//----------------------------------------------------------------------------
+uint8_t toColourByte(float colour)
+{
+    return static_cast<uint8_t>(std::round(std::min(1.0f, std::max(0.0f, colour)) * 255.0f));
+}
+//----------------------------------------------------------------------------
+size_t resolveIndex(int32_t index, bool relative, size_t chunkOffset, size_t size)
+{
+    const long resolved = relative ? ((long)chunkOffset + index) : index;
+    BOB_ASSERT(resolved >= 0 && (size_t)resolved < size);
+    return (size_t)resolved;
+}
+//----------------------------------------------------------------------------
+int32_t readFaceIndex(const char *&text, const char *end, size_t numRead, bool &relative)
+{
+    long index;
+    text = checkParsed(AntWorld::ObjParsing::parseInt(text, end, index));
+
+    // **NOTE** obj indices start from 1
+    BOB_ASSERT(index != 0);
+    relative = (index < 0);
+    return (int32_t)(relative ? ((long)numRead + index) : (index - 1));
+}
+//----------------------------------------------------------------------------
+void readFace(const char *text, const char *end, ObjChunk &chunk,
+              std::vector<int32_t> &positions, std::vector<int32_t> &texCoords, std::vector<uint8_t> &relative)
+{
+    const size_t numPositions = chunk.positions.size() / 3;
+    const size_t numTexCoords = chunk.texCoords.size() / 2;
+
+    // Loop through face vertices i.e. P[/[T][/N]]
+    positions.clear();
+    texCoords.clear();
+    relative.clear();
+    while((text = AntWorld::ObjParsing::skipWhitespace(text, end)) < end) {
+        // Read index of position
+        bool positionRelative;
+        positions.push_back(readFaceIndex(text, end, numPositions, positionRelative));
+
+        // If there is a texture coordinate, read its index
+        bool texCoordRelative = false;
+        if(text < end && *text == '/' && (text + 1) < end && text[1] != '/') {
+            text++;
+            texCoords.push_back(readFaceIndex(text, end, numTexCoords, texCoordRelative));
+        }
+        else {
+            texCoords.push_back(NoIndex);
+        }
+        relative.push_back((uint8_t)(positionRelative ? 1 : 0) | (uint8_t)(texCoordRelative ? 8 : 0));
+
+        // Skip normal index
+        while(text < end && *text != ' ' && *text != '\t') {
+            text++;
+        }
+    }
+    BOB_ASSERT(positions.size() >= 3);
+
+    // Add triangles, splitting any larger polygons into a fan
+    auto &triangles = chunk.groups.back().triangles;
+    for(size_t v = 2; v < positions.size(); v++) {
+        triangles.push_back({ { positions[0], positions[v - 1], positions[v] },
+                              { texCoords[0], texCoords[v - 1], texCoords[v] },
+                              (uint8_t)(relative[0] | (relative[v - 1] << 1) | (relative[v] << 2)) });
+    }
+}
+//----------------------------------------------------------------------------
+void readChunk(const char *text, const char *end, float scale, ObjChunk &chunk)
+{
+    using namespace AntWorld::ObjParsing;
+
+    // Scratch space for reading faces
+    std::vector<int32_t> facePositions;
+    std::vector<int32_t> faceTexCoords;
+    std::vector<uint8_t> faceRelative;
+
+    TextRange command;
+    TextRange parameter;
+    forEachLine(text, end,
+                [&](const char *line, const char *lineEnd)
+                {
+                    // Read command from first token
+                    const char *p = readToken(line, lineEnd, command);
+
+                    // Entirely skip comment or empty lines
+                    if(command.first == command.second || *command.first == '#') {
+                        return;
+                    }
+
+                    if(tokenEquals(command, "mtllib")) {
+                        readToken(p, lineEnd, parameter);
+                        chunk.materialLibraries.emplace_back(parameter.first, parameter.second);
+                    }
+                    else if(tokenEquals(command, "o")) {
+                        readToken(p, lineEnd, parameter);
+                        LOG_DEBUG << "Reading object: " << std::string(parameter.first, parameter.second);
+                    }
+                    else if(tokenEquals(command, "v")) {
+                        // Read vertex
+                        float component;
+                        for(unsigned int c = 0; c < 3; c++) {
+                            p = checkParsed(parseFloat(p, lineEnd, component));
+                            chunk.positions.push_back(component * scale);
+                        }
+
+                        // If line has more data, read it into colours
+                        if(skipWhitespace(p, lineEnd) != lineEnd) {
+                            for(unsigned int c = 0; c < 3; c++) {
+                                p = checkParsed(parseFloat(p, lineEnd, component));
+                                chunk.colours.push_back(toColourByte(component));
+                            }
+                        }
+                    }
+                    else if(tokenEquals(command, "vt")) {
+                        // Read texture coordinate and check there's no unhandled components following it
+                        float component;
+                        for(unsigned int c = 0; c < 2; c++) {
+                            p = checkParsed(parseFloat(p, lineEnd, component));
+                            chunk.texCoords.push_back(component);
+                        }
+                        BOB_ASSERT(skipWhitespace(p, lineEnd) == lineEnd);
+                    }
+                    else if(tokenEquals(command, "vn") || tokenEquals(command, "s")) {
+                        // ignore vertex normals and smoothing
+                    }
+                    else if(tokenEquals(command, "usemtl")) {
+                        readToken(p, lineEnd, parameter);
+                        chunk.groups.push_back({ true, std::string(parameter.first, parameter.second), {} });
+                        LOG_INFO << "\tReading surface: " << chunk.groups.back().name;
+                    }
+                    else if(tokenEquals(command, "f")) {
+                        // If chunk starts part way through a surface, add group to continue it
+                        if(chunk.groups.empty()) {
+                            chunk.groups.push_back({ false, "", {} });
+                        }
+
+                        readFace(p, lineEnd, chunk, facePositions, faceTexCoords, faceRelative);
+                    }
+                    else {
+                        LOG_WARNING << "Unhandled obj tag '" << std::string(command.first, command.second) << "'";
+                    }
+                });
+}
+//----------------------------------------------------------------------------
+void buildSurface(const std::vector<std::pair<size_t, const ObjFaceGroup*>> &groups,
+                  const std::vector<float> &rawPositions,
+                  const std::vector<uint8_t> &rawColours,
+                  const std::vector<float> &rawTexCoords,
+                  const std::vector<size_t> &positionOffsets,
+                  const std::vector<size_t> &texCoordOffsets,
+                  SurfaceData &surface)
+{
+    const size_t numRawPositions = rawPositions.size() / 3;
+    const size_t numRawTexCoords = rawTexCoords.size() / 2;
+    BOB_ASSERT(numRawPositions <= std::numeric_limits<uint32_t>::max());
+    BOB_ASSERT(numRawTexCoords < std::numeric_limits<uint32_t>::max());
+
+    // Count triangles so we can reserve memory
+    size_t numTriangles = 0;
+    for(const auto &group : groups) {
+        numTriangles += group.second->triangles.size();
+    }
+    surface.indices.reserve(numTriangles * 3);
+
+    // Loop through triangles' vertices
+    std::unordered_map<uint64_t, uint32_t> vertexIndices;
+    for(const auto &group : groups) {
+        const size_t positionOffset = positionOffsets[group.first];
+        const size_t texCoordOffset = texCoordOffsets[group.first];
+        for(const auto &triangle : group.second->triangles) {
+            for(unsigned int v = 0; v < 3; v++) {
+                // Get index of raw position and, if there is one, raw texture coordinate
+                const size_t position = resolveIndex(triangle.positions[v], triangle.relative & (1 << v),
+                                                     positionOffset, numRawPositions);
+                const bool hasTexCoord = (triangle.texCoords[v] != NoIndex);
+                const size_t texCoord = hasTexCoord ? resolveIndex(triangle.texCoords[v], triangle.relative & (8 << v),
+                                                                   texCoordOffset, numRawTexCoords) : 0;
+
+                // Vertices are distinct if they have a different position or texture coordinate
+                const uint64_t key = ((uint64_t)position << 32) | (hasTexCoord ? (texCoord + 1) : 0);
+                const auto vertex = vertexIndices.emplace(key, (uint32_t)vertexIndices.size());
+                if(vertex.second) {
+                    std::copy_n(&rawPositions[3 * position], 3, std::back_inserter(surface.positions));
+                    if(!rawColours.empty()) {
+                        std::copy_n(&rawColours[3 * position], 3, std::back_inserter(surface.colours));
+                    }
+                    if(hasTexCoord) {
+                        std::copy_n(&rawTexCoords[2 * texCoord], 2, std::back_inserter(surface.texCoords));
+                    }
+                }
+                surface.indices.push_back(vertex.first->second);
+            }
+        }
+    }
+}
+//----------------------------------------------------------------------------
+void stripWindowsLineEnding(std::string &lineString)
+{
+    // If line has a Windows line ending, remove it
+    if(!lineString.empty() && lineString.back() == '\r') {
+        lineString.pop_back();
+    }
+}
+//----------------------------------------------------------------------------
+void loadMaterials(const filesystem::path &basePath, const std::string &filename,
+                   std::vector<MaterialTexture> &textures)
+{
+    // Open obj file
+    std::ifstream mtlFile((basePath / filename).str());
+    if(!mtlFile.good()) {
+        throw std::runtime_error("Cannot open mtl file: " + filename);
+    }
+
+    LOG_DEBUG << "Reading material file: " << filename;
+
+    // Read lines into strings
+    std::string currentMaterialName;
+    std::string lineString;
+    std::string commandString;
+    std::string parameterString;
+    while(std::getline(mtlFile, lineString)) {
+        // Strip windows line endings
+        stripWindowsLineEnding(lineString);
+
+        // Entirely skip comment or empty lines
+        if(lineString[0] == '#' || lineString.empty()) {
+            continue;
+        }
+
+        // Wrap line in stream for easier parsing
+        std::istringstream lineStream(lineString);
+
+        // Read command from first token
+        lineStream >> commandString;
+        if(commandString == "newmtl") {
+            lineStream >> currentMaterialName;
+            LOG_INFO << "\tReading material: " << currentMaterialName;
+        }
+        else if(commandString == "Ns" || commandString == "Ka" || commandString == "Kd"
+            || commandString == "Ks" || commandString == "Ke" || commandString == "Ni"
+            || commandString == "d" || commandString == "illum")
+        {
+            // ignore lighting properties
+        }
+        else if(commandString == "map_Kd") {
+            BOB_ASSERT(!currentMaterialName.empty());
+
+            // Skip any whitespace preceeding texture filename
+            while(lineStream.peek() == ' ') {
+                lineStream.get();
+            }
+
+            // Treat remainder of line as texture filename
+            std::string textureFilename;
+            std::getline(lineStream, textureFilename);
+            const size_t firstNonQuote = textureFilename.find_first_not_of('"');
+            const size_t lastNonQuote = textureFilename.find_last_not_of('"');
+            textureFilename = textureFilename.substr(firstNonQuote, lastNonQuote - firstNonQuote + 1);
+
+            LOG_DEBUG << "\t\tTexture: '" << textureFilename << "'";
+
+            // Add texture to list to load
+            textures.push_back({ currentMaterialName, (basePath / textureFilename).str() });
+        }
+        else {
+            LOG_WARNING << "Unhandled mtl tag '" << commandString << "'";
+        }
+
+    }
+}
+//----------------------------------------------------------------------------
+cv::Mat loadTexture(const std::string &texturePath, int maxTextureSize)
+{
+    // Load texture
+    // **NOTE** using OpenCV so as to reduce need for extra dependencies
+    cv::Mat texture = cv::imread(texturePath);
+
+    // If texture couldn't be loaded, give warning
+    if(texture.cols == 0 && texture.rows == 0) {
+        LOG_WARNING << "Cannot load texture '" << texturePath << "'";
+        return texture;
+    }
+
+    LOG_DEBUG << "\t\t\tOriginal dimensions: " << texture.cols << "x" << texture.rows;
+
+    // If texture isn't square, use longest side as size
+    int size = texture.cols;
+    if(texture.cols != texture.rows) {
+        size = std::max(texture.cols, texture.rows);
+    }
+
+    // Clamp size to maximum texture size
+    if(maxTextureSize != -1) {
+        size = std::min(size, maxTextureSize);
+    }
+
+    // Perform resize if required
+    if(size != texture.cols || size != texture.rows) {
+        LOG_DEBUG << "\t\t\tResizing to: " << size << "x" << size;
+        cv::resize(texture, texture, cv::Size(size, size), 0, 0, cv::INTER_CUBIC);
+    }
+
+    // Flip texture about y-axis as the origin of OpenGL texture coordinates
+    // is in the bottom-left and obj file's is in the top-left
+    cv::flip(texture, texture, 0);
+    return texture;
+}
+}
+
+//----------------------------------------------------------------------------
+// BoBRobotics::AntWorld::WorldData
+//----------------------------------------------------------------------------
+namespace BoBRobotics
+{
+namespace AntWorld
+{
+WorldData WorldData::load(const filesystem::path &filename, const float (&worldColour)[3],
+                          const float (&groundColour)[3])
+{
+    // Create single surface
+    WorldData world;
+    world.surfaces.emplace_back();
+    auto &surface = world.surfaces.back();
+
+    // Open file for binary IO
+    std::ifstream input(filename.str(), std::ios::binary);
+    if(!input.good()) {
+        throw std::runtime_error("Cannot open world file:" + filename.str());
+    }
+
+    // Seek to end of file, get size and rewind
+    input.seekg(0, std::ios_base::end);
+    const auto numTriangles = static_cast<size_t>(input.tellg()) / (sizeof(double) * 12);
+    input.seekg(0);
+    LOG_INFO << "World has " << numTriangles << " triangles";
+
+    {
+        // Reserve 3 XYZ positions for each triangle and 6 for the ground
+        auto &positions = surface.positions;
+        positions.resize((6 + (numTriangles * 3)) * 3);
+
+        // Initialise bounds to limits of underlying data types
+        std::fill_n(&world.minBound[0], 3, std::numeric_limits<meter_t>::max());
+        std::fill_n(&world.maxBound[0], 3, std::numeric_limits<meter_t>::min());
+
+        // Loop through components(X, Y and Z)
+        for(unsigned int c = 0; c < 3; c++) {
+            // Loop through vertices in each triangle
+            for(unsigned int v = 0; v < 3; v++) {
+                // Loop through triangles
+                for(unsigned int t = 0; t < numTriangles; t++) {
+                    // Read triangle position component
+                    double trianglePosition;
+                    input.read(reinterpret_cast<char*>(&trianglePosition), sizeof(double));
+
+                    // Copy three coordinates from triangle into correct place in vertex array
+                    // **NOTE** after first ground polygons
+                    positions[18 + (t * 9) + (v * 3) + c] = (float)trianglePosition;
+
+                    // Update bounds
+                    world.minBound[c] = units::math::min(world.minBound[c], meter_t(trianglePosition));
+                    world.maxBound[c] = units::math::max(world.maxBound[c], meter_t(trianglePosition));
+                }
+            }
+        }
+
+        const auto &minBound = world.minBound;
+        const auto &maxBound = world.maxBound;
+
+        // Add first ground plane triangle vertex positions
+        positions[0] = minBound[0].value();   positions[1] = minBound[1].value();   positions[2] = 0.0f;
+        positions[3] = maxBound[0].value();   positions[4] = maxBound[1].value();   positions[5] = 0.0f;
+        positions[6] = minBound[0].value();   positions[7] = maxBound[1].value();   positions[8] = 0.0f;
+
+        // Add second ground plane triangle vertex positions
+        positions[9] = minBound[0].value();   positions[10] = minBound[1].value();  positions[11] = 0.0f;
+        positions[12] = maxBound[0].value();  positions[13] = minBound[1].value();  positions[14] = 0.0f;
+        positions[15] = maxBound[0].value();  positions[16] = maxBound[1].value();  positions[17] = 0.0f;
+
+        LOG_INFO << "Min: (" << minBound[0] << ", " << minBound[1] << ", " << minBound[2] << ")";
+        LOG_INFO << "Max: (" << maxBound[0] << ", " << maxBound[1] << ", " << maxBound[2] << ")";
+    }
+
+    {
+        // Reserve 3 RGB colours for each triangle and for the ground
+        auto &colours = surface.colours;
+        colours.resize((6 + (numTriangles * 3)) * 3);
+
+        // Ground triangle colours
+        for(unsigned int c = 0; c < (6 * 3); c += 3) {
+            colours[c] = toColourByte(groundColour[0]);
+            colours[c + 1] = toColourByte(groundColour[1]);
+            colours[c + 2] = toColourByte(groundColour[2]);
+        }
+
+        // Loop through triangles
+        for(unsigned int t = 0; t < numTriangles; t++) {
+            // Read triangle colour component
+            // **NOTE** we only bother reading the R channel because colours are greyscale anyway
+            double triangleColour;
+            input.read(reinterpret_cast<char*>(&triangleColour), sizeof(double));
+
+            // Loop through vertices that make up triangle and
+            // set to world colour multiplied by triangle colour
+            for(unsigned int v = 0; v < 3; v++) {
+                colours[18 + (t * 9) + (v * 3)] = toColourByte(worldColour[0] * triangleColour);
+                colours[18 + (t * 9) + (v * 3) + 1] = toColourByte(worldColour[1] * triangleColour);
+                colours[18 + (t * 9) + (v * 3) + 2] = toColourByte(worldColour[2] * triangleColour);
+            }
+        }
+    }
+
+    return world;
+}
+//----------------------------------------------------------------------------
+void WorldData::index()
+{
+    for(auto &surface : surfaces) {
+        // Skip surfaces which are already indexed
+        if(!surface.indices.empty()) {
+            continue;
+        }
+
+        const size_t numVertices = surface.getNumVertices();
+        const bool hasColours = !surface.colours.empty();
+        const bool hasTexCoords = !surface.texCoords.empty();
+        BOB_ASSERT(numVertices <= std::numeric_limits<uint32_t>::max());
+
+        std::vector<float> positions;
+        std::vector<uint8_t> colours;
+        std::vector<float> texCoords;
+        positions.reserve(surface.positions.size());
+        colours.reserve(surface.colours.size());
+        texCoords.reserve(surface.texCoords.size());
+        surface.indices.reserve(numVertices);
+
+        // Loop through vertices, adding each distinct one to the new vertex arrays
+        std::unordered_map<VertexKey, uint32_t, VertexKeyHash> uniqueVertices;
+        uniqueVertices.reserve(numVertices);
+        for(size_t v = 0; v < numVertices; v++) {
+            VertexKey key{};
+            std::copy_n(&surface.positions[v * 3], 3, key.position);
+            if(hasColours) {
+                std::copy_n(&surface.colours[v * 3], 3, key.colour);
+            }
+            if(hasTexCoords) {
+                std::copy_n(&surface.texCoords[v * 2], 2, key.texCoord);
+            }
+
+            const auto vertex = uniqueVertices.emplace(key, (uint32_t)uniqueVertices.size());
+            if(vertex.second) {
+                positions.insert(positions.end(), key.position, key.position + 3);
+                if(hasColours) {
+                    colours.insert(colours.end(), key.colour, key.colour + 3);
+                }
+                if(hasTexCoords) {
+                    texCoords.insert(texCoords.end(), key.texCoord, key.texCoord + 2);
+                }
+            }
+            surface.indices.push_back(vertex.first->second);
+        }
+
+        LOG_DEBUG << "Surface '" << surface.name << "' indexed: " << uniqueVertices.size() << "/" << numVertices << " distinct vertices";
+
+        // Replace vertices with distinct ones
+        positions.shrink_to_fit();
+        colours.shrink_to_fit();
+        texCoords.shrink_to_fit();
+        surface.positions.swap(positions);
+        surface.colours.swap(colours);
+        surface.texCoords.swap(texCoords);
+    }
+}
+//----------------------------------------------------------------------------
+WorldData WorldData::loadObj(const filesystem::path &filename, float scale, int maxTextureSize)
+{
+    // Map obj file into memory
+    if(!filename.exists()) {
+        throw std::runtime_error("Cannot open obj file: " + filename.str());
+    }
+    const MemoryMappedFile objFile(filename.str());
+
+    // Load materials etc relative to obj file
+    return loadObj(reinterpret_cast<const char*>(objFile.data()), objFile.size(),
+                   filename.make_absolute().parent_path(), scale, maxTextureSize);
+}
+//----------------------------------------------------------------------------
+WorldData WorldData::loadObj(const char *objText, size_t objSize, const filesystem::path &basePath,
+                             float scale, int maxTextureSize, size_t numChunks)
+{
+    WorldData world;
+    auto &objSurfaces = world.surfaces;
+
+    // Split file into chunks of lines and parse them in parallel
+    ThreadPool threadPool;
+    const auto chunkText = ObjParsing::splitLines(objText, objText + objSize,
+                                                  (numChunks == 0) ? threadPool.getNumThreads() : numChunks);
+    std::vector<ObjChunk> chunks(chunkText.size());
+    threadPool.parallelFor(chunks.size(),
+                           [&chunkText, &chunks, scale](size_t, size_t begin, size_t end)
+                           {
+                               for(size_t c = begin; c < end; c++) {
+                                   readChunk(chunkText[c].first, chunkText[c].second, scale, chunks[c]);
+                               }
+                           });
+
+    // Concatenate 'raw' positions, colours and texture coordinates, recording where each chunk's start
+    std::vector<float> rawPositions;
+    std::vector<uint8_t> rawColours;
+    std::vector<float> rawTexCoords;
+    std::vector<size_t> positionOffsets;
+    std::vector<size_t> texCoordOffsets;
+    for(const auto &chunk : chunks) {
+        positionOffsets.push_back(rawPositions.size() / 3);
+        texCoordOffsets.push_back(rawTexCoords.size() / 2);
+        rawPositions.insert(rawPositions.end(), chunk.positions.cbegin(), chunk.positions.cend());
+        rawColours.insert(rawColours.end(), chunk.colours.cbegin(), chunk.colours.cend());
+        rawTexCoords.insert(rawTexCoords.end(), chunk.texCoords.cbegin(), chunk.texCoords.cend());
+    }
+
+    // If there are ANY raw colours, assert that there are the same number as there are positions
+    if(!rawColours.empty()) {
+        BOB_ASSERT(rawColours.size() == rawPositions.size());
+    }
+
+    // Gather the groups of triangles making up each surface, in order
+    std::vector<std::vector<std::pair<size_t, const ObjFaceGroup*>>> surfaceGroups;
+    for(size_t c = 0; c < chunks.size(); c++) {
+        for(const auto &group : chunks[c].groups) {
+            if(group.newSurface) {
+                objSurfaces.emplace_back();
+                objSurfaces.back().name = group.name;
+                surfaceGroups.emplace_back();
+            }
+            // If there are no textures, surfaces aren't always created (at least be MeshLab), so create a default one
+            else if(objSurfaces.empty()) {
+                LOG_WARNING << "Encountered faces before any surfaces are defined - adding default surface";
+                objSurfaces.emplace_back();
+                objSurfaces.back().name = "default";
+                surfaceGroups.emplace_back();
+            }
+            surfaceGroups.back().emplace_back(c, &group);
+        }
+    }
+
+    // Build indexed surfaces in parallel
+    threadPool.parallelFor(objSurfaces.size(),
+                           [&](size_t, size_t begin, size_t end)
+                           {
+                               for(size_t s = begin; s < end; s++) {
+                                   buildSurface(surfaceGroups[s], rawPositions, rawColours, rawTexCoords,
+                                                positionOffsets, texCoordOffsets, objSurfaces[s]);
+                               }
+                           });
+
+    // Parse materials
+    std::vector<MaterialTexture> materialTextures;
+    for(const auto &chunk : chunks) {
+        for(const auto &library : chunk.materialLibraries) {
+            loadMaterials(basePath, library, materialTextures);
+        }
+    }
+
+    // Load textures in parallel
+    std::vector<cv::Mat> textures(materialTextures.size());
+    threadPool.parallelFor(textures.size(),
+                           [&materialTextures, &textures, maxTextureSize](size_t, size_t begin, size_t end)
+                           {
+                               for(size_t t = begin; t < end; t++) {
+                                   textures[t] = loadTexture(materialTextures[t].path, maxTextureSize);
+                               }
+                           });
+
+    // Add textures which could be loaded to world, mapping material names to texture indices
+    std::map<std::string, int> textureNames;
+    for(size_t t = 0; t < textures.size(); t++) {
+        if(!textures[t].empty()) {
+            world.textures.emplace_back(textures[t]);
+
+            const bool inserted = textureNames.insert(std::make_pair(materialTextures[t].materialName, (int)world.textures.size() - 1)).second;
+            BOB_ASSERT(inserted);
+        }
+    }
+
+    size_t numVertices = 0;
+    for(const auto &surface : objSurfaces) {
+        numVertices += surface.getNumVertices();
+    }
+    LOG_INFO << "\t" << rawPositions.size() / 3 << " raw positions, " << rawTexCoords.size() / 2 << " raw texture coordinates, ";
+    LOG_INFO << rawColours.size() / 3 << " raw colours, " << objSurfaces.size() << " surfaces, " << world.textures.size() << " textures";
+    LOG_INFO << "\t" << numVertices << " distinct vertices";
+
+    // Initialise bounds to limits of underlying data types
+    std::fill_n(&world.minBound[0], 3, std::numeric_limits<meter_t>::max());
+    std::fill_n(&world.maxBound[0], 3, std::numeric_limits<meter_t>::lowest());
+    for(unsigned int i = 0; i < rawPositions.size(); i += 3) {
+        for(unsigned int c = 0; c < 3; c++) {
+            world.minBound[c] = units::math::min(world.minBound[c], meter_t(rawPositions[i + c]));
+            world.maxBound[c] = units::math::max(world.maxBound[c], meter_t(rawPositions[i + c]));
+        }
+    }
+
+    LOG_INFO << "Min: (" << world.minBound[0] << ", " << world.minBound[1] << ", " << world.minBound[2] << ")";
+    LOG_INFO << "Max: (" << world.maxBound[0] << ", " << world.maxBound[1] << ", " << world.maxBound[2] << ")";
+
+    // Find texture corresponding to each textured surface
+    for(auto &surface : objSurfaces) {
+        if(!surface.texCoords.empty()) {
+            const auto tex = textureNames.find(surface.name);
+            if(tex != textureNames.end()) {
+                surface.texture = tex->second;
+            }
+        }
+    }
+
+    return world;
+}
+}   // namespace AntWorld
+}   // namespace BoBRobotics
@@ -3,11 +3,66 @@
 #include "antworld/render_mesh.h"
 
 // Standard C++ includes
+#include <algorithm>
+#include <cmath>
 #include <vector>
 
 using namespace units::angle;
 using namespace units::math; // cmath functions for unit types
 
+//----------------------------------------------------------------------------
+// Anonymous namespace
+//----------------------------------------------------------------------------
+namespace
+{
+void addCubeFaces(const GLfloat (&direction)[3], std::bitset<6> &cubeFaces)
+{
+    // Cubemap faces are selected by the component with the largest magnitude
+    // **NOTE** faces are added for all components which tie so selection is conservative
+    const GLfloat major = std::max({ std::abs(direction[0]), std::abs(direction[1]), std::abs(direction[2]) });
+    for(unsigned int a = 0; a < 3; a++) {
+        if(std::abs(direction[a]) >= major * 0.999f) {
+            cubeFaces.set((a * 2) + ((direction[a] < 0.0f) ? 1 : 0));
+        }
+    }
+}
+//----------------------------------------------------------------------------
+std::bitset<6> getSampledCubeFaces(const std::vector<GLfloat> &textureCoords, unsigned int numHorizontalVerts,
+                                   unsigned int numHorizontalSegments, unsigned int numVerticalSegments)
+{
+    // Number of samples taken along each edge of each quad
+    constexpr unsigned int numSamples = 5;
+
+    std::bitset<6> cubeFaces;
+    for(unsigned int y = 0; y < numVerticalSegments; y++) {
+        for(unsigned int x = 0; x < numHorizontalSegments; x++) {
+            // Get texture coordinates of quad's corners
+            const GLfloat *corners[4]{
+                &textureCoords[((y * numHorizontalVerts) + x) * 3],
+                &textureCoords[((y * numHorizontalVerts) + x + 1) * 3],
+                &textureCoords[(((y + 1) * numHorizontalVerts) + x) * 3],
+                &textureCoords[(((y + 1) * numHorizontalVerts) + x + 1) * 3] };
+
+            // Texture coordinates are interpolated across quads, so sample directions across them too
+            for(unsigned int j = 0; j < numSamples; j++) {
+                const GLfloat v = (GLfloat)j / (GLfloat)(numSamples - 1);
+                for(unsigned int i = 0; i < numSamples; i++) {
+                    const GLfloat u = (GLfloat)i / (GLfloat)(numSamples - 1);
+
+                    GLfloat direction[3];
+                    for(unsigned int c = 0; c < 3; c++) {
+                        direction[c] = ((1.0f - u) * (1.0f - v) * corners[0][c]) + (u * (1.0f - v) * corners[1][c])
+                            + ((1.0f - u) * v * corners[2][c]) + (u * v * corners[3][c]);
+                    }
+                    addCubeFaces(direction, cubeFaces);
+                }
+            }
+        }
+    }
+    return cubeFaces;
+}
+}   // Anonymous namespace
+
 //----------------------------------------------------------------------------
 // BoBRobotics::AntWorld::RenderMesh
 //----------------------------------------------------------------------------
@@ -90,6 +145,10 @@ RenderMeshSpherical::RenderMeshSpherical(degree_t horizontalFOV, degree_t vertic
         // Upload positions and texture coordinates
         getSurface().uploadPositions(positions, 2);
         getSurface().uploadTexCoords(textureCoords, 3);
+
+        // Determine which cubemap faces mesh samples so renderer can skip the others
+        setCubeFaces(getSampledCubeFaces(textureCoords, numHorizontalVerts,
+                                         numHorizontalSegments, numVerticalSegments));
     }
 
     {
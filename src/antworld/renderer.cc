@@ -3,7 +3,120 @@
 #include "antworld/render_target.h"
 
 // Standard C++ includes
+#include <algorithm>
 #include <stdexcept>
+#include <string>
+#include <vector>
+
+//------------------------------------------------------------------------
+// Anonymous namespace
+//------------------------------------------------------------------------
+namespace
+{
+// Transforms vertices by the ant's frame, passing through their attributes
+const char *const layeredVertexShaderSource = R"(
+#version 150 compatibility
+out vec4 vertexColour;
+out vec2 vertexTexCoord;
+
+void main()
+{
+    gl_Position = gl_ModelViewMatrix * gl_Vertex;
+    vertexColour = gl_Color;
+    vertexTexCoord = gl_MultiTexCoord0.xy;
+}
+)";
+
+// Emits each triangle into each cubemap face whose frustum it might intersect
+const char *const layeredGeometryShaderSource = R"(
+#version 150 compatibility
+layout(triangles) in;
+layout(triangle_strip, max_vertices = 18) out;
+
+uniform mat4 faceMatrices[6];
+uniform int faces[6];
+uniform int numFaces;
+
+in vec4 vertexColour[];
+in vec2 vertexTexCoord[];
+out vec4 colour;
+out vec2 texCoord;
+
+const vec4 frustumPlanes[6] = vec4[6](vec4(1.0, 0.0, 0.0, 1.0), vec4(-1.0, 0.0, 0.0, 1.0),
+                                      vec4(0.0, 1.0, 0.0, 1.0), vec4(0.0, -1.0, 0.0, 1.0),
+                                      vec4(0.0, 0.0, 1.0, 1.0), vec4(0.0, 0.0, -1.0, 1.0));
+
+void main()
+{
+    for(int i = 0; i < numFaces; i++) {
+        // Transform triangle into face's clip space
+        vec4 clip[3];
+        for(int v = 0; v < 3; v++) {
+            clip[v] = faceMatrices[faces[i]] * gl_in[v].gl_Position;
+        }
+
+        // Skip face if all vertices are outside any one of its frustum planes
+        bool outside = false;
+        for(int p = 0; p < 6; p++) {
+            if(dot(frustumPlanes[p], clip[0]) < 0.0 && dot(frustumPlanes[p], clip[1]) < 0.0
+               && dot(frustumPlanes[p], clip[2]) < 0.0)
+            {
+                outside = true;
+            }
+        }
+        if(outside) {
+            continue;
+        }
+
+        for(int v = 0; v < 3; v++) {
+            gl_Layer = faces[i];
+            gl_Position = clip[v];
+            colour = vertexColour[v];
+            texCoord = vertexTexCoord[v];
+            EmitVertex();
+        }
+        EndPrimitive();
+    }
+}
+)";
+
+// Modulates colour by texture (if surface is textured), as the fixed-function pipeline does, and converts to greyscale
+// **NOTE** weights match cv::cvtColor so images match those converted from colour renders
+const char *const layeredFragmentShaderSource = R"(
+#version 150 compatibility
+uniform sampler2D surfaceTexture;
+uniform bool textured;
+
+in vec4 colour;
+in vec2 texCoord;
+
+void main()
+{
+    vec4 texel = textured ? (colour * texture(surfaceTexture, texCoord)) : colour;
+    gl_FragColor = vec4(vec3(dot(texel.rgb, vec3(0.299, 0.587, 0.114))), texel.a);
+}
+)";
+
+GLuint compileShader(GLenum type, const char *source)
+{
+    const GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, nullptr);
+    glCompileShader(shader);
+
+    // If compilation failed, throw with log
+    GLint status;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+    if(status == GL_FALSE) {
+        GLint logLength;
+        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &logLength);
+        std::vector<GLchar> log(std::max(1, logLength));
+        glGetShaderInfoLog(shader, (GLsizei)log.size(), nullptr, log.data());
+        glDeleteShader(shader);
+        throw std::runtime_error("Cannot compile shader: " + std::string(log.data()));
+    }
+    return shader;
+}
+}   // Anonymous namespace
 
 //------------------------------------------------------------------------
 // BoBRobotics::AntWorld::Renderer
@@ -16,11 +129,36 @@ namespace AntWorld
 // hfov = hfov/180/2*pi;
 // axis([0 14 -hfov hfov -pi/12 pi/3]);
 Renderer::Renderer(GLsizei cubemapSize, double nearClip, double farClip,
-                   degree_t horizontalFOV, degree_t verticalFOV)
+                   degree_t horizontalFOV, degree_t verticalFOV, CubemapMode cubemapMode)
 :   m_RenderMesh(horizontalFOV, verticalFOV, 15_deg, 40, 10),
-    m_CubemapTexture(0), m_FBO(0), m_DepthBuffer(0),
-    m_CubemapSize(cubemapSize), m_NearClip(nearClip), m_FarClip(farClip)
+    m_CubemapTexture(0), m_FBO(0), m_DepthBuffer(0), m_LayeredProgram(0),
+    m_TexturedUniform(-1), m_RenderingLayers(false),
+    m_CubemapSize(cubemapSize), m_NearClip(nearClip), m_FarClip(farClip), m_CubemapMode(cubemapMode)
+{
+    const bool layered = (m_CubemapMode == CubemapMode::LayeredGreyscale);
+    if(layered && !GLEW_VERSION_3_3) {
+        throw std::runtime_error("Layered cubemap rendering requires OpenGL 3.3");
+    }
+
+    // If anything fails, delete whatever OpenGL objects were created, as the destructor won't be called
+    try {
+        createObjects();
+    }
+    catch(...) {
+        deleteObjects();
+        throw;
+    }
+}
+//----------------------------------------------------------------------------
+Renderer::~Renderer()
+{
+    deleteObjects();
+}
+//----------------------------------------------------------------------------
+void Renderer::createObjects()
 {
+    const bool layered = (m_CubemapMode == CubemapMode::LayeredGreyscale);
+
     // Create FBO for rendering to cubemap and bind
     glGenFramebuffers(1, &m_FBO);
     glBindFramebuffer(GL_FRAMEBUFFER, m_FBO);
@@ -30,11 +168,12 @@ Renderer::Renderer(GLsizei cubemapSize, double nearClip, double farClip,
     glBindTexture(GL_TEXTURE_CUBE_MAP, m_CubemapTexture);
 
     // Create textures for all faces of cubemap
-    // **NOTE** even though we don't need top and bottom faces we still need to create them or rendering fails
-    // **TODO** it would be better to use native format
+    // **NOTE** even though we may not need all faces we still need to create them or rendering fails
+    const GLint internalFormat = layered ? GL_R8 : GL_RGB;
+    const GLenum format = layered ? GL_RED : GL_RGB;
     for(unsigned int t = 0; t < 6; t++) {
-        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + t, 0, GL_RGB,
-                     m_CubemapSize, m_CubemapSize, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + t, 0, internalFormat,
+                     m_CubemapSize, m_CubemapSize, 0, format, GL_UNSIGNED_BYTE, nullptr);
     }
     glTexParameterf(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glTexParameterf(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
@@ -42,13 +181,36 @@ Renderer::Renderer(GLsizei cubemapSize, double nearClip, double farClip,
     glTexParameterf(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glTexParameterf(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
 
-    // Create depth render buffer
-    glGenRenderbuffers(1, &m_DepthBuffer);
-    glBindRenderbuffer(GL_RENDERBUFFER, m_DepthBuffer);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, m_CubemapSize, m_CubemapSize);
-
-    // Attach depth buffer to frame buffer
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_DepthBuffer);
+    if(layered) {
+        // Sample greyscale cubemap as grey rather than red
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_SWIZZLE_G, GL_RED);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_SWIZZLE_B, GL_RED);
+
+        // Attach all faces of cubemap to frame buffer
+        glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, m_CubemapTexture, 0);
+
+        // All attachments of a layered frame buffer need to be layered, so create depth cubemap
+        glGenTextures(1, &m_DepthBuffer);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, m_DepthBuffer);
+        for(unsigned int t = 0; t < 6; t++) {
+            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + t, 0, GL_DEPTH_COMPONENT24,
+                         m_CubemapSize, m_CubemapSize, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+        }
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+
+        // Attach depth cubemap to frame buffer
+        glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, m_DepthBuffer, 0);
+    }
+    else {
+        // Create depth render buffer
+        glGenRenderbuffers(1, &m_DepthBuffer);
+        glBindRenderbuffer(GL_RENDERBUFFER, m_DepthBuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, m_CubemapSize, m_CubemapSize);
+
+        // Attach depth buffer to frame buffer
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, m_DepthBuffer);
+    }
 
     // Check frame buffer is created correctly
     if(glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
@@ -61,11 +223,23 @@ Renderer::Renderer(GLsizei cubemapSize, double nearClip, double farClip,
 
     // Pre-generate lookat matrices to point at cubemap faces
     generateCubeFaceLookAtMatrices();
+
+    // If required, create shader program to render all faces in one pass
+    if(layered) {
+        createLayeredProgram();
+    }
 }
 //----------------------------------------------------------------------------
-Renderer::~Renderer()
+void Renderer::deleteObjects()
 {
-    glDeleteRenderbuffers(1, &m_DepthBuffer);
+    // **NOTE** zero names, of objects which weren't created, are silently ignored
+    if(m_CubemapMode == CubemapMode::LayeredGreyscale) {
+        glDeleteProgram(m_LayeredProgram);
+        glDeleteTextures(1, &m_DepthBuffer);
+    }
+    else {
+        glDeleteRenderbuffers(1, &m_DepthBuffer);
+    }
     glDeleteTextures(1, &m_CubemapTexture);
     glDeleteFramebuffers(1, &m_FBO);
 }
@@ -81,38 +255,19 @@ void Renderer::renderPanoramicView(meter_t x, meter_t y, meter_t z,
     // Bind the cubemap FBO for offscreen rendering
     glBindFramebuffer(GL_FRAMEBUFFER, m_FBO);
 
-    // Configure perspective projection matrix
-    // **TODO** re-implement in Eigen
-    glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
-    gluPerspective(90.0,
-                   1.0,
-                   m_NearClip, m_FarClip);
-
-    glMatrixMode(GL_MODELVIEW);
-
     // Save ant transform to matrix
+    glMatrixMode(GL_MODELVIEW);
     float antMatrix[16];
     glLoadIdentity();
     applyFrame(x, y, z, yaw, pitch, roll);
     glGetFloatv(GL_MODELVIEW_MATRIX, antMatrix);
 
-    // Loop through each heading we need to render
-    for(GLenum f = 0; f < 6; f++) {
-        // Attach correct frame buffer face to frame buffer
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, f + GL_TEXTURE_CUBE_MAP_POSITIVE_X, m_CubemapTexture, 0);
-
-        // Load look at matrix for this cube face
-        glLoadMatrixf(m_CubeFaceLookAtMatrices[f]);
-
-        // Multiply this by ant transform
-        glMultMatrixf(antMatrix);
-
-        // Clear colour and depth buffer
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-        // Render geometry
-        renderPanoramicGeometry();
+    // Render cubemap
+    if(m_CubemapMode == CubemapMode::LayeredGreyscale) {
+        renderCubemapLayers(antMatrix);
+    }
+    else {
+        renderCubemapFaces(antMatrix);
     }
 
     // Rebind draw framebuffer
@@ -270,7 +425,7 @@ void Renderer::renderTopDownView(RenderTarget &renderTarget, bool bind, bool cle
 //----------------------------------------------------------------------------
 void Renderer::renderPanoramicGeometry()
 {
-    m_World.render();
+    m_World.render(m_RenderingLayers ? m_TexturedUniform : -1);
 }
 //----------------------------------------------------------------------------
 void Renderer::renderFirstPersonGeometry()
@@ -341,6 +496,144 @@ void Renderer::generateCubeFaceLookAtMatrices()
     }
 }
 //----------------------------------------------------------------------------
+void Renderer::createLayeredProgram()
+{
+    // Compile shaders, deleting those already compiled if one fails
+    GLuint shaders[3]{ 0, 0, 0 };
+    try {
+        shaders[0] = compileShader(GL_VERTEX_SHADER, layeredVertexShaderSource);
+        shaders[1] = compileShader(GL_GEOMETRY_SHADER, layeredGeometryShaderSource);
+        shaders[2] = compileShader(GL_FRAGMENT_SHADER, layeredFragmentShaderSource);
+    }
+    catch(...) {
+        for(GLuint shader : shaders) {
+            glDeleteShader(shader);
+        }
+        throw;
+    }
+
+    // Link program
+    m_LayeredProgram = glCreateProgram();
+    for(GLuint shader : shaders) {
+        glAttachShader(m_LayeredProgram, shader);
+    }
+    glLinkProgram(m_LayeredProgram);
+
+    // Shaders are no longer required once linked
+    for(GLuint shader : shaders) {
+        glDetachShader(m_LayeredProgram, shader);
+        glDeleteShader(shader);
+    }
+
+    // If linking failed, throw with log
+    GLint status;
+    glGetProgramiv(m_LayeredProgram, GL_LINK_STATUS, &status);
+    if(status == GL_FALSE) {
+        GLint logLength;
+        glGetProgramiv(m_LayeredProgram, GL_INFO_LOG_LENGTH, &logLength);
+        std::vector<GLchar> log(std::max(1, logLength));
+        glGetProgramInfoLog(m_LayeredProgram, (GLsizei)log.size(), nullptr, log.data());
+        throw std::runtime_error("Cannot link shader program: " + std::string(log.data()));
+    }
+
+    // Combine projection matrix with each cube face's look at matrix
+    // **TODO** re-implement in Eigen
+    GLfloat faceMatrices[6][16];
+    glMatrixMode(GL_PROJECTION);
+    for(unsigned int f = 0; f < 6; f++) {
+        glLoadIdentity();
+        gluPerspective(90.0,
+                       1.0,
+                       m_NearClip, m_FarClip);
+        glMultMatrixf(m_CubeFaceLookAtMatrices[f]);
+        glGetFloatv(GL_PROJECTION_MATRIX, faceMatrices[f]);
+    }
+    glLoadIdentity();
+    glMatrixMode(GL_MODELVIEW);
+
+    // Get list of faces sampled by render mesh
+    std::vector<GLint> faces;
+    const auto &cubeFaces = m_RenderMesh.getCubeFaces();
+    for(GLint f = 0; f < 6; f++) {
+        if(cubeFaces[f]) {
+            faces.push_back(f);
+        }
+    }
+
+    // Set uniforms, which don't change between views
+    glUseProgram(m_LayeredProgram);
+    glUniformMatrix4fv(glGetUniformLocation(m_LayeredProgram, "faceMatrices"), 6, GL_FALSE, &faceMatrices[0][0]);
+    glUniform1iv(glGetUniformLocation(m_LayeredProgram, "faces"), (GLsizei)faces.size(), faces.data());
+    glUniform1i(glGetUniformLocation(m_LayeredProgram, "numFaces"), (GLint)faces.size());
+    glUniform1i(glGetUniformLocation(m_LayeredProgram, "surfaceTexture"), 0);
+
+    // World sets this for each surface, so only look it up once
+    m_TexturedUniform = glGetUniformLocation(m_LayeredProgram, "textured");
+    glUniform1i(m_TexturedUniform, GL_FALSE);
+    glUseProgram(0);
+}
+//----------------------------------------------------------------------------
+void Renderer::renderCubemapFaces(const float (&antMatrix)[16])
+{
+    // Configure perspective projection matrix
+    // **TODO** re-implement in Eigen
+    glMatrixMode(GL_PROJECTION);
+    glLoadIdentity();
+    gluPerspective(90.0,
+                   1.0,
+                   m_NearClip, m_FarClip);
+
+    glMatrixMode(GL_MODELVIEW);
+
+    // Loop through each heading we need to render
+    const auto &cubeFaces = m_RenderMesh.getCubeFaces();
+    for(GLenum f = 0; f < 6; f++) {
+        // Skip faces render mesh doesn't sample
+        if(!cubeFaces[f]) {
+            continue;
+        }
+
+        // Attach correct frame buffer face to frame buffer
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, f + GL_TEXTURE_CUBE_MAP_POSITIVE_X, m_CubemapTexture, 0);
+
+        // Load look at matrix for this cube face
+        glLoadMatrixf(m_CubeFaceLookAtMatrices[f]);
+
+        // Multiply this by ant transform
+        glMultMatrixf(antMatrix);
+
+        // Clear colour and depth buffer
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        // Render geometry
+        renderPanoramicGeometry();
+    }
+}
+//----------------------------------------------------------------------------
+void Renderer::renderCubemapLayers(const float (&antMatrix)[16])
+{
+    // Clear all faces, converting clear colour to greyscale as only its red channel is written
+    GLfloat clearColour[4];
+    glGetFloatv(GL_COLOR_CLEAR_VALUE, clearColour);
+    const GLfloat clearGrey = (0.299f * clearColour[0]) + (0.587f * clearColour[1]) + (0.114f * clearColour[2]);
+    glClearColor(clearGrey, clearGrey, clearGrey, clearColour[3]);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glClearColor(clearColour[0], clearColour[1], clearColour[2], clearColour[3]);
+
+    // Load ant transform, geometry shader applies each face's projection
+    glMatrixMode(GL_MODELVIEW);
+    glLoadMatrixf(antMatrix);
+
+    // Render geometry into all faces at once
+    // **NOTE** only World::render() sets the textured uniform so reset it for anything else drawn
+    glUseProgram(m_LayeredProgram);
+    m_RenderingLayers = true;
+    renderPanoramicGeometry();
+    m_RenderingLayers = false;
+    glUniform1i(m_TexturedUniform, GL_FALSE);
+    glUseProgram(0);
+}
+//----------------------------------------------------------------------------
 void Renderer::applyFrame(meter_t x, meter_t y, meter_t z,
                           degree_t yaw, degree_t pitch, degree_t roll)
 {
@@ -0,0 +1,112 @@
+#include "os/windows_include.h"
+
+// BoB robotics includes
+#include "common/memory_mapped_file.h"
+
+// Standard C includes
+#include <cerrno>
+#include <cstring>
+
+// Standard C++ includes
+#include <stdexcept>
+
+#ifndef _WIN32
+// POSIX includes
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace BoBRobotics {
+MemoryMappedFile::MemoryMappedFile(const std::string &path)
+{
+#ifdef _WIN32
+    m_File = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                         OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (m_File == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("Could not open " + path);
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(m_File, &fileSize)) {
+        CloseHandle(m_File);
+        throw std::runtime_error("Could not get size of " + path);
+    }
+    m_Size = static_cast<size_t>(fileSize.QuadPart);
+    if (m_Size == 0) {
+        return;
+    }
+
+    m_Mapping = CreateFileMappingA(m_File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!m_Mapping) {
+        CloseHandle(m_File);
+        throw std::runtime_error("Could not map " + path);
+    }
+
+    m_Data = reinterpret_cast<uint8_t *>(MapViewOfFile(m_Mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!m_Data) {
+        CloseHandle(m_Mapping);
+        CloseHandle(m_File);
+        throw std::runtime_error("Could not map " + path);
+    }
+#else
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Could not open " + path + ": " + std::string(strerror(errno)));
+    }
+
+    struct stat status;
+    if (fstat(fd, &status) < 0) {
+        const std::string error = strerror(errno);
+        close(fd);
+        throw std::runtime_error("Could not get size of " + path + ": " + error);
+    }
+    m_Size = static_cast<size_t>(status.st_size);
+    if (m_Size == 0) {
+        close(fd);
+        return;
+    }
+
+    // The mapping stays valid after the file is closed
+    void *data = mmap(nullptr, m_Size, PROT_READ, MAP_PRIVATE, fd, 0);
+    const std::string error = strerror(errno);
+    close(fd);
+    if (data == MAP_FAILED) {
+        throw std::runtime_error("Could not map " + path + ": " + error);
+    }
+    m_Data = reinterpret_cast<uint8_t *>(data);
+#endif
+}
+
+MemoryMappedFile::~MemoryMappedFile()
+{
+#ifdef _WIN32
+    if (m_Data) {
+        UnmapViewOfFile(m_Data);
+    }
+    if (m_Mapping) {
+        CloseHandle(m_Mapping);
+    }
+    if (m_File) {
+        CloseHandle(m_File);
+    }
+#else
+    if (m_Data) {
+        munmap(m_Data, m_Size);
+    }
+#endif
+}
+
+const uint8_t *
+MemoryMappedFile::data() const
+{
+    return m_Data;
+}
+
+size_t
+MemoryMappedFile::size() const
+{
+    return m_Size;
+}
+} // BoBRobotics
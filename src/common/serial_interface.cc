@@ -44,7 +44,7 @@ void
 SerialInterface::setup(const char *path)
 {
 
-    m_Serial_fd = open(path, O_WRONLY | O_NOCTTY | O_SYNC);
+    m_Serial_fd = open(path, O_RDWR | O_NOCTTY | O_SYNC);
     if (m_Serial_fd < 0) {
         throw std::runtime_error("Could not open serial interface: " + std::string(strerror(errno)));
     }
@@ -125,6 +125,23 @@ SerialInterface::readByte(uint8_t &byte)
     return true;
 }
 
+size_t
+SerialInterface::readSome(char *data, size_t maxLength)
+{
+    const ssize_t ret = ::read(m_Serial_fd, data, maxLength);
+    if (ret < 0) {
+        // No data on non-blocking socket
+        if (errno == EAGAIN || errno == EINTR) {
+            return 0;
+        }
+
+        // Otherwise it's a proper error
+        throw std::runtime_error("Failed to read from serial port");
+    }
+
+    return static_cast<size_t>(ret);
+}
+
 void
 SerialInterface::writeByte(uint8_t byte)
 {
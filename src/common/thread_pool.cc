@@ -0,0 +1,104 @@
+// BoB robotics includes
+#include "common/macros.h"
+#include "common/thread_pool.h"
+
+// Standard C++ includes
+#include <algorithm>
+
+namespace BoBRobotics {
+ThreadPool::ThreadPool(size_t numThreads)
+{
+    BOB_ASSERT(numThreads > 0);
+
+    m_Threads.reserve(numThreads);
+    for (size_t i = 0; i < numThreads; i++) {
+        m_Threads.emplace_back(&ThreadPool::runWorker, this);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_TasksMutex);
+        m_Stopping = true;
+    }
+    m_TasksCondition.notify_all();
+
+    for (auto &thread : m_Threads) {
+        thread.join();
+    }
+}
+
+size_t
+ThreadPool::getNumThreads() const
+{
+    return m_Threads.size();
+}
+
+void
+ThreadPool::parallelFor(size_t size, const std::function<void(size_t, size_t, size_t)> &func)
+{
+    if (size == 0) {
+        return;
+    }
+
+    const size_t numChunks = std::min(size, getNumThreads());
+    const size_t chunkSize = (size + numChunks - 1) / numChunks;
+
+    std::vector<std::future<void>> futures;
+    futures.reserve(numChunks);
+    for (size_t chunk = 0; chunk < numChunks; chunk++) {
+        const size_t begin = chunk * chunkSize;
+        const size_t end = std::min(size, begin + chunkSize);
+        if (begin >= end) {
+            break;
+        }
+        futures.emplace_back(enqueue([&func, chunk, begin, end]() { func(chunk, begin, end); }));
+    }
+
+    // Wait for all chunks, rethrowing the first exception (if any)
+    for (auto &future : futures) {
+        future.wait();
+    }
+    for (auto &future : futures) {
+        future.get();
+    }
+}
+
+size_t
+ThreadPool::getDefaultNumThreads()
+{
+    return std::max(1U, std::thread::hardware_concurrency());
+}
+
+void
+ThreadPool::push(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_TasksMutex);
+        m_Tasks.push(std::move(task));
+    }
+    m_TasksCondition.notify_one();
+}
+
+void
+ThreadPool::runWorker()
+{
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(m_TasksMutex);
+            m_TasksCondition.wait(lock, [this]() { return m_Stopping || !m_Tasks.empty(); });
+            if (m_Stopping && m_Tasks.empty()) {
+                return;
+            }
+
+            task = std::move(m_Tasks.front());
+            m_Tasks.pop();
+        }
+
+        // Exceptions are captured by the packaged_task
+        task();
+    }
+}
+} // BoBRobotics
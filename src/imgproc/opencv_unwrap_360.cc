@@ -4,6 +4,9 @@
 #include "common/logging.h"
 #include "imgproc/opencv_unwrap_360.h"
 
+// Standard C includes
+#include <cmath>
+
 // Standard C++ includes
 #include <stdexcept>
 #include <vector>
@@ -15,6 +18,48 @@
 #include "third_party/path.h"
 #include "third_party/units.h"
 
+namespace {
+//! Convert one pixel to greyscale with the same fixed-point weights as cv::cvtColor
+template<int Channels>
+inline uint32_t
+toGreyscale(const uint8_t *pixel)
+{
+    // Greyscale, or YUYV, where the first byte of each pixel is its luma
+    if (Channels < 3) {
+        return pixel[0];
+    }
+
+    // BGR(A)
+    constexpr uint32_t B2Y = 1868, G2Y = 9617, R2Y = 4899, Shift = 14;
+    return (B2Y * pixel[0] + G2Y * pixel[1] + R2Y * pixel[2] + (1 << (Shift - 1))) >> Shift;
+}
+
+template<int Channels>
+void
+unwrapGreyscaleBlocks(const cv::Mat &input, cv::Mat &output,
+                      const std::vector<int32_t> &sourceOffsets,
+                      int unwrappedWidth, int downsample)
+{
+    const uint8_t *source = input.data;
+    const uint32_t blockArea = static_cast<uint32_t>(downsample * downsample);
+    for (int y = 0; y < output.rows; y++) {
+        uint8_t *outRow = output.ptr(y);
+        for (int x = 0; x < output.cols; x++) {
+            uint32_t sum = 0;
+            for (int dy = 0; dy < downsample; dy++) {
+                const int32_t *offsets = &sourceOffsets[(y * downsample + dy) * unwrappedWidth + x * downsample];
+                for (int dx = 0; dx < downsample; dx++) {
+                    if (offsets[dx] >= 0) {
+                        sum += toGreyscale<Channels>(&source[offsets[dx]]);
+                    }
+                }
+            }
+            outRow[x] = static_cast<uint8_t>((sum + blockArea / 2) / blockArea);
+        }
+    }
+}
+} // anonymous namespace
+
 //----------------------------------------------------------------------------
 // BoBRobotics::ImgProc::OpenCVUnwrap360
 //----------------------------------------------------------------------------
@@ -105,37 +150,87 @@ OpenCVUnwrap360::create(const cv::Size &cameraResolution,
 void
 OpenCVUnwrap360::updateMaps()
 {
+    // The angle only depends on the column, so only calculate sin and cos once per column
+    std::vector<float> sinTheta(m_UnwrappedResolution.width), cosTheta(m_UnwrappedResolution.width);
+    for (int j = 0; j < m_UnwrappedResolution.width; j++) {
+        const degree_t th =
+                (((double) j / (double) m_UnwrappedResolution.width) *
+                 360.0_deg) +
+                m_OffsetAngle;
+        sinTheta[j] = (float) units::math::sin(th);
+        cosTheta[j] = (float) units::math::cos(th);
+    }
+
     // Build unwrap maps
     for (int i = 0; i < m_UnwrappedResolution.height; i++) {
+        // Get i as a fraction of unwrapped height, flipping if desired
+        const float iFrac =
+                m_Flip ? 1.0f - ((float) i /
+                                 (float) m_UnwrappedResolution.height)
+                       : ((float) i /
+                          (float) m_UnwrappedResolution.height);
+
+        // Convert i to radius
+        const float r =
+                iFrac * (m_OuterPixel - m_InnerPixel) + m_InnerPixel;
+
+        // Remap onto sphere
+        float *rowX = m_UnwrapMapX.ptr<float>(i);
+        float *rowY = m_UnwrapMapY.ptr<float>(i);
         for (int j = 0; j < m_UnwrappedResolution.width; j++) {
-            // Get i as a fraction of unwrapped height, flipping if desired
-            const float iFrac =
-                    m_Flip ? 1.0f - ((float) i /
-                                     (float) m_UnwrappedResolution.height)
-                           : ((float) i /
-                              (float) m_UnwrappedResolution.height);
-
-            // Convert i and j to polar
-            const float r =
-                    iFrac * (m_OuterPixel - m_InnerPixel) + m_InnerPixel;
-            const degree_t th =
-                    (((double) j / (double) m_UnwrappedResolution.width) *
-                     360.0_deg) +
-                    m_OffsetAngle;
-
-            // Remap onto sphere
-            const float x = m_CentrePixel.x - r * units::math::sin(th);
-            const float y = m_CentrePixel.y + r * units::math::cos(th);
-            m_UnwrapMapX.at<float>(i, j) = x;
-            m_UnwrapMapY.at<float>(i, j) = y;
+            rowX[j] = m_CentrePixel.x - r * sinTheta[j];
+            rowY[j] = m_CentrePixel.y + r * cosTheta[j];
         }
     }
+
+    // Convert to fixed point, for speed
+    cv::convertMaps(m_UnwrapMapX, m_UnwrapMapY, m_FixedMap1, m_FixedMap2, CV_16SC2, true);
+
+    // The offset table for unwrapGreyscale() will be rebuilt when next needed
+    m_SourceOffsets.clear();
+    m_SourceStep = m_SourceElemSize = 0;
 }
 
 void
 OpenCVUnwrap360::unwrap(const cv::Mat &input, cv::Mat &output)
 {
-    cv::remap(input, output, m_UnwrapMapX, m_UnwrapMapY, cv::INTER_NEAREST);
+    cv::remap(input, output, m_FixedMap1, m_FixedMap2, cv::INTER_NEAREST);
+}
+
+void
+OpenCVUnwrap360::unwrapGreyscale(const cv::Mat &input, cv::Mat &output, int downsample)
+{
+    BOB_ASSERT(input.cols == m_CameraResolution.width);
+    BOB_ASSERT(input.rows == m_CameraResolution.height);
+    BOB_ASSERT(input.depth() == CV_8U);
+    BOB_ASSERT(downsample > 0);
+    BOB_ASSERT(m_UnwrappedResolution.width % downsample == 0);
+    BOB_ASSERT(m_UnwrappedResolution.height % downsample == 0);
+
+    // Offsets depend on the layout of the input, so rebuild if it's changed
+    if (input.step != m_SourceStep || input.elemSize() != m_SourceElemSize) {
+        updateSourceOffsets(input.step, input.elemSize());
+    }
+
+    output.create(m_UnwrappedResolution.height / downsample,
+                  m_UnwrappedResolution.width / downsample,
+                  CV_8UC1);
+    switch (input.channels()) {
+    case 1:
+        unwrapGreyscaleBlocks<1>(input, output, m_SourceOffsets, m_UnwrappedResolution.width, downsample);
+        break;
+    case 2:
+        unwrapGreyscaleBlocks<2>(input, output, m_SourceOffsets, m_UnwrappedResolution.width, downsample);
+        break;
+    case 3:
+        unwrapGreyscaleBlocks<3>(input, output, m_SourceOffsets, m_UnwrappedResolution.width, downsample);
+        break;
+    case 4:
+        unwrapGreyscaleBlocks<4>(input, output, m_SourceOffsets, m_UnwrappedResolution.width, downsample);
+        break;
+    default:
+        throw std::runtime_error("Unsupported number of channels: " + std::to_string(input.channels()));
+    }
 }
 
 void
@@ -195,6 +290,30 @@ OpenCVUnwrap360::read(const cv::FileNode &node)
            flip);
 }
 
+void
+OpenCVUnwrap360::updateSourceOffsets(size_t step, size_t elemSize)
+{
+    m_SourceOffsets.resize(m_UnwrappedResolution.area());
+    for (int i = 0; i < m_UnwrappedResolution.height; i++) {
+        const float *rowX = m_UnwrapMapX.ptr<float>(i);
+        const float *rowY = m_UnwrapMapY.ptr<float>(i);
+        int32_t *offsets = &m_SourceOffsets[i * m_UnwrappedResolution.width];
+        for (int j = 0; j < m_UnwrappedResolution.width; j++) {
+            // Use nearest pixel, as unwrap() does; pixels outside the image are black
+            const long x = std::lround(rowX[j]);
+            const long y = std::lround(rowY[j]);
+            if (x < 0 || y < 0 || x >= m_CameraResolution.width || y >= m_CameraResolution.height) {
+                offsets[j] = -1;
+            } else {
+                offsets[j] = static_cast<int32_t>(y * step + x * elemSize);
+            }
+        }
+    }
+
+    m_SourceStep = step;
+    m_SourceElemSize = elemSize;
+}
+
 void
 OpenCVUnwrap360::createMaps()
 {
@@ -14,6 +14,7 @@ AntWorldRotater::AntWorldRotater(const cv::Size &unwrapRes,
                                  const degree_t pitch,
                                  const degree_t roll)
   : m_Agent(agent)
+  , m_BatchRenderer(agent.getBatchRenderer())
   , m_YawStep(yawStep)
   , m_Pitch(pitch)
   , m_Roll(roll)
@@ -38,5 +39,19 @@ AntWorldRotater::columnToHeading(size_t column) const
     return units::angle::turn_t{ (double) column / (double) m_UnwrapRes.width };
 }
 
+std::vector<AntWorld::BatchRenderer::Pose>
+AntWorldRotater::getPoses() const
+{
+    // Rotate on the spot, starting at a yaw of zero
+    auto pose = m_Agent.getPose();
+    std::vector<AntWorld::BatchRenderer::Pose> poses;
+    poses.reserve(numRotations());
+    for (degree_t yaw = 0_deg; yaw < 360_deg; yaw += m_YawStep) {
+        pose.attitude() = { yaw, m_Pitch, m_Roll };
+        poses.push_back(pose);
+    }
+    return poses;
+}
+
 } // Navigation
 } // BoBRobotics
@@ -0,0 +1,381 @@
+// BoB robotics includes
+#include "navigation/differencers.h"
+
+// Standard C includes
+#include <cstdlib>
+
+// SIMD intrinsics
+#if defined(__SSE2__) || defined(_M_X64)
+#define BOB_DIFFERENCE_SSE2
+#include <emmintrin.h>
+
+// We need GCC/Clang's function-level target attributes to build AVX2 code
+// without enabling AVX2 for the whole module
+#if defined(__GNUC__)
+#define BOB_DIFFERENCE_AVX2
+#include <immintrin.h>
+#define BOB_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define BOB_DIFFERENCE_NEON
+#include <arm_neon.h>
+#endif
+
+namespace {
+using KernelFunc = uint64_t (*)(const uint8_t *, const uint8_t *,
+                                const uint8_t *, const uint8_t *,
+                                size_t, size_t &);
+
+/*
+ * Number of vector iterations after which 32-bit squared-difference
+ * accumulators must be widened to 64 bits. Each 32-bit lane receives at most
+ * 4 * 255^2 per iteration, so this stays well clear of overflow.
+ */
+constexpr size_t SquaredBlockIterations = 4096;
+
+//------------------------------------------------------------------------
+// Scalar kernel
+//------------------------------------------------------------------------
+template<bool Squared, bool Masked>
+uint64_t
+sumDiffScalar(const uint8_t *src1, const uint8_t *src2,
+              const uint8_t *mask1, const uint8_t *mask2,
+              size_t n, size_t &numUnmasked)
+{
+    uint64_t sum = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (Masked && (mask1[i] == 0 || mask2[i] == 0)) {
+            continue;
+        }
+
+        const int diff = static_cast<int>(src1[i]) - static_cast<int>(src2[i]);
+        sum += Squared ? static_cast<uint64_t>(diff * diff) : static_cast<uint64_t>(std::abs(diff));
+        if (Masked) {
+            numUnmasked++;
+        }
+    }
+    return sum;
+}
+
+#ifdef BOB_DIFFERENCE_SSE2
+//------------------------------------------------------------------------
+// SSE2 kernel
+//------------------------------------------------------------------------
+inline __m128i
+absDiffSSE2(__m128i a, __m128i b)
+{
+    return _mm_or_si128(_mm_subs_epu8(a, b), _mm_subs_epu8(b, a));
+}
+
+// Returns 0xFF in lanes where both masks are non-zero and 0x00 elsewhere
+inline __m128i
+combineMasksSSE2(__m128i mask1, __m128i mask2)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i masked = _mm_or_si128(_mm_cmpeq_epi8(mask1, zero), _mm_cmpeq_epi8(mask2, zero));
+    return _mm_andnot_si128(masked, _mm_set1_epi8(-1));
+}
+
+inline uint64_t
+horizontalSumSSE2(__m128i acc)
+{
+    alignas(16) uint64_t lanes[2];
+    _mm_store_si128(reinterpret_cast<__m128i *>(lanes), acc);
+    return lanes[0] + lanes[1];
+}
+
+template<bool Squared, bool Masked>
+uint64_t
+sumDiffSSE2(const uint8_t *src1, const uint8_t *src2,
+            const uint8_t *mask1, const uint8_t *mask2,
+            size_t n, size_t &numUnmasked)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i one = _mm_set1_epi8(1);
+    __m128i sum64 = zero;
+    __m128i sum32 = zero;
+    __m128i count64 = zero;
+
+    const size_t numVectors = n / 16;
+    for (size_t v = 0; v < numVectors; v++) {
+        const size_t i = v * 16;
+        __m128i diff = absDiffSSE2(_mm_loadu_si128(reinterpret_cast<const __m128i *>(&src1[i])),
+                                   _mm_loadu_si128(reinterpret_cast<const __m128i *>(&src2[i])));
+        if (Masked) {
+            const __m128i mask = combineMasksSSE2(_mm_loadu_si128(reinterpret_cast<const __m128i *>(&mask1[i])),
+                                                  _mm_loadu_si128(reinterpret_cast<const __m128i *>(&mask2[i])));
+            diff = _mm_and_si128(diff, mask);
+            count64 = _mm_add_epi64(count64, _mm_sad_epu8(_mm_and_si128(mask, one), zero));
+        }
+
+        if (Squared) {
+            const __m128i lo = _mm_unpacklo_epi8(diff, zero);
+            const __m128i hi = _mm_unpackhi_epi8(diff, zero);
+            sum32 = _mm_add_epi32(sum32, _mm_madd_epi16(lo, lo));
+            sum32 = _mm_add_epi32(sum32, _mm_madd_epi16(hi, hi));
+
+            // Periodically widen the 32-bit accumulators
+            if ((v % SquaredBlockIterations) == (SquaredBlockIterations - 1)) {
+                sum64 = _mm_add_epi64(sum64, _mm_unpacklo_epi32(sum32, zero));
+                sum64 = _mm_add_epi64(sum64, _mm_unpackhi_epi32(sum32, zero));
+                sum32 = zero;
+            }
+        } else {
+            sum64 = _mm_add_epi64(sum64, _mm_sad_epu8(diff, zero));
+        }
+    }
+    if (Squared) {
+        sum64 = _mm_add_epi64(sum64, _mm_unpacklo_epi32(sum32, zero));
+        sum64 = _mm_add_epi64(sum64, _mm_unpackhi_epi32(sum32, zero));
+    }
+    if (Masked) {
+        numUnmasked += horizontalSumSSE2(count64);
+    }
+
+    // Handle remaining pixels
+    const size_t done = numVectors * 16;
+    return horizontalSumSSE2(sum64) +
+           sumDiffScalar<Squared, Masked>(&src1[done], &src2[done],
+                                          Masked ? &mask1[done] : nullptr,
+                                          Masked ? &mask2[done] : nullptr,
+                                          n - done, numUnmasked);
+}
+#endif // BOB_DIFFERENCE_SSE2
+
+#ifdef BOB_DIFFERENCE_AVX2
+//------------------------------------------------------------------------
+// AVX2 kernel
+//------------------------------------------------------------------------
+BOB_TARGET_AVX2 inline __m256i
+absDiffAVX2(__m256i a, __m256i b)
+{
+    return _mm256_or_si256(_mm256_subs_epu8(a, b), _mm256_subs_epu8(b, a));
+}
+
+BOB_TARGET_AVX2 inline __m256i
+combineMasksAVX2(__m256i mask1, __m256i mask2)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i masked = _mm256_or_si256(_mm256_cmpeq_epi8(mask1, zero), _mm256_cmpeq_epi8(mask2, zero));
+    return _mm256_andnot_si256(masked, _mm256_set1_epi8(-1));
+}
+
+BOB_TARGET_AVX2 inline uint64_t
+horizontalSumAVX2(__m256i acc)
+{
+    alignas(32) uint64_t lanes[4];
+    _mm256_store_si256(reinterpret_cast<__m256i *>(lanes), acc);
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3];
+}
+
+template<bool Squared, bool Masked>
+BOB_TARGET_AVX2 uint64_t
+sumDiffAVX2(const uint8_t *src1, const uint8_t *src2,
+            const uint8_t *mask1, const uint8_t *mask2,
+            size_t n, size_t &numUnmasked)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i one = _mm256_set1_epi8(1);
+    __m256i sum64 = zero;
+    __m256i sum32 = zero;
+    __m256i count64 = zero;
+
+    const size_t numVectors = n / 32;
+    for (size_t v = 0; v < numVectors; v++) {
+        const size_t i = v * 32;
+        __m256i diff = absDiffAVX2(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(&src1[i])),
+                                   _mm256_loadu_si256(reinterpret_cast<const __m256i *>(&src2[i])));
+        if (Masked) {
+            const __m256i mask = combineMasksAVX2(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(&mask1[i])),
+                                                  _mm256_loadu_si256(reinterpret_cast<const __m256i *>(&mask2[i])));
+            diff = _mm256_and_si256(diff, mask);
+            count64 = _mm256_add_epi64(count64, _mm256_sad_epu8(_mm256_and_si256(mask, one), zero));
+        }
+
+        if (Squared) {
+            const __m256i lo = _mm256_unpacklo_epi8(diff, zero);
+            const __m256i hi = _mm256_unpackhi_epi8(diff, zero);
+            sum32 = _mm256_add_epi32(sum32, _mm256_madd_epi16(lo, lo));
+            sum32 = _mm256_add_epi32(sum32, _mm256_madd_epi16(hi, hi));
+
+            // Periodically widen the 32-bit accumulators
+            if ((v % SquaredBlockIterations) == (SquaredBlockIterations - 1)) {
+                sum64 = _mm256_add_epi64(sum64, _mm256_unpacklo_epi32(sum32, zero));
+                sum64 = _mm256_add_epi64(sum64, _mm256_unpackhi_epi32(sum32, zero));
+                sum32 = zero;
+            }
+        } else {
+            sum64 = _mm256_add_epi64(sum64, _mm256_sad_epu8(diff, zero));
+        }
+    }
+    if (Squared) {
+        sum64 = _mm256_add_epi64(sum64, _mm256_unpacklo_epi32(sum32, zero));
+        sum64 = _mm256_add_epi64(sum64, _mm256_unpackhi_epi32(sum32, zero));
+    }
+    if (Masked) {
+        numUnmasked += horizontalSumAVX2(count64);
+    }
+
+    // Handle remaining pixels
+    const size_t done = numVectors * 32;
+    return horizontalSumAVX2(sum64) +
+           sumDiffScalar<Squared, Masked>(&src1[done], &src2[done],
+                                          Masked ? &mask1[done] : nullptr,
+                                          Masked ? &mask2[done] : nullptr,
+                                          n - done, numUnmasked);
+}
+#endif // BOB_DIFFERENCE_AVX2
+
+#ifdef BOB_DIFFERENCE_NEON
+//------------------------------------------------------------------------
+// NEON kernel
+//------------------------------------------------------------------------
+/*
+ * Number of vector iterations after which 16-bit absolute-difference
+ * accumulators must be widened. Each 16-bit lane receives at most 2 * 255 per
+ * iteration.
+ */
+constexpr size_t AbsBlockIterations = 128;
+
+inline uint64_t
+horizontalSumNEON(uint64x2_t acc)
+{
+    return vgetq_lane_u64(acc, 0) + vgetq_lane_u64(acc, 1);
+}
+
+template<bool Squared, bool Masked>
+uint64_t
+sumDiffNEON(const uint8_t *src1, const uint8_t *src2,
+            const uint8_t *mask1, const uint8_t *mask2,
+            size_t n, size_t &numUnmasked)
+{
+    const size_t blockIterations = Squared ? SquaredBlockIterations : AbsBlockIterations;
+    const uint8x16_t one = vdupq_n_u8(1);
+    uint64x2_t sum64 = vdupq_n_u64(0);
+    uint64x2_t count64 = vdupq_n_u64(0);
+    uint32x4_t sum32 = vdupq_n_u32(0);
+    uint16x8_t sum16 = vdupq_n_u16(0);
+    uint16x8_t count16 = vdupq_n_u16(0);
+
+    const size_t numVectors = n / 16;
+    for (size_t v = 0; v < numVectors; v++) {
+        const size_t i = v * 16;
+        uint8x16_t diff = vabdq_u8(vld1q_u8(&src1[i]), vld1q_u8(&src2[i]));
+        if (Masked) {
+            const uint8x16_t m1 = vld1q_u8(&mask1[i]);
+            const uint8x16_t m2 = vld1q_u8(&mask2[i]);
+            const uint8x16_t mask = vandq_u8(vtstq_u8(m1, m1), vtstq_u8(m2, m2));
+            diff = vandq_u8(diff, mask);
+            count16 = vpadalq_u8(count16, vandq_u8(mask, one));
+        }
+
+        if (Squared) {
+            sum32 = vpadalq_u16(sum32, vmull_u8(vget_low_u8(diff), vget_low_u8(diff)));
+            sum32 = vpadalq_u16(sum32, vmull_u8(vget_high_u8(diff), vget_high_u8(diff)));
+        } else {
+            sum16 = vpadalq_u8(sum16, diff);
+        }
+
+        // Periodically widen the narrow accumulators
+        if ((v % blockIterations) == (blockIterations - 1)) {
+            if (Squared) {
+                sum64 = vpadalq_u32(sum64, sum32);
+                sum32 = vdupq_n_u32(0);
+            } else {
+                sum64 = vpadalq_u32(sum64, vpaddlq_u16(sum16));
+                sum16 = vdupq_n_u16(0);
+            }
+            if (Masked) {
+                count64 = vpadalq_u32(count64, vpaddlq_u16(count16));
+                count16 = vdupq_n_u16(0);
+            }
+        }
+    }
+    sum64 = vpadalq_u32(sum64, sum32);
+    sum64 = vpadalq_u32(sum64, vpaddlq_u16(sum16));
+    if (Masked) {
+        count64 = vpadalq_u32(count64, vpaddlq_u16(count16));
+        numUnmasked += horizontalSumNEON(count64);
+    }
+
+    // Handle remaining pixels
+    const size_t done = numVectors * 16;
+    return horizontalSumNEON(sum64) +
+           sumDiffScalar<Squared, Masked>(&src1[done], &src2[done],
+                                          Masked ? &mask1[done] : nullptr,
+                                          Masked ? &mask2[done] : nullptr,
+                                          n - done, numUnmasked);
+}
+#endif // BOB_DIFFERENCE_NEON
+
+//------------------------------------------------------------------------
+// Runtime dispatch
+//------------------------------------------------------------------------
+template<bool Squared, bool Masked>
+KernelFunc
+selectKernel()
+{
+#if defined(BOB_DIFFERENCE_AVX2)
+    if (__builtin_cpu_supports("avx2")) {
+        return &sumDiffAVX2<Squared, Masked>;
+    }
+#endif
+
+#if defined(BOB_DIFFERENCE_SSE2)
+    return &sumDiffSSE2<Squared, Masked>;
+#elif defined(BOB_DIFFERENCE_NEON)
+    return &sumDiffNEON<Squared, Masked>;
+#else
+    return &sumDiffScalar<Squared, Masked>;
+#endif
+}
+
+template<bool Squared, bool Masked>
+KernelFunc
+getKernel()
+{
+    // Only query the CPU's features the first time round
+    static const KernelFunc kernel = selectKernel<Squared, Masked>();
+    return kernel;
+}
+} // anonymous namespace
+
+namespace BoBRobotics {
+namespace Navigation {
+namespace Internal {
+
+uint64_t
+sumAbsDiff(const uint8_t *src1, const uint8_t *src2, size_t n)
+{
+    size_t numUnmasked = 0;
+    return getKernel<false, false>()(src1, src2, nullptr, nullptr, n, numUnmasked);
+}
+
+uint64_t
+sumAbsDiffMasked(const uint8_t *src1, const uint8_t *src2,
+                 const uint8_t *mask1, const uint8_t *mask2,
+                 size_t n, size_t &numUnmasked)
+{
+    numUnmasked = 0;
+    return getKernel<false, true>()(src1, src2, mask1, mask2, n, numUnmasked);
+}
+
+uint64_t
+sumSquaredDiff(const uint8_t *src1, const uint8_t *src2, size_t n)
+{
+    size_t numUnmasked = 0;
+    return getKernel<true, false>()(src1, src2, nullptr, nullptr, n, numUnmasked);
+}
+
+uint64_t
+sumSquaredDiffMasked(const uint8_t *src1, const uint8_t *src2,
+                     const uint8_t *mask1, const uint8_t *mask2,
+                     size_t n, size_t &numUnmasked)
+{
+    numUnmasked = 0;
+    return getKernel<true, true>()(src1, src2, mask1, mask2, n, numUnmasked);
+}
+
+} // Internal
+} // Navigation
+} // BoBRobotics
@@ -1,14 +1,19 @@
 // BoB robotics includes
 #include "common/logging.h"
+#include "common/thread_pool.h"
 #include "imgproc/opencv_unwrap_360.h"
 #include "navigation/image_database.h"
 
 // Standard C includes
+#include <cstdint>
+#include <cstring>
 #include <ctime>
 
 // Standard C++ includes
 #include <algorithm>
+#include <deque>
 #include <fstream>
+#include <future>
 #include <sstream>
 #include <stdexcept>
 
@@ -22,6 +27,58 @@ namespace Navigation {
 constexpr const char *ImageDatabase::MetadataFilename;
 constexpr const char *ImageDatabase::EntriesFilename;
 
+namespace {
+/*
+ * Layout of packed database files (see ImageDatabase::pack()). Values are
+ * stored in the native byte order of the machine which packed the database,
+ * so files packed on a machine of the other endianness fail the version
+ * check. The file consists of:
+ *  - a PackedHeader
+ *  - the YAML metadata, as text
+ *  - one PackedEntry per entry, at a fixed stride
+ *  - the image data, each image starting on a 64-byte boundary
+ */
+constexpr char PackedMagic[8] = { 'B', 'o', 'B', 'I', 'm', 'D', 'B', '\0' };
+constexpr uint32_t PackedVersion = 1;
+constexpr size_t PackedAlignment = 64;
+
+enum PackedCompression : uint32_t
+{
+    Raw = 0,
+    PNG = 1
+};
+
+struct PackedHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t isRoute;
+    uint32_t compression;
+    uint32_t width, height;
+    uint32_t reserved;
+    uint64_t numEntries;
+    uint64_t metadataOffset, metadataSize;
+    uint64_t indexOffset;
+};
+static_assert(sizeof(PackedHeader) == 64, "PackedHeader must be 64 bytes");
+
+struct PackedEntry
+{
+    double position[3]; // mm
+    double heading;     // degrees
+    uint64_t gridPosition[3];
+    uint64_t offset, size;
+    char filename[56];
+};
+static_assert(sizeof(PackedEntry) == 128, "PackedEntry must be 128 bytes");
+
+size_t
+alignPacked(size_t offset)
+{
+    return ((offset + PackedAlignment - 1) / PackedAlignment) * PackedAlignment;
+}
+} // anonymous namespace
+
 size_t
 Range::size() const
 {
@@ -31,6 +88,16 @@ Range::size() const
 cv::Mat
 ImageDatabase::Entry::load() const
 {
+    if (!packedData.empty()) {
+        if (packedEncoded) {
+            return cv::imdecode(packedData, cv::IMREAD_COLOR);
+        }
+
+        cv::Mat image;
+        cv::cvtColor(packedData, image, cv::COLOR_GRAY2BGR);
+        return image;
+    }
+
     BOB_ASSERT(path.exists());
     return cv::imread(path.str());
 }
@@ -38,6 +105,10 @@ ImageDatabase::Entry::load() const
 cv::Mat
 ImageDatabase::Entry::loadGreyscale() const
 {
+    if (!packedData.empty()) {
+        return packedEncoded ? cv::imdecode(packedData, cv::IMREAD_GRAYSCALE) : packedData;
+    }
+
     BOB_ASSERT(path.exists());
     return cv::imread(path.str(), cv::IMREAD_GRAYSCALE);
 }
@@ -98,6 +169,9 @@ ImageDatabase::Recorder::Recorder(ImageDatabase &imageDatabase,
   , m_Recording(true)
   , m_YAML(".yml", cv::FileStorage::WRITE | cv::FileStorage::MEMORY)
 {
+    // Packed databases are read-only
+    BOB_ASSERT(!imageDatabase.isPacked());
+
     // Set this property of the ImageDatabase
     imageDatabase.m_IsRoute = isRoute;
 
@@ -123,7 +197,7 @@ ImageDatabase::Recorder::addEntry(const std::string &filename,
     BOB_ASSERT(m_Recording);
     m_ImageDatabase.writeImage(filename, image);
     m_NewEntries.emplace_back(Entry{
-            position, heading, m_ImageDatabase.m_Path / filename, gridPosition });
+            position, heading, m_ImageDatabase.m_Path / filename, gridPosition, {}, false });
 }
 
 ImageDatabase::GridRecorder::GridRecorder(ImageDatabase &imageDatabase,
@@ -260,6 +334,12 @@ ImageDatabase::ImageDatabase(const filesystem::path &databasePath, bool overwrit
         filesystem::remove_all(databasePath);
     }
 
+    // Databases can be stored in a single file instead of a folder
+    if (databasePath.is_file()) {
+        loadPacked();
+        return;
+    }
+
     // If we don't have any entries, it's an empty database
     const auto entriesPath = m_Path / EntriesFilename;
     if (!entriesPath.exists()) {
@@ -311,7 +391,9 @@ ImageDatabase::ImageDatabase(const filesystem::path &databasePath, bool overwrit
                 millimeter_t(std::stod(fields[2])) },
             degree_t(std::stod(fields[3])),
             m_Path / fields[4],
-            gridPosition
+            gridPosition,
+            {},
+            false
         };
         m_Entries.push_back(entry);
     }
@@ -372,6 +454,13 @@ ImageDatabase::isGrid() const
     return !empty() && !m_IsRoute;
 }
 
+//! Check if this database is stored in a single packed file (see pack())
+bool
+ImageDatabase::isPacked() const
+{
+    return static_cast<bool>(m_PackedFile);
+}
+
 //! Load all of the images in this database into memory and return
 std::vector<cv::Mat>
 ImageDatabase::getImages() const
@@ -385,10 +474,62 @@ ImageDatabase::getImages() const
 void
 ImageDatabase::getImages(std::vector<cv::Mat> &images) const
 {
-    images.reserve(size());
-    std::transform(begin(), end(), std::back_inserter(images), [](const auto &entry) {
-        return entry.load();
-    });
+    images.reserve(images.size() + size());
+    forEachImage([&images](size_t, const cv::Mat &image) {
+        images.push_back(image);
+    }, /*greyscale=*/false);
+}
+
+void
+ImageDatabase::forEachImage(const ImageCallback &func,
+                            bool greyscale,
+                            const cv::Size &resolution,
+                            size_t numThreads,
+                            size_t readAhead) const
+{
+    if (numThreads == 0) {
+        numThreads = ThreadPool::getDefaultNumThreads();
+    }
+    if (readAhead == 0) {
+        readAhead = 2 * numThreads;
+    }
+
+    const auto loadEntry = [greyscale, resolution](const Entry &entry) {
+        cv::Mat image = greyscale ? entry.loadGreyscale() : entry.load();
+        if (!resolution.empty() && image.size() != resolution) {
+            cv::Mat resized;
+            cv::resize(image, resized, resolution);
+            return resized;
+        }
+        return image;
+    };
+
+    // NB: The pool must outlive the futures, so it's declared first
+    ThreadPool pool(numThreads);
+    std::deque<std::future<cv::Mat>> pending;
+    size_t nextToLoad = 0;
+    const auto loadNext = [&]() {
+        const Entry &entry = m_Entries[nextToLoad++];
+        pending.emplace_back(pool.enqueue([&entry, &loadEntry]() { return loadEntry(entry); }));
+    };
+
+    // Start loading the first batch of images
+    while (nextToLoad < size() && pending.size() < readAhead) {
+        loadNext();
+    }
+
+    for (size_t i = 0; i < size(); i++) {
+        // Wait for the next image (rethrowing any errors from the worker)
+        const cv::Mat image = pending.front().get();
+        pending.pop_front();
+
+        // Keep the workers busy while we process this image
+        if (nextToLoad < size()) {
+            loadNext();
+        }
+
+        func(i, image);
+    }
 }
 
 //! Access the metadata for this database via OpenCV's persistence API
@@ -428,7 +569,7 @@ ImageDatabase::getRouteRecorder(const std::string &imageFormat)
 cv::Size
 ImageDatabase::getResolution() const
 {
-    BOB_ASSERT(hasMetadata());
+    BOB_ASSERT(hasMetadata() || isPacked());
     return m_Resolution;
 }
 
@@ -448,6 +589,7 @@ ImageDatabase::unwrap(const filesystem::path &destination, const cv::Size &unwra
 {
     // Check that the database doesn't already exist
     BOB_ASSERT(!(destination / EntriesFilename).exists());
+    BOB_ASSERT(!isPacked());
 
     // Create object for unwrapping images
     std::string camName;
@@ -500,6 +642,86 @@ ImageDatabase::unwrap(const filesystem::path &destination, const cv::Size &unwra
     }
 }
 
+/**!
+ *  \brief Write all the images in this database, as greyscale, into a
+ *         single packed file, along with the entries and metadata.
+ */
+void
+ImageDatabase::pack(const filesystem::path &destination, bool compress) const
+{
+    BOB_ASSERT(!empty());
+    BOB_ASSERT(!destination.exists()); // Don't overwrite data by default!
+
+    std::ofstream os(destination.str(), std::ios::binary);
+    BOB_ASSERT(os.good());
+
+    const std::string metadataText = getMetadataText();
+    PackedHeader header{};
+    std::memcpy(header.magic, PackedMagic, sizeof(PackedMagic));
+    header.version = PackedVersion;
+    header.isRoute = isRoute() ? 1 : 0;
+    header.compression = compress ? PackedCompression::PNG : PackedCompression::Raw;
+    header.numEntries = size();
+    header.metadataOffset = sizeof(PackedHeader);
+    header.metadataSize = metadataText.size();
+    header.indexOffset = alignPacked(header.metadataOffset + header.metadataSize);
+
+    // Images go after the index, which we fill in as we go
+    std::vector<PackedEntry> index(size());
+    size_t offset = alignPacked(header.indexOffset + index.size() * sizeof(PackedEntry));
+
+    std::vector<uint8_t> encoded;
+    const std::vector<char> padding(PackedAlignment, 0);
+    forEachImage([&](size_t i, const cv::Mat &image) {
+        // All images must have the same resolution
+        if (i == 0) {
+            header.width = static_cast<uint32_t>(image.cols);
+            header.height = static_cast<uint32_t>(image.rows);
+        } else {
+            BOB_ASSERT(image.cols == static_cast<int>(header.width));
+            BOB_ASSERT(image.rows == static_cast<int>(header.height));
+        }
+
+        const Entry &entry = m_Entries[i];
+        PackedEntry &packed = index[i];
+        for (size_t j = 0; j < 3; j++) {
+            packed.position[j] = entry.position[j].value();
+            packed.gridPosition[j] = entry.gridPosition[j];
+        }
+        packed.heading = entry.heading.value();
+
+        const std::string filename = entry.path.filename();
+        BOB_ASSERT(filename.size() < sizeof(packed.filename));
+        std::strncpy(packed.filename, filename.c_str(), sizeof(packed.filename));
+
+        // Write image data, padded up to the next boundary
+        os.seekp(static_cast<std::streamoff>(offset));
+        if (compress) {
+            BOB_ASSERT(cv::imencode(".png", image, encoded));
+            os.write(reinterpret_cast<const char *>(encoded.data()), encoded.size());
+            packed.size = encoded.size();
+        } else {
+            for (int y = 0; y < image.rows; y++) {
+                os.write(reinterpret_cast<const char *>(image.ptr(y)), image.cols);
+            }
+            packed.size = image.total();
+        }
+        packed.offset = offset;
+        offset = alignPacked(offset + packed.size);
+        os.write(padding.data(), static_cast<std::streamsize>(offset - packed.offset - packed.size));
+    });
+
+    // Now we know the resolution and offsets, we can write the header and index
+    os.seekp(0);
+    os.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    os.write(metadataText.data(), metadataText.size());
+    os.seekp(static_cast<std::streamoff>(header.indexOffset));
+    os.write(reinterpret_cast<const char *>(index.data()), index.size() * sizeof(PackedEntry));
+    BOB_ASSERT(os.good());
+
+    LOG_INFO << "Packed " << size() << " images into " << destination;
+}
+
 //! Get a filename for a route-type database
 std::string
 ImageDatabase::getFilename(const size_t routeIndex,
@@ -540,30 +762,117 @@ ImageDatabase::loadMetadata()
         m_IsRoute = true;
         m_MetadataYAML.reset();
     } else {
-        std::ifstream ifs(metadataPath.str());
-        std::stringstream ss;
-        ss << "%YAML:1.0\n"
-           << ifs.rdbuf();
-
-        // Parse metadata file
-        m_MetadataYAML = std::make_unique<cv::FileStorage>(ss.str(), cv::FileStorage::READ | cv::FileStorage::MEMORY);
-
-        // What type of database is it?
-        std::string dbtype;
-        const auto metadata = getMetadata();
-        metadata["type"] >> dbtype;
-        if (dbtype == "route") {
-            m_IsRoute = true;
-        } else if (dbtype == "grid") {
-            m_IsRoute = false;
+        parseMetadata(getMetadataText());
+    }
+}
+
+void
+ImageDatabase::parseMetadata(const std::string &metadataText)
+{
+    std::stringstream ss;
+    ss << "%YAML:1.0\n"
+       << metadataText;
+
+    // Parse metadata file
+    m_MetadataYAML = std::make_unique<cv::FileStorage>(ss.str(), cv::FileStorage::READ | cv::FileStorage::MEMORY);
+
+    // What type of database is it?
+    std::string dbtype;
+    const auto metadata = getMetadata();
+    metadata["type"] >> dbtype;
+    if (dbtype == "route") {
+        m_IsRoute = true;
+    } else if (dbtype == "grid") {
+        m_IsRoute = false;
+    } else {
+        throw std::runtime_error("Invalid database type \"" + dbtype + "\"");
+    }
+
+    // Get image resolution
+    std::vector<int> size(2);
+    metadata["camera"]["resolution"] >> size;
+    m_Resolution = { size[0], size[1] };
+}
+
+//! Get the metadata in its original YAML form (empty if there isn't any)
+std::string
+ImageDatabase::getMetadataText() const
+{
+    if (isPacked()) {
+        const auto &header = *reinterpret_cast<const PackedHeader *>(m_PackedFile->data());
+        return std::string(reinterpret_cast<const char *>(m_PackedFile->data() + header.metadataOffset),
+                           header.metadataSize);
+    }
+
+    const auto metadataPath = m_Path / MetadataFilename;
+    if (!metadataPath.exists()) {
+        return {};
+    }
+
+    std::ifstream ifs(metadataPath.str());
+    std::stringstream ss;
+    ss << ifs.rdbuf();
+    return ss.str();
+}
+
+void
+ImageDatabase::loadPacked()
+{
+    m_PackedFile = std::make_unique<MemoryMappedFile>(m_Path.str());
+    const size_t fileSize = m_PackedFile->size();
+
+    // Check header
+    BOB_ASSERT(fileSize >= sizeof(PackedHeader));
+    const auto &header = *reinterpret_cast<const PackedHeader *>(m_PackedFile->data());
+    if (std::memcmp(header.magic, PackedMagic, sizeof(PackedMagic)) != 0) {
+        throw std::runtime_error(m_Path.str() + " is not a packed image database");
+    }
+    if (header.version != PackedVersion) {
+        throw std::runtime_error("Unsupported packed image database version " + std::to_string(header.version));
+    }
+    BOB_ASSERT(header.compression == PackedCompression::Raw || header.compression == PackedCompression::PNG);
+    BOB_ASSERT(header.metadataOffset + header.metadataSize <= fileSize);
+    BOB_ASSERT(header.indexOffset + header.numEntries * sizeof(PackedEntry) <= fileSize);
+
+    // Use embedded metadata, if there is any
+    if (header.metadataSize > 0) {
+        parseMetadata(getMetadataText());
+    } else {
+        m_IsRoute = header.isRoute != 0;
+    }
+
+    // The header always records the resolution of the stored images, even without metadata
+    m_Resolution = { static_cast<int>(header.width), static_cast<int>(header.height) };
+
+    // Make entries which refer to the image data in place
+    const bool encoded = header.compression != PackedCompression::Raw;
+    const auto *index = reinterpret_cast<const PackedEntry *>(m_PackedFile->data() + header.indexOffset);
+    m_Entries.reserve(header.numEntries);
+    for (size_t i = 0; i < header.numEntries; i++) {
+        const PackedEntry &packed = index[i];
+        BOB_ASSERT(packed.offset + packed.size <= fileSize);
+
+        // The mapping is read-only, but cv::Mat has no const constructor
+        void *imageData = const_cast<uint8_t *>(m_PackedFile->data() + packed.offset);
+        cv::Mat packedData;
+        if (encoded) {
+            packedData = cv::Mat(1, static_cast<int>(packed.size), CV_8UC1, imageData);
         } else {
-            throw std::runtime_error("Invalid database type \"" + dbtype + "\"");
+            BOB_ASSERT(packed.size == static_cast<uint64_t>(header.width) * header.height);
+            packedData = cv::Mat(static_cast<int>(header.height), static_cast<int>(header.width), CV_8UC1, imageData);
         }
 
-        // Get image resolution
-        std::vector<int> size(2);
-        metadata["camera"]["resolution"] >> size;
-        m_Resolution = { size[0], size[1] };
+        Entry entry{
+            { millimeter_t(packed.position[0]),
+              millimeter_t(packed.position[1]),
+              millimeter_t(packed.position[2]) },
+            degree_t(packed.heading),
+            m_Path / std::string(packed.filename, strnlen(packed.filename, sizeof(packed.filename))),
+            { packed.gridPosition[0], packed.gridPosition[1], packed.gridPosition[2] },
+            packedData,
+            encoded
+        };
+        m_Entries.push_back(entry);
     }
 }
 
@@ -0,0 +1,213 @@
+// BoB robotics includes
+#include "navigation/infomax_quantised.h"
+
+// SIMD intrinsics
+#if defined(__SSE2__) || defined(_M_X64)
+#define BOB_DOT_SSE2
+#include <emmintrin.h>
+
+// We need GCC/Clang's function-level target attributes to build AVX2 code
+// without enabling AVX2 for the whole module
+#if defined(__GNUC__)
+#define BOB_DOT_AVX2
+#include <immintrin.h>
+#define BOB_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define BOB_DOT_NEON
+#include <arm_neon.h>
+#endif
+
+namespace {
+using KernelFunc = int64_t (*)(const int8_t *, const uint8_t *, size_t);
+
+/*
+ * Number of vector iterations after which 32-bit accumulators are widened to
+ * 64 bits. Each 32-bit lane receives at most 4 * 255 * 128 per iteration.
+ */
+constexpr size_t BlockIterations = 4096;
+
+//------------------------------------------------------------------------
+// Scalar kernel
+//------------------------------------------------------------------------
+int64_t
+dotScalar(const int8_t *weights, const uint8_t *inputs, size_t n)
+{
+    int64_t sum = 0;
+    for (size_t i = 0; i < n; i++) {
+        sum += static_cast<int32_t>(weights[i]) * static_cast<int32_t>(inputs[i]);
+    }
+    return sum;
+}
+
+#ifdef BOB_DOT_SSE2
+//------------------------------------------------------------------------
+// SSE2 kernel
+//------------------------------------------------------------------------
+inline int64_t
+horizontalSumSSE2(__m128i acc)
+{
+    alignas(16) int32_t lanes[4];
+    _mm_store_si128(reinterpret_cast<__m128i *>(lanes), acc);
+    return static_cast<int64_t>(lanes[0]) + lanes[1] + lanes[2] + lanes[3];
+}
+
+int64_t
+dotSSE2(const int8_t *weights, const uint8_t *inputs, size_t n)
+{
+    const __m128i zero = _mm_setzero_si128();
+    __m128i acc = zero;
+    int64_t sum = 0;
+
+    const size_t numVectors = n / 16;
+    for (size_t v = 0; v < numVectors; v++) {
+        const size_t i = v * 16;
+        const __m128i w = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&weights[i]));
+        const __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i *>(&inputs[i]));
+
+        // Widen to 16 bits: zero-extend inputs and sign-extend weights
+        const __m128i sign = _mm_cmpgt_epi8(zero, w);
+        const __m128i wLo = _mm_unpacklo_epi8(w, sign);
+        const __m128i wHi = _mm_unpackhi_epi8(w, sign);
+        const __m128i xLo = _mm_unpacklo_epi8(x, zero);
+        const __m128i xHi = _mm_unpackhi_epi8(x, zero);
+        acc = _mm_add_epi32(acc, _mm_madd_epi16(wLo, xLo));
+        acc = _mm_add_epi32(acc, _mm_madd_epi16(wHi, xHi));
+
+        if ((v % BlockIterations) == (BlockIterations - 1)) {
+            sum += horizontalSumSSE2(acc);
+            acc = zero;
+        }
+    }
+
+    // Handle remaining elements
+    const size_t done = numVectors * 16;
+    return sum + horizontalSumSSE2(acc) + dotScalar(&weights[done], &inputs[done], n - done);
+}
+#endif // BOB_DOT_SSE2
+
+#ifdef BOB_DOT_AVX2
+//------------------------------------------------------------------------
+// AVX2 kernel
+//------------------------------------------------------------------------
+BOB_TARGET_AVX2 inline int64_t
+horizontalSumAVX2(__m256i acc)
+{
+    alignas(32) int32_t lanes[8];
+    _mm256_store_si256(reinterpret_cast<__m256i *>(lanes), acc);
+    int64_t sum = 0;
+    for (int32_t lane : lanes) {
+        sum += lane;
+    }
+    return sum;
+}
+
+BOB_TARGET_AVX2 int64_t
+dotAVX2(const int8_t *weights, const uint8_t *inputs, size_t n)
+{
+    __m256i acc = _mm256_setzero_si256();
+    int64_t sum = 0;
+
+    const size_t numVectors = n / 16;
+    for (size_t v = 0; v < numVectors; v++) {
+        const size_t i = v * 16;
+
+        // Widen to 16 bits: zero-extend inputs and sign-extend weights
+        const __m256i w = _mm256_cvtepi8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(&weights[i])));
+        const __m256i x = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i *>(&inputs[i])));
+        acc = _mm256_add_epi32(acc, _mm256_madd_epi16(w, x));
+
+        if ((v % BlockIterations) == (BlockIterations - 1)) {
+            sum += horizontalSumAVX2(acc);
+            acc = _mm256_setzero_si256();
+        }
+    }
+
+    // Handle remaining elements
+    const size_t done = numVectors * 16;
+    return sum + horizontalSumAVX2(acc) + dotScalar(&weights[done], &inputs[done], n - done);
+}
+#endif // BOB_DOT_AVX2
+
+#ifdef BOB_DOT_NEON
+//------------------------------------------------------------------------
+// NEON kernel
+//------------------------------------------------------------------------
+inline int64_t
+horizontalSumNEON(int32x4_t acc)
+{
+    const int64x2_t pairs = vpaddlq_s32(acc);
+    return vgetq_lane_s64(pairs, 0) + vgetq_lane_s64(pairs, 1);
+}
+
+int64_t
+dotNEON(const int8_t *weights, const uint8_t *inputs, size_t n)
+{
+    int32x4_t acc = vdupq_n_s32(0);
+    int64_t sum = 0;
+
+    const size_t numVectors = n / 16;
+    for (size_t v = 0; v < numVectors; v++) {
+        const size_t i = v * 16;
+        const int8x16_t w = vld1q_s8(&weights[i]);
+        const uint8x16_t x = vld1q_u8(&inputs[i]);
+
+        // Widen to 16 bits: zero-extend inputs and sign-extend weights
+        const int16x8_t wLo = vmovl_s8(vget_low_s8(w));
+        const int16x8_t wHi = vmovl_s8(vget_high_s8(w));
+        const int16x8_t xLo = vreinterpretq_s16_u16(vmovl_u8(vget_low_u8(x)));
+        const int16x8_t xHi = vreinterpretq_s16_u16(vmovl_u8(vget_high_u8(x)));
+        acc = vmlal_s16(acc, vget_low_s16(wLo), vget_low_s16(xLo));
+        acc = vmlal_s16(acc, vget_high_s16(wLo), vget_high_s16(xLo));
+        acc = vmlal_s16(acc, vget_low_s16(wHi), vget_low_s16(xHi));
+        acc = vmlal_s16(acc, vget_high_s16(wHi), vget_high_s16(xHi));
+
+        if ((v % BlockIterations) == (BlockIterations - 1)) {
+            sum += horizontalSumNEON(acc);
+            acc = vdupq_n_s32(0);
+        }
+    }
+
+    // Handle remaining elements
+    const size_t done = numVectors * 16;
+    return sum + horizontalSumNEON(acc) + dotScalar(&weights[done], &inputs[done], n - done);
+}
+#endif // BOB_DOT_NEON
+
+//------------------------------------------------------------------------
+// Runtime dispatch
+//------------------------------------------------------------------------
+KernelFunc
+selectKernel()
+{
+#if defined(BOB_DOT_AVX2)
+    if (__builtin_cpu_supports("avx2")) {
+        return &dotAVX2;
+    }
+#endif
+
+#if defined(BOB_DOT_SSE2)
+    return &dotSSE2;
+#elif defined(BOB_DOT_NEON)
+    return &dotNEON;
+#else
+    return &dotScalar;
+#endif
+}
+} // anonymous namespace
+
+namespace BoBRobotics {
+namespace Navigation {
+namespace Internal {
+
+int64_t
+dotProductS8U8(const int8_t *weights, const uint8_t *inputs, size_t n)
+{
+    // Only query the CPU's features the first time round
+    static const KernelFunc kernel = selectKernel();
+    return kernel(weights, inputs, n);
+}
+
+} // Internal
+} // Navigation
+} // BoBRobotics
@@ -18,24 +18,15 @@ VisualNavigationBase::~VisualNavigationBase()
 void
 VisualNavigationBase::trainRoute(const ImageDatabase &imdb, bool resizeImages)
 {
-    cv::Mat image;
-    if (resizeImages) {
-        cv::Mat imageResized;
-        for (const auto &e : imdb) {
-            image = e.loadGreyscale();
-            BOB_ASSERT(image.type() == CV_8UC1);
-            cv::resize(image, imageResized, m_UnwrapRes);
-            train(imageResized);
-        }
-    } else {
-        for (const auto &e : imdb) {
-            image = e.loadGreyscale();
-            BOB_ASSERT(image.type() == CV_8UC1);
+    // Images are decoded on worker threads while we train with earlier ones
+    imdb.forEachImage([this, resizeImages](size_t, const cv::Mat &image) {
+        BOB_ASSERT(image.type() == CV_8UC1);
+        if (!resizeImages) {
             BOB_ASSERT(image.cols == m_UnwrapRes.width);
             BOB_ASSERT(image.rows == m_UnwrapRes.height);
-            train(image);
         }
-    }
+        train(image);
+    }, /*greyscale=*/true, resizeImages ? m_UnwrapRes : cv::Size());
 }
 
 void
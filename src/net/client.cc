@@ -13,10 +13,19 @@ namespace BoBRobotics {
 namespace Net {
 
 Client::Client(const std::string &host,
-               uint16_t port)
+               uint16_t port,
+               bool binaryProtocol,
+               bool datagrams)
   : Connection(AF_INET, SOCK_STREAM, 0)
   , m_IP(host)
 {
+    if (binaryProtocol) {
+        requestBinaryProtocol();
+    }
+    if (datagrams) {
+        requestDatagrams();
+    }
+
     // Create socket address structure
     in_addr addr;
     addr.s_addr = inet_addr(host.c_str());
@@ -1,11 +1,45 @@
 // BoB robotics includes
 #include "common/logging.h"
+#include "common/macros.h"
 #include "net/connection.h"
 
 // Standard C++ includes
+#include <algorithm>
+#include <chrono>
 #include <iterator>
+#include <limits>
 #include <sstream>
 
+namespace {
+//! Header preceding each message sent with the binary protocol
+struct MessageHeader
+{
+    uint16_t opcode;
+    uint16_t reserved;
+    uint32_t length;
+};
+static_assert(sizeof(MessageHeader) == 8, "MessageHeader must be packed");
+
+//! How long to wait for outstanding datagrams to be acknowledged when closing
+constexpr std::chrono::milliseconds DatagramFlushTimeout{ 500 };
+
+//! Parse a port number sent by the peer, throwing BadCommandError if it isn't one
+uint16_t
+parsePort(const std::string &str)
+{
+    if (str.empty() || str.size() > 5 ||
+        !std::all_of(str.begin(), str.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+        throw BoBRobotics::Net::BadCommandError();
+    }
+
+    const unsigned long port = std::stoul(str);
+    if (port == 0 || port > std::numeric_limits<uint16_t>::max()) {
+        throw BoBRobotics::Net::BadCommandError();
+    }
+    return static_cast<uint16_t>(port);
+}
+} // anonymous namespace
+
 namespace BoBRobotics {
 namespace Net {
 
@@ -20,16 +54,72 @@ Connection::SocketWriter::~SocketWriter()
     m_Connection.m_SendMutex->unlock();
 }
 
+void Connection::SocketWriter::send(const void *buffer, size_t length)
+{
+    m_Connection.sendStream(buffer, length);
+}
+
+void Connection::SocketWriter::send(const std::string &msg)
+{
+    m_Connection.sendStream(msg.c_str(), msg.size());
+    LOG_VERBOSE << ">>> " << msg;
+}
+
+bool Connection::SocketWriter::isBinary() const
+{
+    return m_Connection.m_SendBinary;
+}
+
+void Connection::SocketWriter::sendMessage(uint16_t opcode, std::initializer_list<ConstBuffer> payload)
+{
+    BOB_ASSERT(isBinary());
+    BOB_ASSERT(payload.size() < Socket::MaxBuffers);
+
+    // Gather header and payload together so they're sent with one system call
+    ConstBuffer buffers[Socket::MaxBuffers];
+    MessageHeader header{ opcode, 0, 0 };
+    size_t length = 0;
+    size_t numBuffers = 1;
+    for (const auto &buffer : payload) {
+        length += buffer.size;
+        buffers[numBuffers++] = buffer;
+    }
+    BOB_ASSERT(length <= std::numeric_limits<uint32_t>::max());
+    header.length = static_cast<uint32_t>(length);
+    buffers[0] = { &header, sizeof(header) };
+
+    m_Connection.m_Socket.send(buffers, numBuffers);
+}
+
 Connection::~Connection()
 {
     if (m_Socket.isOpen()) {
-        m_Socket.send("BYE\n");
+        /*
+         * Give datagrams still awaiting acknowledgement (e.g. a final stop
+         * command) a chance to arrive before the other end sees us say goodbye
+         */
+        const auto datagrams = std::atomic_load(&m_Datagrams);
+        if (datagrams && datagrams->isStarted() && !datagrams->flush(DatagramFlushTimeout)) {
+            LOG_WARNING << "Not all datagrams were acknowledged before closing connection";
+        }
+
+        try {
+            getSocketWriter().send("BYE\n");
+        } catch (OS::Net::NetworkError &e) {
+            // The other end may well have hung up first
+            LOG_DEBUG << "Could not say goodbye: " << e.what();
+        } catch (SocketClosedError &) {
+            // Socket has already been cleanly closed
+        }
         m_Socket.close();
     }
 
     // Wait for thread to terminate
     LOG_DEBUG << "Waiting for connection to close...";
     stop();
+
+    // Make sure no more datagrams are handled, as the handlers are about to be destroyed
+    std::atomic_store(&m_Datagrams, std::shared_ptr<DatagramChannel>());
     LOG_DEBUG << "Connection closed";
 }
 
@@ -41,6 +131,46 @@ void Connection::setCommandHandler(const std::string &commandName, const Command
     m_CommandHandlers.emplace(commandName, handler);
 }
 
+void Connection::setMessageHandler(uint16_t opcode, const MessageHandler handler)
+{
+    BOB_ASSERT(opcode != Opcode::Stream);
+
+    std::lock_guard<std::mutex> guard(*m_MessageHandlersMutex);
+    if (opcode >= m_MessageHandlers.size()) {
+        m_MessageHandlers.resize(opcode + 1);
+    }
+    m_MessageHandlers[opcode] = handler;
+}
+
+void Connection::requestBinaryProtocol()
+{
+    m_RequestBinary = true;
+}
+
+void Connection::requestDatagrams()
+{
+    m_RequestDatagrams = true;
+}
+
+bool Connection::hasDatagrams() const
+{
+    const auto datagrams = std::atomic_load(&m_Datagrams);
+    return datagrams && datagrams->isStarted();
+}
+
+void Connection::sendDatagram(const std::string &command, Delivery delivery)
+{
+    const auto datagrams = std::atomic_load(&m_Datagrams);
+    if (datagrams && datagrams->isStarted()) {
+        datagrams->send(command, delivery);
+        LOG_VERBOSE << ">>> (UDP) " << command;
+    } else if (!command.empty() && command.back() == '\n') {
+        getSocketWriter().send(command);
+    } else {
+        getSocketWriter().send(command + "\n");
+    }
+}
+
 void Connection::read(void *buffer, size_t length)
 {
     // initially, copy over any leftover bytes in m_Buffer
@@ -55,7 +185,7 @@ void Connection::read(void *buffer, size_t length)
 
     // keep reading from socket until we have enough bytes
     while (length > 0) {
-        size_t nbytes = m_Socket.read(cbuffer, length);
+        size_t nbytes = readStream(cbuffer, length);
         cbuffer += nbytes;
         length -= nbytes;
     }
@@ -90,9 +220,36 @@ bool Connection::parseCommand(Command &command)
         return false;
     }
     if (command[0] == "HEY") {
+        // The server supports the binary protocol, so switch if we want to
+        if (m_RequestBinary && command.size() > 1 && command[1] == "BIN") {
+            sendBinaryRequest();
+        }
+
+        // Likewise for datagrams
+        if (m_RequestDatagrams && std::find(command.begin() + 1, command.end(), "UDP") != command.end()) {
+            offerDatagrams();
+        }
+        return true;
+    }
+    if (command[0] == "BIN") {
+        // Everything after this line is sent with the binary protocol...
+        startReceivingBinary();
+
+        // ...so tell the other end to switch too, if it hasn't already
+        sendBinaryRequest();
         return true;
     }
+    if (command[0] == "UDP") {
+        startDatagrams(command);
+        return true;
+    }
+
+    handleCommand(command);
+    return true;
+}
 
+void Connection::handleCommand(const Command &command)
+{
     try {
         std::lock_guard<std::mutex> guard(*m_CommandHandlersMutex);
         CommandHandler &handler = m_CommandHandlers.at(command[0]);
@@ -101,7 +258,6 @@ bool Connection::parseCommand(Command &command)
         if (handler) {
             handler(*this, command);
         }
-        return true;
     } catch (std::out_of_range &) {
         throw BadCommandError();
     }
@@ -121,8 +277,8 @@ std::string Connection::readLine()
     std::ostringstream oss;
     while (true) {
         if (m_BufferBytes == 0) {
-            m_BufferBytes += m_Socket.read(&m_Buffer[m_BufferStart],
-                                            DefaultBufferSize - m_BufferStart);
+            m_BufferBytes += readStream(&m_Buffer[m_BufferStart],
+                                        DefaultBufferSize - m_BufferStart);
         }
 
         // look for newline char
@@ -157,5 +313,153 @@ void Connection::debitBytes(const size_t nbytes)
     m_BufferBytes -= nbytes;
 }
 
+size_t Connection::readStream(void *buffer, size_t length)
+{
+    if (!m_ReceiveBinary) {
+        return m_Socket.read(buffer, length);
+    }
+
+    // Handle any other messages which arrive before the next plaintext
+    while (m_StreamBytesLeft == 0) {
+        MessageHeader header;
+        readWireExactly(&header, sizeof(header));
+        if (header.opcode == Opcode::Stream) {
+            m_StreamBytesLeft = header.length;
+        } else {
+            handleMessage(header.opcode, header.length);
+        }
+    }
+
+    const size_t nbytes = readWire(buffer, std::min(length, m_StreamBytesLeft));
+    m_StreamBytesLeft -= nbytes;
+    return nbytes;
+}
+
+size_t Connection::readWire(void *buffer, size_t length)
+{
+    const size_t leftover = m_WireBuffer.size() - m_WireBufferStart;
+    if (leftover == 0) {
+        const size_t nbytes = m_Socket.read(buffer, length);
+        if (nbytes == 0) {
+            // Other end has hung up
+            m_Socket.close();
+            throw SocketClosedError();
+        }
+        return nbytes;
+    }
+
+    const size_t nbytes = std::min(length, leftover);
+    std::copy_n(&m_WireBuffer[m_WireBufferStart], nbytes, reinterpret_cast<char *>(buffer));
+    m_WireBufferStart += nbytes;
+    if (m_WireBufferStart == m_WireBuffer.size()) {
+        m_WireBuffer.clear();
+        m_WireBufferStart = 0;
+    }
+    return nbytes;
+}
+
+void Connection::readWireExactly(void *buffer, size_t length)
+{
+    auto cbuffer = reinterpret_cast<char *>(buffer);
+    while (length > 0) {
+        const size_t nbytes = readWire(cbuffer, length);
+        cbuffer += nbytes;
+        length -= nbytes;
+    }
+}
+
+void Connection::sendStream(const void *buffer, size_t length)
+{
+    if (!m_SendBinary) {
+        m_Socket.send(buffer, length);
+        return;
+    }
+
+    BOB_ASSERT(length <= std::numeric_limits<uint32_t>::max());
+    const MessageHeader header{ Opcode::Stream, 0, static_cast<uint32_t>(length) };
+    const ConstBuffer buffers[2]{ { &header, sizeof(header) }, { buffer, length } };
+    m_Socket.send(buffers, 2);
+}
+
+void Connection::sendBinaryRequest()
+{
+    std::lock_guard<std::mutex> guard(*m_SendMutex);
+    if (!m_SendBinary) {
+        m_Socket.send("BIN\n");
+        m_SendBinary = true;
+    }
+}
+
+void Connection::startReceivingBinary()
+{
+    // Whatever we've read past the end of the BIN line is already binary
+    m_WireBuffer.assign(m_Buffer.begin() + m_BufferStart,
+                        m_Buffer.begin() + m_BufferStart + m_BufferBytes);
+    m_WireBufferStart = 0;
+    debitBytes(m_BufferBytes);
+
+    m_ReceiveBinary = true;
+    m_StreamBytesLeft = 0;
+}
+
+void Connection::offerDatagrams()
+{
+    const auto datagrams = std::make_shared<DatagramChannel>();
+    std::atomic_store(&m_Datagrams, datagrams);
+    getSocketWriter().send("UDP " + std::to_string(datagrams->getLocalPort()) + "\n");
+}
+
+void Connection::startDatagrams(const Command &command)
+{
+    if (command.size() != 2) {
+        throw BadCommandError();
+    }
+    const uint16_t port = parsePort(command[1]);
+
+    // If we didn't ask for datagrams, the other end is asking us (only this thread sets m_Datagrams)
+    auto datagrams = m_Datagrams;
+    const bool offered = static_cast<bool>(datagrams);
+    if (!offered) {
+        datagrams = std::make_shared<DatagramChannel>();
+    } else if (datagrams->isStarted()) {
+        throw BadCommandError();
+    }
+
+    // Datagrams go to the same host we're connected to over TCP
+    sockaddr_in peer;
+    socklen_t addrlen = sizeof(peer);
+    if (getpeername(m_Socket.getHandle(), reinterpret_cast<sockaddr *>(&peer), &addrlen) ||
+        peer.sin_family != AF_INET) {
+        throw OS::Net::NetworkError("Could not get address of peer");
+    }
+    peer.sin_port = htons(port);
+
+    datagrams->start(peer, [this](const Command &datagramCommand) {
+        handleCommand(datagramCommand);
+    });
+    std::atomic_store(&m_Datagrams, datagrams);
+
+    if (!offered) {
+        getSocketWriter().send("UDP " + std::to_string(datagrams->getLocalPort()) + "\n");
+    }
+}
+
+void Connection::handleMessage(uint16_t opcode, size_t length)
+{
+    m_MessageBuffer.resize(length);
+    readWireExactly(m_MessageBuffer.data(), length);
+
+    std::lock_guard<std::mutex> guard(*m_MessageHandlersMutex);
+    if (opcode >= m_MessageHandlers.size()) {
+        throw BadCommandError();
+    }
+
+    // handler will be nullptr if it has been removed
+    const MessageHandler &handler = m_MessageHandlers[opcode];
+    if (handler) {
+        handler(*this, Message{ opcode, m_MessageBuffer.data(), length });
+    }
+}
+
 } // Net
 } // BoBRobotics
@@ -0,0 +1,334 @@
+// BoB robotics includes
+#include "common/background_exception_catcher.h"
+#include "common/logging.h"
+#include "common/macros.h"
+#include "net/datagram.h"
+
+// Standard C includes
+#include <cerrno>
+#include <cstring>
+
+// Standard C++ includes
+#include <iterator>
+#include <sstream>
+
+namespace {
+//! Header preceding each datagram
+struct DatagramHeader
+{
+    uint32_t sequence;
+    uint8_t flags;
+    uint8_t reserved[3];
+};
+static_assert(sizeof(DatagramHeader) == 8, "DatagramHeader must be packed");
+
+constexpr uint8_t FlagReliable = 1;
+constexpr uint8_t FlagAck = 2;
+
+//! How long to wait for an acknowledgement before sending a datagram again
+constexpr std::chrono::milliseconds RetransmitInterval{ 20 };
+
+//! How long the receiving thread blocks for, so it can also retransmit and stop promptly
+constexpr std::chrono::milliseconds ReceiveTimeout{ 5 };
+
+//! How many times a datagram is sent without being acknowledged before we warn about it
+constexpr int WarnTransmissions = 25;
+
+//! Errors which just mean there's nothing to receive right now
+bool
+isTransientError(int err)
+{
+#ifdef _WIN32
+    return err == WSAETIMEDOUT || err == WSAEWOULDBLOCK || err == WSAECONNRESET;
+#else
+    // ICMP "port unreachable" messages are reported as ECONNREFUSED: the other end may not be up yet
+    return err == EAGAIN || err == EWOULDBLOCK || err == EINTR || err == ECONNREFUSED;
+#endif
+}
+} // anonymous namespace
+
+namespace BoBRobotics {
+namespace Net {
+
+constexpr size_t DatagramChannel::MaxDatagramSize;
+
+DatagramChannel::DatagramChannel()
+  : m_Socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP)
+{
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = 0;
+    if (bind(m_Socket.getHandle(), reinterpret_cast<const sockaddr *>(&addr), sizeof(addr))) {
+        throw OS::Net::NetworkError("Could not bind datagram socket");
+    }
+
+#ifdef _WIN32
+    const DWORD timeout = static_cast<DWORD>(ReceiveTimeout.count());
+#else
+    timeval timeout{};
+    timeout.tv_usec = std::chrono::microseconds(ReceiveTimeout).count();
+#endif
+    if (setsockopt(m_Socket.getHandle(), SOL_SOCKET, SO_RCVTIMEO,
+                   reinterpret_cast<const char *>(&timeout), sizeof(timeout)) < 0) {
+        throw OS::Net::NetworkError("Could not set socket option");
+    }
+}
+
+DatagramChannel::~DatagramChannel()
+{
+    m_DoRun = false;
+    if (m_Thread.joinable()) {
+        m_Thread.join();
+    }
+}
+
+uint16_t
+DatagramChannel::getLocalPort() const
+{
+    sockaddr_in addr;
+    socklen_t addrlen = sizeof(addr);
+    if (getsockname(m_Socket.getHandle(), reinterpret_cast<sockaddr *>(&addr), &addrlen)) {
+        throw OS::Net::NetworkError("Could not get datagram socket's address");
+    }
+    return ntohs(addr.sin_port);
+}
+
+void
+DatagramChannel::start(const sockaddr_in &peer, const Handler handler)
+{
+    BOB_ASSERT(!isStarted());
+
+    // Connecting a UDP socket means we can use send() and recv() and ignore everyone else
+    if (connect(m_Socket.getHandle(), reinterpret_cast<const sockaddr *>(&peer), sizeof(peer)) < 0) {
+        throw OS::Net::NetworkError("Could not connect datagram socket");
+    }
+
+    m_Thread = std::thread(&DatagramChannel::runReceive, this, handler);
+    m_Started = true;
+}
+
+bool
+DatagramChannel::isStarted() const
+{
+    return m_Started;
+}
+
+size_t
+DatagramChannel::getNumMalformedDatagrams() const
+{
+    return m_NumMalformed;
+}
+
+void
+DatagramChannel::send(const std::string &command, Delivery delivery)
+{
+    BOB_ASSERT(isStarted());
+
+    size_t length = command.size();
+    if (length > 0 && command[length - 1] == '\n') {
+        length--;
+    }
+    BOB_ASSERT(length > 0 && sizeof(DatagramHeader) + length <= MaxDatagramSize);
+
+    const bool reliable = delivery == Delivery::Reliable;
+    std::lock_guard<std::mutex> guard(m_SendMutex);
+    PendingDatagram datagram{ reliable ? m_NextReliableSequence++ : m_NextLatestSequence++,
+                              std::vector<char>(sizeof(DatagramHeader) + length),
+                              std::chrono::steady_clock::now(),
+                              1 };
+    const DatagramHeader header{ datagram.sequence, reliable ? FlagReliable : uint8_t{ 0 }, {} };
+    std::memcpy(datagram.data.data(), &header, sizeof(header));
+    std::memcpy(&datagram.data[sizeof(header)], command.data(), length);
+    transmit(datagram.data.data(), datagram.data.size());
+
+    if (reliable) {
+        m_PendingReliable.emplace(datagram.sequence, std::move(datagram));
+    } else {
+        // Any older command with this name is superseded, so stop retransmitting it
+        m_PendingLatest[command.substr(0, command.find(' '))] = std::move(datagram);
+    }
+}
+
+bool
+DatagramChannel::flush(std::chrono::milliseconds timeout)
+{
+    std::unique_lock<std::mutex> lock(m_SendMutex);
+    return m_FlushedCondition.wait_for(lock, timeout, [this]() { return isFlushed(); });
+}
+
+void
+DatagramChannel::runReceive(const Handler handler)
+{
+    try {
+        std::vector<char> buffer(MaxDatagramSize);
+        while (m_DoRun) {
+            const auto nbytes = recv(m_Socket.getHandle(),
+                                     reinterpret_cast<readbuff_t>(buffer.data()),
+                                     static_cast<bufflen_t>(buffer.size()),
+                                     0);
+            if (nbytes > 0 && static_cast<size_t>(nbytes) >= sizeof(DatagramHeader)) {
+                handleDatagram(buffer.data(), static_cast<size_t>(nbytes), handler);
+            } else if (nbytes < 0 && !isTransientError(OS::Net::lastError())) {
+                throw OS::Net::NetworkError("Could not read from datagram socket");
+            }
+
+            retransmit();
+        }
+    } catch (...) {
+        BackgroundExceptionCatcher::set(std::current_exception());
+    }
+}
+
+void
+DatagramChannel::handleDatagram(const char *data, size_t length, const Handler &handler)
+{
+    DatagramHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    const bool reliable = header.flags & FlagReliable;
+    if (header.flags & FlagAck) {
+        handleAck(header.sequence, reliable);
+        return;
+    }
+
+    /*
+     * A stray or spoofed datagram mustn't take the channel down with it, so
+     * just drop it (unacknowledged, as it's nothing we'd want resent)
+     */
+    const std::string line(data + sizeof(header), length - sizeof(header));
+    std::istringstream iss(line);
+    const Command command(std::istream_iterator<std::string>{ iss },
+                          std::istream_iterator<std::string>());
+    if (command.empty()) {
+        m_NumMalformed++;
+        LOG_WARNING << "Dropping datagram " << header.sequence << " with no command";
+        return;
+    }
+
+    // Acknowledge everything, including duplicates, in case an earlier ack went missing
+    const DatagramHeader ack{ header.sequence, static_cast<uint8_t>(header.flags | FlagAck), {} };
+    transmit(&ack, sizeof(ack));
+
+    if (reliable) {
+        if (!isNewReliable(header.sequence)) {
+            return;
+        }
+    } else {
+        // Drop stale state which has arrived out of order
+        auto it = m_LatestReceived.find(command[0]);
+        if (it != m_LatestReceived.end()) {
+            if (static_cast<int32_t>(header.sequence - it->second) <= 0) {
+                return;
+            }
+            it->second = header.sequence;
+        } else {
+            m_LatestReceived.emplace(command[0], header.sequence);
+        }
+    }
+
+    LOG_VERBOSE << "<<< (UDP) " << line;
+    handler(command);
+}
+
+void
+DatagramChannel::handleAck(uint32_t sequence, bool reliable)
+{
+    std::lock_guard<std::mutex> guard(m_SendMutex);
+    if (reliable) {
+        m_PendingReliable.erase(sequence);
+    } else {
+        // If a newer command has superseded this one, it's still pending
+        for (auto it = m_PendingLatest.begin(); it != m_PendingLatest.end(); ++it) {
+            if (it->second.sequence == sequence) {
+                m_PendingLatest.erase(it);
+                break;
+            }
+        }
+    }
+
+    if (isFlushed()) {
+        m_FlushedCondition.notify_all();
+    }
+}
+
+bool
+DatagramChannel::isNewReliable(uint32_t sequence)
+{
+    /*
+     * The sender never gives up on a reliable datagram, so everything before
+     * m_NextReliable has been delivered and we only need to remember which
+     * datagrams after it have arrived early
+     */
+    const auto ahead = static_cast<int32_t>(sequence - m_NextReliable);
+    if (ahead < 0) {
+        return false;
+    }
+    if (ahead > 0) {
+        return m_ReliableAhead.insert(sequence).second;
+    }
+
+    // Catch up with any datagrams which arrived before this one
+    m_NextReliable++;
+    for (auto it = m_ReliableAhead.find(m_NextReliable); it != m_ReliableAhead.end();
+         it = m_ReliableAhead.find(m_NextReliable)) {
+        m_ReliableAhead.erase(it);
+        m_NextReliable++;
+    }
+    return true;
+}
+
+void
+DatagramChannel::retransmit()
+{
+    const auto now = std::chrono::steady_clock::now();
+    const auto retransmitPending = [this, now](auto &pending) {
+        for (auto &entry : pending) {
+            auto &datagram = entry.second;
+            if (now - datagram.lastSent < RetransmitInterval) {
+                continue;
+            }
+
+            transmit(datagram.data.data(), datagram.data.size());
+            datagram.lastSent = now;
+            if (++datagram.transmissions == WarnTransmissions) {
+                LOG_WARNING << "Datagram " << datagram.sequence
+                            << " still hasn't been acknowledged; retrying until it is";
+            }
+        }
+    };
+
+    /*
+     * Giving up on a datagram could lose e.g. a final stop or a control
+     * command, so we keep going until the channel is closed
+     */
+    std::lock_guard<std::mutex> guard(m_SendMutex);
+    retransmitPending(m_PendingLatest);
+    retransmitPending(m_PendingReliable);
+    if (isFlushed()) {
+        m_FlushedCondition.notify_all();
+    }
+}
+
+void
+DatagramChannel::transmit(const void *data, size_t length)
+{
+    const auto ret = ::send(m_Socket.getHandle(),
+                            reinterpret_cast<sendbuff_t>(data),
+                            static_cast<bufflen_t>(length),
+                            OS::Net::sendFlags);
+
+    // Lost datagrams are retransmitted anyway, so there's no need to make a fuss
+    if (ret == -1) {
+        LOG_DEBUG << "Could not send datagram: " << OS::Net::errorMessage();
+    }
+}
+
+bool
+DatagramChannel::isFlushed() const
+{
+    return m_PendingLatest.empty() && m_PendingReliable.empty();
+}
+
+} // Net
+} // BoBRobotics
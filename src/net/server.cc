@@ -44,7 +44,7 @@ Server::waitForConnection() const
     // Wait for incoming TCP connection
     LOG_INFO << "Waiting for incoming connection...";
     Socket socket(accept(m_ListenSocket.getHandle(), (sockaddr *) &addr, &addrlen));
-    socket.send("HEY\n");
+    socket.send("HEY BIN UDP\n");
 
     // Convert IP to string
     char saddr[INET_ADDRSTRLEN];
@@ -1,7 +1,13 @@
 // BoB robotics includes
 #include "common/logging.h"
+#include "common/macros.h"
 #include "net/socket.h"
 
+// POSIX includes
+#ifndef _WIN32
+#include <sys/uio.h>
+#endif
+
 namespace BoBRobotics {
 namespace Net {
 
@@ -13,6 +19,8 @@ BadCommandError::BadCommandError()
   : std::runtime_error("Bad command received")
 {}
 
+constexpr size_t Socket::MaxBuffers;
+
 
 Socket::Socket(const socket_t handle)
     : m_Handle(handle)
@@ -73,6 +81,52 @@ void Socket::send(const std::string &msg)
     LOG_VERBOSE << ">>> " << msg;
 }
 
+void Socket::send(const ConstBuffer *buffers, size_t numBuffers)
+{
+    BOB_ASSERT(numBuffers <= MaxBuffers);
+
+#ifdef _WIN32
+    WSABUF wsaBuffers[MaxBuffers];
+    for (size_t i = 0; i < numBuffers; i++) {
+        wsaBuffers[i].buf = const_cast<char *>(reinterpret_cast<const char *>(buffers[i].data));
+        wsaBuffers[i].len = static_cast<ULONG>(buffers[i].size);
+    }
+
+    // For blocking sockets, WSASend only returns once everything is sent
+    DWORD bytesSent;
+    if (WSASend(m_Handle, wsaBuffers, static_cast<DWORD>(numBuffers), &bytesSent, 0, nullptr, nullptr) != 0) {
+        throwError("Could not send");
+    }
+#else
+    iovec vectors[MaxBuffers];
+    for (size_t i = 0; i < numBuffers; i++) {
+        vectors[i].iov_base = const_cast<void *>(buffers[i].data);
+        vectors[i].iov_len = buffers[i].size;
+    }
+
+    msghdr message{};
+    message.msg_iov = vectors;
+    message.msg_iovlen = numBuffers;
+    while (message.msg_iovlen > 0) {
+        auto ret = sendmsg(m_Handle, &message, OS::Net::sendFlags);
+        if (ret == -1) {
+            throwError("Could not send");
+        }
+
+        // If not everything was sent, skip over what was and try again
+        while (message.msg_iovlen > 0 && static_cast<size_t>(ret) >= message.msg_iov->iov_len) {
+            ret -= message.msg_iov->iov_len;
+            message.msg_iov++;
+            message.msg_iovlen--;
+        }
+        if (message.msg_iovlen > 0) {
+            message.msg_iov->iov_base = static_cast<char *>(message.msg_iov->iov_base) + ret;
+            message.msg_iov->iov_len -= ret;
+        }
+    }
+#endif
+}
+
 Socket::Socket(Socket &&old)
     : m_Handle(old.m_Handle.load())
 {
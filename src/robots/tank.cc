@@ -87,6 +87,12 @@ void Tank::readFromNetwork(Net::Connection &connection)
                                         onCommandReceived(connection, command);
                                     });
 
+    // ...and their binary equivalent
+    connection.setMessageHandler(Net::Opcode::Tank,
+                                    [this](Net::Connection &, const Net::Message &message) {
+                                        tank(message.get<float>(0), message.get<float>(sizeof(float)));
+                                    });
+
     connection.setCommandHandler("TNK_MAX",
                                     [this](Net::Connection &, const Net::Command &command) {
                                         Tank::setMaximumSpeedProportion(stof(command.at(1)));
@@ -101,6 +107,7 @@ void Tank::stopReadingFromNetwork()
     if (m_Connection) {
         // Ignore incoming TNK commands
         m_Connection->setCommandHandler("TNK", nullptr);
+        m_Connection->setMessageHandler(Net::Opcode::Tank, nullptr);
     }
 }
 
@@ -8,7 +8,7 @@ namespace BoBRobotics {
 namespace Robots {
 
 BundledTankNetSink::BundledTankNetSink()
-  : TankNetSinkBase<Net::Client>()
+  : TankNetSinkBase<Net::Client>(Net::Client::getDefaultIP(), static_cast<uint16_t>(Net::Connection::DefaultListenPort), true, true)
 {
     // Run client on background thread
     getConnection().runInBackground();
@@ -39,11 +39,11 @@ TankNetSinkBase<ConnectionType>::setMaximumSpeedProportion(float value)
     if (value != getMaximumSpeedProportion()) {
         Tank::setMaximumSpeedProportion(value);
 
-        m_Connection.getSocketWriter().send("TNK_MAX " + std::to_string(value) + "\n");
+        m_Connection.sendDatagram("TNK_MAX " + std::to_string(value), Net::Delivery::Reliable);
     }
 }
 
-//! Motor command: send TNK command over TCP
+//! Motor command: send TNK command over UDP if possible, otherwise TCP
 template<class ConnectionType>
 void
 TankNetSinkBase<ConnectionType>::tank(float left, float right)
@@ -60,9 +60,22 @@ TankNetSinkBase<ConnectionType>::tank(float left, float right)
     Stopwatch netTimer;
     netTimer.start();
 
-    // send steering command
-    m_Connection.getSocketWriter().send("TNK " + std::to_string(left) + " " +
-                                        std::to_string(right) + "\n");
+    /*
+     * send steering command: only the latest one matters, so don't let lost
+     * packets hold it up. It's retransmitted until acknowledged or superseded
+     * (and the Connection waits for this before closing), so a stop still
+     * gets through.
+     */
+    if (m_Connection.hasDatagrams()) {
+        m_Connection.sendDatagram("TNK " + std::to_string(left) + " " + std::to_string(right));
+    } else {
+        auto socket = m_Connection.getSocketWriter();
+        if (socket.isBinary()) {
+            socket.sendValues(Net::Opcode::Tank, left, right);
+        } else {
+            socket.send("TNK " + std::to_string(left) + " " + std::to_string(right) + "\n");
+        }
+    }
 
     // print warning if steering command was slow to send
     using namespace std::literals;
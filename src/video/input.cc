@@ -35,7 +35,17 @@ bool
 Input::readGreyscaleFrame(cv::Mat &outFrame)
 {
     // If reading (colour frame) was successful
-    if (readFrame(m_IntermediateFrame)) {
+    if (readFrameShared(m_IntermediateFrame)) {
+        /*
+         * Some sources (e.g. NetSource) may give us greyscale frames already,
+         * in which case we can hand the frame over without copying it
+         */
+        if (m_IntermediateFrame.type() == CV_8UC1) {
+            outFrame = m_IntermediateFrame;
+            m_IntermediateFrame.release();
+            return true;
+        }
+
         // Make sure frame is of right size and type
         outFrame.create(m_IntermediateFrame.size(), CV_8UC1);
 
@@ -47,6 +57,12 @@ Input::readGreyscaleFrame(cv::Mat &outFrame)
     }
 }
 
+bool
+Input::readFrameShared(cv::Mat &outFrame)
+{
+    return readFrame(outFrame);
+}
+
 bool
 Input::needsUnwrapping() const
 {
@@ -56,12 +72,33 @@ Input::needsUnwrapping() const
 
 BOB_NOT_IMPLEMENTED(void Input::setOutputSize(const cv::Size &))
 
-void
+bool
 Input::readFrameSync(cv::Mat &outFrame)
 {
     while (!readFrame(outFrame)) {
-        std::this_thread::sleep_for(10ms);
+        if (!waitForNewFrame()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool
+Input::readGreyscaleFrameSync(cv::Mat &outFrame)
+{
+    while (!readGreyscaleFrame(outFrame)) {
+        if (!waitForNewFrame()) {
+            return false;
+        }
     }
+    return true;
+}
+
+bool
+Input::waitForNewFrame()
+{
+    std::this_thread::sleep_for(10ms);
+    return true;
 }
 
 void
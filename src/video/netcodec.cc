@@ -0,0 +1,196 @@
+// BoB robotics includes
+#include "common/macros.h"
+#include "video/netcodec.h"
+
+// Standard C++ includes
+#include <algorithm>
+#include <cctype>
+#include <stdexcept>
+
+namespace {
+// Get a greyscale version of frame, only converting if necessary
+const cv::Mat &
+toGreyscale(const cv::Mat &frame, cv::Mat &greyscale)
+{
+    switch (frame.channels()) {
+    case 1:
+        return frame;
+    case 3:
+        cv::cvtColor(frame, greyscale, cv::COLOR_BGR2GRAY);
+        return greyscale;
+    case 4:
+        cv::cvtColor(frame, greyscale, cv::COLOR_BGRA2GRAY);
+        return greyscale;
+    default:
+        throw std::invalid_argument("Unsupported number of channels");
+    }
+}
+
+// out = a - b, wrapping around rather than saturating, so it can be undone exactly
+void
+subtractWrapped(const cv::Mat &a, const cv::Mat &b, cv::Mat &out)
+{
+    out.create(a.size(), CV_8UC1);
+    for (int y = 0; y < a.rows; y++) {
+        const uint8_t *aRow = a.ptr(y);
+        const uint8_t *bRow = b.ptr(y);
+        uint8_t *outRow = out.ptr(y);
+        for (int x = 0; x < a.cols; x++) {
+            outRow[x] = static_cast<uint8_t>(aRow[x] - bRow[x]);
+        }
+    }
+}
+
+// a += b, wrapping around
+void
+addWrapped(cv::Mat &a, const cv::Mat &b)
+{
+    for (int y = 0; y < a.rows; y++) {
+        uint8_t *aRow = a.ptr(y);
+        const uint8_t *bRow = b.ptr(y);
+        for (int x = 0; x < a.cols; x++) {
+            aRow[x] = static_cast<uint8_t>(aRow[x] + bRow[x]);
+        }
+    }
+}
+
+void
+copyRaw(const cv::Mat &frame, std::vector<uint8_t> &buffer)
+{
+    const size_t rowBytes = static_cast<size_t>(frame.cols) * frame.elemSize();
+    buffer.resize(rowBytes * frame.rows);
+    for (int y = 0; y < frame.rows; y++) {
+        std::copy_n(frame.ptr(y), rowBytes, &buffer[y * rowBytes]);
+    }
+}
+} // anonymous namespace
+
+namespace BoBRobotics {
+namespace Video {
+
+NetCodec
+parseNetCodec(const std::string &name)
+{
+    std::string lower = name;
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) {
+        return static_cast<char>(std::tolower(c));
+    });
+
+    if (lower == "jpeg" || lower == "jpg") {
+        return NetCodec::JPEG;
+    } else if (lower == "png") {
+        return NetCodec::PNG;
+    } else if (lower == "raw") {
+        return NetCodec::RawGreyscale;
+    } else if (lower == "delta") {
+        return NetCodec::DeltaGreyscale;
+    } else {
+        throw std::invalid_argument("Unknown codec: " + name);
+    }
+}
+
+//----------------------------------------------------------------------------
+// NetEncoder
+//----------------------------------------------------------------------------
+NetEncoder::NetEncoder(NetCodec codec, int quality)
+  : m_Codec(codec)
+{
+    switch (codec) {
+    case NetCodec::JPEG:
+        m_Params = { cv::IMWRITE_JPEG_QUALITY, (quality < 0) ? 95 : quality };
+        break;
+    case NetCodec::PNG:
+    case NetCodec::DeltaGreyscale:
+        // Favour speed over size by default
+        m_Params = { cv::IMWRITE_PNG_COMPRESSION, (quality < 0) ? 1 : quality };
+        break;
+    case NetCodec::RawGreyscale:
+        break;
+    default:
+        throw std::invalid_argument("Unknown codec");
+    }
+}
+
+bool
+NetEncoder::encode(const cv::Mat &frame, std::vector<uint8_t> &buffer)
+{
+    switch (m_Codec) {
+    case NetCodec::JPEG:
+        BOB_ASSERT(cv::imencode(".jpg", frame, buffer, m_Params));
+        return true;
+    case NetCodec::PNG:
+        BOB_ASSERT(cv::imencode(".png", frame, buffer, m_Params));
+        return true;
+    case NetCodec::RawGreyscale:
+        copyRaw(toGreyscale(frame, m_Greyscale), buffer);
+        return true;
+    case NetCodec::DeltaGreyscale: {
+        const cv::Mat &greyscale = toGreyscale(frame, m_Greyscale);
+        const bool keyFrame = m_Previous.empty() || m_Previous.size() != greyscale.size();
+        if (keyFrame) {
+            BOB_ASSERT(cv::imencode(".png", greyscale, buffer, m_Params));
+        } else {
+            subtractWrapped(greyscale, m_Previous, m_Delta);
+            BOB_ASSERT(cv::imencode(".png", m_Delta, buffer, m_Params));
+        }
+
+        // Frame may belong to the caller, so take a copy
+        greyscale.copyTo(m_Previous);
+        return keyFrame;
+    }
+    default:
+        throw std::invalid_argument("Unknown codec");
+    }
+}
+
+void
+NetEncoder::reset()
+{
+    m_Previous.release();
+}
+
+NetCodec
+NetEncoder::getCodec() const
+{
+    return m_Codec;
+}
+
+//----------------------------------------------------------------------------
+// NetDecoder
+//----------------------------------------------------------------------------
+void
+NetDecoder::decode(NetCodec codec, bool keyFrame, const cv::Size &size,
+                   const uint8_t *data, size_t sizeBytes, cv::Mat &frame)
+{
+    // Wrap data in a header so it isn't copied
+    const cv::Mat encoded(1, static_cast<int>(sizeBytes), CV_8UC1, const_cast<uint8_t *>(data));
+
+    switch (codec) {
+    case NetCodec::JPEG:
+    case NetCodec::PNG:
+        cv::imdecode(encoded, cv::IMREAD_UNCHANGED, &frame);
+        break;
+    case NetCodec::RawGreyscale:
+        BOB_ASSERT(sizeBytes == static_cast<size_t>(size.area()));
+        cv::Mat(size, CV_8UC1, const_cast<uint8_t *>(data)).copyTo(frame);
+        break;
+    case NetCodec::DeltaGreyscale:
+        if (keyFrame) {
+            m_Previous = cv::imdecode(encoded, cv::IMREAD_GRAYSCALE);
+        } else {
+            // We can't decode a delta without the frame it's relative to
+            BOB_ASSERT(m_Previous.size() == size);
+            addWrapped(m_Previous, cv::imdecode(encoded, cv::IMREAD_GRAYSCALE));
+        }
+        BOB_ASSERT(m_Previous.size() == size);
+
+        // Keep our own copy of the frame for decoding the next delta
+        m_Previous.copyTo(frame);
+        break;
+    default:
+        throw std::invalid_argument("Unknown codec");
+    }
+}
+
+} // Video
+} // BoBRobotics
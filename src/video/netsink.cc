@@ -4,8 +4,10 @@
 #include "video/netsink.h"
 
 // Standard C++ includes
+#include <algorithm>
 #include <chrono>
 #include <stdexcept>
+#include <utility>
 
 using namespace std::literals;
 
@@ -17,11 +19,12 @@ NetSink::NetSink(Net::Connection &connection, Input &input)
     , m_Name(input.getCameraName())
     , m_FrameSize(input.getOutputSize())
     , m_Input(&input)
+    , m_Encoder(std::make_unique<NetEncoder>())
 {
     // handle incoming IMG commands
     m_Connection.setCommandHandler("IMG",
                                     [this](Net::Connection &, const Net::Command &command) {
-                                        onCommandReceivedAsync(command);
+                                        onCommandReceived(command);
                                     });
 }
 
@@ -30,11 +33,12 @@ NetSink::NetSink(Net::Connection &connection, const cv::Size &frameSize, const s
     , m_Name(cameraName)
     , m_FrameSize(frameSize)
     , m_Input(nullptr)
+    , m_Encoder(std::make_unique<NetEncoder>())
 {
     // handle incoming IMG commands
     m_Connection.setCommandHandler("IMG",
                                     [this](Net::Connection &, const Net::Command &command) {
-                                        onCommandReceivedSync(command);
+                                        onCommandReceived(command);
                                     });
 }
 
@@ -45,10 +49,17 @@ NetSink::~NetSink()
     // Ignore IMG commands
     m_Connection.setCommandHandler("IMG", nullptr);
 
-    m_DoRun = false;
+    {
+        std::lock_guard<std::mutex> guard(m_PipelineMutex);
+        m_DoRun = false;
+    }
+    m_PipelineCondition.notify_all();
     if (m_Thread.joinable()) {
         m_Thread.join();
     }
+    if (m_EncoderThread.joinable()) {
+        m_EncoderThread.join();
+    }
 
     LOG_DEBUG << "Video::NetSink stopped";
 }
@@ -62,46 +73,120 @@ void NetSink::sendFrame(const cv::Mat &frame)
     // Wait for start acknowledgement
     m_AckSemaphore.waitOnce();
 
-    sendFrameInternal(frame);
+    // Wait for encoder to pick up previous frame
+    std::unique_lock<std::mutex> lock(m_PipelineMutex);
+    m_PipelineCondition.wait(lock, [this]() { return !m_HasPendingFrame || !m_DoRun; });
+
+    frame.copyTo(m_PendingFrame);
+    m_PendingTime = std::chrono::steady_clock::now();
+    m_HasPendingFrame = true;
+    lock.unlock();
+    m_PipelineCondition.notify_all();
+}
+
+void NetSink::setCodec(NetCodec codec, int quality)
+{
+    // The encoder thread will pick this up before encoding the next frame
+    std::lock_guard<std::mutex> guard(m_PipelineMutex);
+    m_NextEncoder = std::make_unique<NetEncoder>(codec, quality);
+}
+
+std::chrono::microseconds NetSink::getLatency() const
+{
+    return std::chrono::microseconds(m_LatencyMicroseconds.load());
 }
 
-void NetSink::sendFrameInternal(const cv::Mat &frame)
+//----------------------------------------------------------------------------
+// Private methods
+//----------------------------------------------------------------------------
+void NetSink::encodeAndSend(const cv::Mat &frame, uint32_t id, bool streaming)
 {
-    cv::imencode(".jpg", frame, m_Buffer);
+    if (!streaming) {
+        // The NetSource only understands JPEGs
+        cv::imencode(".jpg", frame, m_Buffer);
+
+        auto socket = m_Connection.getSocketWriter();
+        socket.send("IMG FRAME " + std::to_string(m_Buffer.size()) + "\n");
+        socket.send(m_Buffer.data(), m_Buffer.size());
+        return;
+    }
+
+    const NetCodec codec = m_Encoder->getCodec();
+    const bool keyFrame = m_Encoder->encode(frame, m_Buffer);
 
     auto socket = m_Connection.getSocketWriter();
-    socket.send("IMG FRAME " + std::to_string(m_Buffer.size()) + "\n");
-    socket.send(m_Buffer.data(), m_Buffer.size());
+    if (socket.isBinary()) {
+        const NetFrameHeader header{ id, static_cast<uint16_t>(codec), keyFrame,
+                                     static_cast<uint32_t>(frame.cols), static_cast<uint32_t>(frame.rows) };
+        socket.sendMessage(Net::Opcode::Image, { { &header, sizeof(header) }, { m_Buffer.data(), m_Buffer.size() } });
+    } else {
+        socket.send("IMG DATA " + std::to_string(id) + " " + std::to_string(static_cast<uint16_t>(codec)) + " " +
+                    std::to_string(keyFrame) + " " + std::to_string(frame.cols) + " " +
+                    std::to_string(frame.rows) + " " + std::to_string(m_Buffer.size()) + "\n");
+        socket.send(m_Buffer.data(), m_Buffer.size());
+    }
 }
 
 void NetSink::onCommandReceived(const Net::Command &command)
 {
+    if (command.size() < 2) {
+        throw Net::BadCommandError();
+    }
+    if (command[1] == "ACK") {
+        onAckReceived(command);
+        return;
+    }
     if (command[1] != "START") {
         throw Net::BadCommandError();
     }
 
-    // ACK the command and tell client the camera resolution
+    // Newer NetSources ask to stream frames, saying how many can be in flight at once
+    {
+        std::lock_guard<std::mutex> guard(m_PipelineMutex);
+        if (command.size() >= 4 && command[2] == "STREAM") {
+            m_Streaming = true;
+            m_Window = std::max<size_t>(1, std::stoul(command[3]));
+        }
+    }
+
+    // ACK the command and tell client the camera resolution (and that we can stream)
     m_Connection.getSocketWriter().send("IMG PARAMS " + std::to_string(m_FrameSize.width) + " " +
                                     std::to_string(m_FrameSize.height) + " " +
-                                    m_Name + "\n");
-}
+                                    m_Name + " STREAM\n");
 
-void NetSink::onCommandReceivedAsync(const Net::Command &command)
-{
-    // Handle command
-    onCommandReceived(command);
+    // start threads to capture and transmit images in background
+    if (!m_EncoderThread.joinable()) {
+        m_EncoderThread = std::thread(&NetSink::runEncoder, this);
+    }
+    if (m_Input && !m_Thread.joinable()) {
+        m_Thread = std::thread(&NetSink::runAsync, this);
+    }
 
-    // start thread to transmit images in background
-    m_Thread = std::thread(&NetSink::runAsync, this);
+    // Raise semaphore
+    m_AckSemaphore.notify();
 }
 
-void NetSink::onCommandReceivedSync(const Net::Command &command)
+void NetSink::onAckReceived(const Net::Command &command)
 {
-    // Handle command
-    onCommandReceived(command);
+    if (command.size() != 3) {
+        throw Net::BadCommandError();
+    }
 
-    // Raise semaphore
-    m_AckSemaphore.notify();
+    const auto id = static_cast<uint32_t>(std::stoul(command[2]));
+    const auto now = std::chrono::steady_clock::now();
+    {
+        // Frames are acknowledged in order, so anything before this one has been too
+        std::lock_guard<std::mutex> guard(m_PipelineMutex);
+        while (!m_FramesInFlight.empty() && m_FramesInFlight.front().first != id) {
+            m_FramesInFlight.pop_front();
+        }
+        if (!m_FramesInFlight.empty()) {
+            const auto latency = now - m_FramesInFlight.front().second;
+            m_LatencyMicroseconds = std::chrono::duration_cast<std::chrono::microseconds>(latency).count();
+            m_FramesInFlight.pop_front();
+        }
+    }
+    m_PipelineCondition.notify_all();
 }
 
 void NetSink::runAsync()
@@ -110,7 +195,19 @@ void NetSink::runAsync()
         cv::Mat frame;
         while (m_DoRun) {
             if (m_Input->readFrame(frame)) {
-                sendFrameInternal(frame);
+                const auto now = std::chrono::steady_clock::now();
+                {
+                    /*
+                     * Replace whatever frame is waiting to be encoded, so we
+                     * always send the freshest one. We swap, so the stale
+                     * frame's memory is reused for reading the next one.
+                     */
+                    std::lock_guard<std::mutex> guard(m_PipelineMutex);
+                    std::swap(m_PendingFrame, frame);
+                    m_PendingTime = now;
+                    m_HasPendingFrame = true;
+                }
+                m_PipelineCondition.notify_all();
             } else {
                 std::this_thread::sleep_for(25ms);
             }
@@ -120,5 +217,44 @@ void NetSink::runAsync()
     }
 }
 
+void NetSink::runEncoder()
+{
+    try {
+        cv::Mat frame;
+        while (true) {
+            uint32_t id;
+            bool streaming;
+            {
+                // Wait for a frame and, if streaming, for there to be room in the window
+                std::unique_lock<std::mutex> lock(m_PipelineMutex);
+                m_PipelineCondition.wait(lock, [this]() {
+                    return !m_DoRun || (m_HasPendingFrame && (!m_Streaming || m_FramesInFlight.size() < m_Window));
+                });
+                if (!m_DoRun) {
+                    break;
+                }
+
+                std::swap(frame, m_PendingFrame);
+                m_HasPendingFrame = false;
+                streaming = m_Streaming;
+                id = m_NextFrameID++;
+                if (streaming) {
+                    m_FramesInFlight.emplace_back(id, m_PendingTime);
+                }
+                if (m_NextEncoder) {
+                    m_Encoder = std::move(m_NextEncoder);
+                }
+            }
+
+            // Let sendFrame() know the slot is free
+            m_PipelineCondition.notify_all();
+
+            encodeAndSend(frame, id, streaming);
+        }
+    } catch (...) {
+        BackgroundExceptionCatcher::set(std::current_exception());
+    }
+}
+
 } // Video
 } // BoBRobotics
@@ -1,10 +1,16 @@
 // BoB robotics includes
 #include "video/netsource.h"
 
+// Standard C++ includes
+#include <chrono>
+#include <utility>
+
+using namespace std::literals;
+
 namespace BoBRobotics {
 namespace Video {
 
-NetSource::NetSource(Net::Connection &connection)
+NetSource::NetSource(Net::Connection &connection, unsigned int maxFramesInFlight)
   : m_Connection(connection)
 {
     // Handle incoming IMG commands
@@ -12,14 +18,20 @@ NetSource::NetSource(Net::Connection &connection)
         onCommandReceived(connection, command);
     });
 
-    // When connected, send command to start streaming
-    connection.getSocketWriter().send("IMG START\n");
+    // ...and frames sent over the binary protocol
+    connection.setMessageHandler(Net::Opcode::Image, [this](Net::Connection &, const Net::Message &message) {
+        onMessageReceived(message);
+    });
+
+    // When connected, send command to start streaming (older NetSinks ignore the extra arguments)
+    connection.getSocketWriter().send("IMG START STREAM " + std::to_string(maxFramesInFlight) + "\n");
 }
 
 NetSource::~NetSource()
 {
     // Ignore IMG commands
     m_Connection.setCommandHandler("IMG", nullptr);
+    m_Connection.setMessageHandler(Net::Opcode::Image, nullptr);
 }
 
 std::string
@@ -58,6 +70,37 @@ NetSource::readFrame(cv::Mat &frame)
     }
 }
 
+bool
+NetSource::readFrameShared(cv::Mat &frame)
+{
+    if (!m_NewFrame.exchange(false)) {
+        return false;
+    } else {
+        std::lock_guard<std::mutex> guard(m_FrameMutex);
+
+        /*
+         * Hand over the decoded frame without copying it. We keep our
+         * reference, so onFrameReceived() can tell whether the caller still
+         * holds the buffer before decoding into it again.
+         */
+        frame = m_Frame;
+        return true;
+    }
+}
+
+bool
+NetSource::waitForNewFrame()
+{
+    // We aren't told when the connection closes, so check it every so often
+    std::unique_lock<std::mutex> lock(m_FrameMutex);
+    while (!m_NewFrameCondition.wait_for(lock, 100ms, [this]() { return m_NewFrame.load(); })) {
+        if (!m_Connection.isOpen()) {
+            return false;
+        }
+    }
+    return true;
+}
+
 void
 NetSource::onCommandReceived(Net::Connection &connection, const Net::Command &command)
 {
@@ -65,19 +108,73 @@ NetSource::onCommandReceived(Net::Connection &connection, const Net::Command &co
         m_CameraResolution.width = stoi(command[2]);
         m_CameraResolution.height = stoi(command[3]);
         m_CameraName = command[4];
+
+        // Newer NetSinks stream frames and want us to acknowledge them
+        m_SinkStreams = command.size() > 5 && command[5] == "STREAM";
         m_ParamsSemaphore.notify();
     } else if (command[1] == "FRAME") {
+        // Older NetSinks only send JPEGs
         const auto nbytes = static_cast<size_t>(stoul(command[2]));
         m_Buffer.resize(nbytes);
         connection.read(m_Buffer.data(), nbytes);
+        onFrameReceived(0, NetCodec::JPEG, true, {}, m_Buffer.data(), nbytes);
+    } else if (command[1] == "DATA") {
+        if (command.size() != 8) {
+            throw Net::BadCommandError();
+        }
 
-        std::lock_guard<std::mutex> guard(m_FrameMutex);
-        cv::imdecode(m_Buffer, cv::IMREAD_UNCHANGED, &m_Frame);
-        m_NewFrame = true;
+        const auto id = static_cast<uint32_t>(stoul(command[2]));
+        const auto codec = static_cast<NetCodec>(stoi(command[3]));
+        const bool keyFrame = stoi(command[4]) != 0;
+        const cv::Size size{ stoi(command[5]), stoi(command[6]) };
+        const auto nbytes = static_cast<size_t>(stoul(command[7]));
+        m_Buffer.resize(nbytes);
+        connection.read(m_Buffer.data(), nbytes);
+        onFrameReceived(id, codec, keyFrame, size, m_Buffer.data(), nbytes);
     } else {
         throw Net::BadCommandError();
     }
 }
 
+void
+NetSource::onMessageReceived(const Net::Message &message)
+{
+    const auto header = message.get<NetFrameHeader>();
+    const cv::Size size{ static_cast<int>(header.width), static_cast<int>(header.height) };
+    onFrameReceived(header.id, static_cast<NetCodec>(header.codec), header.keyFrame != 0, size,
+                    message.payload + sizeof(header), message.size - sizeof(header));
+}
+
+void
+NetSource::onFrameReceived(uint32_t id, NetCodec codec, bool keyFrame,
+                           const cv::Size &size, const uint8_t *data, size_t sizeBytes)
+{
+    /*
+     * m_Decoded holds the frame before last, which we can decode into again
+     * unless a reader still has it from readFrameShared(). Only readers can
+     * drop references to it, so this can't change under us.
+     */
+    if (m_Decoded.u && m_Decoded.u->refcount > 1) {
+        m_Decoded.release();
+    }
+
+    // Decode outside the lock, so readers aren't held up
+    m_Decoder.decode(codec, keyFrame, size, data, sizeBytes, m_Decoded);
+
+    {
+        std::lock_guard<std::mutex> guard(m_FrameMutex);
+
+        // Swap, so the latest frame can be read while we decode the next
+        std::swap(m_Frame, m_Decoded);
+        m_NewFrame = true;
+    }
+    m_NewFrameCondition.notify_all();
+
+    // Let the sink know it can send another frame
+    if (m_SinkStreams) {
+        m_Connection.getSocketWriter().send("IMG ACK " + std::to_string(id) + "\n");
+    }
+}
+
 } // Video
 } // BoBRobotics
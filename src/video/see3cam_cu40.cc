@@ -4,9 +4,257 @@
 #include "video/see3cam_cu40.h"
 
 // Standard C++
+#include <algorithm>
 #include <chrono>
 #include <numeric>
 #include <thread>
+#include <vector>
+
+// SIMD intrinsics
+#if defined(__SSE2__) || defined(_M_X64)
+#define BOB_BAYER_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define BOB_BAYER_NEON
+#include <arm_neon.h>
+#endif
+
+namespace {
+/*
+ * Each super-pixel is made from a 2x2 block of Bayer pixels:
+ *
+ *     B G
+ *     x R
+ *
+ * so, for super-pixel x, blue and green are at 2x and 2x + 1 in the first row
+ * and red is at 2x + 1 in the second. Values are 10-bit.
+ */
+struct Gains
+{
+    int shift;
+    uint16_t b, g, r;
+};
+
+// Fixed-point reciprocal of 12 (3 channels x 4 to go from 10 to 8 bits), exact for 10-bit sums
+constexpr uint16_t OneTwelfth = 5462;
+
+inline uint8_t
+applyGain(uint16_t v, int shift, uint16_t gain)
+{
+    const uint32_t scaled = (static_cast<uint32_t>(v << shift) * gain) >> 16;
+    return static_cast<uint8_t>(std::min<uint32_t>(scaled, 255));
+}
+
+//------------------------------------------------------------------------
+// Scalar kernels
+//------------------------------------------------------------------------
+void
+demosaicRowBGRScalar(const uint16_t *bg, const uint16_t *xr, const Gains &gains,
+                     uint8_t *out, size_t begin, size_t end)
+{
+    for (size_t x = begin; x < end; x++) {
+        *(out++) = applyGain(bg[2 * x], gains.shift, gains.b);
+        *(out++) = applyGain(bg[2 * x + 1], gains.shift, gains.g);
+        *(out++) = applyGain(xr[2 * x + 1], gains.shift, gains.r);
+    }
+}
+
+void
+sumRowScalar(const uint16_t *bg, const uint16_t *xr, uint16_t *out, size_t begin, size_t end)
+{
+    for (size_t x = begin; x < end; x++) {
+        out[x] = bg[2 * x] + bg[2 * x + 1] + xr[2 * x + 1];
+    }
+}
+
+void
+greyRowScalar(const uint16_t *bg, const uint16_t *xr, uint8_t *out, size_t begin, size_t end)
+{
+    for (size_t x = begin; x < end; x++) {
+        out[x] = static_cast<uint8_t>((bg[2 * x] + bg[2 * x + 1] + xr[2 * x + 1]) / (3 * 4));
+    }
+}
+
+#if defined(BOB_BAYER_SSE2)
+//------------------------------------------------------------------------
+// SSE2 kernels
+//------------------------------------------------------------------------
+// Load 8 super-pixels' worth of channels as 16-bit values
+inline void
+loadChannelsSSE2(const uint16_t *bg, const uint16_t *xr, __m128i &b, __m128i &g, __m128i &r)
+{
+    const __m128i bg0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(bg));
+    const __m128i bg1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(bg + 8));
+    const __m128i xr0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(xr));
+    const __m128i xr1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(xr + 8));
+
+    // Even elements are in the low half of each 32-bit lane and odd ones in the high half
+    b = _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(bg0, 16), 16), _mm_srai_epi32(_mm_slli_epi32(bg1, 16), 16));
+    g = _mm_packs_epi32(_mm_srai_epi32(bg0, 16), _mm_srai_epi32(bg1, 16));
+    r = _mm_packs_epi32(_mm_srai_epi32(xr0, 16), _mm_srai_epi32(xr1, 16));
+}
+
+void
+demosaicRowBGR(const uint16_t *bg, const uint16_t *xr, const Gains &gains,
+               uint8_t *out, size_t width)
+{
+    const __m128i shift = _mm_cvtsi32_si128(gains.shift);
+    const __m128i gainB = _mm_set1_epi16(static_cast<int16_t>(gains.b));
+    const __m128i gainG = _mm_set1_epi16(static_cast<int16_t>(gains.g));
+    const __m128i gainR = _mm_set1_epi16(static_cast<int16_t>(gains.r));
+
+    size_t x = 0;
+    for (; (x + 16) <= width; x += 16) {
+        __m128i b[2], g[2], r[2];
+        for (size_t i = 0; i < 2; i++) {
+            loadChannelsSSE2(&bg[2 * (x + 8 * i)], &xr[2 * (x + 8 * i)], b[i], g[i], r[i]);
+            b[i] = _mm_mulhi_epu16(_mm_sll_epi16(b[i], shift), gainB);
+            g[i] = _mm_mulhi_epu16(_mm_sll_epi16(g[i], shift), gainG);
+            r[i] = _mm_mulhi_epu16(_mm_sll_epi16(r[i], shift), gainR);
+        }
+
+        // Saturate to 8 bits
+        alignas(16) uint8_t planes[3][16];
+        _mm_store_si128(reinterpret_cast<__m128i *>(planes[0]), _mm_packus_epi16(b[0], b[1]));
+        _mm_store_si128(reinterpret_cast<__m128i *>(planes[1]), _mm_packus_epi16(g[0], g[1]));
+        _mm_store_si128(reinterpret_cast<__m128i *>(planes[2]), _mm_packus_epi16(r[0], r[1]));
+
+        // SSE2 has no byte shuffle, so interleave into BGR from the stack
+        uint8_t *outPixels = &out[3 * x];
+        for (size_t i = 0; i < 16; i++) {
+            *(outPixels++) = planes[0][i];
+            *(outPixels++) = planes[1][i];
+            *(outPixels++) = planes[2][i];
+        }
+    }
+
+    // Handle remaining super-pixels
+    demosaicRowBGRScalar(bg, xr, gains, &out[3 * x], x, width);
+}
+
+void
+sumRow(const uint16_t *bg, const uint16_t *xr, uint16_t *out, size_t width)
+{
+    size_t x = 0;
+    for (; (x + 8) <= width; x += 8) {
+        __m128i b, g, r;
+        loadChannelsSSE2(&bg[2 * x], &xr[2 * x], b, g, r);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(&out[x]), _mm_add_epi16(_mm_add_epi16(b, g), r));
+    }
+
+    // Handle remaining super-pixels
+    sumRowScalar(bg, xr, out, x, width);
+}
+
+void
+greyRow(const uint16_t *bg, const uint16_t *xr, uint8_t *out, size_t width)
+{
+    const __m128i oneTwelfth = _mm_set1_epi16(static_cast<int16_t>(OneTwelfth));
+
+    size_t x = 0;
+    for (; (x + 16) <= width; x += 16) {
+        __m128i grey[2];
+        for (size_t i = 0; i < 2; i++) {
+            __m128i b, g, r;
+            loadChannelsSSE2(&bg[2 * (x + 8 * i)], &xr[2 * (x + 8 * i)], b, g, r);
+            grey[i] = _mm_mulhi_epu16(_mm_add_epi16(_mm_add_epi16(b, g), r), oneTwelfth);
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(&out[x]), _mm_packus_epi16(grey[0], grey[1]));
+    }
+
+    // Handle remaining super-pixels
+    greyRowScalar(bg, xr, out, x, width);
+}
+#elif defined(BOB_BAYER_NEON)
+//------------------------------------------------------------------------
+// NEON kernels
+//------------------------------------------------------------------------
+// Multiply 16-bit values and keep the high 16 bits of the results
+inline uint16x8_t
+mulhiNEON(uint16x8_t v, uint16x4_t gain)
+{
+    return vcombine_u16(vshrn_n_u32(vmull_u16(vget_low_u16(v), gain), 16),
+                        vshrn_n_u32(vmull_u16(vget_high_u16(v), gain), 16));
+}
+
+void
+demosaicRowBGR(const uint16_t *bg, const uint16_t *xr, const Gains &gains,
+               uint8_t *out, size_t width)
+{
+    const int16x8_t shift = vdupq_n_s16(static_cast<int16_t>(gains.shift));
+    const uint16x4_t gainB = vdup_n_u16(gains.b);
+    const uint16x4_t gainG = vdup_n_u16(gains.g);
+    const uint16x4_t gainR = vdup_n_u16(gains.r);
+
+    size_t x = 0;
+    for (; (x + 8) <= width; x += 8) {
+        // De-interleave while loading
+        const uint16x8x2_t bgPixels = vld2q_u16(&bg[2 * x]);
+        const uint16x8x2_t xrPixels = vld2q_u16(&xr[2 * x]);
+
+        // Scale, saturate to 8 bits and store interleaved
+        uint8x8x3_t bgr;
+        bgr.val[0] = vqmovn_u16(mulhiNEON(vshlq_u16(bgPixels.val[0], shift), gainB));
+        bgr.val[1] = vqmovn_u16(mulhiNEON(vshlq_u16(bgPixels.val[1], shift), gainG));
+        bgr.val[2] = vqmovn_u16(mulhiNEON(vshlq_u16(xrPixels.val[1], shift), gainR));
+        vst3_u8(&out[3 * x], bgr);
+    }
+
+    // Handle remaining super-pixels
+    demosaicRowBGRScalar(bg, xr, gains, &out[3 * x], x, width);
+}
+
+void
+sumRow(const uint16_t *bg, const uint16_t *xr, uint16_t *out, size_t width)
+{
+    size_t x = 0;
+    for (; (x + 8) <= width; x += 8) {
+        const uint16x8x2_t bgPixels = vld2q_u16(&bg[2 * x]);
+        const uint16x8x2_t xrPixels = vld2q_u16(&xr[2 * x]);
+        vst1q_u16(&out[x], vaddq_u16(vaddq_u16(bgPixels.val[0], bgPixels.val[1]), xrPixels.val[1]));
+    }
+
+    // Handle remaining super-pixels
+    sumRowScalar(bg, xr, out, x, width);
+}
+
+void
+greyRow(const uint16_t *bg, const uint16_t *xr, uint8_t *out, size_t width)
+{
+    const uint16x4_t oneTwelfth = vdup_n_u16(OneTwelfth);
+
+    size_t x = 0;
+    for (; (x + 8) <= width; x += 8) {
+        const uint16x8x2_t bgPixels = vld2q_u16(&bg[2 * x]);
+        const uint16x8x2_t xrPixels = vld2q_u16(&xr[2 * x]);
+        const uint16x8_t sum = vaddq_u16(vaddq_u16(bgPixels.val[0], bgPixels.val[1]), xrPixels.val[1]);
+        vst1_u8(&out[x], vqmovn_u16(mulhiNEON(sum, oneTwelfth)));
+    }
+
+    // Handle remaining super-pixels
+    greyRowScalar(bg, xr, out, x, width);
+}
+#else
+void
+demosaicRowBGR(const uint16_t *bg, const uint16_t *xr, const Gains &gains,
+               uint8_t *out, size_t width)
+{
+    demosaicRowBGRScalar(bg, xr, gains, out, 0, width);
+}
+
+void
+sumRow(const uint16_t *bg, const uint16_t *xr, uint16_t *out, size_t width)
+{
+    sumRowScalar(bg, xr, out, 0, width);
+}
+
+void
+greyRow(const uint16_t *bg, const uint16_t *xr, uint8_t *out, size_t width)
+{
+    greyRowScalar(bg, xr, out, 0, width);
+}
+#endif
+} // anonymous namespace
 
 namespace BoBRobotics {
 namespace Video {
@@ -29,19 +277,17 @@ See3CAM_CU40::getCameraName() const
 bool
 See3CAM_CU40::readFrame(cv::Mat &outFrame)
 {
-    // Try to read from camera and throw error if it fails
+    // Try to read from camera; returns false if there is no new frame yet
     outFrame.create(getSuperPixelSize(), CV_8UC3);
-    captureSuperPixelWBU30(outFrame);
-    return true;
+    return captureSuperPixelWBU30(outFrame);
 }
 
 bool
 See3CAM_CU40::readGreyscaleFrame(cv::Mat &outFrame)
 {
-    // Try to read from camera and throw error if it fails
+    // Try to read from camera; returns false if there is no new frame yet
     outFrame.create(getSuperPixelSize(), CV_8UC1);
-    captureSuperPixelGreyscale(outFrame);
-    return true;
+    return captureSuperPixelGreyscale(outFrame);
 }
 
 cv::Size
@@ -75,72 +321,96 @@ See3CAM_CU40::open(const std::string &device,
     }
 }
 
-void
+bool
 See3CAM_CU40::captureSuperPixel(cv::Mat &output)
 {
-    captureSuperPixel<PixelScale>(output);
+    // Divide by 4 to convert 10-bit to 8-bit
+    return captureSuperPixel(output, 0, 16384, 16384, 16384);
 }
 
-void
+bool
 See3CAM_CU40::captureSuperPixelClamp(cv::Mat &output)
 {
-    captureSuperPixel<PixelClamp>(output);
+    // Clamp 10-bit values at 255
+    // **NOTE** this is dubious but a)Is what the qtcam example does and b)Can
+    // LOOK nicer than scaling
+    return captureSuperPixel(output, 6, 1024, 1024, 1024);
 }
 
-void
+bool
 See3CAM_CU40::captureSuperPixelWBCoolWhite(cv::Mat &output)
 {
-    captureSuperPixel<WhiteBalanceCoolWhite>(output);
+    // Blue: 1.74 (28508), green: 1, red: 0.96 (15729), all divided by 4
+    return captureSuperPixel(output, 0, 28508, 16384, 15729);
 }
 
-void
+bool
 See3CAM_CU40::captureSuperPixelWBU30(cv::Mat &output)
 {
-    captureSuperPixel<WhiteBalanceU30>(output);
+    // Blue: 1.53 (25068), green: 1, red: 0.92 (15073), all divided by 4
+    return captureSuperPixel(output, 0, 25068, 16384, 15073);
 }
 
-void
-See3CAM_CU40::captureSuperPixelGreyscale(cv::Mat &output)
+bool
+See3CAM_CU40::captureSuperPixelGreyscale(cv::Mat &output, unsigned int downsample)
 {
+    BOB_ASSERT(downsample > 0);
+
     // Check that output size is suitable for super-pixel output i.e. a
-    // quarter input size
+    // quarter input size, further shrunk by downsample
     const unsigned int inputWidth = getWidth();
-    const unsigned int inputHeight = getHeight();
-    BOB_ASSERT(output.cols == (int) inputWidth / 2);
-    BOB_ASSERT(output.rows == (int) inputHeight / 2);
+    const unsigned int superPixelWidth = getSuperPixelWidth();
+    BOB_ASSERT(output.cols == (int) (superPixelWidth / downsample));
+    BOB_ASSERT(output.rows == (int) (getSuperPixelHeight() / downsample));
     BOB_ASSERT(output.type() == CV_8UC1);
 
-    // Read data and size (in bytes) from camera
-    // **NOTE** these pointers are only valid within one frame
-    void *data = nullptr;
-    uint32_t sizeBytes = Video4LinuxCamera::capture(data);
-
-    // Check frame size is correct
-    BOB_ASSERT(sizeBytes == (inputWidth * inputHeight * sizeof(uint16_t)));
-    const uint16_t *bayerData = reinterpret_cast<uint16_t *>(data);
-
-    // Loop through bayer pixels
-    for (unsigned int y = 0; y < inputHeight; y += 2) {
-        // Get pointers to start of both rows of Bayer data and output
-        // RGB data
-        const uint16_t *inBG16Start = &bayerData[y * inputWidth];
-        const uint16_t *inR16Start =
-                &bayerData[((y + 1) * inputWidth) + 1];
-        uint8_t *outStart = output.ptr(y / 2);
-        for (unsigned int x = 0; x < inputWidth; x += 2) {
-            // Read Bayer pixels
-            const uint16_t b = *(inBG16Start++);
-            const uint16_t g = *(inBG16Start++);
-            const uint16_t r = *inR16Start;
-            inR16Start += 2;
+    const uint16_t *bayerData = captureBayer();
+    if (!bayerData) {
+        return false;
+    }
 
-            // Add channels together and divide by 3 to take average and
-            // 4 to rescale from 10-bit per-channel to 8-bit
-            const uint32_t gray = (b + g + r) / (3 * 4);
+    // Loop through bands of output rows
+    forEachRowBand(output.rows, [&](size_t begin, size_t end) {
+        if (downsample == 1) {
+            for (size_t y = begin; y < end; y++) {
+                const uint16_t *inBG = &bayerData[2 * y * inputWidth];
+                greyRow(inBG, inBG + inputWidth, output.ptr(y), superPixelWidth);
+            }
+        } else {
+            const size_t outputWidth = static_cast<size_t>(output.cols);
+            const uint32_t divisor = 3 * 4 * downsample * downsample;
+            std::vector<uint16_t> rowSums(superPixelWidth);
+            std::vector<uint32_t> columnSums(outputWidth);
+            for (size_t y = begin; y < end; y++) {
+                // Sum the channels of each block of super-pixels...
+                std::fill(columnSums.begin(), columnSums.end(), 0);
+                for (size_t row = y * downsample; row < (y + 1) * downsample; row++) {
+                    const uint16_t *inBG = &bayerData[2 * row * inputWidth];
+                    sumRow(inBG, inBG + inputWidth, rowSums.data(), superPixelWidth);
+                    for (size_t x = 0; x < outputWidth; x++) {
+                        const uint16_t *block = &rowSums[x * downsample];
+                        columnSums[x] = std::accumulate(block, block + downsample, columnSums[x]);
+                    }
+                }
 
-            // Write back to BGR
-            *(outStart++) = (uint8_t) gray;
+                // ...and divide to get mean intensity
+                uint8_t *out = output.ptr(y);
+                for (size_t x = 0; x < outputWidth; x++) {
+                    out[x] = static_cast<uint8_t>(columnSums[x] / divisor);
+                }
+            }
         }
+    });
+    return true;
+}
+
+void
+See3CAM_CU40::setNumThreads(size_t numThreads)
+{
+    if (numThreads > 1) {
+        m_ThreadPool = std::make_shared<ThreadPool>(numThreads);
+    } else {
+        m_ThreadPool.reset();
     }
 }
 
@@ -159,14 +429,9 @@ See3CAM_CU40::calculateImageEntropy(const cv::Mat &mask)
                           mask.rows == (int) (inputHeight / 2)));
     BOB_ASSERT(noMask || mask.type() == CV_8UC1);
 
-    // Read data and size (in bytes) from camera
-    // **NOTE** these pointers are only valid within one frame
-    void *data = nullptr;
-    uint32_t sizeBytes = Video4LinuxCamera::capture(data);
-
-    // Check frame size is correct
-    BOB_ASSERT(sizeBytes == (inputWidth * inputHeight * sizeof(uint16_t)));
-    const uint16_t *bayerData = reinterpret_cast<uint16_t *>(data);
+    // Read data from camera, whether or not the capture thread is running
+    // **NOTE** this pointer is only valid within one frame
+    const uint16_t *bayerData = captureBayerSync();
 
     // Zero a 10-bit RGB histogram for each colour channel
     unsigned int hist[3][1024];
@@ -256,9 +521,8 @@ See3CAM_CU40::autoExposure(const cv::Mat &mask, int brightnessExposureConstant)
 
         // Throw away frame so new frame is captured AFTER setting change
         // **NOTE** this is required because of double-buffering in
-        // Video4LinuxCamera
-        void *data = nullptr;
-        capture(data);
+        // Video4LinuxCamera (or a frame waiting in the capture thread)
+        captureBayerSync();
 
         // Calculate image entropy
         const float entropy = calculateImageEntropy(mask);
@@ -382,89 +646,81 @@ See3CAM_CU40::createBubblescopeMask(const cv::Size &camRes)
     return mask;
 }
 
-uint8_t
-See3CAM_CU40::PixelScale::getR(uint16_t r, uint16_t, uint16_t)
-{
-    return getScaled(r);
-}
-uint8_t
-See3CAM_CU40::PixelScale::getG(uint16_t, uint16_t g, uint16_t)
-{
-    return getScaled(g);
-}
-uint8_t
-See3CAM_CU40::PixelScale::getB(uint16_t, uint16_t, uint16_t b)
-{
-    return getScaled(b);
-}
-
-uint8_t
-See3CAM_CU40::PixelScale::getScaled(uint16_t v)
-{
-    return (uint8_t)(v >> 2);
-}
-
-uint8_t
-See3CAM_CU40::PixelClamp::getR(uint16_t r, uint16_t, uint16_t)
-{
-    return getClamped(r);
-}
-uint8_t
-See3CAM_CU40::PixelClamp::getG(uint16_t, uint16_t g, uint16_t)
-{
-    return getClamped(g);
-}
-uint8_t
-See3CAM_CU40::PixelClamp::getB(uint16_t, uint16_t, uint16_t b)
-{
-    return getClamped(b);
-}
-uint8_t
-See3CAM_CU40::PixelClamp::getClamped(uint16_t v)
+//------------------------------------------------------------------------
+// Private API
+//------------------------------------------------------------------------
+bool
+See3CAM_CU40::captureSuperPixel(cv::Mat &output, int shift, uint16_t gainB, uint16_t gainG, uint16_t gainR)
 {
-    return (uint8_t) std::min<uint16_t>(255, v);
-}
+    // Check that output size is suitable for super-pixel output i.e. a
+    // quarter input size
+    const unsigned int inputWidth = getWidth();
+    BOB_ASSERT(output.cols == (int) getSuperPixelWidth());
+    BOB_ASSERT(output.rows == (int) getSuperPixelHeight());
+    BOB_ASSERT(output.type() == CV_8UC3);
 
-uint8_t
-See3CAM_CU40::WhiteBalanceCoolWhite::getR(uint16_t r, uint16_t, uint16_t)
-{
-    // 0.96 (15729)
-    return (uint8_t)(((uint32_t) r * 15729) >> 16);
-}
+    const uint16_t *bayerData = captureBayer();
+    if (!bayerData) {
+        return false;
+    }
 
-uint8_t
-See3CAM_CU40::WhiteBalanceCoolWhite::getG(uint16_t, uint16_t g, uint16_t)
-{
-    return (uint8_t)(g >> 2);
+    // Loop through bands of super-pixel rows
+    const Gains gains{ shift, gainB, gainG, gainR };
+    forEachRowBand(output.rows, [&](size_t begin, size_t end) {
+        for (size_t y = begin; y < end; y++) {
+            const uint16_t *inBG = &bayerData[2 * y * inputWidth];
+            demosaicRowBGR(inBG, inBG + inputWidth, gains, output.ptr(y), output.cols);
+        }
+    });
+    return true;
 }
 
-uint8_t
-See3CAM_CU40::WhiteBalanceCoolWhite::getB(uint16_t, uint16_t, uint16_t b)
+const uint16_t *
+See3CAM_CU40::captureBayer()
 {
-    // 1.74 (28508)
-    return (uint8_t) std::min<uint32_t>(((uint32_t) b * 28508) >> 16,
-                                        255);
-}
+    // Read data and size (in bytes) from camera
+    // **NOTE** these pointers are only valid within one frame
+    const void *data = nullptr;
+    uint32_t sizeBytes;
+    if (isCaptureThreadRunning()) {
+        Frame frame;
+        if (!tryGetFrame(frame)) {
+            return nullptr;
+        }
+        data = frame.data;
+        sizeBytes = frame.sizeBytes;
+    } else {
+        void *buffer = nullptr;
+        sizeBytes = Video4LinuxCamera::capture(buffer);
+        data = buffer;
+    }
 
-uint8_t
-See3CAM_CU40::WhiteBalanceU30::getR(uint16_t r, uint16_t, uint16_t)
-{
-    // 0.92 (15073)
-    return (uint8_t)(((uint32_t) r * 15073) >> 16);
+    // Check frame size is correct
+    BOB_ASSERT(sizeBytes == (getWidth() * getHeight() * sizeof(uint16_t)));
+    return reinterpret_cast<const uint16_t *>(data);
 }
 
-uint8_t
-See3CAM_CU40::WhiteBalanceU30::getG(uint16_t, uint16_t g, uint16_t)
+const uint16_t *
+See3CAM_CU40::captureBayerSync()
 {
-    return (uint8_t)(g >> 2);
+    // Only the capture thread can leave us without a frame, so wait for it to signal one
+    const uint16_t *bayerData;
+    while (!(bayerData = captureBayer())) {
+        waitForFrame(std::chrono::milliseconds(100));
+    }
+    return bayerData;
 }
 
-uint8_t
-See3CAM_CU40::WhiteBalanceU30::getB(uint16_t, uint16_t, uint16_t b)
-{
-    // 1.53 (25068)
-    return (uint8_t) std::min<uint32_t>(((uint32_t) b * 25068) >> 16,
-                                        255);
+void
+See3CAM_CU40::forEachRowBand(size_t numRows, const std::function<void(size_t, size_t)> &func)
+{
+    if (m_ThreadPool) {
+        m_ThreadPool->parallelFor(numRows, [&func](size_t, size_t begin, size_t end) {
+            func(begin, end);
+        });
+    } else {
+        func(0, numRows);
+    }
 }
 
 } // Video
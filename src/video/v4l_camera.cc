@@ -1,13 +1,16 @@
 #ifdef __linux__
 // BoB robotics includes
 #include "video/v4l_camera.h"
+#include "common/background_exception_catcher.h"
 #include "common/logging.h"
+#include "common/macros.h"
 
 // Standard C includes
 #include <cstring>
 
 // POSIX includes
 #include <fcntl.h>
+#include <poll.h>
 #include <sys/ioctl.h>
 #include <sys/mman.h>
 #include <unistd.h>
@@ -22,20 +25,32 @@ Video4LinuxCamera::Error::Error(const std::string &msg)
 Video4LinuxCamera::Video4LinuxCamera()
   : m_Camera(-1)
   , m_Frame(0)
-  , m_Buffer{ nullptr, nullptr }
+  , m_CaptureThreadRunning(false)
+  , m_CapturePolicy(CapturePolicy::LatestOnly)
+  , m_LatestBuffer(-1)
+  , m_RingHead(0)
+  , m_RingTail(0)
+  , m_HeldBuffer(-1)
 {}
 
 Video4LinuxCamera::Video4LinuxCamera(const std::string &device,
                                      unsigned int width,
                                      unsigned int height,
-                                     uint32_t pixelFormat)
+                                     uint32_t pixelFormat,
+                                     unsigned int numBuffers)
   : Video4LinuxCamera()
 {
-    open(device, width, height, pixelFormat);
+    open(device, width, height, pixelFormat, numBuffers);
 }
 
 Video4LinuxCamera::~Video4LinuxCamera()
 {
+    // Stop capture thread before we pull the buffers out from under it
+    if (m_CaptureThread.joinable()) {
+        m_CaptureThreadRunning = false;
+        m_CaptureThread.join();
+    }
+
     if (m_Camera >= 0) {
         // Stop video streaming
         int type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
@@ -45,10 +60,11 @@ Video4LinuxCamera::~Video4LinuxCamera()
         }
 
         // munmap buffers
-        if ((m_Buffer[0] && munmap(m_Buffer[0], m_BufferInfo[0].length) == -1) ||
-            (m_Buffer[1] && munmap(m_Buffer[1], m_BufferInfo[1].length) == -1)) {
-            LOG_WARNING << "Could not free buffers ("
-                        << strerror(errno) << ")";
+        for (size_t i = 0; i < m_Buffer.size(); i++) {
+            if (m_Buffer[i] && munmap(m_Buffer[i], m_BufferInfo[i].length) == -1) {
+                LOG_WARNING << "Could not free buffers ("
+                            << strerror(errno) << ")";
+            }
         }
 
         // Close camera
@@ -60,8 +76,11 @@ void
 Video4LinuxCamera::open(const std::string &device,
                         unsigned int width,
                         unsigned int height,
-                        uint32_t pixelFormat)
+                        uint32_t pixelFormat,
+                        unsigned int numBuffers)
 {
+    BOB_ASSERT(numBuffers > 0);
+
     // Open camera
     if ((m_Camera = ::open(device.c_str(), O_RDWR)) < 0) {
         throw Error("Could not open camera");
@@ -96,19 +115,31 @@ Video4LinuxCamera::open(const std::string &device,
         throw Error("Cannot set format");
     }
 
-    // Fill buffer request structure to request two buffers
+    // Fill buffer request structure to request buffers
     v4l2_requestbuffers bufferRequest;
     memset(&bufferRequest, 0, sizeof(v4l2_requestbuffers));
     bufferRequest.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
     bufferRequest.memory = V4L2_MEMORY_MMAP;
-    bufferRequest.count = 2;
+    bufferRequest.count = numBuffers;
 
     if (ioctl(m_Camera, VIDIOC_REQBUFS, &bufferRequest) < 0) {
         throw Error("Cannot request buffers");
     }
 
+    // The driver may give us a different number of buffers
+    if (bufferRequest.count == 0) {
+        throw Error("Driver allocated no buffers");
+    }
+    if (bufferRequest.count != numBuffers) {
+        LOG_WARNING << "Requested " << numBuffers << " buffers but driver allocated "
+                    << bufferRequest.count;
+    }
+    m_Buffer.assign(bufferRequest.count, nullptr);
+    m_BufferInfo.resize(bufferRequest.count);
+    m_Ring.resize(bufferRequest.count);
+
     // Loop through buffers
-    for (unsigned int i = 0; i < 2; i++) {
+    for (unsigned int i = 0; i < bufferRequest.count; i++) {
         // Fill buffer structure
         memset(&m_BufferInfo[i], 0, sizeof(v4l2_buffer));
         m_BufferInfo[i].type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
@@ -141,19 +172,7 @@ Video4LinuxCamera::open(const std::string &device,
         memset(m_Buffer[i], 0, m_BufferInfo[i].length);
     }
 
-    // Start video streaming
-    int type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
-    if (ioctl(m_Camera, VIDIOC_STREAMON, &type) < 0) {
-        throw Error("Cannot start streaming");
-    }
-
-    // Enqueue our buffer onto the device's incoming queue
-    if (ioctl(m_Camera, VIDIOC_QBUF, &m_BufferInfo[0]) < 0) {
-        throw Error("Cannot enqueue buffer");
-    }
-
-    // Ensure that frame is zeroed
-    m_Frame = 0;
+    startStreaming();
 }
 
 void
@@ -192,6 +211,8 @@ Video4LinuxCamera::queryControl(uint32_t id, v4l2_queryctrl &queryControl)
 uint32_t
 Video4LinuxCamera::capture(void *&buffer)
 {
+    BOB_ASSERT(!m_CaptureThread.joinable());
+
     // Dequeue this frame's buffer from device's outgoing queue
     if (ioctl(m_Camera, VIDIOC_DQBUF, &m_BufferInfo[m_Frame]) < 0) {
         throw Error("Cannot dequeue buffer");
@@ -202,12 +223,10 @@ Video4LinuxCamera::capture(void *&buffer)
     uint32_t sizebytes = m_BufferInfo[m_Frame].length;
 
     // Increment frame number
-    m_Frame = (m_Frame + 1) % 2;
+    m_Frame = (m_Frame + 1) % m_Buffer.size();
 
     // Enqueue next buffer onto the device's incoming queue
-    if (ioctl(m_Camera, VIDIOC_QBUF, &m_BufferInfo[m_Frame]) < 0) {
-        throw Error("Cannot enqueue buffer");
-    }
+    queueBuffer(m_Frame);
 
     return sizebytes;
 }
@@ -243,6 +262,231 @@ Video4LinuxCamera::setControlValue(uint32_t id, int32_t value)
     }
 }
 
+size_t
+Video4LinuxCamera::getNumBuffers() const
+{
+    return m_Buffer.size();
+}
+
+void
+Video4LinuxCamera::startCaptureThread(CapturePolicy policy)
+{
+    BOB_ASSERT(m_Camera >= 0);
+    BOB_ASSERT(!m_CaptureThread.joinable());
+    if (policy == CapturePolicy::LatestOnly && m_Buffer.size() < 3) {
+        throw std::runtime_error("At least three buffers are needed to only keep the latest frame");
+    }
+
+    m_CapturePolicy = policy;
+    m_LatestBuffer = -1;
+    m_RingHead = 0;
+    m_RingTail = 0;
+    m_HeldBuffer = -1;
+
+    // Only the current frame's buffer is queued for synchronous capture, so queue the rest
+    for (unsigned int i = 0; i < m_Buffer.size(); i++) {
+        if (i != m_Frame) {
+            queueBuffer(i);
+        }
+    }
+
+    m_CaptureThreadRunning = true;
+    m_CaptureThread = std::thread(&Video4LinuxCamera::runCaptureThread, this);
+}
+
+void
+Video4LinuxCamera::stopCaptureThread()
+{
+    if (!m_CaptureThread.joinable()) {
+        return;
+    }
+
+    m_CaptureThreadRunning = false;
+    m_CaptureThread.join();
+
+    // Restarting streaming takes all the buffers back from the driver
+    stopStreaming();
+    startStreaming();
+}
+
+bool
+Video4LinuxCamera::isCaptureThreadRunning() const
+{
+    return m_CaptureThreadRunning;
+}
+
+bool
+Video4LinuxCamera::tryGetFrame(Frame &frame)
+{
+    BOB_ASSERT(m_CaptureThread.joinable());
+
+    // Take ownership of the next buffer, if there is one
+    int index;
+    if (m_CapturePolicy == CapturePolicy::LatestOnly) {
+        index = m_LatestBuffer.exchange(-1, std::memory_order_acq_rel);
+    } else {
+        if (m_RingHead == m_RingTail.load(std::memory_order_acquire)) {
+            index = -1;
+        } else {
+            index = static_cast<int>(m_Ring[m_RingHead % m_Ring.size()]);
+            m_RingHead++;
+        }
+    }
+    if (index < 0) {
+        return false;
+    }
+
+    // Give the last frame's buffer back to the driver
+    if (m_HeldBuffer >= 0) {
+        queueBuffer(static_cast<unsigned int>(m_HeldBuffer));
+    }
+    m_HeldBuffer = index;
+
+    fillFrame(static_cast<unsigned int>(index), frame);
+    return true;
+}
+
+bool
+Video4LinuxCamera::waitForFrame(std::chrono::milliseconds timeout)
+{
+    BOB_ASSERT(m_CaptureThread.joinable());
+
+    std::unique_lock<std::mutex> lock(m_NewFrameMutex);
+    return m_NewFrameCondition.wait_for(lock, timeout, [this]() { return hasNewFrame(); });
+}
+
+void
+Video4LinuxCamera::queueBuffer(unsigned int index)
+{
+    // Enqueue buffer onto the device's incoming queue
+    if (ioctl(m_Camera, VIDIOC_QBUF, &m_BufferInfo[index]) < 0) {
+        throw Error("Cannot enqueue buffer");
+    }
+}
+
+bool
+Video4LinuxCamera::dequeueBuffer(v4l2_buffer &bufferInfo)
+{
+    // Dequeue whichever buffer the driver has finished with first
+    memset(&bufferInfo, 0, sizeof(v4l2_buffer));
+    bufferInfo.type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    bufferInfo.memory = V4L2_MEMORY_MMAP;
+    if (ioctl(m_Camera, VIDIOC_DQBUF, &bufferInfo) < 0) {
+        if (errno == EAGAIN) {
+            return false;
+        } else {
+            throw Error("Cannot dequeue buffer");
+        }
+    }
+    return true;
+}
+
+void
+Video4LinuxCamera::startStreaming()
+{
+    // Start video streaming
+    int type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    if (ioctl(m_Camera, VIDIOC_STREAMON, &type) < 0) {
+        throw Error("Cannot start streaming");
+    }
+
+    // Enqueue our buffer onto the device's incoming queue
+    m_Frame = 0;
+    queueBuffer(m_Frame);
+}
+
+void
+Video4LinuxCamera::stopStreaming()
+{
+    // This also dequeues all buffers
+    int type = V4L2_BUF_TYPE_VIDEO_CAPTURE;
+    if (ioctl(m_Camera, VIDIOC_STREAMOFF, &type) < 0) {
+        throw Error("Cannot stop streaming");
+    }
+}
+
+void
+Video4LinuxCamera::runCaptureThread()
+{
+    try {
+        while (m_CaptureThreadRunning) {
+            // Wait for a frame, but wake up regularly to check if we should stop
+            pollfd fd;
+            fd.fd = m_Camera;
+            fd.events = POLLIN;
+            fd.revents = 0;
+            const int ret = poll(&fd, 1, 100);
+            if (ret < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw Error("Cannot poll camera");
+            } else if (ret == 0) {
+                continue;
+            }
+
+            v4l2_buffer bufferInfo;
+            if (!dequeueBuffer(bufferInfo)) {
+                continue;
+            }
+
+            // Store frame's size and timestamp so the consumer can read them once it's published
+            const unsigned int index = bufferInfo.index;
+            m_BufferInfo[index] = bufferInfo;
+
+            if (m_CapturePolicy == CapturePolicy::LatestOnly) {
+                // Publish frame, giving the previous one back to the driver if it wasn't collected
+                const int stale = m_LatestBuffer.exchange(static_cast<int>(index), std::memory_order_acq_rel);
+                if (stale >= 0) {
+                    queueBuffer(static_cast<unsigned int>(stale));
+                }
+            } else {
+                const size_t tail = m_RingTail.load(std::memory_order_relaxed);
+                m_Ring[tail % m_Ring.size()] = index;
+                m_RingTail.store(tail + 1, std::memory_order_release);
+            }
+
+            /*
+             * Frames are published without the lock, so tryGetFrame() never
+             * waits for it, but we have to take it before notifying or a
+             * waiter could miss the frame between checking and sleeping
+             */
+            {
+                std::lock_guard<std::mutex> lock(m_NewFrameMutex);
+            }
+            m_NewFrameCondition.notify_all();
+        }
+    } catch (...) {
+        m_CaptureThreadRunning = false;
+        BackgroundExceptionCatcher::set(std::current_exception());
+    }
+}
+
+bool
+Video4LinuxCamera::hasNewFrame() const
+{
+    if (m_CapturePolicy == CapturePolicy::LatestOnly) {
+        return m_LatestBuffer.load(std::memory_order_acquire) >= 0;
+    } else {
+        return m_RingHead != m_RingTail.load(std::memory_order_acquire);
+    }
+}
+
+void
+Video4LinuxCamera::fillFrame(unsigned int index, Frame &frame) const
+{
+    using namespace std::chrono;
+
+    const v4l2_buffer &bufferInfo = m_BufferInfo[index];
+    frame.data = m_Buffer[index];
+    frame.sizeBytes = bufferInfo.bytesused ? bufferInfo.bytesused : bufferInfo.length;
+    frame.sequence = bufferInfo.sequence;
+
+    // Drivers timestamp frames with CLOCK_MONOTONIC, which is what steady_clock uses on Linux
+    const auto sinceEpoch = seconds(bufferInfo.timestamp.tv_sec) + microseconds(bufferInfo.timestamp.tv_usec);
+    frame.timestamp = steady_clock::time_point(duration_cast<steady_clock::duration>(sinceEpoch));
+}
+
 } // Video
 } // BoBRobotics
 #endif // linux
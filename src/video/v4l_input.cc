@@ -0,0 +1,106 @@
+#ifdef __linux__
+// BoB robotics includes
+#include "common/macros.h"
+#include "video/v4l_input.h"
+
+// Standard C++ includes
+#include <chrono>
+
+using namespace std::literals;
+
+namespace BoBRobotics {
+namespace Video {
+
+Video4LinuxInput::Video4LinuxInput(const std::string &device,
+                                   const cv::Size &resolution,
+                                   const std::string &cameraName)
+  : Video4LinuxCamera(device, resolution.width, resolution.height, V4L2_PIX_FMT_YUYV)
+  , m_Resolution(resolution)
+  , m_CameraName(cameraName)
+{}
+
+//------------------------------------------------------------------------
+// Video::Input virtuals
+//------------------------------------------------------------------------
+std::string
+Video4LinuxInput::getCameraName() const
+{
+    return m_CameraName;
+}
+
+cv::Size
+Video4LinuxInput::getOutputSize() const
+{
+    return m_Resolution;
+}
+
+bool
+Video4LinuxInput::readFrame(cv::Mat &outFrame)
+{
+    cv::Mat yuyv;
+    if (!captureYUYV(yuyv)) {
+        return false;
+    }
+
+    cv::cvtColor(yuyv, outFrame, cv::COLOR_YUV2BGR_YUYV);
+    return true;
+}
+
+bool
+Video4LinuxInput::readGreyscaleFrame(cv::Mat &outFrame)
+{
+    cv::Mat yuyv;
+    if (!captureYUYV(yuyv)) {
+        return false;
+    }
+
+    // In YUYV, every other byte is a luma value, so this is all we need to copy
+    cv::extractChannel(yuyv, outFrame, 0);
+    return true;
+}
+
+bool
+Video4LinuxInput::waitForNewFrame()
+{
+    // Without the capture thread, readFrame() blocks on the driver anyway
+    if (!isCaptureThreadRunning()) {
+        return Input::waitForNewFrame();
+    }
+
+    // Wake up every so often, in case the capture thread has stopped
+    while (!waitForFrame(100ms)) {
+        if (!isCaptureThreadRunning()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------
+// Private API
+//------------------------------------------------------------------------
+bool
+Video4LinuxInput::captureYUYV(cv::Mat &yuyv)
+{
+    void *data = nullptr;
+    uint32_t sizeBytes;
+    if (isCaptureThreadRunning()) {
+        // Don't wait for the driver: just take the newest frame, if there is one
+        Frame frame;
+        if (!tryGetFrame(frame)) {
+            return false;
+        }
+        data = const_cast<void *>(frame.data);
+        sizeBytes = frame.sizeBytes;
+    } else {
+        sizeBytes = capture(data);
+    }
+
+    BOB_ASSERT(sizeBytes >= static_cast<uint32_t>(m_Resolution.area() * 2));
+    yuyv = cv::Mat(m_Resolution, CV_8UC2, data);
+    return true;
+}
+
+} // Video
+} // BoBRobotics
+#endif // __linux__
@@ -0,0 +1,140 @@
+#include "common.h"
+
+// BoB robotics includes
+#include "antworld/obj_parsing.h"
+#include "antworld/world_data.h"
+
+// Third-party includes
+#include "third_party/path.h"
+
+// Standard C++ includes
+#include <array>
+#include <cstring>
+#include <vector>
+
+using namespace BoBRobotics::AntWorld;
+
+namespace {
+/*
+ * Faces before any usemtl command, a quad and faces with negative indices,
+ * which refer back past the start of a chunk once the file is split finely enough
+ */
+constexpr const char *TestObj =
+        "# Test world\n"
+        "v 0 0 0\n"
+        "v 1 0 0\n"
+        "v 1 1 0\n"
+        "f -3 -2 -1\n"
+        "usemtl ground\n"
+        "v 0 0 1\n"
+        "v 1 0 1\n"
+        "v 1 1 1\n"
+        "v 0 1 1\n"
+        "f -4 -3 -2 -1\n"
+        "usemtl textured\n"
+        "vt 0 0\n"
+        "vt 1 0\n"
+        "vt 1 1\n"
+        "f 1/1 2/2 3/3\n"
+        "s off\n"
+        "f 5/-3 7/-1 6/-2\n";
+
+//! Get the position of each triangle's vertices, in order
+std::vector<std::array<float, 3>>
+getTrianglePositions(const WorldData::SurfaceData &surface)
+{
+    std::vector<std::array<float, 3>> positions;
+    for (uint32_t index : surface.indices) {
+        const float *position = &surface.positions[3 * index];
+        positions.push_back({ position[0], position[1], position[2] });
+    }
+    return positions;
+}
+
+//! Get the texture coordinate of each triangle's vertices, in order
+std::vector<std::array<float, 2>>
+getTriangleTexCoords(const WorldData::SurfaceData &surface)
+{
+    std::vector<std::array<float, 2>> texCoords;
+    for (uint32_t index : surface.indices) {
+        const float *texCoord = &surface.texCoords[2 * index];
+        texCoords.push_back({ texCoord[0], texCoord[1] });
+    }
+    return texCoords;
+}
+} // anonymous namespace
+
+TEST(ObjParsing, SplitLinesEndsChunksAtLineEnds) {
+    const char *end = TestObj + std::strlen(TestObj);
+    for (size_t numChunks = 1; numChunks < 20; numChunks++) {
+        const auto chunks = ObjParsing::splitLines(TestObj, end, numChunks);
+        ASSERT_FALSE(chunks.empty());
+        EXPECT_LE(chunks.size(), numChunks);
+
+        // Chunks should cover all of the text, in order, with every line in one chunk
+        const char *expectedStart = TestObj;
+        for (const auto &chunk : chunks) {
+            EXPECT_EQ(chunk.first, expectedStart);
+            ASSERT_GT(chunk.second, chunk.first);
+            EXPECT_EQ(chunk.second[-1], '\n');
+            expectedStart = chunk.second;
+        }
+        EXPECT_EQ(expectedStart, end);
+    }
+}
+
+TEST(WorldData, LoadObjInChunks) {
+    using Positions = std::vector<std::array<float, 3>>;
+    using TexCoords = std::vector<std::array<float, 2>>;
+    const Positions expectedDefault{ { 0, 0, 0 }, { 1, 0, 0 }, { 1, 1, 0 } };
+    const Positions expectedGround{ { 0, 0, 1 }, { 1, 0, 1 }, { 1, 1, 1 },
+                                    { 0, 0, 1 }, { 1, 1, 1 }, { 0, 1, 1 } };
+    const Positions expectedTextured{ { 0, 0, 0 }, { 1, 0, 0 }, { 1, 1, 0 },
+                                      { 1, 0, 1 }, { 0, 1, 1 }, { 1, 1, 1 } };
+    const TexCoords expectedTexCoords{ { 0, 0 }, { 1, 0 }, { 1, 1 },
+                                       { 0, 0 }, { 1, 1 }, { 1, 0 } };
+
+    // With as many chunks as lines, each line is parsed separately
+    for (size_t numChunks = 1; numChunks < 20; numChunks++) {
+        const auto world = WorldData::loadObj(TestObj, std::strlen(TestObj), filesystem::path("."),
+                                              1.0f, -1, numChunks);
+        ASSERT_EQ(world.surfaces.size(), 3);
+
+        // Faces before any usemtl command should be put in a default surface
+        EXPECT_EQ(world.surfaces[0].name, "default");
+        EXPECT_EQ(getTrianglePositions(world.surfaces[0]), expectedDefault);
+
+        // Quad should be split into two triangles, with shared vertices merged
+        const auto &ground = world.surfaces[1];
+        EXPECT_EQ(ground.name, "ground");
+        EXPECT_EQ(ground.getNumVertices(), 4);
+        EXPECT_TRUE(ground.texCoords.empty());
+        EXPECT_EQ(getTrianglePositions(ground), expectedGround);
+
+        const auto &textured = world.surfaces[2];
+        EXPECT_EQ(textured.name, "textured");
+        EXPECT_EQ(textured.getNumVertices(), 6);
+        EXPECT_EQ(getTrianglePositions(textured), expectedTextured);
+        EXPECT_EQ(getTriangleTexCoords(textured), expectedTexCoords);
+
+        BOB_EXPECT_UNIT_T_EQ(world.minBound[0], 0_m);
+        BOB_EXPECT_UNIT_T_EQ(world.maxBound[2], 1_m);
+    }
+}
+
+TEST(WorldData, ClampsObjVertexColours) {
+    constexpr const char *ColouredObj =
+            "v 0 0 0 1.5 -0.2 0.5\n"
+            "v 1 0 0 1 0 0\n"
+            "v 1 1 0 0 1 0\n"
+            "f 1 2 3\n";
+    const auto world = WorldData::loadObj(ColouredObj, std::strlen(ColouredObj), filesystem::path("."));
+    ASSERT_EQ(world.surfaces.size(), 1);
+    const auto &colours = world.surfaces[0].colours;
+    ASSERT_EQ(colours.size(), 9);
+
+    // Out-of-range components should saturate, rather than wrapping around
+    EXPECT_EQ(colours[0], 255);
+    EXPECT_EQ(colours[1], 0);
+    EXPECT_EQ(colours[2], 128);
+}
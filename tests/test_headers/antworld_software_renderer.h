@@ -0,0 +1,202 @@
+#include "common.h"
+
+// BoB robotics includes
+#include "antworld/software_renderer.h"
+#include "antworld/world_data.h"
+
+// Standard C++ includes
+#include <array>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+using namespace BoBRobotics::AntWorld;
+
+namespace {
+using Vector = std::array<float, 3>;
+
+Vector
+operator-(const Vector &a, const Vector &b)
+{
+    return { a[0] - b[0], a[1] - b[1], a[2] - b[2] };
+}
+
+float
+dot(const Vector &a, const Vector &b)
+{
+    return (a[0] * b[0]) + (a[1] * b[1]) + (a[2] * b[2]);
+}
+
+Vector
+cross(const Vector &a, const Vector &b)
+{
+    return { (a[1] * b[2]) - (a[2] * b[1]),
+             (a[2] * b[0]) - (a[0] * b[2]),
+             (a[0] * b[1]) - (a[1] * b[0]) };
+}
+
+//! Add a triangle with a single colour to surface
+void
+addTriangle(WorldData::SurfaceData &surface, const std::array<Vector, 3> &vertices,
+            const std::array<uint8_t, 3> &rgb)
+{
+    for (const auto &vertex : vertices) {
+        surface.positions.insert(surface.positions.end(), vertex.begin(), vertex.end());
+        surface.colours.insert(surface.colours.end(), rgb.begin(), rgb.end());
+    }
+}
+
+/*
+ * Direction of the ray through each pixel, with the agent facing along y
+ * with z up, as SoftwareRenderer (and Renderer's spherical mesh) calculate it
+ */
+Vector
+getPixelDirection(int row, int col, const cv::Size &size)
+{
+    using namespace units::angle;
+    const double HorizontalFOV = radian_t(296_deg).value();
+    const double VerticalFOV = radian_t(75_deg).value();
+    const double StartLongitude = radian_t(15_deg).value();
+    const double longitude = StartLongitude - ((1.0 - ((row + 0.5) / size.height)) * VerticalFOV);
+    const double latitude = (-HorizontalFOV / 2.0) + (((col + 0.5) / size.width) * HorizontalFOV);
+    return { (float) (std::sin(latitude) * std::cos(longitude)),
+             (float) (std::cos(latitude) * std::cos(longitude)),
+             (float) -std::sin(longitude) };
+}
+
+/*
+ * Find the colour of the nearest front-facing triangle along a ray by testing
+ * every triangle, or return false if the ray hits nothing
+ */
+bool
+castBruteForce(const WorldData &world, const Vector &direction, std::array<uint8_t, 3> &rgb)
+{
+    float nearest = std::numeric_limits<float>::max();
+    for (const auto &surface : world.surfaces) {
+        for (size_t i = 0; i < surface.indices.size(); i += 3) {
+            std::array<Vector, 3> vertices;
+            for (size_t v = 0; v < 3; v++) {
+                const float *position = &surface.positions[3 * surface.indices[i + v]];
+                vertices[v] = { position[0], position[1], position[2] };
+            }
+
+            // Moller-Trumbore, from the origin, culling anticlockwise triangles
+            const Vector edge1 = vertices[1] - vertices[0];
+            const Vector edge2 = vertices[2] - vertices[0];
+            const Vector p = cross(direction, edge2);
+            const float determinant = dot(edge1, p);
+            if (determinant <= std::numeric_limits<float>::epsilon()) {
+                continue;
+            }
+            const Vector s = Vector{ 0.f, 0.f, 0.f } - vertices[0];
+            const float u = dot(s, p) / determinant;
+            const Vector q = cross(s, edge1);
+            const float v = dot(direction, q) / determinant;
+            const float distance = dot(edge2, q) / determinant;
+            if (u >= 0.f && v >= 0.f && (u + v) <= 1.f && distance > 0.001f && distance < nearest) {
+                nearest = distance;
+                const uint8_t *colour = &surface.colours[3 * surface.indices[i]];
+                rgb = { colour[0], colour[1], colour[2] };
+            }
+        }
+    }
+    return nearest < std::numeric_limits<float>::max();
+}
+} // anonymous namespace
+
+TEST(SoftwareRenderer, MatchesBruteForceRayCast) {
+    // Scatter lots of triangles, facing either way, around the agent at the origin
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> position(-4.f, 4.f), offset(-1.f, 1.f);
+    std::uniform_int_distribution<int> component(0, 255);
+    WorldData world;
+    world.surfaces.resize(2);
+    for (int i = 0; i < 1000; i++) {
+        const Vector centre{ position(rng), position(rng), position(rng) };
+        std::array<Vector, 3> vertices;
+        for (auto &vertex : vertices) {
+            vertex = { centre[0] + offset(rng), centre[1] + offset(rng), centre[2] + offset(rng) };
+        }
+        addTriangle(world.surfaces[i % 2], vertices,
+                    { (uint8_t) component(rng), (uint8_t) component(rng), (uint8_t) component(rng) });
+    }
+    world.index();
+
+    SoftwareRenderer renderer;
+    renderer.setWorld(world);
+    renderer.setNumThreads(1);
+    const cv::Size size(90, 30);
+    cv::Mat image;
+    renderer.renderPanoramicView(0_m, 0_m, 0_m, 0_deg, 0_deg, 0_deg, image, size);
+    ASSERT_EQ(image.type(), CV_8UC3);
+
+    // Floating-point differences may change the result at the very edges of triangles
+    int numHits = 0, numMismatches = 0;
+    for (int row = 0; row < size.height; row++) {
+        for (int col = 0; col < size.width; col++) {
+            std::array<uint8_t, 3> rgb{ 0, 255, 255 };
+            numHits += castBruteForce(world, getPixelDirection(row, col, size), rgb);
+            const cv::Vec3b &bgr = image.at<cv::Vec3b>(row, col);
+            if (bgr[0] != rgb[2] || bgr[1] != rgb[1] || bgr[2] != rgb[0]) {
+                numMismatches++;
+            }
+        }
+    }
+    EXPECT_GT(numHits, size.area() / 2);
+    EXPECT_LE(numMismatches, size.area() / 200);
+}
+
+TEST(SoftwareRenderer, CullsBackFacesAndSamplesTextures) {
+    constexpr float Left = -10.f, Right = 10.f, Bottom = -10.f, Top = 10.f;
+
+    // A wall 1m in front of the agent, with a texture that's blue on the left and red on the right
+    WorldData world;
+    world.surfaces.resize(1);
+    auto &wall = world.surfaces[0];
+    const std::array<Vector, 3> lowerRight{ { { Left, 1.f, Bottom }, { Right, 1.f, Bottom }, { Right, 1.f, Top } } };
+    const std::array<Vector, 3> upperLeft{ { { Left, 1.f, Bottom }, { Right, 1.f, Top }, { Left, 1.f, Top } } };
+    addTriangle(wall, lowerRight, { 255, 255, 255 });
+    addTriangle(wall, upperLeft, { 255, 255, 255 });
+    wall.texCoords = { 0.f, 0.f, 1.f, 0.f, 1.f, 1.f, 0.f, 0.f, 1.f, 1.f, 0.f, 1.f };
+    wall.texture = 0;
+    cv::Mat texture(1, 2, CV_8UC3);
+    texture.at<cv::Vec3b>(0, 0) = cv::Vec3b(255, 0, 0);
+    texture.at<cv::Vec3b>(0, 1) = cv::Vec3b(0, 0, 255);
+    world.textures.push_back(texture);
+    world.index();
+
+    /*
+     * With 8 degrees per column, column 18 looks straight ahead at the middle
+     * of the texture and columns 8 and 28 at 80 degrees either side, where
+     * the wall's U coordinate is below 0.25 or above 0.75 (i.e. past the
+     * centres of the texels). Row 11 is close to the horizon.
+     */
+    const cv::Size size(37, 15);
+    constexpr int Row = 11;
+    SoftwareRenderer renderer;
+    renderer.setWorld(world);
+    cv::Mat image;
+    renderer.renderPanoramicView(0_m, 0_m, 0_m, 0_deg, 0_deg, 0_deg, image, size);
+    EXPECT_EQ(image.at<cv::Vec3b>(Row, 8), cv::Vec3b(255, 0, 0));
+    const cv::Vec3b &middle = image.at<cv::Vec3b>(Row, 18);
+    EXPECT_NEAR(middle[0], 128, 1);
+    EXPECT_EQ(middle[1], 0);
+    EXPECT_NEAR(middle[2], 128, 1);
+    EXPECT_EQ(image.at<cv::Vec3b>(Row, 28), cv::Vec3b(0, 0, 255));
+
+    // Looking from the other side, we should only see the (default, cyan) sky
+    renderer.renderPanoramicView(0_m, 2_m, 0_m, 180_deg, 0_deg, 0_deg, image, size);
+    for (int col = 0; col < size.width; col++) {
+        EXPECT_EQ(image.at<cv::Vec3b>(Row, col), cv::Vec3b(255, 255, 0));
+    }
+
+    // The same view in greyscale, with the texture modulated by vertex colours
+    for (size_t i = 0; i < wall.colours.size(); i += 3) {
+        wall.colours[i + 1] = 0;
+    }
+    renderer.setWorld(world);
+    renderer.renderPanoramicView(0_m, 0_m, 0_m, 0_deg, 0_deg, 0_deg, image, size, CV_8UC1);
+    EXPECT_EQ(image.at<uint8_t>(Row, 8), 29);
+    EXPECT_EQ(image.at<uint8_t>(Row, 28), 76);
+}
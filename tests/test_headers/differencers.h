@@ -0,0 +1,49 @@
+#include "common.h"
+
+// BoB robotics includes
+#include "navigation/differencers.h"
+
+// Standard C includes
+#include <cstdlib>
+
+// Standard C++ includes
+#include <random>
+#include <vector>
+
+using namespace BoBRobotics::Navigation;
+
+TEST(Differencers, FusedKernelsMatchScalar) {
+    // Use an odd size so the scalar tail of the SIMD kernels is exercised too
+    constexpr size_t n = 180 * 50 + 7;
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int> dist(0, 255);
+    std::vector<uint8_t> src1(n), src2(n), mask1(n), mask2(n);
+    for (size_t i = 0; i < n; i++) {
+        src1[i] = static_cast<uint8_t>(dist(gen));
+        src2[i] = static_cast<uint8_t>(dist(gen));
+        mask1[i] = (dist(gen) < 200) ? 255 : 0;
+        mask2[i] = (dist(gen) < 200) ? 1 : 0;
+    }
+
+    uint64_t absSum = 0, sqSum = 0, absSumMasked = 0, sqSumMasked = 0;
+    size_t numUnmasked = 0;
+    for (size_t i = 0; i < n; i++) {
+        const int diff = static_cast<int>(src1[i]) - static_cast<int>(src2[i]);
+        absSum += std::abs(diff);
+        sqSum += diff * diff;
+        if (mask1[i] && mask2[i]) {
+            absSumMasked += std::abs(diff);
+            sqSumMasked += diff * diff;
+            numUnmasked++;
+        }
+    }
+
+    EXPECT_EQ(absSum, AbsDiff::sum(src1.data(), src2.data(), n));
+    EXPECT_EQ(sqSum, RMSDiff::sum(src1.data(), src2.data(), n));
+
+    size_t count;
+    EXPECT_EQ(absSumMasked, AbsDiff::sumMasked(src1.data(), src2.data(), mask1.data(), mask2.data(), n, count));
+    EXPECT_EQ(numUnmasked, count);
+    EXPECT_EQ(sqSumMasked, RMSDiff::sumMasked(src1.data(), src2.data(), mask1.data(), mask2.data(), n, count));
+    EXPECT_EQ(numUnmasked, count);
+}
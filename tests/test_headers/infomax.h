@@ -0,0 +1,112 @@
+#include "common.h"
+
+// BoB robotics includes
+#include "navigation/infomax.h"
+
+// Eigen
+#include <Eigen/Core>
+
+// OpenCV
+#include <opencv2/opencv.hpp>
+
+// Standard C++ includes
+#include <algorithm>
+#include <random>
+#include <vector>
+
+using namespace BoBRobotics::Navigation;
+
+namespace {
+const cv::Size UnwrapRes(12, 4);
+constexpr float LearningRate = 0.01f;
+
+Eigen::MatrixXf
+getRandomWeights(std::mt19937 &gen)
+{
+    const int numPixels = UnwrapRes.width * UnwrapRes.height;
+    std::normal_distribution<float> weightDist;
+    Eigen::MatrixXf weights(numPixels + 1, numPixels);
+    for (int i = 0; i < weights.rows(); i++) {
+        for (int j = 0; j < weights.cols(); j++) {
+            weights(i, j) = weightDist(gen);
+        }
+    }
+    return weights;
+}
+
+std::vector<cv::Mat>
+getRandomImages(std::mt19937 &gen, size_t count)
+{
+    std::uniform_int_distribution<int> pixelDist(0, 255);
+    std::vector<cv::Mat> images;
+    for (size_t i = 0; i < count; i++) {
+        images.emplace_back(UnwrapRes, CV_8UC1);
+        for (int p = 0; p < UnwrapRes.area(); p++) {
+            images.back().data[p] = static_cast<uint8_t>(pixelDist(gen));
+        }
+    }
+    return images;
+}
+} // anonymous namespace
+
+TEST(InfoMax, TestBatchMatchesTest) {
+    std::mt19937 gen(42);
+    const InfoMax<> infomax(UnwrapRes, getRandomWeights(gen));
+    const auto images = getRandomImages(gen, 5);
+
+    Eigen::MatrixXf inputs(UnwrapRes.area(), images.size());
+    for (size_t i = 0; i < images.size(); i++) {
+        InfoMax<>::copyToColumn(images[i], inputs.col(i));
+    }
+    std::vector<float> differences;
+    infomax.testBatch(inputs, differences);
+
+    ASSERT_EQ(differences.size(), images.size());
+    for (size_t i = 0; i < images.size(); i++) {
+        const float expected = infomax.test(images[i]);
+        EXPECT_NEAR(differences[i], expected, 1e-4f * expected);
+    }
+}
+
+TEST(InfoMax, TrainBatchMatchesTrain) {
+    std::mt19937 gen(42);
+    const Eigen::MatrixXf initialWeights = getRandomWeights(gen);
+    const auto images = getRandomImages(gen, 2);
+
+    // A batch of one image should give the same update as training on it alone...
+    std::vector<Eigen::MatrixXf> updates;
+    for (const auto &image : images) {
+        InfoMax<> single(UnwrapRes, initialWeights, LearningRate);
+        single.train(image);
+        updates.emplace_back(single.getWeights() - initialWeights);
+
+        InfoMax<> batch(UnwrapRes, initialWeights, LearningRate);
+        batch.trainBatch({ image });
+        EXPECT_TRUE((batch.getWeights() - initialWeights).isApprox(updates.back(), 1e-4f));
+    }
+
+    // ...and a larger batch, the mean of each image's update
+    InfoMax<> batch(UnwrapRes, initialWeights, LearningRate);
+    batch.trainBatch(images);
+    EXPECT_TRUE((batch.getWeights() - initialWeights).isApprox((updates[0] + updates[1]) / 2.f, 1e-4f));
+}
+
+TEST(InfoMaxRotater, DifferencesMatchTest) {
+    std::mt19937 gen(42);
+    const InfoMaxRotater<> infomax(UnwrapRes, getRandomWeights(gen));
+    const cv::Mat image = getRandomImages(gen, 1)[0];
+
+    // Testing every rotation at once should be the same as testing them one by one
+    const auto &differences = infomax.getImageDifferences(image);
+    ASSERT_EQ(differences.size(), static_cast<size_t>(UnwrapRes.width));
+    cv::Mat rotated(UnwrapRes, CV_8UC1);
+    for (int column = 0; column < UnwrapRes.width; column++) {
+        for (int y = 0; y < UnwrapRes.height; y++) {
+            std::rotate_copy(image.ptr(y), image.ptr(y) + column, image.ptr(y) + UnwrapRes.width,
+                             rotated.ptr(y));
+        }
+
+        const float expected = infomax.test(rotated);
+        EXPECT_NEAR(differences[column], expected, 1e-4f * expected);
+    }
+}
@@ -0,0 +1,48 @@
+#include "common.h"
+
+// BoB robotics includes
+#include "navigation/infomax_quantised.h"
+
+// Eigen
+#include <Eigen/Core>
+
+// OpenCV
+#include <opencv2/opencv.hpp>
+
+// Standard C++ includes
+#include <random>
+
+using namespace BoBRobotics::Navigation;
+
+TEST(InfoMaxQuantised, MatchesFloatWeights) {
+    // Use an odd number of pixels so the scalar tail of the SIMD kernels is exercised too
+    const cv::Size unwrapRes(45, 7);
+    const int numPixels = unwrapRes.width * unwrapRes.height;
+
+    std::mt19937 gen(42);
+    std::normal_distribution<float> weightDist;
+    std::uniform_int_distribution<int> pixelDist(0, 255);
+
+    Eigen::MatrixXf weights(numPixels + 1, numPixels);
+    for (int i = 0; i < weights.rows(); i++) {
+        for (int j = 0; j < weights.cols(); j++) {
+            weights(i, j) = weightDist(gen);
+        }
+    }
+
+    cv::Mat image(unwrapRes, CV_8UC1);
+    for (int i = 0; i < numPixels; i++) {
+        image.data[i] = static_cast<uint8_t>(pixelDist(gen));
+    }
+
+    // Reference: the same calculation as InfoMax::test()
+    Eigen::VectorXf input(numPixels);
+    for (int i = 0; i < numPixels; i++) {
+        input(i) = static_cast<float>(image.data[i]) / 255.f;
+    }
+    const float expected = (weights * input).array().abs().sum();
+
+    // Quantisation error should be well under 1%
+    const InfoMaxQuantised<> infomax(unwrapRes, weights);
+    EXPECT_NEAR(infomax.test(image), expected, 0.01f * expected);
+}
@@ -0,0 +1,120 @@
+#ifndef _WIN32
+#include "common.h"
+
+// BoB robotics includes
+#include "net/connection.h"
+
+// POSIX includes
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+// Standard C++ includes
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+using namespace BoBRobotics::Net;
+
+TEST(Connection, NegotiatesBinaryProtocol) {
+    int handles[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, handles), 0);
+    Connection server(handles[0]), client(handles[1]);
+    client.requestBinaryProtocol();
+
+    float left = 0.f, right = 0.f;
+    server.setMessageHandler(Opcode::Tank, [&](Connection &, const Message &message) {
+        left = message.get<float>(0);
+        right = message.get<float>(sizeof(float));
+    });
+    Command received;
+    const auto onCommand = [&](Connection &, const Command &command) {
+        received = command;
+    };
+    server.setCommandHandler("TST", onCommand);
+    client.setCommandHandler("TST", onCommand);
+
+    // Server advertises binary protocol, so client switches to it for sending
+    server.getSocketWriter().send("HEY BIN\n");
+    EXPECT_EQ(client.readNextCommand(), "HEY");
+    {
+        auto socket = client.getSocketWriter();
+        ASSERT_TRUE(socket.isBinary());
+        socket.sendValues(Opcode::Tank, 0.5f, -0.25f);
+        socket.send("TST 1 2\n");
+    }
+
+    // Binary message is handled on the way to the next plaintext command
+    EXPECT_EQ(server.readNextCommand(), "BIN");
+    EXPECT_EQ(server.readNextCommand(), "TST");
+    EXPECT_EQ(left, 0.5f);
+    EXPECT_EQ(right, -0.25f);
+    EXPECT_EQ(received, (Command{ "TST", "1", "2" }));
+
+    // Server confirms and switches too
+    EXPECT_EQ(client.readNextCommand(), "BIN");
+    server.getSocketWriter().send("TST 3 4\n");
+    EXPECT_EQ(client.readNextCommand(), "TST");
+    EXPECT_EQ(received, (Command{ "TST", "3", "4" }));
+}
+
+TEST(Connection, PlaintextWithoutRequest) {
+    int handles[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, handles), 0);
+    Connection server(handles[0]), client(handles[1]);
+
+    server.getSocketWriter().send("HEY BIN\n");
+    EXPECT_EQ(client.readNextCommand(), "HEY");
+    EXPECT_FALSE(client.getSocketWriter().isBinary());
+}
+
+TEST(Connection, RejectsBadDatagramPort) {
+    int handles[2];
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, handles), 0);
+    Connection server(handles[0]), client(handles[1]);
+
+    for (const char *port : { "70000", "0", "-1", "12ab", "99999999999999999999" }) {
+        server.getSocketWriter().send(std::string("UDP ") + port + "\n");
+        EXPECT_THROW(client.readNextCommand(), BadCommandError) << port;
+    }
+}
+
+TEST(Connection, NegotiatesDatagrams) {
+    // Datagrams go to the TCP peer's address, so we need a real TCP connection
+    const int listener = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addrlen = sizeof(addr);
+    ASSERT_EQ(bind(listener, reinterpret_cast<sockaddr *>(&addr), addrlen), 0);
+    ASSERT_EQ(listen(listener, 1), 0);
+    ASSERT_EQ(getsockname(listener, reinterpret_cast<sockaddr *>(&addr), &addrlen), 0);
+    const int clientHandle = socket(AF_INET, SOCK_STREAM, 0);
+    ASSERT_EQ(connect(clientHandle, reinterpret_cast<sockaddr *>(&addr), addrlen), 0);
+    Connection server(accept(listener, nullptr, nullptr)), client(clientHandle);
+    close(listener);
+    client.requestDatagrams();
+
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::vector<Command> received;
+    server.setCommandHandler("TST", [&](Connection &, const Command &command) {
+        std::lock_guard<std::mutex> guard(mutex);
+        received.push_back(command);
+        condition.notify_all();
+    });
+
+    // Client offers its port, then the server replies with its own
+    server.getSocketWriter().send("HEY BIN UDP\n");
+    EXPECT_EQ(client.readNextCommand(), "HEY");
+    EXPECT_FALSE(client.hasDatagrams());
+    EXPECT_EQ(server.readNextCommand(), "UDP");
+    EXPECT_TRUE(server.hasDatagrams());
+    EXPECT_EQ(client.readNextCommand(), "UDP");
+    ASSERT_TRUE(client.hasDatagrams());
+
+    client.sendDatagram("TST 1 2", Delivery::Reliable);
+    std::unique_lock<std::mutex> lock(mutex);
+    ASSERT_TRUE(condition.wait_for(lock, std::chrono::seconds(1), [&]() { return !received.empty(); }));
+    EXPECT_EQ(received[0], (Command{ "TST", "1", "2" }));
+}
+#endif // !_WIN32
@@ -0,0 +1,236 @@
+#ifndef _WIN32
+#include "common.h"
+
+// BoB robotics includes
+#include "net/datagram.h"
+
+// POSIX includes
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Standard C++ includes
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace BoBRobotics::Net;
+
+namespace {
+/*
+ * Forwards datagrams between two DatagramChannels over loopback, dropping the
+ * first numDrops which carry the given command
+ */
+class LossyDatagramProxy
+{
+public:
+    LossyDatagramProxy(const std::string &dropCommand, int numDrops)
+      : m_DropCommand(dropCommand)
+      , m_DropsLeft(numDrops)
+    {
+        for (int &handle : m_Handles) {
+            handle = socket(AF_INET, SOCK_DGRAM, 0);
+            const sockaddr_in addr = getLoopbackAddress(0);
+            EXPECT_EQ(bind(handle, reinterpret_cast<const sockaddr *>(&addr), sizeof(addr)), 0);
+        }
+    }
+
+    ~LossyDatagramProxy()
+    {
+        m_DoRun = false;
+        if (m_Thread.joinable()) {
+            m_Thread.join();
+        }
+        for (int handle : m_Handles) {
+            close(handle);
+        }
+    }
+
+    //! Get the address channel side (0 or 1) should send to
+    sockaddr_in getAddress(int side) const
+    {
+        sockaddr_in addr;
+        socklen_t addrlen = sizeof(addr);
+        EXPECT_EQ(getsockname(m_Handles[side], reinterpret_cast<sockaddr *>(&addr), &addrlen), 0);
+        return addr;
+    }
+
+    //! Start forwarding between the channels listening on the given ports
+    void start(uint16_t port0, uint16_t port1)
+    {
+        m_Peers[0] = getLoopbackAddress(port0);
+        m_Peers[1] = getLoopbackAddress(port1);
+        m_Thread = std::thread(&LossyDatagramProxy::run, this);
+    }
+
+    int getNumDropped() const
+    {
+        return m_NumDropped;
+    }
+
+    static sockaddr_in getLoopbackAddress(uint16_t port)
+    {
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(port);
+        return addr;
+    }
+
+private:
+    const std::string m_DropCommand;
+    int m_DropsLeft;
+    std::atomic<int> m_NumDropped{ 0 };
+    int m_Handles[2];
+    sockaddr_in m_Peers[2];
+    std::thread m_Thread;
+    std::atomic<bool> m_DoRun{ true };
+
+    void run()
+    {
+        std::vector<char> buffer(DatagramChannel::MaxDatagramSize);
+        pollfd fds[2] = { { m_Handles[0], POLLIN, 0 }, { m_Handles[1], POLLIN, 0 } };
+        while (m_DoRun) {
+            if (poll(fds, 2, 5) <= 0) {
+                continue;
+            }
+
+            for (int side = 0; side < 2; side++) {
+                if (!(fds[side].revents & POLLIN)) {
+                    continue;
+                }
+
+                const auto nbytes = recv(m_Handles[side], buffer.data(), buffer.size(), 0);
+                if (nbytes <= 0) {
+                    continue;
+                }
+
+                // Skip the eight-byte header to get at the command (acks have none)
+                const size_t length = static_cast<size_t>(nbytes);
+                if (length > 8 && m_DropsLeft > 0 &&
+                    std::string(&buffer[8], length - 8) == m_DropCommand) {
+                    m_DropsLeft--;
+                    m_NumDropped++;
+                    continue;
+                }
+
+                const int other = 1 - side;
+                sendto(m_Handles[other], buffer.data(), length, 0,
+                       reinterpret_cast<const sockaddr *>(&m_Peers[other]), sizeof(m_Peers[other]));
+            }
+        }
+    }
+}; // LossyDatagramProxy
+
+//! How many copies of a datagram to drop, at one every 20ms
+constexpr int NumDrops = 40;
+} // anonymous namespace
+
+TEST(DatagramChannel, LatestRetransmittedUntilAcknowledged) {
+    // Drop copies of the stop command for well over half a second
+    const std::string stopCommand = "TNK 0.000000 0.000000";
+    LossyDatagramProxy proxy(stopCommand, NumDrops);
+
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::vector<Command> received;
+    DatagramChannel sender, receiver;
+    proxy.start(sender.getLocalPort(), receiver.getLocalPort());
+    sender.start(proxy.getAddress(0), [](const Command &) {});
+    receiver.start(proxy.getAddress(1), [&](const Command &command) {
+        std::lock_guard<std::mutex> guard(mutex);
+        received.push_back(command);
+        condition.notify_all();
+    });
+
+    sender.send("TNK 0.500000 0.500000", Delivery::Latest);
+    sender.send(stopCommand, Delivery::Latest);
+
+    // The stop command is only acknowledged once it finally gets through
+    EXPECT_TRUE(sender.flush(std::chrono::seconds(5)));
+    EXPECT_EQ(proxy.getNumDropped(), NumDrops);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    ASSERT_TRUE(condition.wait_for(lock, std::chrono::seconds(1), [&]() {
+        return !received.empty() && received.back() == (Command{ "TNK", "0.000000", "0.000000" });
+    }));
+}
+
+TEST(DatagramChannel, ReliableRetransmittedUntilAcknowledged) {
+    const std::string maxCommand = "TNK_MAX 0.500000";
+    LossyDatagramProxy proxy(maxCommand, NumDrops);
+
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::vector<Command> received;
+    DatagramChannel sender, receiver;
+    proxy.start(sender.getLocalPort(), receiver.getLocalPort());
+    sender.start(proxy.getAddress(0), [](const Command &) {});
+    receiver.start(proxy.getAddress(1), [&](const Command &command) {
+        std::lock_guard<std::mutex> guard(mutex);
+        received.push_back(command);
+        condition.notify_all();
+    });
+
+    // Commands sent after the lost one shouldn't stop it being delivered once it gets through
+    sender.send(maxCommand, Delivery::Reliable);
+    for (int i = 0; i < 100; i++) {
+        sender.send("TST " + std::to_string(i), Delivery::Reliable);
+    }
+    EXPECT_TRUE(sender.flush(std::chrono::seconds(5)));
+    EXPECT_EQ(proxy.getNumDropped(), NumDrops);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    ASSERT_TRUE(condition.wait_for(lock, std::chrono::seconds(1), [&]() {
+        return received.size() == 101;
+    }));
+    EXPECT_EQ(received.back(), (Command{ "TNK_MAX", "0.500000" }));
+}
+
+TEST(DatagramChannel, DropsMalformedDatagrams) {
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::vector<Command> received;
+    DatagramChannel receiver;
+
+    // Send datagrams by hand from a plain socket
+    const int handle = socket(AF_INET, SOCK_DGRAM, 0);
+    const sockaddr_in addr = LossyDatagramProxy::getLoopbackAddress(0);
+    ASSERT_EQ(bind(handle, reinterpret_cast<const sockaddr *>(&addr), sizeof(addr)), 0);
+    sockaddr_in localAddr;
+    socklen_t addrlen = sizeof(localAddr);
+    ASSERT_EQ(getsockname(handle, reinterpret_cast<sockaddr *>(&localAddr), &addrlen), 0);
+    receiver.start(localAddr, [&](const Command &command) {
+        std::lock_guard<std::mutex> guard(mutex);
+        received.push_back(command);
+        condition.notify_all();
+    });
+
+    const sockaddr_in receiverAddr = LossyDatagramProxy::getLoopbackAddress(receiver.getLocalPort());
+    const auto sendRaw = [&](uint32_t sequence, const std::string &command) {
+        std::vector<char> datagram(8, 0);
+        std::memcpy(datagram.data(), &sequence, sizeof(sequence));
+        datagram.insert(datagram.end(), command.begin(), command.end());
+        sendto(handle, datagram.data(), datagram.size(), 0,
+               reinterpret_cast<const sockaddr *>(&receiverAddr), sizeof(receiverAddr));
+    };
+    sendRaw(0, "");
+    sendRaw(1, " \n ");
+    sendRaw(2, "TST 1");
+
+    // The channel should still be up to receive the good command
+    std::unique_lock<std::mutex> lock(mutex);
+    ASSERT_TRUE(condition.wait_for(lock, std::chrono::seconds(1), [&]() {
+        return !received.empty();
+    }));
+    EXPECT_EQ(received, std::vector<Command>{ (Command{ "TST", "1" }) });
+    EXPECT_EQ(receiver.getNumMalformedDatagrams(), 2);
+    close(handle);
+}
+#endif // !_WIN32
@@ -0,0 +1,67 @@
+#include "common.h"
+
+// BoB robotics includes
+#include "common/nmea_parser.h"
+
+// Standard C++ includes
+#include <cstring>
+
+TEST(NMEAParser, ParsesSentencesSplitAcrossReads)
+{
+    const char *sentences = "$GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*47\r\n"
+                            "$GNVTG,054.7,T,034.4,M,005.5,N,010.2,K*56\r\n";
+    GPS::NMEAParser parser;
+    GPS::GPSData data;
+    EXPECT_FALSE(parser.getLatestData(data));
+
+    // Feed in awkwardly sized chunks, as if from the serial port
+    const size_t length = std::strlen(sentences);
+    size_t numUpdates = 0;
+    for (size_t i = 0; i < length; i += 7) {
+        numUpdates += parser.feed(&sentences[i], std::min<size_t>(7, length - i));
+    }
+    EXPECT_EQ(numUpdates, 2);
+    EXPECT_EQ(parser.getNumBadSentences(), 0);
+
+    ASSERT_TRUE(parser.getLatestData(data));
+    EXPECT_EQ(data.gpsQuality, GPS::GPSQuality::GPSFIX);
+    EXPECT_EQ(data.numberOfSatellites, 8);
+    EXPECT_DOUBLE_EQ(data.horizontalDilution, 0.9);
+    EXPECT_NEAR(data.coordinate.lat.value(), 48.0 + 7.038 / 60.0, 1e-12);
+    EXPECT_NEAR(data.coordinate.lon.value(), 11.0 + 31.0 / 60.0, 1e-12);
+    BOB_EXPECT_UNIT_T_EQ(data.altitude, 545.4_m);
+    EXPECT_NEAR(data.velocity.value(), 10.2 / 3.6, 1e-12);
+    EXPECT_EQ(data.time.hour, 12);
+    EXPECT_EQ(data.time.minute, 35);
+    EXPECT_EQ(data.time.second, 19);
+}
+
+TEST(NMEAParser, RejectsBadChecksums)
+{
+    GPS::NMEAParser parser;
+    const std::string sentence = "$GPGGA,123519,4807.038,N,01131.000,E,1,08,0.9,545.4,M,46.9,M,,*48\r\n";
+    EXPECT_EQ(parser.feed(sentence.data(), sentence.size()), 0);
+    EXPECT_EQ(parser.getNumBadSentences(), 1);
+
+    GPS::GPSData data;
+    EXPECT_FALSE(parser.getLatestData(data));
+}
+
+TEST(NMEAParser, ParsesEveryFixQuality)
+{
+    const auto data = GPS::NMEAParser::parseNMEA(
+            "$GPGGA,123519,4807.038,N,01131.000,E,6,08,0.9,545.4,M,46.9,M,,*40\r\n");
+    EXPECT_EQ(data.gpsQuality, GPS::GPSQuality::ESTIMATED);
+    EXPECT_THROW(GPS::NMEAParser::parseNMEA("$GPGGA,123519,4807.038,N,01131.000,E,9,08,0.9,545.4,M,46.9,M,,*4F\r\n"),
+                 GPS::GPSError);
+}
+
+TEST(NMEAParser, ParseNMEA)
+{
+    const auto data = GPS::NMEAParser::parseNMEA(
+            "$GNRMC,123519.50,A,4807.038,N,01131.000,E,022.4,084.4,230394,003.1,W*5F\r\n"
+            "$GNGGA,,,,,,0,00,99.99,,,,,,*56");
+    EXPECT_EQ(data.gpsQuality, GPS::GPSQuality::INVALID);
+    EXPECT_NEAR(data.velocity.value(), 22.4 * 1852.0 / 3600.0, 1e-12);
+    EXPECT_THROW(GPS::NMEAParser::parseNMEA("$GNRMC,123519.50,A*00"), GPS::GPSError);
+}
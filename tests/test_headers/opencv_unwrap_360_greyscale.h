@@ -0,0 +1,72 @@
+#include "common.h"
+
+// BoB robotics includes
+#include "imgproc/opencv_unwrap_360.h"
+
+// OpenCV
+#include <opencv2/opencv.hpp>
+
+namespace {
+ImgProc::OpenCVUnwrap360
+createGreyscaleTestUnwrapper(const cv::Size &unwrapResolution)
+{
+    return ImgProc::OpenCVUnwrap360({ 1280, 400 }, unwrapResolution, 0.45468750000000002,
+                                    0.20499999999999999, 0.087499999999999994, 0.19, 0_deg, true);
+}
+
+/*
+ * A smooth BGR test image, so that a source pixel chosen by a differently
+ * rounded map coordinate gives at most a difference of one grey level
+ */
+cv::Mat
+createGreyscaleTestInput()
+{
+    cv::Mat input(400, 1280, CV_8UC3);
+    for (int y = 0; y < input.rows; y++) {
+        for (int x = 0; x < input.cols; x++) {
+            input.at<cv::Vec3b>(y, x) = { static_cast<uchar>(x * 255 / 1279),
+                                          static_cast<uchar>(y * 255 / 399),
+                                          static_cast<uchar>((x + y) * 255 / 1678) };
+        }
+    }
+    return input;
+}
+} // anonymous namespace
+
+TEST(OpenCVUnwrap360, UnwrapGreyscaleMatchesUnwrapThenConvert) {
+    auto unwrapper = createGreyscaleTestUnwrapper({ 180, 50 });
+    const cv::Mat input = createGreyscaleTestInput();
+
+    // Unwrap the colour image, then convert it to greyscale
+    cv::Mat unwrapped, expected;
+    unwrapper.unwrap(input, unwrapped);
+    cv::cvtColor(unwrapped, expected, cv::COLOR_BGR2GRAY);
+
+    // Do both in one pass, from BGR, BGRA and greyscale images
+    cv::Mat inputBGRA, inputGrey;
+    cv::cvtColor(input, inputBGRA, cv::COLOR_BGR2BGRA);
+    cv::cvtColor(input, inputGrey, cv::COLOR_BGR2GRAY);
+    for (const cv::Mat &in : { input, inputBGRA, inputGrey }) {
+        cv::Mat actual;
+        unwrapper.unwrapGreyscale(in, actual);
+        ASSERT_EQ(actual.type(), CV_8UC1);
+        ASSERT_EQ(actual.size(), expected.size());
+        EXPECT_LE(cv::norm(actual, expected, cv::NORM_INF), 1.0);
+    }
+}
+
+TEST(OpenCVUnwrap360, UnwrapGreyscaleDownsample) {
+    auto unwrapper = createGreyscaleTestUnwrapper({ 180, 50 });
+    const cv::Mat input = createGreyscaleTestInput();
+
+    // Unwrap, convert to greyscale and shrink by averaging 2x2 blocks
+    cv::Mat unwrapped, grey, expected;
+    unwrapper.unwrap(input, unwrapped);
+    cv::cvtColor(unwrapped, grey, cv::COLOR_BGR2GRAY);
+    cv::resize(grey, expected, { 90, 25 }, 0, 0, cv::INTER_AREA);
+
+    cv::Mat actual;
+    unwrapper.unwrapGreyscale(input, actual, 2);
+    ASSERT_EQ(actual.size(), expected.size());
+    EXPECT_LE(cv::norm(actual, expected, cv::NORM_INF), 2.0);
+}
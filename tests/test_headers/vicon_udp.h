@@ -0,0 +1,135 @@
+#ifndef _WIN32
+#include "common.h"
+
+// BoB robotics includes
+#include "vicon/udp.h"
+
+// POSIX includes
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// Standard C++ includes
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+using namespace BoBRobotics::Vicon;
+
+namespace {
+/*
+ * Object data which holds up the client's read thread when the first pose
+ * arrives, so that the packets sent meanwhile queue up and are read in one batch
+ */
+class StallingObjectData : public ObjectData
+{
+public:
+    using ObjectData::ObjectData;
+
+    void update(uint32_t frameNumber, Pose3<units::length::millimeter_t, units::angle::radian_t> pose)
+    {
+        if (frameNumber == 0) {
+            IsStalled = true;
+            while (!ShouldResume) {
+                std::this_thread::sleep_for(1ms);
+            }
+        }
+        ObjectData::update(frameNumber, pose);
+    }
+
+    static std::atomic<bool> IsStalled, ShouldResume;
+};
+
+std::atomic<bool> StallingObjectData::IsStalled{ false };
+std::atomic<bool> StallingObjectData::ShouldResume{ false };
+
+//! Build a Vicon packet with a single object at (x, 0, 0) mm
+std::vector<uint8_t>
+createViconPacket(uint32_t frameNumber, double x)
+{
+    std::vector<uint8_t> packet(5 + 75, 0);
+    std::memcpy(&packet[0], &frameNumber, sizeof(frameNumber));
+    packet[4] = 1;
+
+    const uint16_t itemDataSize = 72;
+    std::memcpy(&packet[6], &itemDataSize, sizeof(itemDataSize));
+    std::strcpy(reinterpret_cast<char *>(&packet[8]), "robot");
+    std::memcpy(&packet[32], &x, sizeof(x));
+    return packet;
+}
+
+//! Find a UDP port which is free to bind to
+uint16_t
+getFreePort()
+{
+    const int handle = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    EXPECT_EQ(bind(handle, reinterpret_cast<const sockaddr *>(&addr), sizeof(addr)), 0);
+    socklen_t addrlen = sizeof(addr);
+    EXPECT_EQ(getsockname(handle, reinterpret_cast<sockaddr *>(&addr), &addrlen), 0);
+    close(handle);
+    return ntohs(addr.sin_port);
+}
+} // anonymous namespace
+
+TEST(ViconUDPClient, BatchedPacketsTimestampedIndividually) {
+    constexpr uint32_t NumFrames = 8;
+    const uint16_t port = getFreePort();
+    UDPClient<StallingObjectData> client(port);
+
+    const int handle = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    const auto send = [&](uint32_t frameNumber) {
+        const auto packet = createViconPacket(frameNumber, frameNumber);
+        ASSERT_EQ(sendto(handle, packet.data(), packet.size(), 0,
+                         reinterpret_cast<const sockaddr *>(&addr), sizeof(addr)),
+                  static_cast<ssize_t>(packet.size()));
+    };
+
+    // Queue up the rest of the packets, a little apart, while the read thread is stalled
+    send(0);
+    while (!StallingObjectData::IsStalled) {
+        std::this_thread::sleep_for(1ms);
+    }
+    for (uint32_t frame = 1; frame < NumFrames; frame++) {
+        std::this_thread::sleep_for(2ms);
+        send(frame);
+    }
+    StallingObjectData::ShouldResume = true;
+
+    const ObjectHandle robot = client.getObjectHandle("robot");
+    std::array<PoseSample, UDPClient<>::HistorySize> history;
+    for (int i = 0; i < 1000 && client.getPoseHistory(robot, history) < NumFrames; i++) {
+        std::this_thread::sleep_for(1ms);
+    }
+    ASSERT_EQ(client.getPoseHistory(robot, history), NumFrames);
+    close(handle);
+
+    // Each packet should have the time it arrived, not the time the batch was read
+    for (uint32_t frame = 1; frame < NumFrames; frame++) {
+        EXPECT_EQ(history[frame].frameNumber, frame);
+        EXPECT_GE(history[frame].time - history[frame - 1].time, 1ms);
+    }
+
+    // Halfway between two packets, we should be halfway between their positions
+    Pose3<millimeter_t, units::angle::radian_t> pose;
+    const auto midTime = history[3].time + (history[4].time - history[3].time) / 2;
+    ASSERT_TRUE(client.getPoseAt(robot, midTime, pose));
+    EXPECT_NEAR(pose.x().value(), 3.5, 0.01);
+
+    std::array<units::velocity::meters_per_second_t, 3> velocity;
+    std::array<units::angular_velocity::radians_per_second_t, 3> angularVelocity;
+    ASSERT_TRUE(client.getVelocity(robot, velocity, angularVelocity, 1s));
+    EXPECT_TRUE(std::isfinite(velocity[0].value()));
+    EXPECT_GT(velocity[0].value(), 0.0);
+}
+#endif // !_WIN32
@@ -4,6 +4,7 @@
 #include "common/path.h"
 #include "common/pose.h"
 #include "antworld/agent.h"
+#include "antworld/batch_renderer.h"
 #include "antworld/common.h"
 #include "antworld/renderer.h"
 #include "antworld/route_continuous.h"
@@ -65,19 +66,24 @@ protected:
     template<typename PoseVectorType, typename RecordOp>
     void run(const PoseVectorType &poses, RecordOp record)
     {
-        // Host OpenCV array to hold pixels read from screen
-        cv::Mat frame(RenderSize, CV_8UC3);
+        // Render views in batches rather than waiting for each one to be read back from the screen
+        auto &batchRenderer = m_Agent.getBatchRenderer();
 
-        for (auto it = poses.cbegin(); m_Window.isOpen() && it < poses.cend(); ++it) {
-            // Update agent's position
-            m_Agent.setPosition(it->x(), it->y(), AgentHeight);
-            m_Agent.setAttitude(it->yaw(), 0_deg, 0_deg);
-
-            // Get current view
-            m_Agent.readFrameSync(frame);
+        std::vector<AntWorld::BatchRenderer::Pose> agentPoses;
+        agentPoses.reserve(poses.size());
+        for (const auto &pose : poses) {
+            agentPoses.push_back({ { pose.x(), pose.y(), AgentHeight }, { pose.yaw(), 0_deg, 0_deg } });
+        }
 
-            // Write to image database
-            record(frame);
+        // Render a few batches at a time, so we can stop if the window is closed
+        const size_t chunkSize = 8 * batchRenderer.getFramesPerBatch();
+        for (size_t first = 0; m_Window.isOpen() && first < agentPoses.size(); first += chunkSize) {
+            const auto last = agentPoses.cbegin() + std::min(first + chunkSize, agentPoses.size());
+            const std::vector<AntWorld::BatchRenderer::Pose> chunk(agentPoses.cbegin() + first, last);
+            batchRenderer.renderPanoramicViews(chunk, [&](size_t i, const cv::Mat &frame) {
+                // Write to image database
+                record(agentPoses[first + i], frame);
+            });
         }
     }
 
@@ -114,7 +120,7 @@ public:
         addMetadata(gridRecorder);
 
         // Record image database
-        run(gridRecorder.getPositions(), [&gridRecorder](const cv::Mat &image) { gridRecorder.record(image); });
+        run(gridRecorder.getPositions(), [&gridRecorder](const auto &, const cv::Mat &image) { gridRecorder.record(image); });
     }
 };
 
@@ -141,9 +147,8 @@ public:
         auto routeRecorder = m_Database.getRouteRecorder();
         addMetadata(routeRecorder);
 
-        run(poses, [&routeRecorder, this](const cv::Mat &image) {
-            const auto pos = m_Agent.getPose().position();
-            routeRecorder.record({pos[0], pos[1], pos[2]}, m_Agent.getPose().attitude()[0], image);
+        run(poses, [&routeRecorder](const auto &pose, const cv::Mat &image) {
+            routeRecorder.record({ pose.x(), pose.y(), pose.z() }, pose.yaw(), image);
         });
     }
 
@@ -0,0 +1,18 @@
+// BoB robotics includes
+#include "navigation/image_database.h"
+
+// Standard C++ includes
+#include <string>
+
+using namespace BoBRobotics;
+
+int
+main(int argc, char **argv)
+{
+    // We must have a path + an optional "--compress" flag
+    BOB_ASSERT(argc == 2 || (argc == 3 && std::string(argv[2]) == "--compress"));
+
+    // Pack image database into a single file, optionally storing images as PNGs
+    const Navigation::ImageDatabase database(argv[1]);
+    database.pack(database.getName() + ".imdb", argc == 3);
+}
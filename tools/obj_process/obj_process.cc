@@ -1,41 +1,47 @@
 // BoB robotics includes
+#include "antworld/obj_parsing.h"
+#include "antworld/world_cache.h"
+#include "antworld/world_data.h"
 #include "common/logging.h"
 #include "common/macros.h"
+#include "common/memory_mapped_file.h"
+#include "common/thread_pool.h"
 #include "third_party/path.h"
 
+// Standard C includes
+#include <cstring>
+
 // Standard C++ includes
 #include <algorithm>
+#include <array>
 #include <fstream>
+#include <limits>
+#include <iterator>
 #include <map>
-#include <sstream>
 #include <vector>
 
-#ifdef __GNUC__
-#include <fcntl.h>
-#include <ext/stdio_filebuf.h>
-#endif
-
 //----------------------------------------------------------------------------
 // Anonymous namespace
 //----------------------------------------------------------------------------
 namespace
 {
+using namespace BoBRobotics::AntWorld;
+
 template<unsigned int N>
-void readVector(std::istringstream &stream, float(&vector)[N])
+void readVector(const char *text, const char *end, float(&vector)[N])
 {
-    // Read components and push back
-    float x;
+    // Read components
     for(unsigned int i = 0; i < N; i++) {
-        stream >> x;
-        vector[i] = x;
+        text = ObjParsing::parseFloat(text, end, vector[i]);
+        BOB_ASSERT(text != nullptr);
     }
 }
 
-bool getRemappedIndex(const std::map<int, int> &indices, const std::string &indexString,
+bool getRemappedIndex(const std::map<int, int> &indices, long originalIndex,
                       std::vector<int> &remappedIndices)
 {
     // If index isn't found, return false
-    const auto index = indices.find(stoi(indexString));
+    const auto index = indices.find((int)originalIndex);
     if (index == indices.cend()) {
         return false;
     }
@@ -46,48 +52,86 @@ bool getRemappedIndex(const std::map<int, int> &indices, const std::string &inde
     }
 }
 
-void findBounds(std::istream &inputObjFile)
+// Read the indices of a face vertex i.e. P/T[/N], setting normal to zero if there isn't one
+// **NOTE** obj indices start from 1
+const char *readFaceVertex(const char *text, const char *end, long &position, long &texCoord, long &normal)
+{
+    text = ObjParsing::parseInt(text, end, position);
+    BOB_ASSERT(text != nullptr && text < end && *text == '/');
+    text = ObjParsing::parseInt(text + 1, end, texCoord);
+    BOB_ASSERT(text != nullptr);
+
+    normal = 0;
+    if (text < end && *text == '/') {
+        text = ObjParsing::parseInt(text + 1, end, normal);
+        BOB_ASSERT(text != nullptr);
+    }
+    return text;
+}
+
+void writeLine(std::ofstream &outputObjFile, const char *line, const char *lineEnd)
+{
+    outputObjFile.write(line, lineEnd - line);
+    outputObjFile << '\n';
+}
+
+void findBounds(const char *objFilename)
 {
-    // Initialise bounds
+    LOGI << "1/1 - Finding bounds:";
+
+    // Map obj file into memory and split it into chunks of lines
+    const BoBRobotics::MemoryMappedFile objFile(objFilename);
+    const char *objText = reinterpret_cast<const char*>(objFile.data());
+    BoBRobotics::ThreadPool threadPool;
+    const auto chunks = ObjParsing::splitLines(objText, objText + objFile.size(), threadPool.getNumThreads());
+
+    // Initialise bounds of each chunk
+    std::vector<std::array<float, 6>> chunkBounds(chunks.size());
+    for(auto &bounds : chunkBounds) {
+        std::fill_n(bounds.begin(), 3, std::numeric_limits<float>::max());
+        std::fill_n(bounds.begin() + 3, 3, std::numeric_limits<float>::lowest());
+    }
+
+    // Find bounds of the positions in each chunk in parallel
+    threadPool.parallelFor(chunks.size(),
+                           [&chunks, &chunkBounds](size_t, size_t begin, size_t end)
+                           {
+                               ObjParsing::TextRange command;
+                               for(size_t c = begin; c < end; c++) {
+                                   auto &bounds = chunkBounds[c];
+                                   ObjParsing::forEachLine(chunks[c].first, chunks[c].second,
+                                                           [&bounds, &command](const char *line, const char *lineEnd)
+                                                           {
+                                                               // If line is a position
+                                                               const char *p = ObjParsing::readToken(line, lineEnd, command);
+                                                               if(ObjParsing::tokenEquals(command, "v")) {
+                                                                   // Read position
+                                                                   float position[3];
+                                                                   readVector(p, lineEnd, position);
+
+                                                                   // Update bounds
+                                                                   for(unsigned int i = 0; i < 3; i++) {
+                                                                       bounds[i] = std::min(bounds[i], position[i]);
+                                                                       bounds[i + 3] = std::max(bounds[i + 3], position[i]);
+                                                                   }
+                                                               }
+                                                           });
+                               }
+                           });
+
+    // Combine bounds of chunks
     float minBound[3]{
         std::numeric_limits<float>::max(),
         std::numeric_limits<float>::max(),
         std::numeric_limits<float>::max() };
     float maxBound[3]{
-        std::numeric_limits<float>::min(),
-        std::numeric_limits<float>::min(),
-        std::numeric_limits<float>::min() };
-
-    LOGI << "1/1 - Finding bounds:";
-    std::string lineString;
-    std::string commandString;
-    for(size_t l = 0; std::getline(inputObjFile, lineString); l++) {
-        // Entirely skip comment or empty lines
-        if (lineString[0] == '#' || lineString.empty()) {
-            continue;
-        }
-
-        // Wrap line in stream for easier parsing
-        std::istringstream lineStream(lineString);
-
-        // Read command from first token
-        lineStream >> commandString;
-
-        // If line is a position
-        if (commandString == "v") {
-            // Read position
-            float position[3];
-            readVector(lineStream, position);
-
-            // Update bounds
-            for (unsigned int i = 0; i < 3; i++) {
-                minBound[i] = std::min(minBound[i], position[i]);
-                maxBound[i] = std::max(maxBound[i], position[i]);
-            }
-        }
-        // Otherwise, if we've hit the faces section there should be no more vertices so break;
-        else if(commandString == "f") {
-            break;
+        std::numeric_limits<float>::lowest(),
+        std::numeric_limits<float>::lowest(),
+        std::numeric_limits<float>::lowest() };
+    for(const auto &bounds : chunkBounds) {
+        for(unsigned int i = 0; i < 3; i++) {
+            minBound[i] = std::min(minBound[i], bounds[i]);
+            maxBound[i] = std::max(maxBound[i], bounds[i + 3]);
         }
     }
 
@@ -96,146 +140,143 @@ void findBounds(std::istream &inputObjFile)
 }
 
 void copyPositions(const float(&min)[3], const float(&max)[3],
-                   std::istream &inputObjFile, std::ofstream &outputObjFile,
+                   const char *objText, const char *objEnd, std::ofstream &outputObjFile,
                    std::map<int, int> &positionIndices)
 {
     LOGI << "1/3 - Copy positions:";
-    std::string lineString;
-    std::string commandString;
+    ObjParsing::TextRange command;
     int originalPositionID = 1;
     int remappedPositionID = 1;
-    while (std::getline(inputObjFile, lineString)) {
-        // Entirely skip comment or empty lines
-        if (lineString[0] == '#' || lineString.empty()) {
-            continue;
-        }
-
-        // Wrap line in stream for easier parsing
-        std::istringstream lineStream(lineString);
-
-        // Read command from first token
-        lineStream >> commandString;
-
-        // If line is a position
-        if (commandString == "v") {
-            // Read position
-            float position[3];
-            readVector(lineStream, position);
-
-            // If position is within bounds
-            if (position[0] >= min[0] && position[1] >= min[1] && position[2] >= min[2] &&
-                position[0] < max[0] && position[1] < max[1] && position[2] < max[2])
-            {
-                // Copy vertex to output file
-                outputObjFile << lineString << std::endl;
-
-                // Add mapping between original adn remapped ID to map
-                positionIndices.insert(std::make_pair(originalPositionID, remappedPositionID));
-
-                // Incrememnt remapped vertex ID
-                remappedPositionID++;
-            }
-
-            // Remap original vertex ID
-            originalPositionID++;
-        }
-        else if (commandString == "mtllib" || commandString == "o") {
-            outputObjFile << lineString << std::endl;
-        }
-        // Otherwise, if we've hit the faces section there should be no more vertices so break;
-        else if(commandString == "f") {
-            break;
-        }
-    }
-
+    bool reachedFaces = false;
+    ObjParsing::forEachLine(objText, objEnd,
+                            [&](const char *line, const char *lineEnd)
+                            {
+                                // Once we've hit the faces section there should be no more vertices
+                                if (reachedFaces) {
+                                    return;
+                                }
+
+                                // Read command from first token, skipping comment or empty lines
+                                const char *p = ObjParsing::readToken(line, lineEnd, command);
+                                if (command.first == command.second || *command.first == '#') {
+                                    return;
+                                }
+
+                                // If line is a position
+                                if (ObjParsing::tokenEquals(command, "v")) {
+                                    // Read position
+                                    float position[3];
+                                    readVector(p, lineEnd, position);
+
+                                    // If position is within bounds
+                                    if (position[0] >= min[0] && position[1] >= min[1] && position[2] >= min[2] &&
+                                        position[0] < max[0] && position[1] < max[1] && position[2] < max[2])
+                                    {
+                                        // Copy vertex to output file
+                                        writeLine(outputObjFile, line, lineEnd);
+
+                                        // Add mapping between original and remapped ID to map
+                                        positionIndices.insert(std::make_pair(originalPositionID, remappedPositionID));
+
+                                        // Incrememnt remapped vertex ID
+                                        remappedPositionID++;
+                                    }
+
+                                    // Remap original vertex ID
+                                    originalPositionID++;
+                                }
+                                else if (ObjParsing::tokenEquals(command, "mtllib") || ObjParsing::tokenEquals(command, "o")) {
+                                    writeLine(outputObjFile, line, lineEnd);
+                                }
+                                else if (ObjParsing::tokenEquals(command, "f")) {
+                                    reachedFaces = true;
+                                }
+                            });
 
     LOGI << "\t" << remappedPositionID - 1 << "/" << originalPositionID - 1 << " vertices";
 }
 
-void findFaces(std::istream &inputObjFile,
+void findFaces(const char *objText, const char *objEnd, BoBRobotics::ThreadPool &threadPool,
                const std::map<int, int> &positionIndices,
                std::map<int, int> &texCoordIndices, std::map<int, int> &normalIndices)
 {
     LOGI << "2/3 - Reading faces to find tex coords and normals:";
-    std::string lineString;
-    std::string commandString;
-    std::string faceIndexString;
-    std::string indexString;
-    std::vector<int> facePositionIndices;
-    std::vector<int> faceTexCoordIndices;
-    std::vector<int> faceNormalIndices;
+
+    // Faces don't depend on each other so, for each chunk of lines in parallel,
+    // find the tex coords and normals used by faces within bounds
+    struct ChunkFaces
+    {
+        std::vector<int> texCoords, normals;
+        int totalFaces = 0, facesInBounds = 0;
+    };
+    const auto chunks = ObjParsing::splitLines(objText, objEnd, threadPool.getNumThreads());
+    std::vector<ChunkFaces> chunkFaces(chunks.size());
+    threadPool.parallelFor(chunks.size(),
+                           [&](size_t, size_t begin, size_t end)
+                           {
+                               ObjParsing::TextRange command;
+                               std::vector<int> faceTexCoordIndices;
+                               std::vector<int> faceNormalIndices;
+                               for(size_t c = begin; c < end; c++) {
+                                   auto &faces = chunkFaces[c];
+                                   ObjParsing::forEachLine(chunks[c].first, chunks[c].second,
+                                                           [&](const char *line, const char *lineEnd)
+                                                           {
+                                                               const char *p = ObjParsing::readToken(line, lineEnd, command);
+                                                               if (!ObjParsing::tokenEquals(command, "f")) {
+                                                                   return;
+                                                               }
+
+                                                               // Read indices i.e. P/T[/N], checking all of the positions are included in the map
+                                                               faceTexCoordIndices.clear();
+                                                               faceNormalIndices.clear();
+                                                               bool inBounds = true;
+                                                               long position, texCoord, normal;
+                                                               while ((p = ObjParsing::skipWhitespace(p, lineEnd)) < lineEnd) {
+                                                                   p = readFaceVertex(p, lineEnd, position, texCoord, normal);
+                                                                   inBounds &= (positionIndices.find((int)position) != positionIndices.cend());
+                                                                   faceTexCoordIndices.push_back((int)texCoord);
+                                                                   if (normal != 0) {
+                                                                       faceNormalIndices.push_back((int)normal);
+                                                                   }
+                                                               }
+
+                                                               // If face is within bounds, add its tex coords and normals
+                                                               if (inBounds) {
+                                                                   faces.texCoords.insert(faces.texCoords.end(), faceTexCoordIndices.cbegin(), faceTexCoordIndices.cend());
+                                                                   faces.normals.insert(faces.normals.end(), faceNormalIndices.cbegin(), faceNormalIndices.cend());
+                                                                   faces.facesInBounds++;
+                                                               }
+                                                               faces.totalFaces++;
+                                                           });
+                               }
+                           });
+
+    // Add indices of texture coordinates and normals from each chunk to maps
+    // **NOTE** at this point, remapped ids are zero to be filled during next pass
     int totalFaces = 0;
     int facesInBounds = 0;
-    while (std::getline(inputObjFile, lineString)) {
-        // Entirely skip comment or empty lines
-        if (lineString[0] == '#' || lineString.empty()) {
-            continue;
-        }
-
-        // Wrap line in stream for easier parsing
-        std::istringstream lineStream(lineString);
-
-        // Read command from first token
-        lineStream >> commandString;
-
-        if (commandString == "f") {
-            // Read indices i.e. P/T[/N] into string
-            facePositionIndices.clear();
-            faceTexCoordIndices.clear();
-            faceNormalIndices.clear();
-            while(lineStream >> faceIndexString) {
-                // Convert into stream for processing
-                std::istringstream faceIndexStream(faceIndexString);
-
-                // Extract indices of position, tex coordinate and normal
-                // **NOTE** obj indices start from 1
-                std::getline(faceIndexStream, indexString, '/');
-                facePositionIndices.push_back(stoi(indexString));
-                std::getline(faceIndexStream, indexString, '/');
-                faceTexCoordIndices.push_back(stoi(indexString));
-                if(std::getline(faceIndexStream, indexString, '/')) {
-                    faceNormalIndices.push_back(stoi(indexString));
-                }
-            }
-
-            // If all of the face position indices are included in the map
-            if (std::all_of(facePositionIndices.cbegin(), facePositionIndices.cend(),
-                [&positionIndices](int pos){ return (positionIndices.find(pos) != positionIndices.cend()); }))
-            {
-                // Add indices of texture coordinates to maps
-                // **NOTE** at this point, remapped ids are zero to be filled during next pass
-                std::transform(faceTexCoordIndices.cbegin(), faceTexCoordIndices.cend(), std::inserter(texCoordIndices, texCoordIndices.end()),
-                               [](int id){ return std::make_pair(id, 0); });
-
-                // If any face normals were found, add indices of normals to maps
-                // **NOTE** at this point, remapped ids are zero to be filled during next pass
-                if(!faceNormalIndices.empty()) {
-                    std::transform(faceNormalIndices.cbegin(), faceNormalIndices.cend(), std::inserter(normalIndices, normalIndices.end()),
-                                [](int id){ return std::make_pair(id, 0); });
-                }
-
-                // Increment number of faces in bounds
-                facesInBounds++;
-            }
-
-            // Increment face count
-            totalFaces++;
-        }
+    for (const auto &faces : chunkFaces) {
+        std::transform(faces.texCoords.cbegin(), faces.texCoords.cend(), std::inserter(texCoordIndices, texCoordIndices.end()),
+                       [](int id){ return std::make_pair(id, 0); });
+        std::transform(faces.normals.cbegin(), faces.normals.cend(), std::inserter(normalIndices, normalIndices.end()),
+                       [](int id){ return std::make_pair(id, 0); });
+        totalFaces += faces.totalFaces;
+        facesInBounds += faces.facesInBounds;
     }
+
     LOGI << "\t" << facesInBounds << "/" << totalFaces << " faces";
     LOGI << "\t" << texCoordIndices.size() << " tex coords";
     LOGI << "\t" << normalIndices.size() << " normals";
 }
 
-void completeCopy(std::istream &inputObjFile, std::ofstream &outputObjFile,
+void completeCopy(const char *objText, const char *objEnd, std::ofstream &outputObjFile,
                   const std::map<int, int> &positionIndices,
                   std::map<int, int> &texCoordIndices, std::map<int, int> &normalIndices)
 {
     LOGI << "3/3 - Copying remaining geometry:";
-    std::string lineString;
-    std::string commandString;
-    std::string faceIndexString;
-    std::string indexString;
+    ObjParsing::TextRange command;
+    ObjParsing::TextRange index;
     int originalTexCoordID = 1;
     int originalNormalID = 1;
     int remappedTexCoordID = 1;
@@ -243,151 +284,132 @@ void completeCopy(std::istream &inputObjFile, std::ofstream &outputObjFile,
     std::vector<int> facePositionIndices;
     std::vector<int> faceTexCoordIndices;
     std::vector<int> faceNormalIndices;
-    while (std::getline(inputObjFile, lineString)) {
-        // Entirely skip comment or empty lines
-        if (lineString[0] == '#' || lineString.empty()) {
-            continue;
-        }
-
-        // Wrap line in stream for easier parsing
-        std::istringstream lineStream(lineString);
-
-        // Read command from first token
-        lineStream >> commandString;
-
-        // If line is a texture coordinate
-        if (commandString == "vt") {
-            // If texture coord should be includes
-            auto texCoord = texCoordIndices.find(originalTexCoordID);
-            if (texCoord != texCoordIndices.cend()) {
-                // Update mapping with new texture coord id
-                texCoord->second = remappedTexCoordID;
-
-                // Write texture coord to output
-                outputObjFile << lineString << std::endl;
+    ObjParsing::forEachLine(objText, objEnd,
+                            [&](const char *line, const char *lineEnd)
+                            {
+                                // Read command from first token, skipping comment or empty lines
+                                const char *p = ObjParsing::readToken(line, lineEnd, command);
+                                if (command.first == command.second || *command.first == '#') {
+                                    return;
+                                }
+
+                                // If line is a texture coordinate
+                                if (ObjParsing::tokenEquals(command, "vt")) {
+                                    // If texture coord should be includes
+                                    auto texCoord = texCoordIndices.find(originalTexCoordID);
+                                    if (texCoord != texCoordIndices.cend()) {
+                                        // Update mapping with new texture coord id
+                                        texCoord->second = remappedTexCoordID;
+
+                                        // Write texture coord to output
+                                        writeLine(outputObjFile, line, lineEnd);
+
+                                        // Increment remapped texture coord id
+                                        remappedTexCoordID++;
+                                    }
+
+                                    // Increment original texture coord id
+                                    originalTexCoordID++;
+                                }
+                                // Otherwise, if line is a vertex normal
+                                else if (ObjParsing::tokenEquals(command, "vn")) {
+                                    // If normal should be includes
+                                    auto normal = normalIndices.find(originalNormalID);
+                                    if (normal != normalIndices.cend()) {
+                                        // Update mapping with new normal id
+                                        normal->second = remappedNormalID;
+
+                                        // Write normal to output
+                                        writeLine(outputObjFile, line, lineEnd);
+
+                                        // Increment remapped normal id
+                                        remappedNormalID++;
+                                    }
+
+                                    // Increment original normal id
+                                    originalNormalID++;
+                                }
+                                // Otherwise, if line is a face
+                                else if (ObjParsing::tokenEquals(command, "f")) {
+                                    // Read indices i.e. P/T[/N] and remap them
+                                    facePositionIndices.clear();
+                                    faceTexCoordIndices.clear();
+                                    faceNormalIndices.clear();
+                                    long position, texCoord, normal;
+                                    while ((p = ObjParsing::skipWhitespace(p, lineEnd)) < lineEnd) {
+                                        p = readFaceVertex(p, lineEnd, position, texCoord, normal);
+                                        if (!getRemappedIndex(positionIndices, position, facePositionIndices)
+                                            || !getRemappedIndex(texCoordIndices, texCoord, faceTexCoordIndices)
+                                            || (normal != 0 && !getRemappedIndex(normalIndices, normal, faceNormalIndices)))
+                                        {
+                                            return;
+                                        }
+                                    }
+
+                                    // Check all sizes match
+                                    BOB_ASSERT(facePositionIndices.size() == faceTexCoordIndices.size());
+                                    BOB_ASSERT(faceNormalIndices.empty() || faceTexCoordIndices.size() == faceNormalIndices.size());
+
+                                    // Write new face
+                                    outputObjFile << "f ";
+                                    for(size_t i = 0; i < facePositionIndices.size(); i++) {
+                                        if(faceNormalIndices.empty()) {
+                                            outputObjFile << facePositionIndices[i] << "/" << faceTexCoordIndices[i];
+                                        }
+                                        else {
+                                            outputObjFile << facePositionIndices[i] << "/" << faceTexCoordIndices[i] << "/" << faceNormalIndices[i];
+                                        }
+
+                                        // If this isn't the last face vertex, add whitespace
+                                        if(i != (facePositionIndices.size() - 1)) {
+                                            outputObjFile << " ";
+                                        }
+                                    }
+                                    outputObjFile << '\n';
+                                }
+                                // Otherwise, if this is a line
+                                else if (ObjParsing::tokenEquals(command, "l")) {
+                                    // Read position indices and remap them
+                                    facePositionIndices.clear();
+                                    long position;
+                                    while ((p = ObjParsing::skipWhitespace(p, lineEnd)) < lineEnd) {
+                                        p = ObjParsing::parseInt(p, lineEnd, position);
+                                        BOB_ASSERT(p != nullptr);
+                                        if (!getRemappedIndex(positionIndices, position, facePositionIndices)) {
+                                            return;
+                                        }
+                                    }
+
+                                    // Write new line
+                                    outputObjFile << "l ";
+                                    for(size_t i = 0; i < facePositionIndices.size(); i++) {
+                                        outputObjFile << facePositionIndices[i];
+
+                                        // If this isn't the last line vertex, add whitespace
+                                        if(i != (facePositionIndices.size() - 1)) {
+                                            outputObjFile << " ";
+                                        }
+                                    }
+                                    outputObjFile << '\n';
+                                }
+                                // Otherwise, if command has already been handled by copyPositions, ignore
+                                else if (ObjParsing::tokenEquals(command, "mtllib") || ObjParsing::tokenEquals(command, "o")
+                                         || ObjParsing::tokenEquals(command, "v")) {
+                                }
+                                // Otherwise, copy line directly
+                                else {
+                                    writeLine(outputObjFile, line, lineEnd);
+                                }
+                            });
+}
 
-                // Increment remapped texture coord id
-                remappedTexCoordID++;
-            }
+void writeCache(const filesystem::path &objPath, float scale, int maxTextureSize)
+{
+    LOGI << "1/2 - Loading and indexing world:";
+    const auto world = WorldData::loadObj(objPath, scale, maxTextureSize);
 
-            // Increment original texture coord id
-            originalTexCoordID++;
-        }
-        // Otherwise, if line is a vertex normal
-        else if (commandString == "vn") {
-            // If normal should be includes
-            auto normal = normalIndices.find(originalNormalID);
-            if (normal != normalIndices.cend()) {
-                // Update mapping with new normal id
-                normal->second = remappedNormalID;
-
-                // Write normal to output
-                outputObjFile << lineString << std::endl;
-
-                // Increment remapped normal id
-                remappedNormalID++;
-            }
-
-            // Increment original normal id
-            originalNormalID++;
-        }
-        // Otherwise, if line is a face
-        else if (commandString == "f") {
-            // Read indices i.e. P/T[/N] into string
-            facePositionIndices.clear();
-            faceTexCoordIndices.clear();
-            faceNormalIndices.clear();
-            bool validFace = true;
-            while(lineStream >> faceIndexString) {
-                // Convert into stream for processing
-                std::istringstream faceIndexStream(faceIndexString);
-
-                // Update mapping with remapped position index
-                std::getline(faceIndexStream, indexString, '/');
-                if(!getRemappedIndex(positionIndices, indexString, facePositionIndices)) {
-                    validFace = false;
-                    break;
-                }
-
-                // Update mapping with remapped texture coordinate index
-                std::getline(faceIndexStream, indexString, '/');
-                if(!getRemappedIndex(texCoordIndices, indexString, faceTexCoordIndices)) {
-                    validFace = false;
-                    break;
-                }
-
-                // If normals are present, update mapping with remapped normal index
-                if(std::getline(faceIndexStream, indexString, '/')) {
-                    if(!getRemappedIndex(normalIndices, indexString, faceNormalIndices)) {
-                        validFace = false;
-                        break;
-                    }
-                }
-            }
-
-            // If a valid face has been parsed
-            if(validFace) {
-                // Check all sizes match
-                BOB_ASSERT(facePositionIndices.size() == faceTexCoordIndices.size());
-                BOB_ASSERT(faceNormalIndices.empty() || faceTexCoordIndices.size() == faceNormalIndices.size());
-
-                // Write new face
-                outputObjFile << "f ";
-                for(size_t i = 0; i < facePositionIndices.size(); i++) {
-                    if(faceNormalIndices.empty()) {
-                        outputObjFile << facePositionIndices[i] << "/" << faceTexCoordIndices[i];
-                    }
-                    else {
-                        outputObjFile << facePositionIndices[i] << "/" << faceTexCoordIndices[i] << "/" << faceNormalIndices[i];
-                    }
-
-                    // If this isn't the last face vertex, add whitespace
-                    if(i != (facePositionIndices.size() - 1)) {
-                        outputObjFile << " ";
-                    }
-                }
-
-                outputObjFile << std::endl;
-            }
-        }
-        // Otherwise, if this is a line
-        else if(commandString == "l") {
-            facePositionIndices.clear();
-            bool validLine = true;
-            do {
-                // Read index into string
-                lineStream >> faceIndexString;
-
-                // Add remapped position index to vector
-                if(!getRemappedIndex(positionIndices, faceIndexString, facePositionIndices)) {
-                    validLine = false;
-                    break;
-                }
-            } while (!lineStream.eof());
-
-            // If a valid line has been parsed
-            if(validLine) {
-                 // Write new line
-                outputObjFile << "l ";
-                for(size_t i = 0; i < facePositionIndices.size(); i++) {
-                    outputObjFile << facePositionIndices[i];
-
-                    // If this isn't the last line vertex, add whitespace
-                    if(i != (facePositionIndices.size() - 1)) {
-                        outputObjFile << " ";
-                    }
-                }
-                outputObjFile << std::endl;
-            }
-        }
-        // Otherwise, if command has already been handled by copyPositions, ignore
-        else if (commandString == "mtllib" || commandString == "o" || commandString == "v") {
-        }
-        // Otherwise, copy line directly
-        else {
-            outputObjFile << lineString << std::endl;
-        }
-    }
+    LOGI << "2/2 - Writing world cache:";
+    WorldCache::write(WorldCache::getPath(objPath), world, objPath, scale, maxTextureSize);
 }
 }   // Anonymous namespace
 
@@ -398,77 +420,58 @@ int main(int argc, char **argv)
         LOGF << "At least one argument (object filename) required";
         return EXIT_FAILURE;
     }
-    else {
-#ifdef __GNUC__
-        // Open file using POSIX API
-        int fd = open(argv[1], O_RDONLY);
-        if(fd == -1) {
-            LOGF << "Cannot open obj file: " << argv[1];
+    // If requested, write cache for World::loadObj to use
+    else if(strcmp(argv[1], "--cache") == 0) {
+        if(argc < 3 || argc > 5) {
+            LOGF << "--cache requires object filename and optional scale and max texture size arguments";
             return EXIT_FAILURE;
         }
 
-        // Advise the kernel of our access pattern.
-        // https://stackoverflow.com/questions/17925051/fast-textfile-reading-in-c
-        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
-
-        // **HACK** apply terrifying GCC hack to build a std::istream from a POSIX handle
-        // https://stackoverflow.com/questions/2746168/how-to-construct-a-c-fstream-from-a-posix-file-descriptor
-        __gnu_cxx::stdio_filebuf<char> filebuf(fd, std::ios::in);
-        std::istream inputObjFile(&filebuf);
-#else
-         // Open obj file
-        std::ifstream inputObjFile(argv[1]);
-#endif
-        if(!inputObjFile.good()) {
-            LOGF << "Cannot open obj file: " << argv[1];
-            return EXIT_FAILURE;
-        }
-
-        // If only one argument is passed, find bounds of model
-        if(argc == 2) {
-            findBounds(inputObjFile);
-            return EXIT_SUCCESS;
-        }
-        // Otherwise
-        else if(argc == 8) {
-            // Create an output path for object
-            const auto inputPath = filesystem::path(argv[1]).make_absolute();
-            const auto outputPath = inputPath.parent_path() / ("output_" + inputPath.filename());
-
-            // Open output file
-            std::ofstream outputObjFile(outputPath.str());
-
-            // Parse bounds
-            const float min[3]{ strtof(argv[2], nullptr), strtof(argv[3], nullptr), strtof(argv[4], nullptr) };
-            const float max[3]{ strtof(argv[5], nullptr), strtof(argv[6], nullptr), strtof(argv[7], nullptr) };
-
-            // Copy positions withing bounds to output file
-            std::map<int, int> positionIndices;
-            copyPositions(min, max, inputObjFile, outputObjFile,
-                        positionIndices);
-
-            // Rewind
-            inputObjFile.clear();
-            inputObjFile.seekg(0);
-
-            // Find the faces required for these vertices
-            std::map<int, int> texCoordIndices;
-            std::map<int, int> normalIndices;
-            findFaces(inputObjFile, positionIndices,
-                    texCoordIndices, normalIndices);
-
-            // Rewind
-            inputObjFile.clear();
-            inputObjFile.seekg(0);
-
-            // Complete copy of geometry to output file
-            completeCopy(inputObjFile, outputObjFile,
-                        positionIndices, texCoordIndices, normalIndices);
-            return EXIT_SUCCESS;
-        }
-        else {
-            LOGF << "Object filename, minX, minY, minZ, maxX, maxY, maxZ arguments required";
-            return EXIT_FAILURE;
-        }
+        writeCache(argv[2], (argc > 3) ? strtof(argv[3], nullptr) : 1.0f,
+                   (argc > 4) ? atoi(argv[4]) : -1);
+        return EXIT_SUCCESS;
+    }
+    // If only one argument is passed, find bounds of model
+    else if(argc == 2) {
+        findBounds(argv[1]);
+        return EXIT_SUCCESS;
+    }
+    else if(argc == 8) {
+        // Map obj file into memory
+        const BoBRobotics::MemoryMappedFile objFile(argv[1]);
+        const char *objText = reinterpret_cast<const char*>(objFile.data());
+        const char *objEnd = objText + objFile.size();
+
+        // Create an output path for object
+        const auto inputPath = filesystem::path(argv[1]).make_absolute();
+        const auto outputPath = inputPath.parent_path() / ("output_" + inputPath.filename());
+
+        // Open output file
+        std::ofstream outputObjFile(outputPath.str());
+
+        // Parse bounds
+        const float min[3]{ strtof(argv[2], nullptr), strtof(argv[3], nullptr), strtof(argv[4], nullptr) };
+        const float max[3]{ strtof(argv[5], nullptr), strtof(argv[6], nullptr), strtof(argv[7], nullptr) };
+
+        // Copy positions withing bounds to output file
+        std::map<int, int> positionIndices;
+        copyPositions(min, max, objText, objEnd, outputObjFile,
+                      positionIndices);
+
+        // Find the faces required for these vertices
+        BoBRobotics::ThreadPool threadPool;
+        std::map<int, int> texCoordIndices;
+        std::map<int, int> normalIndices;
+        findFaces(objText, objEnd, threadPool, positionIndices,
+                  texCoordIndices, normalIndices);
+
+        // Complete copy of geometry to output file
+        completeCopy(objText, objEnd, outputObjFile,
+                     positionIndices, texCoordIndices, normalIndices);
+        return EXIT_SUCCESS;
+    }
+    else {
+        LOGF << "Object filename, minX, minY, minZ, maxX, maxY, maxZ arguments required";
+        return EXIT_FAILURE;
     }
 }